@@ -56,6 +56,23 @@ struct comdb2_appsock {
 };
 typedef struct comdb2_appsock comdb2_appsock_t;
 
+/*
+  Invoked on an appsock pool thread once a parked connection becomes readable
+  (ready = 1), or when the peer hangs up or the connection stays idle past its
+  timeout (ready = 0). The callback owns the connection again and is
+  responsible for closing it.
+*/
+typedef void appsock_resume_fn(struct thr_handle *thr_self, SBUF2 *sb,
+                               void *arg, int ready);
+
+/*
+  Hand an idle connection over to the appsock poller so that it does not hold
+  an appsock thread while waiting for the next request. Returns 0 if the
+  connection was parked; the caller must not touch sb or arg afterwards.
+*/
+int appsock_park(SBUF2 *sb, int idle_timeout_sec, appsock_resume_fn *fn,
+                 void *arg);
+
 #define APPSOCK_PLUGIN_DESC(X)                                                 \
     comdb2_appsock_t X##_plugin = {                                            \
         #X,                  /* Name */                                        \
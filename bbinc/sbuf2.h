@@ -138,6 +138,11 @@ sbuf2readfn SBUF2_FUNC(sbuf2getr)(SBUF2 *sb);
 sbuf2writefn SBUF2_FUNC(sbuf2getw)(SBUF2 *sb);
 #define sbuf2getw SBUF2_FUNC(sbuf2getw)
 
+/* number of bytes that can be read without touching the underlying fd.
+   includes ungetc'd characters and bytes pending in the SSL layer. */
+int SBUF2_FUNC(sbuf2rpending)(SBUF2 *sb);
+#define sbuf2rpending SBUF2_FUNC(sbuf2rpending)
+
 /* set up poll timeout on file descriptor*/
 void SBUF2_FUNC(sbuf2settimeout)(SBUF2 *sb, int readtimeout, int writetimeout);
 #define sbuf2settimeout SBUF2_FUNC(sbuf2settimeout)
@@ -246,6 +246,13 @@ DEF_ATTR(TEMPTABLE_MEM_THRESHOLD, temptable_mem_threshold, QUANTITY, 512,
 DEF_ATTR(TEMPTABLE_CACHESZ, temptable_cachesz, BYTES, 262144,
          "Cache size for temporary tables. Temp tables do not share the "
          "database's main buffer pool.")
+DEF_ATTR(TEMPTABLE_MEM_BYTES, temptable_mem_bytes, BYTES, 1048576,
+         "Keep ordered temp tables in memory until they use more than this "
+         "many bytes, then move them to disk-backed tables. 0 puts them on "
+         "disk from the start.")
+DEF_ATTR(TEMPTABLE_MEM_TOTAL, temptable_mem_total, BYTES, 268435456,
+         "Move in-memory ordered temp tables to disk as they grow once all of "
+         "them together use more than this many bytes. 0 for no limit.")
 DEF_ATTR(PARTICIPANTID_BITS, participantid_bits, QUANTITY, 0,
          "Number of bits allocated for the participant stripe ID (remaining "
          "bits are used for the update ID).")
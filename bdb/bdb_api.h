@@ -133,6 +133,10 @@ struct bdb_queue_stats {
 
     unsigned n_logical_gets;
     unsigned n_physical_gets;
+
+    /* batched gets, and the items they read */
+    unsigned n_batch_gets;
+    unsigned n_batch_items_got;
 };
 
 /* This is identical to bb_berkdb_thread_stats in db.h */
@@ -847,6 +851,9 @@ int bdb_lite_exact_fetch_alloc(bdb_state_type *bdb_handle, void *key,
 int bdb_lite_exact_fetch_tran(bdb_state_type *bdb_state, tran_type *tran,
                               void *key, void *fnddta, int maxlen, int *fndlen,
                               int *bdberr);
+int bdb_lite_exact_fetch_rmw(bdb_state_type *bdb_state, tran_type *tran,
+                             void *key, void *fnddta, int maxlen, int *fndlen,
+                             int *bdberr);
 int bdb_lite_exact_var_fetch(bdb_state_type *bdb_handle, void *key,
                              void **fnddta, int *fndlen, int *bdberr);
 int bdb_lite_exact_var_fetch_tran(bdb_state_type *bdb_state, tran_type *tran,
@@ -874,6 +881,11 @@ int bdb_lite_fetch_partial_tran(bdb_state_type *bdb_state, tran_type *tran,
 
 enum { BDBQUEUE_MAX_CONSUMERS = 32 };
 
+/* A partitioned queuedb keeps partition p in consumer slot p; the partition
+ * is also stored in the stripe bits of each item's genid, so items can be
+ * consumed by genid alone. */
+enum { BDBQUEUE_MAX_PARTITIONS = 16 };
+
 /* 16 byte pointer to an item in an ondisk queue. */
 struct bdb_queue_cursor {
     bbuint32_t genid[2]; /* genid of item */
@@ -889,6 +901,12 @@ int bdb_queue_consumer(bdb_state_type *bdb_state, int consumer, int active,
 int bdb_queue_add(bdb_state_type *bdb_state, tran_type *tran, const void *dta,
                   size_t dtalen, int *bdberr, unsigned long long *out_genid);
 
+/* add an item to one partition of a partitioned queue.  Unlike
+ * bdb_queue_add, the item is seen by the consumer of that partition only. */
+int bdb_queue_add_partition(bdb_state_type *bdb_state, tran_type *tran,
+                            const void *dta, size_t dtalen, int partition,
+                            int *bdberr, unsigned long long *out_genid);
+
 /* add/consume dummy records to aid extent reclaimation.  winner of the
  * May 2006 "Most Absurd Hack" award. */
 int bdb_queue_check_goose(bdb_state_type *bdb_state, tran_type *tran,
@@ -908,6 +926,16 @@ int bdb_queue_get(bdb_state_type *bdb_state, int consumer,
                   struct bdb_queue_cursor *fndcursor, unsigned int *epoch,
                   int *bdberr);
 
+/* Like bdb_queue_get, but read up to max items in one pass.  fnd, fnddtalen
+ * and fnddtaoff are arrays of max entries; *nfound items are returned, each
+ * of which the caller must free.  fndcursor is set to the last item found.
+ * Only queuedb queues support this. */
+int bdb_queue_get_batch(bdb_state_type *bdb_state, int consumer,
+                        const struct bdb_queue_cursor *prevcursor, int max,
+                        void **fnd, size_t *fnddtalen, size_t *fnddtaoff,
+                        struct bdb_queue_cursor *fndcursor, int *nfound,
+                        int *bdberr);
+
 /* Get the genid of a queue item that was retrieved by bdb_queue_get() */
 unsigned long long bdb_queue_item_genid(const void *dta);
 
@@ -1496,6 +1524,14 @@ int bdb_clear_high_genid(tran_type *input_trans, const char *db_name,
 int bdb_get_high_genid(const char *db_name, int stripe,
                        unsigned long long *genid, int *bdberr);
 
+int bdb_get_rowcount(tran_type *tran, const char *tblname, int stripe,
+                     long long *count, uint8_t *fileid, int rmw, int *bdberr);
+int bdb_set_rowcount(tran_type *tran, const char *tblname, int stripe,
+                     long long count, const uint8_t *fileid, int *bdberr);
+int bdb_del_rowcounts(tran_type *tran, const char *tblname, int *bdberr);
+int bdb_rowcount_get(bdb_state_type *bdb_state, int64_t *count);
+int bdb_rowcount_init(bdb_state_type *bdb_state, int *bdberr);
+
 void bdb_scdone_start(bdb_state_type *bdb_state);
 void bdb_scdone_end(bdb_state_type *bdb_state);
 
@@ -1796,6 +1832,11 @@ int bdb_get_lock_counters(bdb_state_type *bdb_state, int64_t *deadlocks, int64_t
 int bdb_get_bpool_counters(bdb_state_type *bdb_state, int64_t *bpool_hits,
                            int64_t *bpool_misses, int64_t *rw_evicts);
 
+int bdb_get_log_group_commit_counters(bdb_state_type *bdb_state,
+                                      int64_t *flushes, int64_t *commits,
+                                      int64_t *flush_p50_us,
+                                      int64_t *flush_p99_us);
+
 int bdb_master_should_reject(bdb_state_type *bdb_state);
 
 void bdb_berkdb_iomap_set(bdb_state_type *bdb_state, int onoff);
@@ -2132,4 +2173,10 @@ int bdb_pack_heap(bdb_state_type *bdb_state, void *in, size_t inlen, void **out,
  * Otherwise unpack the payload into heap memory. */
 int bdb_unpack_heap(bdb_state_type *bdb_state, void *in, size_t inlen,
                     void **out, size_t *outlen, void **freeptr);
+
+/* LZ4 a buffer that is not a record (no ondisk header).  Returns the
+ * compressed length, or 0 if it does not fit in outlen bytes. */
+int bdb_compress_lz4(const void *in, int inlen, void *out, int outlen);
+/* Returns 0 if `in' expands to exactly outlen bytes. */
+int bdb_decompress_lz4(const void *in, int inlen, void *out, int outlen);
 #endif
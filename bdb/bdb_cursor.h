@@ -199,4 +199,12 @@ int bdb_get_context_from_lsn(bdb_state_type *bdb_state, void *lsnp,
 
 int bdb_direct_count(bdb_cursor_ifn_t *, int ixnum, int64_t *count);
 
+/**
+ * Restrict first/next/last/prev moves of a data cursor to a range of
+ * data stripes; used to split a table scan between parallel engines
+ *
+ */
+void bdb_cursor_set_stripes(bdb_cursor_ifn_t *cur, int first_stripe,
+                            int nstripes);
+
 #endif
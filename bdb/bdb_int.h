@@ -462,6 +462,12 @@ struct tran_tag {
     /* Newsi pglogs queue hash */
     hash_t *pglogs_queue_hash;
     u_int32_t flags;
+
+    /* Row count changes made by this transaction, applied to the maintained
+       counts when the top level transaction commits */
+    struct bdb_rowcount_delta *rowcount_deltas;
+    int num_rowcount_deltas;
+    int max_rowcount_deltas;
 };
 
 struct seqnum_t {
@@ -582,6 +588,11 @@ struct bdb_cursor_impl_tag {
     int lastpage;
     int lastindex;
 
+    /* parallel scans: data moves only visit stripes
+       [first_stripe, first_stripe + nstripes); 0 means all stripes */
+    int first_stripe;
+    int nstripes;
+
     /* read committed/snapshot/serializable (maybe we should merge this here, in
      * bdb, not in db) */
     tmpcursor_t *addcur; /* cursors for add and upd data shadows; */
@@ -1004,6 +1015,10 @@ struct bdb_state_tag {
     /* cache the version_num for the data; this is used to detect dta changes */
     unsigned long long version_num;
 
+    /* whether the table has a maintained row count, as seen by this node as
+       master: replication generation << 2 | ROWCOUNT_ABSENT/PRESENT */
+    uint64_t rowcount_hint;
+
     pthread_cond_t temptable_wait;
 #ifdef DEBUG_TEMP_TABLES
     LISTC_T(struct temp_table) busy_temptables;
@@ -1211,6 +1226,15 @@ int bdb_inplace_cmp_genids(bdb_state_type *bdb_state, unsigned long long g1,
 int __rep_send_message(DB_ENV *, char *, u_int32_t, DB_LSN *, const DBT *,
                        u_int32_t, void *);
 
+/* maintained row counts (count.c) */
+extern int gbl_exact_row_counts;
+void bdb_rowcount_add(tran_type *tran, bdb_state_type *bdb_state, int stripe,
+                      int delta);
+void bdb_rowcount_merge(tran_type *child, tran_type *parent);
+int bdb_rowcount_flush(tran_type *tran, int *bdberr);
+void bdb_rowcount_free(tran_type *tran);
+int bdb_count_stripe(bdb_state_type *bdb_state, int stripe, int64_t *rcnt);
+
 /* Error handling utilities */
 int bdb_dbcp_close(DBC **dbcp_ptr, int *bdberr, const char *context_str);
 void bdb_cursor_error(bdb_state_type *bdb_state, DB_TXN *tid, int rc,
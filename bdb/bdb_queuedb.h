@@ -14,6 +14,11 @@ int bdb_queuedb_best_pagesize(int avg_item_sz);
 int bdb_queuedb_add(bdb_state_type *bdb_state, tran_type *tran, const void *dta,
                     size_t dtalen, int *bdberr, unsigned long long *out_genid);
 
+/* add to a single partition */
+int bdb_queuedb_add_partition(bdb_state_type *bdb_state, tran_type *tran,
+                              const void *dta, size_t dtalen, int partition,
+                              int *bdberr, unsigned long long *out_genid);
+
 /* no-op */
 int bdb_queuedb_add_goose(bdb_state_type *bdb_state, tran_type *tran,
                           int *bdberr);
@@ -41,6 +46,12 @@ int bdb_queuedb_get(bdb_state_type *bdb_state, int consumer,
 int bdb_queuedb_consume(bdb_state_type *bdb_state, tran_type *tran,
                         int consumer, const void *prevfnd, int *bdberr);
 
+int bdb_queuedb_get_batch(bdb_state_type *bdb_state, int consumer,
+                          const struct bdb_queue_cursor *prevcursor, int max,
+                          void **fnd, size_t *fnddtalen, size_t *fnddtaoff,
+                          struct bdb_queue_cursor *fndcursor, int *nfound,
+                          int *bdberr);
+
 const struct bdb_queue_stats *bdb_queuedb_get_stats(bdb_state_type *bdb_state);
 
 int bdb_trigger_subscribe(bdb_state_type *, pthread_cond_t **,
@@ -41,6 +41,10 @@
 #include <net.h>
 #include "bdb_int.h"
 #include "locks.h"
+#include "logmsg.h"
+
+extern int gbl_rowlocks;
+extern int gbl_maxretries;
 
 /* returns -1 on error, 0 on empy table, >0 for number of recs found */
 int bdb_count_int(bdb_state_type *bdb_state, int *bdberr)
@@ -294,10 +298,263 @@ int bdb_count_int(bdb_state_type *bdb_state, int *bdberr)
 
 int bdb_count(bdb_state_type *bdb_state, int *bdberr)
 {
+    int64_t maintained;
     int ret;
+
+    /* not under rowlocks; same gate as sqlite3BtreeCount() */
+    if (gbl_exact_row_counts && !gbl_rowlocks &&
+        bdb_rowcount_get(bdb_state, &maintained) == 0)
+        return maintained;
+
     BDB_READLOCK("bdb_count");
 
     ret = bdb_count_int(bdb_state, bdberr);
     BDB_RELLOCK();
     return ret;
 }
+
+/* Maintained row counts.  Every insert into and delete from a table's data
+ * stripe adds a delta to its transaction.  A child transaction hands its
+ * deltas to the parent when it commits; the top level transaction adds them
+ * to the stripes' llmeta counts just before it commits, so a count is logged
+ * together with the rows it counts.  A stripe's count is only trusted while
+ * the fileid saved with it matches the open data file: schema changes and
+ * truncates build new files, which drops the count until it is rebuilt. */
+int gbl_exact_row_counts = 0;
+
+struct bdb_rowcount_delta {
+    bdb_state_type *bdb_state;
+    int stripe;
+    int64_t delta;
+};
+
+void bdb_rowcount_add(tran_type *tran, bdb_state_type *bdb_state, int stripe,
+                      int delta)
+{
+    struct bdb_rowcount_delta *d;
+    int i;
+
+    if (bdb_state->bdbtype != BDBTYPE_TABLE)
+        return;
+
+    for (i = 0; i < tran->num_rowcount_deltas; i++) {
+        d = &tran->rowcount_deltas[i];
+        if (d->bdb_state == bdb_state && d->stripe == stripe) {
+            d->delta += delta;
+            return;
+        }
+    }
+
+    if (tran->num_rowcount_deltas == tran->max_rowcount_deltas) {
+        int max = tran->max_rowcount_deltas ? tran->max_rowcount_deltas * 2 : 4;
+        d = realloc(tran->rowcount_deltas, max * sizeof(*d));
+        if (d == NULL) {
+            logmsg(LOGMSG_FATAL, "%s: out of memory\n", __func__);
+            abort();
+        }
+        tran->rowcount_deltas = d;
+        tran->max_rowcount_deltas = max;
+    }
+
+    d = &tran->rowcount_deltas[tran->num_rowcount_deltas++];
+    d->bdb_state = bdb_state;
+    d->stripe = stripe;
+    d->delta = delta;
+}
+
+void bdb_rowcount_merge(tran_type *child, tran_type *parent)
+{
+    int i;
+
+    for (i = 0; i < child->num_rowcount_deltas; i++) {
+        struct bdb_rowcount_delta *d = &child->rowcount_deltas[i];
+        if (d->delta)
+            bdb_rowcount_add(parent, d->bdb_state, d->stripe, d->delta);
+    }
+    child->num_rowcount_deltas = 0;
+}
+
+enum { ROWCOUNT_ABSENT = 1, ROWCOUNT_PRESENT = 2 };
+
+static int rowcount_hint(bdb_state_type *bdb_state, uint32_t gen)
+{
+    uint64_t hint = bdb_state->rowcount_hint;
+    return (hint >> 2) == gen ? (hint & 3) : 0;
+}
+
+static void set_rowcount_hint(bdb_state_type *bdb_state, uint32_t gen,
+                              int state)
+{
+    bdb_state->rowcount_hint = ((uint64_t)gen << 2) | state;
+}
+
+/* Apply tran's deltas to the counts of the stripes that have one.  The caller
+ * holds a table lock on every table it wrote to, and counts are only created
+ * under a table write lock, so a table seen without a count here will not get
+ * one before tran commits.  That is remembered until the master changes, so
+ * tables without a count cost no llmeta lookups. */
+int bdb_rowcount_flush(tran_type *tran, int *bdberr)
+{
+    uint8_t fileid[DB_FILE_ID_LEN];
+    long long count;
+    uint32_t gen;
+    int i, rc;
+
+    *bdberr = BDBERR_NOERROR;
+
+    for (i = 0; i < tran->num_rowcount_deltas; i++) {
+        struct bdb_rowcount_delta *d = &tran->rowcount_deltas[i];
+        bdb_state_type *bdb_state = d->bdb_state;
+        DB *dbp = bdb_state->dbp_data[0][d->stripe];
+        int hint;
+
+        if (d->delta == 0)
+            continue;
+
+        bdb_state->dbenv->get_rep_gen(bdb_state->dbenv, &gen);
+        hint = rowcount_hint(bdb_state, gen);
+        if (hint == 0) {
+            /* counts are created for all stripes at once: look at stripe 0 */
+            rc = bdb_get_rowcount(tran, bdb_state->name, 0, &count, fileid, 0,
+                                  bdberr);
+            if (rc < 0)
+                return rc;
+            hint = (rc == 0 && memcmp(fileid, bdb_state->dbp_data[0][0]->fileid,
+                                      DB_FILE_ID_LEN) == 0)
+                       ? ROWCOUNT_PRESENT
+                       : ROWCOUNT_ABSENT;
+            set_rowcount_hint(bdb_state, gen, hint);
+        }
+        if (hint == ROWCOUNT_ABSENT)
+            continue;
+
+        rc = bdb_get_rowcount(tran, bdb_state->name, d->stripe, &count,
+                              fileid, 1, bdberr);
+        if (rc < 0)
+            return rc;
+        if (rc > 0 || memcmp(fileid, dbp->fileid, DB_FILE_ID_LEN))
+            continue;
+
+        rc = bdb_set_rowcount(tran, bdb_state->name, d->stripe,
+                              count + d->delta, dbp->fileid, bdberr);
+        if (rc)
+            return rc;
+    }
+    return 0;
+}
+
+void bdb_rowcount_free(tran_type *tran)
+{
+    free(tran->rowcount_deltas);
+    tran->rowcount_deltas = NULL;
+    tran->num_rowcount_deltas = tran->max_rowcount_deltas = 0;
+}
+
+/* Sum the maintained counts of all data stripes.  Returns 0 on success, 1 if
+ * any stripe has no usable count, <0 on error. */
+int bdb_rowcount_get(bdb_state_type *bdb_state, int64_t *count)
+{
+    uint8_t fileid[DB_FILE_ID_LEN];
+    long long stripe_count;
+    int64_t total = 0;
+    int stripe, rc, bdberr;
+
+    if (bdb_state->bdbtype != BDBTYPE_TABLE)
+        return 1;
+
+    for (stripe = 0; stripe < bdb_state->attr->dtastripe; stripe++) {
+        rc = bdb_get_rowcount(NULL, bdb_state->name, stripe, &stripe_count,
+                              fileid, 0, &bdberr);
+        if (rc)
+            return rc;
+        if (memcmp(fileid, bdb_state->dbp_data[0][stripe]->fileid,
+                   DB_FILE_ID_LEN))
+            return 1;
+        total += stripe_count;
+    }
+
+    *count = total;
+    return 0;
+}
+
+/* Count every data stripe of the table and save the counts, holding the
+ * table write lock so that no writer commits in between.  From then on the
+ * counts are kept up to date by the writers.  Master only. */
+int bdb_rowcount_init(bdb_state_type *bdb_state, int *bdberr)
+{
+    tran_type *tran;
+    int64_t count;
+    uint32_t gen;
+    int retries = 0, stripe, rc;
+
+    *bdberr = BDBERR_NOERROR;
+
+    if (!bdb_amimaster(bdb_state)) {
+        *bdberr = BDBERR_READONLY;
+        return -1;
+    }
+
+retry:
+    if (++retries >= gbl_maxretries) {
+        logmsg(LOGMSG_ERROR, "%s: giving up after %d retries\n", __func__,
+               retries);
+        return -1;
+    }
+
+    tran = bdb_tran_begin(bdb_state, NULL, bdberr);
+    if (tran == NULL) {
+        if (*bdberr == BDBERR_DEADLOCK)
+            goto retry;
+        return -1;
+    }
+
+    rc = bdb_lock_table_write(bdb_state, tran);
+    if (rc) {
+        *bdberr = (rc == BDBERR_DEADLOCK) ? BDBERR_DEADLOCK : BDBERR_MISC;
+        goto backout;
+    }
+
+    BDB_READLOCK("bdb_rowcount_init");
+    for (stripe = 0; stripe < bdb_state->attr->dtastripe; stripe++) {
+        rc = bdb_count_stripe(bdb_state, stripe, &count);
+        if (rc) {
+            *bdberr = (rc == BDBERR_DEADLOCK) ? BDBERR_DEADLOCK : BDBERR_MISC;
+            break;
+        }
+        rc = bdb_set_rowcount(tran, bdb_state->name, stripe, count,
+                              bdb_state->dbp_data[0][stripe]->fileid, bdberr);
+        if (rc)
+            break;
+    }
+    BDB_RELLOCK();
+    if (rc)
+        goto backout;
+
+    /* before commit, while writers are still locked out; a wrong
+     * PRESENT hint only costs a lookup */
+    bdb_state->dbenv->get_rep_gen(bdb_state->dbenv, &gen);
+    set_rowcount_hint(bdb_state, gen, ROWCOUNT_PRESENT);
+
+    rc = bdb_tran_commit(bdb_state, tran, bdberr);
+    if (rc) {
+        if (*bdberr == BDBERR_DEADLOCK)
+            goto retry;
+        return -1;
+    }
+
+    logmsg(LOGMSG_INFO, "%s: maintaining row count for table %s\n", __func__,
+           bdb_state->name);
+    return 0;
+
+backout:
+    {
+        int prev_bdberr = *bdberr;
+        bdb_tran_abort(bdb_state, tran, bdberr);
+        *bdberr = prev_bdberr;
+    }
+    if (*bdberr == BDBERR_DEADLOCK)
+        goto retry;
+    logmsg(LOGMSG_ERROR, "%s: table %s failed with bdberr %d\n", __func__,
+           bdb_state->name, *bdberr);
+    return -1;
+}
@@ -129,6 +129,11 @@ int lkprintf(loglvl lvl, const char *fmt, ...)
     ((id) >= 0 && (((id) < cur->state->attr->dtastripe) ||                     \
                    ((id) == cur->state->attr->dtastripe && cur->addcur)))
 
+/* is this stripe part of the range assigned to the cursor, if any */
+#define IS_SCANNED_DTA(id)                                                     \
+    (cur->nstripes == 0 || ((id) >= cur->first_stripe &&                       \
+                            (id) < cur->first_stripe + cur->nstripes))
+
 hash_t *logfile_pglogs_repo = NULL;
 static unsigned first_logfile;
 static unsigned last_logfile;
@@ -5953,6 +5958,10 @@ static int bdb_cursor_move_int(bdb_cursor_impl_t *cur, int how, int *bdberr)
         int dtafile =
             (how == DB_FIRST) ? 0 : (cur->state->attr->dtastripe -
                                      ((cur->addcur) ? 0 : 1)); /* last stripe */
+        if (cur->nstripes)
+            dtafile = (how == DB_FIRST)
+                          ? cur->first_stripe
+                          : cur->first_stripe + cur->nstripes - 1;
 
         if (cur->data) {
             /* cursor is positioned */
@@ -6046,7 +6055,7 @@ static int bdb_cursor_move_int(bdb_cursor_impl_t *cur, int how, int *bdberr)
                 return -1;
             }
 
-            if (!IS_VALID_DTA(nextstripe))
+            if (!IS_VALID_DTA(nextstripe) || !IS_SCANNED_DTA(nextstripe))
                 return (how == DB_FIRST || how == DB_LAST) ? IX_EMPTY
                                                            : IX_PASTEOF;
 
@@ -8479,6 +8488,33 @@ static void *db_count(void *varg)
     return NULL;
 }
 
+/* Bulk count the records of one data stripe */
+int bdb_count_stripe(bdb_state_type *bdb_state, int stripe, int64_t *rcnt)
+{
+    struct count_arg arg = {0};
+
+    arg.db = bdb_state->dbp_data[0][stripe];
+    db_count(&arg);
+    if (arg.rc == DB_LOCK_DEADLOCK)
+        return BDBERR_DEADLOCK;
+    else if (arg.rc != DB_NOTFOUND)
+        return -1;
+    *rcnt = arg.count;
+    return 0;
+}
+
+void bdb_cursor_set_stripes(bdb_cursor_ifn_t *pcur_ifn, int first_stripe,
+                            int nstripes)
+{
+    bdb_cursor_impl_t *cur = pcur_ifn->impl;
+
+    if (cur->type != BDBC_DT || nstripes <= 0 || first_stripe < 0 ||
+        first_stripe + nstripes > cur->state->attr->dtastripe)
+        return;
+    cur->first_stripe = first_stripe;
+    cur->nstripes = nstripes;
+}
+
 int gbl_parallel_count = 0;
 int bdb_direct_count(bdb_cursor_ifn_t *cur, int ixnum, int64_t *rcnt)
 {
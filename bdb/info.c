@@ -133,6 +133,20 @@ static void txn_stats(FILE *out, bdb_state_type *bdb_state)
     free(stats);
 }
 
+static void print_log2_hist(FILE *out, const char *name, const char *unit,
+                            const u_int64_t *hist, int nbuckets)
+{
+    int i;
+
+    logmsgf(LOGMSG_USER, out, "%s:\n", name);
+    for (i = 0; i < nbuckets; i++) {
+        if (hist[i] == 0)
+            continue;
+        logmsgf(LOGMSG_USER, out, "  %10lld - %-10lld %s: %" PRIu64 "\n",
+                i ? 1LL << i : 0LL, (2LL << i) - 1, unit, hist[i]);
+    }
+}
+
 static void log_stats(FILE *out, bdb_state_type *bdb_state)
 {
     DB_LOG_STAT *stats;
@@ -179,7 +193,59 @@ static void log_stats(FILE *out, bdb_state_type *bdb_state)
         prn_stat(st_inline_writes);
     }
 
+    if (stats->st_gc_flushes) {
+        prn_lstat(st_gc_flushes);
+        prn_lstat(st_gc_commits);
+        prn_lstat(st_gc_max_flush_us);
+        print_log2_hist(out, "st_gc_batch_hist", "commits",
+                        stats->st_gc_batch_hist, DB_LOG_GC_NBUCKETS);
+        print_log2_hist(out, "st_gc_flush_us_hist", "us",
+                        stats->st_gc_flush_us_hist, DB_LOG_GC_NBUCKETS);
+    }
+
+    free(stats);
+}
+
+/* Percentile from a power-of-two histogram: the upper bound of the bucket
+ * holding the pct'th value. */
+static int64_t log2_hist_pct(const u_int64_t *hist, int nbuckets, int pct)
+{
+    u_int64_t total = 0, seen = 0;
+    int i;
+
+    for (i = 0; i < nbuckets; i++)
+        total += hist[i];
+    if (total == 0)
+        return 0;
+    for (i = 0; i < nbuckets; i++) {
+        seen += hist[i];
+        if (seen * 100 >= total * pct)
+            break;
+    }
+    return (2LL << i) - 1;
+}
+
+int bdb_get_log_group_commit_counters(bdb_state_type *bdb_state,
+                                      int64_t *flushes, int64_t *commits,
+                                      int64_t *flush_p50_us,
+                                      int64_t *flush_p99_us)
+{
+    DB_LOG_STAT *stats;
+    int rc;
+
+    rc = bdb_state->dbenv->log_stat(bdb_state->dbenv, &stats, 0);
+    if (rc)
+        return rc;
+
+    *flushes = stats->st_gc_flushes;
+    *commits = stats->st_gc_commits;
+    *flush_p50_us =
+        log2_hist_pct(stats->st_gc_flush_us_hist, DB_LOG_GC_NBUCKETS, 50);
+    *flush_p99_us =
+        log2_hist_pct(stats->st_gc_flush_us_hist, DB_LOG_GC_NBUCKETS, 99);
+
     free(stats);
+    return 0;
 }
 
 int bdb_get_lock_counters(bdb_state_type *bdb_state, int64_t *deadlocks, int64_t *waits, 
@@ -338,7 +404,8 @@ static void rep_stats(FILE *out, bdb_state_type *bdb_state)
     char str[80];
     extern int64_t gbl_rep_trans_parallel, gbl_rep_trans_serial,
         gbl_rep_trans_deadlocked, gbl_rep_trans_inline,
-        gbl_rep_rowlocks_multifile;
+        gbl_rep_rowlocks_multifile, gbl_rep_page_parallel_queues,
+        gbl_rep_page_parallel_records;
 
     bdb_state->dbenv->rep_stat(bdb_state->dbenv, &stats, 0);
 
@@ -391,6 +458,10 @@ static void rep_stats(FILE *out, bdb_state_type *bdb_state)
     logmsgf(LOGMSG_USER, out, "txn inline: %ld\n", gbl_rep_trans_inline);
     logmsgf(LOGMSG_USER, out, "txn multifile rowlocks: %ld\n",
             gbl_rep_rowlocks_multifile);
+    logmsgf(LOGMSG_USER, out, "page-scheduled queues: %ld\n",
+            gbl_rep_page_parallel_queues);
+    logmsgf(LOGMSG_USER, out, "page-scheduled records: %ld\n",
+            gbl_rep_page_parallel_records);
     logmsgf(LOGMSG_USER, out, "txn deadlocked: %ld\n",
             gbl_rep_trans_deadlocked);
     prn_lstat(lc_cache_hits);
@@ -562,6 +633,16 @@ static void cache_stats(FILE *out, bdb_state_type *bdb_state, int extra)
     prn_lstat(st_alloc_max_pages);
     prn_lstat(st_ckp_pages_sync);
     prn_lstat(st_ckp_pages_skip);
+    prn_lstat(st_alloc_freelist);
+    prn_lstat(st_evict_scan);
+    prn_lstat(st_evict_max_scan);
+    prn_lstat(st_evict_us);
+    prn_lstat(st_evict_max_us);
+    prn_lstat(st_probation_evict);
+    prn_lstat(st_clock_promote);
+    prn_lstat(st_probation_pages);
+    prn_lstat(st_clock_pages);
+    prn_lstat(st_freelist_pages);
 
     if (extra) {
         bdb_state->dbenv->memp_dump_region(bdb_state->dbenv, "A", out);
@@ -50,9 +50,11 @@
 #include "locks.h"
 #include <logmsg.h>
 
-int bdb_lite_exact_fetch_int(bdb_state_type *bdb_state, tran_type *tran,
-                             void *key, void *fnddta, int maxlen, int *fndlen,
-                             int *bdberr)
+static int bdb_lite_exact_fetch_flags_int(bdb_state_type *bdb_state,
+                                          tran_type *tran, void *key,
+                                          void *fnddta, int maxlen,
+                                          int *fndlen, u_int32_t flags,
+                                          int *bdberr)
 {
     int rc, outrc = 0, ixlen;
     DBT dbt_key, dbt_data;
@@ -78,7 +80,7 @@ int bdb_lite_exact_fetch_int(bdb_state_type *bdb_state, tran_type *tran,
     dbt_data.flags |= DB_DBT_USERMEM;
 
     rc = bdb_state->dbp_data[0][0]->get(bdb_state->dbp_data[0][0], tid,
-                                        &dbt_key, &dbt_data, 0);
+                                        &dbt_key, &dbt_data, flags);
 
     if (rc == 0) {
         *fndlen = dbt_data.size;
@@ -98,6 +100,29 @@ int bdb_lite_exact_fetch_int(bdb_state_type *bdb_state, tran_type *tran,
     return outrc;
 }
 
+int bdb_lite_exact_fetch_int(bdb_state_type *bdb_state, tran_type *tran,
+                             void *key, void *fnddta, int maxlen, int *fndlen,
+                             int *bdberr)
+{
+    return bdb_lite_exact_fetch_flags_int(bdb_state, tran, key, fnddta, maxlen,
+                                          fndlen, 0, bdberr);
+}
+
+/* fetch with a write lock, for a read-modify-write under tran */
+int bdb_lite_exact_fetch_rmw(bdb_state_type *bdb_state, tran_type *tran,
+                             void *key, void *fnddta, int maxlen, int *fndlen,
+                             int *bdberr)
+{
+    int rc;
+
+    BDB_READLOCK("bdb_lite_exact_fetch_rmw");
+    rc = bdb_lite_exact_fetch_flags_int(bdb_state, tran, key, fnddta, maxlen,
+                                        fndlen, DB_RMW, bdberr);
+    BDB_RELLOCK();
+
+    return rc;
+}
+
 /*allows you to pass a transaction if you want to (it can still be NULL)*/
 int bdb_lite_exact_fetch_tran(bdb_state_type *bdb_state, tran_type *tran,
                               void *key, void *fnddta, int maxlen, int *fndlen,
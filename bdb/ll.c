@@ -239,6 +239,9 @@ int ll_dta_add(bdb_state_type *bdb_state, unsigned long long genid, DB *dbp,
                              tran ? tran->tid : NULL, dbt_key, dbt_data,
                              tran_flags, odhready);
 
+        if (!outrc && dtafile == 0 && !tran->logical_tran)
+            bdb_rowcount_add(tran, bdb_state, dtastripe, 1);
+
         if (!outrc && add_snapisol_logging(bdb_state, tran)) {
             tran_type *parent = (tran->parent) ? tran->parent : tran;
             DBT dbt_tbl = {0};
@@ -450,6 +453,9 @@ int ll_dta_del(bdb_state_type *bdb_state, tran_type *tran, int rrn,
 
         rc = dbcp->c_close(dbcp);
 
+        if (!rc && dtafile == 0 && !tran->logical_tran)
+            bdb_rowcount_add(tran, bdb_state, dtastripe, -1);
+
         if (!rc && add_snapisol_logging(bdb_state, tran)) {
             tran_type *parent = (tran->parent) ? tran->parent : tran;
             DBT dbt_tbl = {0};
@@ -162,7 +162,8 @@ typedef enum {
     LLMETA_FVER_FILE_TYPE_QDB = 46, /* file version for a dbqueue */
     LLMETA_TABLE_NUM_SC_DONE = 47,
     LLMETA_GLOBAL_STRIPE_INFO = 48,
-    LLMETA_SC_START_LSN = 49
+    LLMETA_SC_START_LSN = 49,
+    LLMETA_ROW_COUNT = 50 /* maintained row count of a table data stripe */
 } llmetakey_t;
 
 struct llmeta_file_type_key {
@@ -3911,6 +3912,185 @@ retry:
     return 0;
 }
 
+struct llmeta_rowcount_data_type {
+    long long count;
+    uint8_t fileid[DB_FILE_ID_LEN]; /* data file the count belongs to */
+};
+
+enum { LLMETA_ROWCOUNT_DATA_TYPE_LEN = 8 + DB_FILE_ID_LEN };
+
+static uint8_t *llmeta_rowcount_data_type_put(
+    const struct llmeta_rowcount_data_type *p_rowcount, uint8_t *p_buf,
+    const uint8_t *p_buf_end)
+{
+    if (p_buf_end < p_buf ||
+        LLMETA_ROWCOUNT_DATA_TYPE_LEN > (p_buf_end - p_buf))
+        return NULL;
+
+    p_buf = buf_put(&(p_rowcount->count), sizeof(p_rowcount->count), p_buf,
+                    p_buf_end);
+    p_buf = buf_no_net_put(&(p_rowcount->fileid), sizeof(p_rowcount->fileid),
+                           p_buf, p_buf_end);
+
+    return p_buf;
+}
+
+static const uint8_t *
+llmeta_rowcount_data_type_get(struct llmeta_rowcount_data_type *p_rowcount,
+                              const uint8_t *p_buf, const uint8_t *p_buf_end)
+{
+    if (p_buf_end < p_buf ||
+        LLMETA_ROWCOUNT_DATA_TYPE_LEN > (p_buf_end - p_buf))
+        return NULL;
+
+    p_buf = buf_get(&(p_rowcount->count), sizeof(p_rowcount->count), p_buf,
+                    p_buf_end);
+    p_buf = buf_no_net_get(&(p_rowcount->fileid), sizeof(p_rowcount->fileid),
+                           p_buf, p_buf_end);
+
+    return p_buf;
+}
+
+/* the row count key has the same layout as the high genid key */
+static int llmeta_rowcount_key(const char *tblname, int stripe, char *key)
+{
+    struct llmeta_high_genid_key_type rowcount_key;
+
+    rowcount_key.file_type = LLMETA_ROW_COUNT;
+    strncpy(rowcount_key.dbname, tblname, sizeof(rowcount_key.dbname));
+    rowcount_key.dbname_len = strlen(rowcount_key.dbname);
+    rowcount_key.stripe = stripe;
+
+    if (!llmeta_high_genid_key_type_put(&rowcount_key, (uint8_t *)key,
+                                        (uint8_t *)key + LLMETA_IXLEN)) {
+        logmsg(LOGMSG_ERROR, "%s: llmeta_high_genid_key_type_put returns NULL\n",
+               __func__);
+        logmsg(LOGMSG_ERROR, "%s: check the length of table: %s\n", __func__,
+               tblname);
+        return -1;
+    }
+    return 0;
+}
+
+/* Fetch the maintained row count of one data stripe of a table, along with
+ * the fileid of the data file it was counted against.  With rmw the entry is
+ * write locked under tran, ready to be updated.
+ * Returns 0 if found, 1 if the stripe has no maintained count, <0 on error. */
+int bdb_get_rowcount(tran_type *tran, const char *tblname, int stripe,
+                     long long *count, uint8_t *fileid, int rmw, int *bdberr)
+{
+    char key[LLMETA_IXLEN] = {0};
+    uint8_t buf[LLMETA_ROWCOUNT_DATA_TYPE_LEN];
+    struct llmeta_rowcount_data_type rowcount;
+    int fndlen;
+    int rc;
+
+    *bdberr = BDBERR_NOERROR;
+
+    if (!llmeta_bdb_state) {
+        *bdberr = BDBERR_DBEMPTY;
+        return -1;
+    }
+
+    if (llmeta_rowcount_key(tblname, stripe, key)) {
+        *bdberr = BDBERR_BADARGS;
+        return -1;
+    }
+
+    if (rmw)
+        rc = bdb_lite_exact_fetch_rmw(llmeta_bdb_state, tran, key, buf,
+                                      sizeof(buf), &fndlen, bdberr);
+    else
+        rc = bdb_lite_exact_fetch_tran(llmeta_bdb_state, tran, key, buf,
+                                       sizeof(buf), &fndlen, bdberr);
+    if (rc) {
+        if (*bdberr == BDBERR_FETCH_DTA) {
+            *bdberr = BDBERR_NOERROR;
+            return 1;
+        }
+        return -1;
+    }
+
+    if (fndlen != LLMETA_ROWCOUNT_DATA_TYPE_LEN ||
+        !llmeta_rowcount_data_type_get(&rowcount, buf,
+                                       buf + LLMETA_ROWCOUNT_DATA_TYPE_LEN)) {
+        *bdberr = BDBERR_DTA_MISMATCH;
+        return -1;
+    }
+
+    *count = rowcount.count;
+    memcpy(fileid, rowcount.fileid, DB_FILE_ID_LEN);
+    return 0;
+}
+
+/* Set the maintained row count of one data stripe of a table.  A NULL fileid
+ * clears it.  The change is part of tran, so it commits, replicates and
+ * recovers along with the rows it counts. */
+int bdb_set_rowcount(tran_type *tran, const char *tblname, int stripe,
+                     long long count, const uint8_t *fileid, int *bdberr)
+{
+    char key[LLMETA_IXLEN] = {0};
+    uint8_t buf[LLMETA_ROWCOUNT_DATA_TYPE_LEN];
+    struct llmeta_rowcount_data_type rowcount;
+    int rc;
+
+    *bdberr = BDBERR_NOERROR;
+
+    if (!llmeta_bdb_state) {
+        *bdberr = BDBERR_DBEMPTY;
+        return -1;
+    }
+
+    if (!tran) {
+        logmsg(LOGMSG_ERROR, "%s: NULL transaction\n", __func__);
+        *bdberr = BDBERR_BADARGS;
+        return -1;
+    }
+
+    if (llmeta_rowcount_key(tblname, stripe, key)) {
+        *bdberr = BDBERR_BADARGS;
+        return -1;
+    }
+
+    rc = bdb_lite_exact_del(llmeta_bdb_state, tran, key, bdberr);
+    if (rc && *bdberr != BDBERR_DEL_DTA)
+        return -1;
+    *bdberr = BDBERR_NOERROR;
+
+    if (!fileid)
+        return 0;
+
+    rowcount.count = count;
+    memcpy(rowcount.fileid, fileid, DB_FILE_ID_LEN);
+    if (!llmeta_rowcount_data_type_put(&rowcount, buf,
+                                       buf + LLMETA_ROWCOUNT_DATA_TYPE_LEN)) {
+        logmsg(LOGMSG_ERROR, "%s: llmeta_rowcount_data_type_put returns NULL\n",
+               __func__);
+        *bdberr = BDBERR_BADARGS;
+        return -1;
+    }
+
+    rc = bdb_lite_add(llmeta_bdb_state, tran, buf, sizeof(buf), key, bdberr);
+    if (rc && *bdberr != BDBERR_NOERROR)
+        return -1;
+
+    return 0;
+}
+
+/* Remove the maintained row counts of every possible data stripe of a table,
+ * for a table that is dropped or renamed. */
+int bdb_del_rowcounts(tran_type *tran, const char *tblname, int *bdberr)
+{
+    int stripe, rc;
+
+    for (stripe = 0; stripe < MAXDTASTRIPE; stripe++) {
+        rc = bdb_set_rowcount(tran, tblname, stripe, 0, NULL, bdberr);
+        if (rc)
+            return rc;
+    }
+    return 0;
+}
+
 int bdb_delete_file_lwm(bdb_state_type *bdb_state, tran_type *tran, int *bdberr)
 {
     char key[LLMETA_IXLEN] = {0};
@@ -6052,6 +6232,27 @@ int bdb_llmeta_print_record(bdb_state_type *bdb_state, void *key, int keylen,
     case LLMETA_SC_SEEDS:
         logmsg(LOGMSG_USER, "LLMETA_SC_SEEDS\n");
         break;
+    case LLMETA_ROW_COUNT: {
+        struct llmeta_high_genid_key_type akey;
+        struct llmeta_rowcount_data_type adata;
+
+        if (keylen < LLMETA_HIGH_GENID_KEY_TYPE_MIN_LEN ||
+            datalen < LLMETA_ROWCOUNT_DATA_TYPE_LEN) {
+            logmsg(LOGMSG_USER, "%s:%d: wrong LLMETA_ROW_COUNT entry\n",
+                   __FILE__, __LINE__);
+            *bdberr = BDBERR_MISC;
+            return -1;
+        }
+
+        p_buf_key =
+            llmeta_high_genid_key_type_get(&akey, p_buf_key, p_buf_end_key);
+
+        p_buf_data =
+            llmeta_rowcount_data_type_get(&adata, p_buf_data, p_buf_end_data);
+
+        logmsg(LOGMSG_USER, "LLMETA_ROW_COUNT: table=\"%s\" stripe=%d count=%lld\n",
+               akey.dbname, akey.stripe, adata.count);
+    } break;
     case LLMETA_SC_START_LSN: {
         struct llmeta_schema_change_type akey;
         struct llmeta_db_lsn_data_type adata = {{0}};
@@ -9224,6 +9425,11 @@ int bdb_rename_table_metadata(bdb_state_type *bdb_state, tran_type *tran,
     if (rc)
         return rc;
 
+    /* row counts are keyed by name; the next analyze rebuilds them */
+    rc = bdb_del_rowcounts(tran, bdb_state->name, bdberr);
+    if (rc)
+        return rc;
+
     /* rename files finally, with new versions */
     rc = bdb_rename_files(bdb_state, tran, newname, bdberr);
     if (rc)
@@ -1411,3 +1411,20 @@ int bdb_pack_heap(bdb_state_type *bdb_state, void *in, size_t inlen, void **out,
         free(*freeptr);
     return rc;
 }
+
+int bdb_compress_lz4(const void *in, int inlen, void *out, int outlen)
+{
+    int rc;
+
+    if (inlen <= 0 || outlen <= 0)
+        return 0;
+    rc = LZ4_compress_default(in, out, inlen, outlen);
+    return rc > 0 ? rc : 0;
+}
+
+int bdb_decompress_lz4(const void *in, int inlen, void *out, int outlen)
+{
+    /* the input may come off the wire, so do not trust it to be well-formed */
+    int rc = LZ4_decompress_safe(in, out, inlen, outlen);
+    return rc == outlen ? 0 : -1;
+}
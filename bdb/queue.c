@@ -535,6 +535,26 @@ int bdb_queue_add(bdb_state_type *bdb_state, tran_type *tran, const void *dta,
     return rc;
 }
 
+int bdb_queue_add_partition(bdb_state_type *bdb_state, tran_type *tran,
+                            const void *dta, size_t dtalen, int partition,
+                            int *bdberr, unsigned long long *out_genid)
+{
+    int rc;
+
+    if (bdb_state->bdbtype != BDBTYPE_QUEUEDB || partition < 0 ||
+        partition >= BDBQUEUE_MAX_PARTITIONS) {
+        *bdberr = BDBERR_BADARGS;
+        return -1;
+    }
+
+    BDB_READLOCK("bdb_queue_add_partition");
+    rc = bdb_queuedb_add_partition(bdb_state, tran, dta, dtalen, partition,
+                                   bdberr, out_genid);
+    BDB_RELLOCK();
+
+    return rc;
+}
+
 static int bdb_queue_add_goose_int(bdb_state_type *bdb_state, tran_type *tran,
                                    int *bdberr)
 {
@@ -1687,6 +1707,28 @@ int bdb_queue_get(bdb_state_type *bdb_state, int consumer,
     return rc;
 }
 
+int bdb_queue_get_batch(bdb_state_type *bdb_state, int consumer,
+                        const struct bdb_queue_cursor *prevcursor, int max,
+                        void **fnd, size_t *fnddtalen, size_t *fnddtaoff,
+                        struct bdb_queue_cursor *fndcursor, int *nfound,
+                        int *bdberr)
+{
+    int rc;
+
+    *nfound = 0;
+    if (bdb_state->bdbtype != BDBTYPE_QUEUEDB) {
+        *bdberr = BDBERR_BADARGS;
+        return -1;
+    }
+
+    BDB_READLOCK("bdb_queue_get_batch");
+    rc = bdb_queuedb_get_batch(bdb_state, consumer, prevcursor, max, fnd,
+                               fnddtalen, fnddtaoff, fndcursor, nfound, bdberr);
+    BDB_RELLOCK();
+
+    return rc;
+}
+
 static int bdb_queue_consume_int(bdb_state_type *bdb_state, tran_type *intran,
                                  int consumer, const void *prevfnd, int *bdberr)
 {
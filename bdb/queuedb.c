@@ -92,9 +92,19 @@ int bdb_queuedb_best_pagesize(int avg_item_sz)
     return calc_pagesize(avg_item_sz);
 }
 
-/* add to queue */
-int bdb_queuedb_add(bdb_state_type *bdb_state, tran_type *tran, const void *dta,
-                    size_t dtalen, int *bdberr, unsigned long long *out_genid)
+/* Slot holding an item of this consumer.  Items of a partitioned queue
+ * carry their partition in the genid's stripe bits; for everything else
+ * those bits are zero and the slot is just the consumer. */
+static int queuedb_slot(int consumer, uint64_t genid)
+{
+    return consumer + get_dtafile_from_genid(genid);
+}
+
+/* Add to every active consumer, or only to slot partition if that is not
+ * negative. */
+static int queuedb_add_int(bdb_state_type *bdb_state, tran_type *tran,
+                           const void *dta, size_t dtalen, int partition,
+                           int *bdberr, unsigned long long *out_genid)
 {
     DB *db;
     struct queuedb_key k;
@@ -110,7 +120,9 @@ int bdb_queuedb_add(bdb_state_type *bdb_state, tran_type *tran, const void *dta,
 
     qstate = (struct bdb_queue_priv *)bdb_state->qpriv;
     databuf = malloc(dtalen + sizeof(struct bdb_queue_found));
-    qfnd.genid = get_genid(bdb_state, 0);
+    qfnd.genid = get_genid(bdb_state, partition < 0 ? 0 : partition);
+    if (out_genid)
+        *out_genid = qfnd.genid;
     qfnd.data_len = dtalen;
     qfnd.data_offset = sizeof(struct bdb_queue_found);
     qfnd.trans.tid = tran->tid->txnid;
@@ -137,7 +149,8 @@ int bdb_queuedb_add(bdb_state_type *bdb_state, tran_type *tran, const void *dta,
     *bdberr = BDBERR_NOERROR;
     db = bdb_state->dbp_data[0][0];
     for (int i = 0; i < MAXCONSUMERS; i++) {
-        if (btst(&bdb_state->active_consumers, i)) {
+        if (partition < 0 ? btst(&bdb_state->active_consumers, i)
+                          : i == partition) {
             uint8_t key[QUEUEDB_KEY_LEN];
             uint8_t *p_buf, *p_buf_end;
             p_buf = key;
@@ -192,6 +205,22 @@ done:
     return rc;
 }
 
+/* add to queue */
+int bdb_queuedb_add(bdb_state_type *bdb_state, tran_type *tran, const void *dta,
+                    size_t dtalen, int *bdberr, unsigned long long *out_genid)
+{
+    return queuedb_add_int(bdb_state, tran, dta, dtalen, -1, bdberr,
+                           out_genid);
+}
+
+int bdb_queuedb_add_partition(bdb_state_type *bdb_state, tran_type *tran,
+                              const void *dta, size_t dtalen, int partition,
+                              int *bdberr, unsigned long long *out_genid)
+{
+    return queuedb_add_int(bdb_state, tran, dta, dtalen, partition, bdberr,
+                           out_genid);
+}
+
 int bdb_queuedb_walk(bdb_state_type *bdb_state, int flags, void *lastitem,
                      bdb_queue_walk_callback_t callback, void *userptr,
                      int *bdberr)
@@ -541,7 +570,7 @@ int bdb_queuedb_consume(bdb_state_type *bdb_state, tran_type *tran,
         rc = -1;
         goto done;
     }
-    k.consumer = consumer;
+    k.consumer = queuedb_slot(consumer, qfnd.genid);
     k.genid = qfnd.genid;
     if (gbl_debug_queuedb)
         logmsg(LOGMSG_USER, "consumer %d genid %016lx\n", consumer, k.genid);
@@ -632,6 +661,173 @@ done:
     return rc;
 }
 
+/* Read up to max items for this consumer, after prevcursor if given, in a
+ * single cursor pass.  On success fnd[0..*nfound-1] point to items that the
+ * caller must free, laid out as for bdb_queuedb_get(), and fndcursor (if not
+ * NULL) is positioned on the last one.  Returns -1 with BDBERR_FETCH_DTA if
+ * there is nothing to read.  A deadlock after the first item ends the batch
+ * early rather than failing it. */
+int bdb_queuedb_get_batch(bdb_state_type *bdb_state, int consumer,
+                          const struct bdb_queue_cursor *prevcursor, int max,
+                          void **fnd, size_t *fnddtalen, size_t *fnddtaoff,
+                          struct bdb_queue_cursor *fndcursor, int *nfound,
+                          int *bdberr)
+{
+    struct queuedb_key k, fndk;
+    DBT dbt_key = {0}, dbt_data = {0};
+    DBC *dbcp = NULL;
+    int rc, n = 0;
+    struct bdb_queue_found qfnd;
+    uint8_t *p_buf, *p_buf_end;
+    uint8_t key[QUEUEDB_KEY_LEN] = {0};
+    struct bdb_queue_priv *qstate = bdb_state->qpriv;
+
+    *nfound = 0;
+    if (bdb_state->dbp_data[0][0] == NULL) { // trigger dropped?
+        *bdberr = BDBERR_BADARGS;
+        return -1;
+    }
+    if (max <= 0) {
+        *bdberr = BDBERR_BADARGS;
+        return -1;
+    }
+
+    if (gbl_debug_queuedb)
+        logmsg(LOGMSG_USER, ">> bdb_queuedb_get_batch %s max %d\n",
+               bdb_state->name, max);
+
+    dbt_key.flags = dbt_data.flags = DB_DBT_REALLOC;
+
+    rc = bdb_state->dbp_data[0][0]->cursor(bdb_state->dbp_data[0][0], NULL,
+                                           &dbcp, 0);
+    if (rc) {
+        *bdberr = BDBERR_MISC;
+        rc = -1;
+        goto done;
+    }
+
+    k.consumer = consumer;
+    if (prevcursor)
+        memcpy(&k.genid, prevcursor->genid, sizeof(uint64_t));
+    else
+        k.genid = 0;
+
+    p_buf = key;
+    p_buf_end = p_buf + QUEUEDB_KEY_LEN;
+    if (queuedb_key_put(&k, p_buf, p_buf_end) == NULL) {
+        logmsg(LOGMSG_ERROR,
+               "%s:%d failed to encode key for queue %s consumer %d\n",
+               __func__, __LINE__, bdb_state->name, consumer);
+        *bdberr = BDBERR_MISC;
+        rc = -1;
+        goto done;
+    }
+
+    dbt_key.data = key;
+    dbt_key.size = QUEUEDB_KEY_LEN;
+
+    qstate->stats.n_physical_gets++;
+    qstate->stats.n_batch_gets++;
+    rc = dbcp->c_get(dbcp, &dbt_key, &dbt_data, DB_SET_RANGE);
+
+    /* skip the previous record if it hasn't been consumed yet */
+    if (rc == 0 && prevcursor && prevcursor->genid[0] != 0 &&
+        prevcursor->genid[1] != 0 && dbt_key.size == QUEUEDB_KEY_LEN &&
+        memcmp(dbt_key.data, key, QUEUEDB_KEY_LEN) == 0)
+        rc = dbcp->c_get(dbcp, &dbt_key, &dbt_data, DB_NEXT);
+
+    while (rc == 0) {
+        p_buf = dbt_key.data;
+        p_buf_end = p_buf + dbt_key.size;
+        if (queuedb_key_get(&fndk, p_buf, p_buf_end) == NULL) {
+            logmsg(LOGMSG_ERROR,
+                   "%s:%d failed to decode found key for queue %s consumer "
+                   "%d\n",
+                   __func__, __LINE__, bdb_state->name, consumer);
+            *bdberr = BDBERR_MISC;
+            rc = -1;
+            goto done;
+        }
+        /* the rest of the btree belongs to other consumers */
+        if (fndk.consumer != consumer)
+            break;
+
+        p_buf = dbt_data.data;
+        p_buf_end = p_buf + dbt_data.size;
+        if (dbt_data.size < sizeof(struct bdb_queue_found) ||
+            queue_found_get(&qfnd, p_buf, p_buf_end) == NULL) {
+            logmsg(LOGMSG_ERROR, "%s: invalid queue entry size %u in queue %s\n",
+                   __func__, dbt_data.size, bdb_state->name);
+            *bdberr = BDBERR_MISC;
+            rc = -1;
+            goto done;
+        }
+
+        fnd[n] = dbt_data.data;
+        if (fnddtalen)
+            fnddtalen[n] = dbt_data.size;
+        if (fnddtaoff)
+            fnddtaoff[n] = sizeof(struct bdb_queue_found);
+        if (fndcursor) {
+            memcpy(fndcursor->genid, &qfnd.genid, sizeof(qfnd.genid));
+            fndcursor->recno = 0;
+            fndcursor->reserved = 0;
+        }
+        /* berkdb allocates a fresh buffer for the next record */
+        dbt_data.data = NULL;
+        dbt_data.size = 0;
+        if (++n == max)
+            break;
+
+        rc = dbcp->c_get(dbcp, &dbt_key, &dbt_data, DB_NEXT);
+    }
+
+    if (rc == DB_LOCK_DEADLOCK) {
+        qstate->stats.n_get_deadlocks++;
+        if (n == 0) {
+            *bdberr = BDBERR_DEADLOCK;
+            rc = -1;
+            goto done;
+        }
+    } else if (rc != 0 && rc != DB_NOTFOUND) {
+        logmsg(LOGMSG_ERROR, "%s %s get rc %d\n", __func__, bdb_state->name,
+               rc);
+        *bdberr = BDBERR_MISC;
+        rc = -1;
+        goto done;
+    }
+
+    if (n == 0) {
+        qstate->stats.n_get_not_founds++;
+        *bdberr = BDBERR_FETCH_DTA;
+        rc = -1;
+        goto done;
+    }
+
+    qstate->stats.n_batch_items_got += n;
+    *bdberr = BDBERR_NOERROR;
+    rc = 0;
+
+done:
+    if (rc) {
+        while (n > 0)
+            free(fnd[--n]);
+    }
+    *nfound = n;
+    if (dbt_key.data && dbt_key.data != key)
+        free(dbt_key.data);
+    if (dbt_data.data)
+        free(dbt_data.data);
+    if (dbcp) {
+        int crc = dbcp->c_close(dbcp);
+        if (crc && rc == 0) {
+            /* the items we read are still good */
+            logmsg(LOGMSG_ERROR, "%s: c_close berk rc %d\n", __func__, crc);
+        }
+    }
+    return rc;
+}
+
 const struct bdb_queue_stats *bdb_queuedb_get_stats(bdb_state_type *bdb_state)
 {
     struct bdb_queue_priv *qstate = bdb_state->qpriv;
@@ -66,6 +66,7 @@
 #include "dbinc/lock.h"
 #include "dbinc/log.h"
 #include "dbinc/mp.h"
+#include "dbinc/rep_profile.h"
 #include <trigger.h>
 #include "printformats.h"
 #include <llog_auto.h>
@@ -5148,6 +5149,9 @@ void berkdb_receive_rtn(void *ack_handle, void *usr_ptr, char *from_host,
     if (bdb_state->parent)
         bdb_state = bdb_state->parent;
 
+    if (gbl_rep_apply_profile)
+        rep_profile_recv_us = comdb2_time_epochus();
+
 again:
     BDB_READLOCK("berkdb_receive_rtn");
 
@@ -60,6 +60,9 @@ extern void backtrace_symbols_fd(void *const *, int, int);
 
 extern char *gbl_crypto;
 extern int64_t gbl_temptable_spills;
+extern int64_t gbl_temptable_mem_tables;
+extern int64_t gbl_temptable_mem_spills;
+extern int64_t gbl_temptable_mem_inuse;
 
 struct hashobj {
     int len;
@@ -107,10 +110,21 @@ struct temp_cursor {
     struct temp_list_node *list_cur;
     void *hash_cur;
     unsigned int hash_cur_buk;
+    /* in-memory btree position; only trusted while mem_gen matches the
+       table's, otherwise we seek again from mem_rec's key */
+    struct tmpmem_node *mem_leaf;
+    int mem_idx;
+    unsigned int mem_gen;
+    struct tmpmem_rec *mem_rec;
     LINKC_T(struct temp_cursor) lnk;
 };
 
-enum { TEMP_TABLE_TYPE_BTREE, TEMP_TABLE_TYPE_HASH, TEMP_TABLE_TYPE_LIST };
+enum {
+    TEMP_TABLE_TYPE_BTREE,
+    TEMP_TABLE_TYPE_HASH,
+    TEMP_TABLE_TYPE_LIST,
+    TEMP_TABLE_TYPE_MEM
+};
 
 struct temp_table {
     DB_ENV *dbenv_temp;
@@ -120,6 +134,13 @@ struct temp_table {
     LISTC_T(struct temp_list_node) temp_tbl_list;
     hash_t *temp_hash_tbl;
 
+    /* TEMP_TABLE_TYPE_MEM */
+    struct tmpmem_node *mem_root;
+    struct tmpmem_chunk *mem_chunks;
+    size_t mem_bytes;
+    unsigned int mem_gen;
+    struct tmpmem_rec *mem_unused[32]; /* replaced records, by log2(cap) */
+
     tmptbl_cmp cmpfunc;
     void *usermem;
     char filename[512];
@@ -150,8 +171,9 @@ static int temp_table_compare(DB *db, const DBT *dbt1, const DBT *dbt2);
 
 /* refactored both insert and put code paths here */
 static int bdb_temp_table_insert_put(bdb_state_type *, struct temp_table *,
-                                     void *key, int keylen, void *data,
-                                     int dtalen, int *bdberr);
+                                     struct temp_cursor *, void *key,
+                                     int keylen, void *data, int dtalen,
+                                     void *unpacked, int *bdberr);
 
 void *bdb_temp_table_get_cur(struct temp_cursor *skippy) { return skippy->cur; }
 
@@ -166,6 +188,621 @@ hash_t *bdb_temp_table_histhash_init(void)
                           sizeof(pthread_t));
 }
 
+/* In-memory ordered temp tables.
+ *
+ * Btree temp tables start out as a B+tree whose nodes and records are carved
+ * out of a per-table arena, and only get a berkdb environment once they grow
+ * past temptable_mem_bytes (or all of them together past
+ * temptable_mem_total).  Deletes just unlink the record from its leaf; the
+ * tree is never rebalanced and nothing goes back to the arena until the
+ * table is truncated or spills, so a record pointer stays good for as long
+ * as a cursor may hold it.  An update rewrites its record in place when the
+ * new data fits; otherwise the old record is reused by later inserts and
+ * updates, once no cursor holds it.
+ */
+#define TMPMEM_FANOUT 64
+#define TMPMEM_MAXDEPTH 16
+#define TMPMEM_CHUNK (64 * 1024)
+
+struct tmpmem_rec {
+    int keylen;
+    int datalen;
+    int cap; /* bytes allocated for buf */
+    unsigned char buf[/* keylen + datalen */];
+};
+
+struct tmpmem_node {
+    int leaf;
+    int n;
+    struct tmpmem_node *prev; /* leaves only */
+    struct tmpmem_node *next;
+    /* leaf: the records in key order
+       internal: rec[i] is the smallest key child[i] can hold (i > 0) */
+    struct tmpmem_rec *rec[TMPMEM_FANOUT];
+    struct tmpmem_node *child[TMPMEM_FANOUT]; /* not allocated for leaves */
+};
+
+struct tmpmem_chunk {
+    struct tmpmem_chunk *next;
+    size_t used;
+    size_t size;
+    char mem[];
+};
+
+enum { TMPMEM_SEEK_GE, TMPMEM_SEEK_GT, TMPMEM_SEEK_LT };
+
+static void *tmpmem_alloc(struct temp_table *tbl, size_t sz)
+{
+    struct tmpmem_chunk *c = tbl->mem_chunks;
+    void *p;
+
+    sz = (sz + 7) & ~(size_t)7;
+    if (c == NULL || c->size - c->used < sz) {
+        size_t csz = sz > TMPMEM_CHUNK ? sz : TMPMEM_CHUNK;
+        struct tmpmem_chunk *n = malloc(offsetof(struct tmpmem_chunk, mem) + csz);
+        if (n == NULL)
+            return NULL;
+        n->size = csz;
+        n->used = 0;
+        /* an oversized record gets a chunk of its own; keep filling the
+           current one */
+        if (c && csz > TMPMEM_CHUNK) {
+            n->next = c->next;
+            c->next = n;
+        } else {
+            n->next = c;
+            tbl->mem_chunks = n;
+        }
+        c = n;
+        tbl->mem_bytes += csz;
+        ATOMIC_ADD(gbl_temptable_mem_inuse, csz);
+    }
+    p = c->mem + c->used;
+    c->used += sz;
+    return p;
+}
+
+static void tmpmem_free(struct temp_table *tbl)
+{
+    struct tmpmem_chunk *c, *next;
+
+    for (c = tbl->mem_chunks; c; c = next) {
+        next = c->next;
+        free(c);
+    }
+    if (tbl->mem_bytes)
+        ATOMIC_ADD(gbl_temptable_mem_inuse, -(int64_t)tbl->mem_bytes);
+    tbl->mem_chunks = NULL;
+    tbl->mem_bytes = 0;
+    tbl->mem_root = NULL;
+    memset(tbl->mem_unused, 0, sizeof(tbl->mem_unused));
+    tbl->mem_gen++;
+}
+
+static struct tmpmem_node *tmpmem_node_new(struct temp_table *tbl, int leaf)
+{
+    size_t sz = leaf ? offsetof(struct tmpmem_node, child)
+                     : sizeof(struct tmpmem_node);
+    struct tmpmem_node *node = tmpmem_alloc(tbl, sz);
+
+    if (node) {
+        node->leaf = leaf;
+        node->n = 0;
+        node->prev = node->next = NULL;
+    }
+    return node;
+}
+
+static inline int tmpmem_log2(unsigned int v)
+{
+    int b = 0;
+
+    while (v >>= 1)
+        b++;
+    return b;
+}
+
+/* Keep a record no cursor holds for reuse; the list link lives in buf */
+static void tmpmem_rec_unused(struct temp_table *tbl, struct tmpmem_rec *rec)
+{
+    struct temp_cursor *cur;
+    int k;
+
+    if (rec->cap < sizeof(struct tmpmem_rec *))
+        return;
+    LISTC_FOR_EACH(&tbl->cursors, cur, lnk)
+    {
+        if (cur->mem_rec == rec || cur->key == rec->buf)
+            return;
+    }
+    k = tmpmem_log2(rec->cap);
+    memcpy(rec->buf, &tbl->mem_unused[k], sizeof(struct tmpmem_rec *));
+    tbl->mem_unused[k] = rec;
+}
+
+static struct tmpmem_rec *tmpmem_rec_new(struct temp_table *tbl,
+                                         const void *key, int keylen,
+                                         const void *data, int datalen)
+{
+    struct tmpmem_rec *rec = NULL;
+    int len = keylen + datalen;
+    int k;
+
+    /* any record in a class above log2(len) is big enough */
+    for (k = len > 1 ? tmpmem_log2(len - 1) + 1 : 0; k < 32; k++) {
+        if ((rec = tbl->mem_unused[k]) != NULL) {
+            memcpy(&tbl->mem_unused[k], rec->buf, sizeof(struct tmpmem_rec *));
+            break;
+        }
+    }
+    if (rec == NULL) {
+        size_t sz = (offsetof(struct tmpmem_rec, buf) + len + 7) & ~(size_t)7;
+        rec = tmpmem_alloc(tbl, sz);
+        if (rec == NULL)
+            return NULL;
+        rec->cap = sz - offsetof(struct tmpmem_rec, buf);
+    }
+    rec->keylen = keylen;
+    rec->datalen = datalen;
+    memcpy(rec->buf, key, keylen);
+    memcpy(rec->buf + keylen, data, datalen);
+    return rec;
+}
+
+/* Same orientation as temp_table_compare(): search key versus stored key. */
+static inline int tmpmem_cmp(struct temp_table *tbl, int keylen,
+                             const void *key, void *unpacked,
+                             const struct tmpmem_rec *rec)
+{
+    if (unpacked)
+        return -tbl->cmpfunc(NULL, rec->keylen, rec->buf, -1, unpacked);
+    return tbl->cmpfunc(tbl->usermem, keylen, key, rec->keylen, rec->buf);
+}
+
+static int tmpmem_child(struct temp_table *tbl, struct tmpmem_node *node,
+                        int keylen, const void *key, void *unpacked)
+{
+    int lo = 1, hi = node->n;
+
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (tmpmem_cmp(tbl, keylen, key, unpacked, node->rec[mid]) < 0)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    return lo - 1;
+}
+
+/* index of the first record >= key */
+static int tmpmem_lower(struct temp_table *tbl, struct tmpmem_node *leaf,
+                        int keylen, const void *key, void *unpacked,
+                        int *exact)
+{
+    int lo = 0, hi = leaf->n;
+
+    *exact = 0;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        int c = tmpmem_cmp(tbl, keylen, key, unpacked, leaf->rec[mid]);
+        if (c > 0) {
+            lo = mid + 1;
+        } else {
+            if (c == 0)
+                *exact = 1;
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/* skip over leaves emptied by deletes */
+static struct tmpmem_node *tmpmem_fwd(struct tmpmem_node *leaf, int *idx)
+{
+    while (leaf && *idx >= leaf->n) {
+        leaf = leaf->next;
+        *idx = 0;
+    }
+    return leaf;
+}
+
+static struct tmpmem_node *tmpmem_back(struct tmpmem_node *leaf, int *idx)
+{
+    while (leaf && *idx < 0) {
+        leaf = leaf->prev;
+        *idx = leaf ? leaf->n - 1 : 0;
+    }
+    return leaf;
+}
+
+static struct tmpmem_node *tmpmem_edge(struct temp_table *tbl, int last,
+                                       int *idx)
+{
+    struct tmpmem_node *node = tbl->mem_root;
+
+    if (node == NULL)
+        return NULL;
+    while (!node->leaf)
+        node = node->child[last ? node->n - 1 : 0];
+    if (last) {
+        *idx = node->n - 1;
+        return tmpmem_back(node, idx);
+    }
+    *idx = 0;
+    return tmpmem_fwd(node, idx);
+}
+
+static struct tmpmem_node *tmpmem_seek(struct temp_table *tbl, int keylen,
+                                       const void *key, void *unpacked,
+                                       int how, int *idx, int *exact)
+{
+    struct tmpmem_node *node = tbl->mem_root;
+
+    *exact = 0;
+    if (node == NULL)
+        return NULL;
+    while (!node->leaf)
+        node = node->child[tmpmem_child(tbl, node, keylen, key, unpacked)];
+    *idx = tmpmem_lower(tbl, node, keylen, key, unpacked, exact);
+    switch (how) {
+    case TMPMEM_SEEK_GT:
+        if (*exact)
+            (*idx)++;
+        /* fall through */
+    case TMPMEM_SEEK_GE:
+        return tmpmem_fwd(node, idx);
+    default:
+        (*idx)--;
+        return tmpmem_back(node, idx);
+    }
+}
+
+/* Internal nodes use leaf records as separators; point the ones on old's
+   path at its replacement, which has the same key. */
+static void tmpmem_replace_separators(struct temp_table *tbl,
+                                      struct tmpmem_rec *old,
+                                      struct tmpmem_rec *rec)
+{
+    struct tmpmem_node *node = tbl->mem_root;
+    int i;
+
+    while (node && !node->leaf) {
+        i = tmpmem_child(tbl, node, old->keylen, old->buf, NULL);
+        if (node->rec[i] == old)
+            node->rec[i] = rec;
+        node = node->child[i];
+    }
+}
+
+static void tmpmem_node_insert(struct tmpmem_node *node, int i,
+                               struct tmpmem_rec *rec,
+                               struct tmpmem_node *child)
+{
+    memmove(&node->rec[i + 1], &node->rec[i],
+            (node->n - i) * sizeof(node->rec[0]));
+    node->rec[i] = rec;
+    if (!node->leaf) {
+        memmove(&node->child[i + 1], &node->child[i],
+                (node->n - i) * sizeof(node->child[0]));
+        node->child[i] = child;
+    }
+    node->n++;
+}
+
+/* Insert into a full node and move the upper half to the empty node right,
+   which becomes its sibling; right->rec[0] is the separator for the parent.
+   Cannot fail: the caller allocates right up front. */
+static void tmpmem_split(struct tmpmem_node *node, int i,
+                         struct tmpmem_rec *rec, struct tmpmem_node *child,
+                         struct tmpmem_node *right)
+{
+    struct tmpmem_rec *recs[TMPMEM_FANOUT + 1];
+    struct tmpmem_node *kids[TMPMEM_FANOUT + 1];
+    int n = node->n + 1, h = n / 2;
+
+    memcpy(recs, node->rec, i * sizeof(recs[0]));
+    recs[i] = rec;
+    memcpy(&recs[i + 1], &node->rec[i], (node->n - i) * sizeof(recs[0]));
+    memcpy(node->rec, recs, h * sizeof(recs[0]));
+    memcpy(right->rec, &recs[h], (n - h) * sizeof(recs[0]));
+    if (!node->leaf) {
+        memcpy(kids, node->child, i * sizeof(kids[0]));
+        kids[i] = child;
+        memcpy(&kids[i + 1], &node->child[i], (node->n - i) * sizeof(kids[0]));
+        memcpy(node->child, kids, h * sizeof(kids[0]));
+        memcpy(right->child, &kids[h], (n - h) * sizeof(kids[0]));
+    } else {
+        right->next = node->next;
+        right->prev = node;
+        if (node->next)
+            node->next->prev = right;
+        node->next = right;
+    }
+    node->n = h;
+    right->n = n - h;
+}
+
+/* Add rec, replacing the record with an equal key if there is one (a btree
+   temp table has no duplicates).  Returns where rec ended up. */
+static int tmpmem_insert(struct temp_table *tbl, struct tmpmem_rec *rec,
+                         void *unpacked, struct tmpmem_node **pleaf,
+                         int *pidx)
+{
+    struct tmpmem_node *path[TMPMEM_MAXDEPTH];
+    struct tmpmem_node *spare[TMPMEM_MAXDEPTH + 1];
+    int pos[TMPMEM_MAXDEPTH];
+    struct tmpmem_node *node, *right, *root = NULL;
+    int depth = 0, level, k, i, exact;
+
+    if (tbl->mem_root == NULL) {
+        tbl->mem_root = tmpmem_node_new(tbl, 1);
+        if (tbl->mem_root == NULL)
+            return -1;
+    }
+    node = tbl->mem_root;
+    while (!node->leaf) {
+        if (depth == TMPMEM_MAXDEPTH)
+            return -1;
+        i = tmpmem_child(tbl, node, rec->keylen, rec->buf, unpacked);
+        path[depth] = node;
+        pos[depth++] = i;
+        node = node->child[i];
+    }
+    i = tmpmem_lower(tbl, node, rec->keylen, rec->buf, unpacked, &exact);
+    if (exact) {
+        node->rec[i] = rec;
+        *pleaf = node;
+        *pidx = i;
+        return 0;
+    }
+
+    if (node->n < TMPMEM_FANOUT) {
+        tbl->mem_gen++;
+        tbl->num_mem_entries++;
+        tmpmem_node_insert(node, i, rec, NULL);
+        *pleaf = node;
+        *pidx = i;
+        return 0;
+    }
+
+    /* The leaf is full.  The split climbs through every full ancestor and
+       adds a root if it reaches the top; get all of those nodes before
+       touching the tree so a failed allocation leaves it intact. */
+    for (level = depth; level > 0 && path[level - 1]->n == TMPMEM_FANOUT;
+         level--)
+        ;
+    if (level == 0 && depth == TMPMEM_MAXDEPTH)
+        return -1;
+    for (k = depth; k >= level; k--) {
+        spare[k] = tmpmem_node_new(tbl, k == depth);
+        if (spare[k] == NULL)
+            return -1;
+    }
+    if (level == 0) {
+        root = tmpmem_node_new(tbl, 0);
+        if (root == NULL)
+            return -1;
+    }
+
+    tbl->mem_gen++;
+    tbl->num_mem_entries++;
+    right = spare[depth];
+    tmpmem_split(node, i, rec, NULL, right);
+    if (i < node->n) {
+        *pleaf = node;
+        *pidx = i;
+    } else {
+        *pleaf = right;
+        *pidx = i - node->n;
+    }
+
+    while (depth > level) {
+        node = path[--depth];
+        i = pos[depth] + 1;
+        tmpmem_split(node, i, right->rec[0], right, spare[depth]);
+        right = spare[depth];
+    }
+    if (level > 0) {
+        node = path[level - 1];
+        tmpmem_node_insert(node, pos[level - 1] + 1, right->rec[0], right);
+    } else {
+        root->n = 2;
+        root->rec[0] = NULL;
+        root->child[0] = tbl->mem_root;
+        root->rec[1] = right->rec[0];
+        root->child[1] = right;
+        tbl->mem_root = root;
+    }
+    return 0;
+}
+
+/* Find the slot of the record the cursor sits on; NULL if it is gone. */
+static struct tmpmem_node *tmpmem_cursor_slot(struct temp_cursor *cur,
+                                              int *idx)
+{
+    struct temp_table *tbl = cur->tbl;
+    struct tmpmem_node *leaf;
+    int exact;
+
+    if (cur->mem_rec == NULL)
+        return NULL;
+    if (cur->mem_gen == tbl->mem_gen) {
+        *idx = cur->mem_idx;
+        return cur->mem_leaf;
+    }
+    leaf = tmpmem_seek(tbl, cur->mem_rec->keylen, cur->mem_rec->buf, NULL,
+                       TMPMEM_SEEK_GE, idx, &exact);
+    if (leaf == NULL || !exact)
+        return NULL;
+    cur->mem_leaf = leaf;
+    cur->mem_idx = *idx;
+    cur->mem_gen = tbl->mem_gen;
+    return leaf;
+}
+
+static void tmpmem_cursor_place(struct temp_cursor *cur,
+                                struct tmpmem_node *leaf, int idx)
+{
+    cur->mem_leaf = leaf;
+    cur->mem_idx = idx;
+    cur->mem_gen = cur->tbl->mem_gen;
+    cur->mem_rec = leaf->rec[idx];
+}
+
+/* Load the record at (leaf, idx) into the cursor.  Like the berkdb path,
+   the data is a private copy the caller may take over; the key points into
+   the arena. */
+static int tmpmem_cursor_load(struct temp_cursor *cur,
+                              struct tmpmem_node *leaf, int idx)
+{
+    struct tmpmem_rec *rec = leaf->rec[idx];
+
+    if (cur->data) {
+        free(cur->data);
+        cur->data = NULL;
+    }
+    cur->key = NULL;
+    cur->valid = 0;
+    cur->data = malloc(rec->datalen ? rec->datalen : 1);
+    if (cur->data == NULL)
+        return -1;
+    memcpy(cur->data, rec->buf + rec->keylen, rec->datalen);
+    cur->datalen = rec->datalen;
+    cur->key = rec->buf;
+    cur->keylen = rec->keylen;
+    cur->valid = 1;
+    tmpmem_cursor_place(cur, leaf, idx);
+    return 0;
+}
+
+static int tmpmem_over_budget(bdb_state_type *bdb_state,
+                              struct temp_table *tbl)
+{
+    int total = bdb_state->attr->temptable_mem_total;
+
+    if (tbl->mem_bytes > bdb_state->attr->temptable_mem_bytes)
+        return 1;
+    return total > 0 && gbl_temptable_mem_inuse > total;
+}
+
+static int bdb_temp_table_env_open(bdb_state_type *bdb_state,
+                                   struct temp_table *tbl, int *bdberr);
+static int bdb_temp_table_reset_temp_db(bdb_state_type *bdb_state,
+                                        struct temp_table *tbl, int *bdberr);
+
+/* Move an in-memory table into its berkdb btree, keeping cursor positions. */
+static int bdb_temp_table_mem_spill(bdb_state_type *bdb_state,
+                                    struct temp_table *tbl, int *bdberr)
+{
+    struct tmpmem_node *leaf;
+    struct temp_cursor *cur;
+    DBT dkey, ddata;
+    int i, rc;
+
+    rc = bdb_temp_table_env_open(bdb_state, tbl, bdberr);
+    if (rc)
+        return rc;
+
+    bzero(&dkey, sizeof(DBT));
+    bzero(&ddata, sizeof(DBT));
+    for (leaf = tmpmem_edge(tbl, 0, &i); leaf; leaf = leaf->next) {
+        for (i = 0; i < leaf->n; i++) {
+            struct tmpmem_rec *rec = leaf->rec[i];
+            dkey.data = rec->buf;
+            dkey.size = rec->keylen;
+            ddata.data = rec->buf + rec->keylen;
+            ddata.size = rec->datalen;
+            rc = tbl->tmpdb->put(tbl->tmpdb, NULL, &dkey, &ddata, 0);
+            if (rc) {
+                logmsg(LOGMSG_ERROR, "%s:%d put rc %d\n", __FILE__, __LINE__,
+                       rc);
+                /* stay in memory; don't leave half a copy behind */
+                bdb_temp_table_reset_temp_db(bdb_state, tbl, bdberr);
+                *bdberr = rc;
+                return -1;
+            }
+        }
+    }
+
+    tbl->temp_table_type = TEMP_TABLE_TYPE_BTREE;
+
+    LISTC_FOR_EACH(&tbl->cursors, cur, lnk)
+    {
+        /* the arena is going away: keys become private copies, as they are
+           on the berkdb path */
+        if (cur->key) {
+            void *key = malloc(cur->keylen ? cur->keylen : 1);
+            if (key)
+                memcpy(key, cur->key, cur->keylen);
+            cur->key = key;
+            if (key == NULL)
+                cur->valid = 0;
+        }
+
+        rc = tbl->tmpdb->cursor(tbl->tmpdb, NULL, &cur->cur, 0);
+        if (rc) {
+            cur->cur = NULL;
+            logmsg(LOGMSG_ERROR, "%s:%d cursor rc %d\n", __FILE__, __LINE__,
+                   rc);
+            continue;
+        }
+        if (cur->mem_rec == NULL)
+            continue;
+
+        /* put the berkdb cursor where ours was; if our record was deleted,
+           park on its predecessor so the next step returns its successor */
+        bzero(&dkey, sizeof(DBT));
+        bzero(&ddata, sizeof(DBT));
+        dkey.flags = DB_DBT_USERMEM;
+        dkey.data = cur->mem_rec->buf;
+        dkey.ulen = dkey.size = cur->mem_rec->keylen;
+        ddata.flags = DB_DBT_MALLOC;
+        rc = cur->cur->c_get(cur->cur, &dkey, &ddata, DB_SET);
+        if (rc == DB_NOTFOUND) {
+            rc = cur->cur->c_get(cur->cur, &dkey, &ddata, DB_SET_RANGE);
+            if (rc == 0) {
+                free(ddata.data);
+                ddata.data = NULL;
+                rc = cur->cur->c_get(cur->cur, &dkey, &ddata, DB_PREV);
+            } else {
+                rc = cur->cur->c_get(cur->cur, &dkey, &ddata, DB_LAST);
+            }
+        }
+        if (rc == 0)
+            free(ddata.data);
+        cur->mem_rec = NULL;
+    }
+
+    tmpmem_free(tbl);
+    ATOMIC_ADD(gbl_temptable_mem_spills, 1);
+    return 0;
+}
+
+static int bdb_temp_table_mem_put(bdb_state_type *bdb_state,
+                                  struct temp_table *tbl,
+                                  struct temp_cursor *cur, void *key,
+                                  int keylen, void *data, int dtalen,
+                                  void *unpacked, int *bdberr)
+{
+    struct tmpmem_node *leaf;
+    struct tmpmem_rec *rec;
+    int idx;
+
+    rec = tmpmem_rec_new(tbl, key, keylen, data, dtalen);
+    if (rec == NULL || tmpmem_insert(tbl, rec, unpacked, &leaf, &idx)) {
+        logmsg(LOGMSG_ERROR, "%s: out of memory\n", __func__);
+        *bdberr = ENOMEM;
+        return -1;
+    }
+    /* berkdb leaves a cursor that did a put on the new record */
+    if (cur)
+        tmpmem_cursor_place(cur, leaf, idx);
+
+    if (tmpmem_over_budget(bdb_state, tbl))
+        return bdb_temp_table_mem_spill(bdb_state, tbl, bdberr);
+    return 0;
+}
+
 static int bdb_hash_table_copy_to_temp_db(bdb_state_type *bdb_state,
                                           struct temp_table *tbl, int *bdberr)
 {
@@ -179,6 +816,10 @@ static int bdb_hash_table_copy_to_temp_db(bdb_state_type *bdb_state,
     unsigned int hash_cur_buk;
     char *data;
 
+    rc = bdb_temp_table_env_open(bdb_state, tbl, bdberr);
+    if (rc)
+        return rc;
+
     /* copy the hash to a btree */
     data = hash_first(tbl->temp_hash_tbl, &hash_cur, &hash_cur_buk);
     while (data) {
@@ -312,6 +953,10 @@ static int bdb_temp_table_env_close(bdb_state_type *bdb_state,
         }
         tbl->tmpdb = NULL;
     }
+    if (tbl->dbenv_temp == NULL) {
+        *bdberr = 0;
+        return 0;
+    }
     rc = tbl->dbenv_temp->close(tbl->dbenv_temp, 0);
     if (rc) {
         logmsg(LOGMSG_ERROR, "%s: failed to close dbenv_temp rc=%d\n", __func__, rc);
@@ -325,30 +970,32 @@ static int bdb_temp_table_env_close(bdb_state_type *bdb_state,
 pthread_key_t current_sql_query_key;
 int gbl_debug_temptables = 0;
 
-static struct temp_table *bdb_temp_table_create_main(bdb_state_type *bdb_state,
-                                                     int *bdberr)
+/* Give the table its private berkdb environment and btree; in-memory and
+   hash tables only get one when they spill. */
+static int bdb_temp_table_env_open(bdb_state_type *bdb_state,
+                                   struct temp_table *tbl, int *bdberr)
 {
     int rc;
-    struct temp_table *tbl;
     bdb_state_type *parent;
-    int id;
     DB_ENV *dbenv_temp;
     unsigned int gb = 0, bytes = 0;
 
+    if (tbl->tmpdb)
+        return 0;
+
     if (bdb_state->parent)
         parent = bdb_state->parent;
     else
         parent = bdb_state;
 
-    tbl = calloc(1, sizeof(struct temp_table));
-    tbl->cmpfunc = key_memcmp;
+    if (tbl->dbenv_temp)
+        goto opendb;
 
     rc = db_env_create(&dbenv_temp, 0);
     if (rc != 0) {
         logmsg(LOGMSG_ERROR, "couldnt create temp table env\n");
-        free(tbl);
-        tbl = NULL;
-        goto done;
+        *bdberr = rc;
+        return -1;
     }
 
     if (gbl_crypto) {
@@ -361,9 +1008,7 @@ static struct temp_table *bdb_temp_table_create_main(bdb_state_type *bdb_state,
         if ((rc = dbenv_temp->set_encrypt(dbenv_temp, passwd,
                                           DB_ENCRYPT_AES)) != 0) {
             fprintf(stderr, "%s set_encrypt rc:%d\n", __func__, rc);
-            free(tbl);
-            tbl = NULL;
-            goto done;
+            goto err;
         }
         memset(passwd, 0xff, sizeof(passwd));
     }
@@ -371,9 +1016,7 @@ static struct temp_table *bdb_temp_table_create_main(bdb_state_type *bdb_state,
     rc = dbenv_temp->set_is_tmp_tbl(dbenv_temp, 1);
     if (rc != 0) {
         logmsg(LOGMSG_ERROR, "couldnt set property is_tmp_tbl\n");
-        free(tbl);
-        tbl = NULL;
-        goto done;
+        goto err;
     }
 
     bytes = bdb_state->attr->temptable_cachesz;
@@ -391,29 +1034,60 @@ static struct temp_table *bdb_temp_table_create_main(bdb_state_type *bdb_state,
     rc = dbenv_temp->set_cachesize(dbenv_temp, gb, bytes, 1);
     if (rc != 0) {
         logmsg(LOGMSG_ERROR, "invalid set_cache_size call: gb %d bytes %d\n", gb, bytes);
-        free(tbl);
-        *bdberr = rc;
-        tbl = NULL;
-        goto done;
-    }
-
-    rc = dbenv_temp->set_tmp_dir(dbenv_temp, parent->tmpdir);
-    if (rc) {
-        logmsg(LOGMSG_ERROR, "can't set temp table environment's temp directory");
-        /* continue anyway */
+        goto err;
     }
 
     rc = dbenv_temp->open(dbenv_temp, parent->tmpdir,
                           DB_INIT_MPOOL | DB_CREATE | DB_PRIVATE, 0666);
     if (rc != 0) {
         logmsg(LOGMSG_ERROR, "couldnt open temp table env\n");
-        free(tbl);
-        tbl = NULL;
-        goto done;
+        goto err;
     }
 
     tbl->dbenv_temp = dbenv_temp;
 
+opendb:
+    return bdb_temp_table_reset_temp_db(bdb_state, tbl, bdberr);
+
+err:
+    dbenv_temp->close(dbenv_temp, 0);
+    *bdberr = rc;
+    return -1;
+}
+
+/* (Re)create the btree without losing the table's rowid and entry count. */
+static int bdb_temp_table_reset_temp_db(bdb_state_type *bdb_state,
+                                        struct temp_table *tbl, int *bdberr)
+{
+    unsigned long long rowid = tbl->rowid;
+    unsigned long long num_mem_entries = tbl->num_mem_entries;
+    int rc;
+
+    rc = bdb_temp_table_init_temp_db(bdb_state, tbl, bdberr);
+    tbl->rowid = rowid;
+    tbl->num_mem_entries = num_mem_entries;
+    return rc;
+}
+
+static struct temp_table *bdb_temp_table_create_main(bdb_state_type *bdb_state,
+                                                     int *bdberr)
+{
+    struct temp_table *tbl;
+    bdb_state_type *parent;
+    int id;
+
+    if (bdb_state->parent)
+        parent = bdb_state->parent;
+    else
+        parent = bdb_state;
+
+    tbl = calloc(1, sizeof(struct temp_table));
+    if (tbl == NULL) {
+        *bdberr = ENOMEM;
+        goto done;
+    }
+    tbl->cmpfunc = key_memcmp;
+
     if (gbl_temptable_pool_capacity == 0) {
         Pthread_mutex_lock(&parent->temp_list_lock);
         id = parent->temp_table_id++;
@@ -431,12 +1105,8 @@ static struct temp_table *bdb_temp_table_create_main(bdb_state_type *bdb_state,
 
     tbl->max_mem_entries = bdb_state->attr->temptable_mem_threshold;
 
-    rc = bdb_temp_table_init_temp_db(bdb_state, tbl, bdberr);
-    if (rc) {
-        free(tbl);
-        tbl = NULL;
-        goto done;
-    }
+    /* Start with rowid 2 */
+    tbl->rowid = 2;
 
     listc_init(&tbl->temp_tbl_list, offsetof(struct temp_list_node, lnk));
 
@@ -548,24 +1218,41 @@ static struct temp_table *bdb_temp_table_create_type(bdb_state_type *bdb_state,
         table->num_mem_entries = 0;
         table->cmpfunc = key_memcmp;
         table->temp_table_type = temp_table_type;
+        if (temp_table_type == TEMP_TABLE_TYPE_MEM) {
+            ATOMIC_ADD(gbl_temptable_mem_tables, 1);
+        } else if (temp_table_type == TEMP_TABLE_TYPE_BTREE &&
+                   bdb_temp_table_env_open(bdb_state, table, bdberr)) {
+            int err;
+            bdb_temp_table_close(bdb_state, table, &err);
+            table = NULL;
+        }
     }
 
     return table;
 }
 
+/* btree temp tables live in memory until they outgrow their budget */
+static int bdb_temp_table_btree_type(bdb_state_type *bdb_state)
+{
+    if (bdb_state->attr->temptable_mem_bytes > 0)
+        return TEMP_TABLE_TYPE_MEM;
+    return TEMP_TABLE_TYPE_BTREE;
+}
+
 struct temp_table *bdb_temp_table_create_flags(bdb_state_type *bdb_state,
                                                int flags, int *bdberr)
 {
     int temptype;
 
-    temptype = TEMP_TABLE_TYPE_BTREE;
+    temptype = bdb_temp_table_btree_type(bdb_state);
 
     return bdb_temp_table_create_type(bdb_state, temptype, bdberr);
 }
 
 struct temp_table *bdb_temp_table_create(bdb_state_type *bdb_state, int *bdberr)
 {
-    return bdb_temp_table_create_type(bdb_state, TEMP_TABLE_TYPE_BTREE, bdberr);
+    return bdb_temp_table_create_type(
+        bdb_state, bdb_temp_table_btree_type(bdb_state), bdberr);
 }
 
 struct temp_table *bdb_temp_list_create(bdb_state_type *bdb_state, int *bdberr)
@@ -607,6 +1294,10 @@ struct temp_cursor *bdb_temp_table_cursor(bdb_state_type *bdb_state,
     case TEMP_TABLE_TYPE_BTREE:
         rc = tbl->tmpdb->cursor(tbl->tmpdb, NULL, &cur->cur, 0);
         break;
+
+    case TEMP_TABLE_TYPE_MEM:
+        cur->mem_rec = NULL;
+        break;
     }
 
     if (rc) {
@@ -639,8 +1330,8 @@ int bdb_temp_table_insert(bdb_state_type *bdb_state, struct temp_cursor *cur,
     DBT dkey, ddata;
     struct temp_table *tbl = cur->tbl;
 
-    int rc = bdb_temp_table_insert_put(bdb_state, tbl, key, keylen, data,
-                                       dtalen, bdberr);
+    int rc = bdb_temp_table_insert_put(bdb_state, tbl, cur, key, keylen, data,
+                                       dtalen, NULL, bdberr);
     if (rc <= 0)
         goto done;
 
@@ -676,6 +1367,45 @@ int bdb_temp_table_update(bdb_state_type *bdb_state, struct temp_cursor *cur,
     DBT dkey, ddata;
     int rc = 0;
 
+    if (cur->tbl->temp_table_type == TEMP_TABLE_TYPE_MEM) {
+        struct temp_table *tbl = cur->tbl;
+        struct tmpmem_node *leaf;
+        struct tmpmem_rec *rec;
+        int idx;
+
+        leaf = tmpmem_cursor_slot(cur, &idx);
+        if (leaf == NULL) {
+            *bdberr = DB_KEYEMPTY;
+            return -1;
+        }
+        rec = leaf->rec[idx];
+        if (rec->keylen + dtalen <= rec->cap) {
+            /* other cursors on this record keep their own copy of the
+               data, and the key does not change */
+            memcpy(rec->buf + rec->keylen, data, dtalen);
+            rec->datalen = dtalen;
+            dbgtrace(3, "temp_table_update(cursor %d) = %d\n", cur->curid,
+                     rc);
+            return rc;
+        }
+        struct tmpmem_rec *old = rec;
+        rec = tmpmem_rec_new(tbl, old->buf, old->keylen, data, dtalen);
+        if (rec == NULL) {
+            *bdberr = ENOMEM;
+            return -1;
+        }
+        tmpmem_replace_separators(tbl, old, rec);
+        leaf->rec[idx] = rec;
+        cur->mem_rec = rec;
+        if (cur->key == old->buf)
+            cur->key = rec->buf;
+        tmpmem_rec_unused(tbl, old);
+        if (tmpmem_over_budget(bdb_state, tbl))
+            rc = bdb_temp_table_mem_spill(bdb_state, tbl, bdberr);
+        dbgtrace(3, "temp_table_update(cursor %d) = %d\n", cur->curid, rc);
+        return rc;
+    }
+
     if (cur->tbl->temp_table_type != TEMP_TABLE_TYPE_BTREE) {
         logmsg(LOGMSG_ERROR, "bdb_temp_table_update operation "
                         "only supported for btree.\n");
@@ -719,8 +1449,8 @@ int bdb_temp_table_put(bdb_state_type *bdb_state, struct temp_table *tbl,
 {
     DBT dkey, ddata;
 
-    int rc = bdb_temp_table_insert_put(bdb_state, tbl, key, keylen, data,
-                                       dtalen, bdberr);
+    int rc = bdb_temp_table_insert_put(bdb_state, tbl, NULL, key, keylen, data,
+                                       dtalen, unpacked, bdberr);
     if (rc <= 0)
         goto done;
 
@@ -793,6 +1523,21 @@ static int bdb_temp_table_first_last(bdb_state_type *bdb_state,
         return 0;
     }
 
+    if (cur->tbl->temp_table_type == TEMP_TABLE_TYPE_MEM) {
+        struct tmpmem_node *leaf;
+        int idx;
+
+        cur->valid = 0;
+        leaf = tmpmem_edge(cur->tbl, how == DB_LAST, &idx);
+        if (leaf == NULL)
+            return IX_EMPTY;
+        if (tmpmem_cursor_load(cur, leaf, idx)) {
+            *bdberr = ENOMEM;
+            return -1;
+        }
+        return 0;
+    }
+
     /* if cursor was deleted, need to reopen */
     if (cur->cur == NULL) {
         int rc = cur->tbl->tmpdb->cursor(cur->tbl->tmpdb, NULL, &cur->cur, 0);
@@ -885,6 +1630,39 @@ static int bdb_temp_table_next_prev_norewind(bdb_state_type *bdb_state,
         return 0;
     }
 
+    if (cur->tbl->temp_table_type == TEMP_TABLE_TYPE_MEM) {
+        struct temp_table *tbl = cur->tbl;
+        struct tmpmem_rec *rec = cur->mem_rec;
+        struct tmpmem_node *leaf;
+        int idx, exact;
+
+        if (rec == NULL)
+            return IX_PASTEOF;
+        if (cur->mem_gen == tbl->mem_gen) {
+            leaf = cur->mem_leaf;
+            idx = cur->mem_idx;
+            if (how == DB_NEXT) {
+                idx++;
+                leaf = tmpmem_fwd(leaf, &idx);
+            } else {
+                idx--;
+                leaf = tmpmem_back(leaf, &idx);
+            }
+        } else {
+            /* the tree changed under us, find our neighbour by key */
+            leaf = tmpmem_seek(tbl, rec->keylen, rec->buf, NULL,
+                               how == DB_NEXT ? TMPMEM_SEEK_GT : TMPMEM_SEEK_LT,
+                               &idx, &exact);
+        }
+        if (leaf == NULL)
+            return IX_PASTEOF;
+        if (tmpmem_cursor_load(cur, leaf, idx)) {
+            *bdberr = ENOMEM;
+            return -1;
+        }
+        return IX_FND;
+    }
+
     /* if cursor was deleted, need to reopen */
     if (cur->cur == NULL) {
         int rc = cur->tbl->tmpdb->cursor(cur->tbl->tmpdb, NULL, &cur->cur, 0);
@@ -1146,6 +1924,18 @@ int bdb_temp_table_truncate(bdb_state_type *bdb_state, struct temp_table *tbl,
         }
         break;
 
+    case TEMP_TABLE_TYPE_MEM: {
+        struct temp_cursor *cur;
+        tmpmem_free(tbl);
+        tbl->num_mem_entries = 0;
+        LISTC_FOR_EACH(&tbl->cursors, cur, lnk)
+        {
+            cur->key = NULL;
+            cur->valid = 0;
+            cur->mem_rec = NULL;
+        }
+    } break;
+
     case TEMP_TABLE_TYPE_BTREE:
 
         if (tbl->num_mem_entries < 100)
@@ -1196,8 +1986,9 @@ int bdb_temp_table_close(bdb_state_type *bdb_state, struct temp_table *tbl,
 
     Pthread_mutex_lock(&(bdb_state->temp_list_lock));
 
-    if ((tbl->dbenv_temp->memp_stat(tbl->dbenv_temp, &tmp, NULL,
-                                    DB_STAT_CLEAR)) == 0) {
+    if (tbl->dbenv_temp && (tbl->dbenv_temp->memp_stat(tbl->dbenv_temp, &tmp,
+                                                       NULL,
+                                                       DB_STAT_CLEAR)) == 0) {
         bdb_state->temp_stats->st_gbytes += tmp->st_gbytes;
         bdb_state->temp_stats->st_bytes += tmp->st_bytes;
         bdb_state->temp_stats->st_ncache += tmp->st_ncache;
@@ -1291,8 +2082,9 @@ int bdb_temp_table_destroy_lru(struct temp_table *tbl,
     bdb_state->temp_list = tbl->next;
     *last = 0;
 
-    if ((tbl->dbenv_temp->memp_stat(tbl->dbenv_temp, &tmp, NULL,
-                                    DB_STAT_CLEAR)) == 0) {
+    if (tbl->dbenv_temp && (tbl->dbenv_temp->memp_stat(tbl->dbenv_temp, &tmp,
+                                                       NULL,
+                                                       DB_STAT_CLEAR)) == 0) {
         bdb_state->temp_stats->st_gbytes += tmp->st_gbytes;
         bdb_state->temp_stats->st_bytes += tmp->st_bytes;
         bdb_state->temp_stats->st_ncache += tmp->st_ncache;
@@ -1364,6 +2156,10 @@ int bdb_temp_table_destroy_lru(struct temp_table *tbl,
         hash_clear(tbl->temp_hash_tbl);
     } break;
 
+    case TEMP_TABLE_TYPE_MEM:
+        tmpmem_free(tbl);
+        break;
+
     case TEMP_TABLE_TYPE_BTREE:
         break;
     }
@@ -1402,6 +2198,23 @@ int bdb_temp_table_delete(bdb_state_type *bdb_state, struct temp_cursor *cur,
         goto done;
     }
 
+    if (cur->tbl->temp_table_type == TEMP_TABLE_TYPE_MEM) {
+        struct tmpmem_node *leaf;
+        int idx;
+
+        if (!cur->valid || (leaf = tmpmem_cursor_slot(cur, &idx)) == NULL) {
+            *bdberr = DB_KEYEMPTY;
+            return -1;
+        }
+        /* cursor keeps mem_rec, so the next step finds the neighbours */
+        memmove(&leaf->rec[idx], &leaf->rec[idx + 1],
+                (leaf->n - idx - 1) * sizeof(leaf->rec[0]));
+        leaf->n--;
+        cur->tbl->mem_gen++;
+        rc = 0;
+        goto done;
+    }
+
     /*Pthread_setspecific(cur->tbl->curkey, cur);*/
     if (!cur->valid) {
         rc = -1;
@@ -1509,6 +2322,21 @@ int bdb_temp_table_find(bdb_state_type *bdb_state, struct temp_cursor *cur,
     else if (cur->tbl->temp_table_type == TEMP_TABLE_TYPE_HASH) {
         return bdb_temp_table_find_hash(cur, key, keylen);
     }
+    else if (cur->tbl->temp_table_type == TEMP_TABLE_TYPE_MEM) {
+        struct tmpmem_node *leaf;
+        int idx, exact;
+
+        cur->valid = 0;
+        leaf = tmpmem_seek(cur->tbl, keylen, key, unpacked, TMPMEM_SEEK_GE,
+                           &idx, &exact);
+        if (leaf == NULL) /* find anything at all if possible */
+            return bdb_temp_table_last(bdb_state, cur, bdberr);
+        if (tmpmem_cursor_load(cur, leaf, idx)) {
+            *bdberr = ENOMEM;
+            return -1;
+        }
+        return 0;
+    }
 
     assert(cur->cur != NULL);
 
@@ -1622,6 +2450,24 @@ int bdb_temp_table_find_exact(bdb_state_type *bdb_state,
     else if (cur->tbl->temp_table_type == TEMP_TABLE_TYPE_HASH) {
         return bdb_temp_table_find_exact_hash(cur, key, keylen);
     }
+    else if (cur->tbl->temp_table_type == TEMP_TABLE_TYPE_MEM) {
+        struct tmpmem_node *leaf;
+        int idx;
+
+        cur->valid = 0;
+        leaf = tmpmem_seek(cur->tbl, keylen, key, NULL, TMPMEM_SEEK_GE, &idx,
+                           &exists);
+        if (leaf == NULL || !exists)
+            return IX_NOTFND;
+        if (tmpmem_cursor_load(cur, leaf, idx)) {
+            *bdberr = ENOMEM;
+            return -1;
+        }
+        /* the cursor's key points into the table, so the caller's key is
+           not kept as it is on the berkdb path */
+        free(key);
+        return IX_FND;
+    }
 
     /*Pthread_setspecific(cur->tbl->curkey, cur);*/
 
@@ -1730,6 +2576,10 @@ int bdb_temp_table_close_cursor(bdb_state_type *bdb_state,
            cursor.  The search (custom search routine)
            will need access to thread-specific data. */
         /*Pthread_setspecific(cur->tbl->curkey, NULL);*/
+    } else if (cur->tbl->temp_table_type == TEMP_TABLE_TYPE_MEM) {
+        /* the key lives in the table's arena */
+        free(cur->data);
+        cur->data = NULL;
     }
 
     listc_rfl(&tbl->cursors, cur);
@@ -1804,12 +2654,17 @@ inline int bdb_is_hashtable(struct temp_table *tt)
 }
 
 static int bdb_temp_table_insert_put(bdb_state_type *bdb_state,
-                                     struct temp_table *tbl, void *key,
+                                     struct temp_table *tbl,
+                                     struct temp_cursor *cur, void *key,
                                      int keylen, void *data, int dtalen,
-                                     int *bdberr)
+                                     void *unpacked, int *bdberr)
 {
     int rc;
 
+    if (tbl->temp_table_type == TEMP_TABLE_TYPE_MEM)
+        return bdb_temp_table_mem_put(bdb_state, tbl, cur, key, keylen, data,
+                                      dtalen, unpacked, bdberr);
+
     if (tbl->temp_table_type == TEMP_TABLE_TYPE_LIST) {
         struct temp_list_node *c_node = malloc(sizeof(struct temp_list_node));
         void *list_data = malloc(dtalen);
@@ -1866,7 +2721,8 @@ inline const char *bdb_temp_table_filename(struct temp_table *tbl)
 inline void bdb_temp_table_flush(struct temp_table *tbl)
 {
     DB *db = tbl->tmpdb;
-    db->sync(db, 0);
+    if (db)
+        db->sync(db, 0);
 }
 
 int bdb_temp_table_stat(bdb_state_type *bdb_state, DB_MPOOL_STAT **gspp)
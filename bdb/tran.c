@@ -1575,6 +1575,18 @@ static int bdb_tran_commit_with_seqnum_int_int(
         if (!bdb_state->attr->synctransactions)
             flags |= DB_TXN_NOSYNC;
 
+        /* bring the maintained row counts along with the rows */
+        if (tran->parent == NULL && tran->num_rowcount_deltas &&
+            bdb_rowcount_flush(tran, bdberr)) {
+            if (*bdberr != BDBERR_DEADLOCK)
+                logmsg(LOGMSG_ERROR, "%s:%d failed to update row counts, "
+                                     "bdberr %d\n",
+                       __func__, __LINE__, *bdberr);
+            outrc = -1;
+            tran->tid->abort(tran->tid);
+            goto cleanup;
+        }
+
         bdb_osql_trn_repo_lock();
 
         /* only generate a log for PARENT transactions */
@@ -1674,6 +1686,7 @@ static int bdb_tran_commit_with_seqnum_int_int(
         /* Set the 'committed-child' flag if this is not the parent. */
         if (tran->parent != NULL) {
             tran->parent->committed_child = 1;
+            bdb_rowcount_merge(tran, tran->parent);
         }
 
         break;
@@ -2078,6 +2091,8 @@ cleanup:
         free(tran->table_version_cache);
     tran->table_version_cache = NULL;
 
+    bdb_rowcount_free(tran);
+
     pool_free(tran->rc_pool);
     myfree(tran->rc_list);
     myfree(tran->rc_locks);
@@ -2401,6 +2416,8 @@ cleanup:
         free(tran->table_version_cache);
     tran->table_version_cache = NULL;
 
+    bdb_rowcount_free(tran);
+
     if (tran->pglogs_queue_hash) {
         hash_for(tran->pglogs_queue_hash, free_pglogs_queue_cursors, NULL);
         hash_free(tran->pglogs_queue_hash);
@@ -708,6 +708,13 @@ struct __db_log_stat {
 	u_int32_t st_ondisk_get;	/* On-disk log_get. */
 	u_int32_t st_inmem_trav;	/* Mem-log steps for partial reads. */
 	u_int32_t st_wrap_copy;		/* Count of wrapped copies. */
+	u_int64_t st_gc_flushes;	/* Group-commit flusher syncs. */
+	u_int64_t st_gc_commits;	/* Commits made durable by them. */
+	u_int64_t st_gc_max_flush_us;	/* Slowest group-commit sync. */
+#define	DB_LOG_GC_NBUCKETS	24
+	/* Power-of-two histograms: bucket i counts values in [2^i, 2^(i+1)). */
+	u_int64_t st_gc_batch_hist[DB_LOG_GC_NBUCKETS];
+	u_int64_t st_gc_flush_us_hist[DB_LOG_GC_NBUCKETS];
 };
 
 /*******************************************************
@@ -893,6 +900,16 @@ struct __db_mpool_stat {
 	u_int64_t st_alloc_max_pages;	/* Max checked during allocation. */
 	u_int64_t st_ckp_pages_sync;	/* Number of pages sync'd using perfect ckp. */
 	u_int64_t st_ckp_pages_skip;	/* Number of pages skipped using perfect ckp. */
+	u_int64_t st_alloc_freelist;	/* Allocations from a free list. */
+	u_int64_t st_evict_scan;	/* Buffers passed by the clock hand. */
+	u_int64_t st_evict_max_scan;	/* Max passed in one allocation. */
+	u_int64_t st_evict_us;		/* Time spent evicting to allocate. */
+	u_int64_t st_evict_max_us;	/* Max eviction time of one allocation. */
+	u_int64_t st_probation_evict;	/* Evicted while on probation. */
+	u_int64_t st_clock_promote;	/* Moved from probation to the ring. */
+	u_int64_t st_probation_pages;	/* Buffers on probation. */
+	u_int64_t st_clock_pages;	/* Buffers on the main ring. */
+	u_int64_t st_freelist_pages;	/* Evicted buffers parked for reuse. */
 };
 
 /* Mpool file statistics structure. */
@@ -2838,6 +2855,8 @@ struct __recovery_record {
 	DBT logdbt;	/* log record to apply */
 	DB_LSN lsn;	/* LSN of log record to apply */
 	int fileid;
+	int npgnos;	/* pages touched, -1 if unknown */
+	db_pgno_t pgnos[4];
 	LINKC_T(struct __recovery_record) lnk;
 };
 
@@ -105,6 +105,23 @@ struct __db_log {
 	DB_ENV	 *dbenv;		/* Reference to error information. */
 	REGINFO	  reginfo;		/* Region information. */
 
+/*
+ * Group commit flusher, see log_put.c.  These fields are protected by
+ * gc_lk.
+ */
+	pthread_mutex_t gc_lk;
+	pthread_cond_t gc_work;		/* Flusher waits for committers. */
+	pthread_cond_t gc_done;		/* Committers wait for their epoch. */
+	DB_LSN	  gc_lsn;		/* Highest LSN queued so far. */
+	struct __log_gc_waiter *gc_waiters;/* Committers in the open epoch. */
+	u_int32_t gc_nwaiters;
+	pthread_t gc_td;
+#define	DBLOG_GC_IDLE		0	/* Flusher not started. */
+#define	DBLOG_GC_RUNNING	1
+#define	DBLOG_GC_STOPPING	2	/* Flush what is queued, then exit. */
+#define	DBLOG_GC_OFF		3	/* Stopped, or failed to start. */
+	int	  gc_state;
+
 #define	DBLOG_RECOVER		0x01	/* We are in recovery. */
 #define	DBLOG_FORCE_OPEN	0x02	/* Force the DB open even if it appears
 					 * to be deleted. */
@@ -110,6 +110,24 @@ struct __db_mpreg {
 #define	NBUCKET(mc, mf_offset, pgno)					\
 	(((pgno) ^ ((mf_offset) << 9)) % (mc)->htab_buckets)
 
+/*
+ * BHQ --
+ *	A queue of buffer headers, linked through the cq field.
+ */
+typedef SH_TAILQ_HEAD(__bhq, __bh) BHQ;
+
+/*
+ * MPOOL_FREELIST --
+ *	Evicted buffers of one page size kept for reuse without going back
+ *	through the region allocator.
+ */
+#define	MPOOL_NFREELIST	4
+typedef struct __mpool_freelist {
+	size_t	  pagesize;		/* Page size, 0 if the slot is unused. */
+	u_int32_t count;		/* Buffers on the list. */
+	BHQ	  head;
+} MPOOL_FREELIST;
+
 /*
  * MPOOL --
  *	Shared memory pool region.
@@ -182,6 +200,29 @@ struct __mpool {
 	 * know that none exist.
 	 */
 	DB_LSN	  trickle_lsn;		/* Maximum checkpoint LSN. */
+
+	/*
+	 * Clock/2Q replacement, used instead of the hash bucket sweep when
+	 * the cache was created with memp_clock set.  Buffers read into the
+	 * cache go on the probation queue.  The clock hand works that queue
+	 * while it holds more than its share of the cache, so pages touched
+	 * once by a scan are evicted before the working set.  A buffer
+	 * referenced again while on probation moves to the main ring; one
+	 * referenced on the main ring gets a second chance.
+	 *
+	 * The queues, their counts and the free lists are protected by
+	 * clock_mutex.  It is always acquired last: nothing else is locked
+	 * while holding it.  The alloc_full hint is protected by the region
+	 * lock.
+	 */
+	int	  clock;		/* Clock/2Q replacement is in use. */
+	int	  alloc_full;		/* Region allocator last came up empty. */
+	DB_MUTEX  clock_mutex;
+	BHQ	  probq;		/* Probation queue. */
+	BHQ	  clockq;		/* Main clock ring. */
+	u_int32_t n_probq;
+	u_int32_t n_clockq;
+	MPOOL_FREELIST freelist[MPOOL_NFREELIST];
 };
 
 typedef SH_TAILQ_HEAD(HashTab, __bh) HashTab;
@@ -334,6 +375,14 @@ struct __bh {
 	u_int32_t	priority;	/* LRU priority. */
 	SH_TAILQ_ENTRY(__bh) hq;	/* MPOOL hash bucket queue. */
 
+	/* Clock/2Q state; cq and cq_which are protected by clock_mutex. */
+	SH_TAILQ_ENTRY(__bh) cq;	/* Probation, clock or free queue. */
+#define	BH_CQ_NONE	0
+#define	BH_CQ_PROB	1
+#define	BH_CQ_CLOCK	2
+	u_int8_t	cq_which;	/* Queue the buffer is on. */
+	u_int8_t	cq_ref;		/* Referenced since the hand passed. */
+
 	db_pgno_t pgno;			/* Underlying MPOOLFILE page number. */
 	roff_t	  mf_offset;		/* Associated MPOOLFILE offset. */
 
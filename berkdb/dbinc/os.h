@@ -79,6 +79,16 @@ struct __fh_t {
 	u_int8_t flags;
 };
 
+/* One vectored request in a batch handed to __os_uring_rw. */
+struct __os_uring_req {
+	int	  fd;
+	struct iovec *iov;
+	int	  iovcnt;
+	off_t	  off;
+	size_t	  len;			/* Total bytes described by iov. */
+	ssize_t	  res;			/* Bytes moved, or -errno. */
+};
+
 #if defined(__cplusplus)
 }
 #endif
@@ -0,0 +1,66 @@
+/*
+   Copyright 2019 Bloomberg Finance L.P.
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef _REP_PROFILE_H_
+#define	_REP_PROFILE_H_
+
+#include <stdint.h>
+
+/*
+ * Replicant apply profile.  Each log record a replicant receives goes
+ * through the stages below; the time spent in each is counted into a
+ * power-of-two histogram.  Page apply is also broken down per file.
+ */
+enum rep_apply_stage {
+	REP_STAGE_RECEIVE = 0,	/* net handler entry to rep_process_message */
+	REP_STAGE_ENQUEUE,	/* enqueue, including queue-full waits */
+	REP_STAGE_QUEUE,	/* time on the apply queue */
+	REP_STAGE_APPLY,	/* __rep_apply of a single message */
+	REP_STAGE_GETLOCKS,	/* acquiring a transaction's page/row locks */
+	REP_STAGE_PAGE,		/* dispatching a transaction's records */
+	REP_STAGE_COMMIT,	/* lock release and logical commit */
+	REP_STAGE_MAX
+};
+
+#define	REP_PROFILE_NBUCKETS	32
+
+struct rep_apply_profile {
+	char *stage;
+	char *file;		/* NULL for the all-files row */
+	int64_t count;
+	int64_t records;
+	int64_t total_us;
+	int64_t max_us;
+	int64_t p50_us;
+	int64_t p90_us;
+	int64_t p99_us;
+};
+
+extern int gbl_rep_apply_profile;
+
+/* Set by the net handler when a replication message arrives. */
+extern __thread int64_t rep_profile_recv_us;
+
+struct __db_env;
+
+void __rep_profile_add(int stage, int64_t us);
+void __rep_profile_file(struct __db_env *dbenv, int32_t fileid, int64_t us,
+    int nrecs);
+int __rep_apply_profile_get(struct rep_apply_profile **rows, int *nrows);
+void __rep_apply_profile_free(struct rep_apply_profile *rows, int nrows);
+void __rep_apply_profile_reset(void);
+
+#endif
@@ -26,6 +26,8 @@ static const char revid[] = "$Id: log.c,v 11.133 2003/09/13 19:20:37 bostic Exp
 #include "dbinc/db_swap.h"
 #include "dbinc/txn.h"
 
+#include <locks_wrap.h>
+
 static int	__log_init __P((DB_ENV *, DB_LOG *));
 static int	__log_recover __P((DB_LOG *));
 static size_t	__log_region_size __P((DB_ENV *));
@@ -50,6 +52,9 @@ __log_open(dbenv)
 	if ((ret = __os_calloc(dbenv, 1, sizeof(DB_LOG), &dblp)) != 0)
 		return (ret);
 	dblp->dbenv = dbenv;
+	Pthread_mutex_init(&dblp->gc_lk, NULL);
+	Pthread_cond_init(&dblp->gc_work, NULL);
+	Pthread_cond_init(&dblp->gc_done, NULL);
 
 	/* Join/create the log region. */
 	dblp->reginfo.type = REGION_TYPE_LOG;
@@ -158,6 +163,9 @@ err:	dbenv->lg_handle = NULL;
 	if (dblp->mutexp != NULL)
 		__db_mutex_free(dbenv, &dblp->reginfo, dblp->mutexp);
 
+	Pthread_cond_destroy(&dblp->gc_done);
+	Pthread_cond_destroy(&dblp->gc_work);
+	Pthread_mutex_destroy(&dblp->gc_lk);
 	__os_free(dbenv, dblp);
 
 	return (ret);
@@ -843,6 +851,9 @@ __log_dbenv_refresh(dbenv)
 
 	dblp = dbenv->lg_handle;
 
+	/* Stop the group commit flusher before the region goes away. */
+	__log_group_commit_stop(dblp);
+
 	/* We may have opened files as part of XA; if so, close them. */
 	F_SET(dblp, DBLOG_RECOVER);
 	ret = __dbreg_close_files(dbenv);
@@ -870,6 +881,9 @@ __log_dbenv_refresh(dbenv)
 	void *p = R_ADDR(&dblp->reginfo, region->buffer_off);
 	__os_free(dbenv, p);
 
+	Pthread_cond_destroy(&dblp->gc_done);
+	Pthread_cond_destroy(&dblp->gc_work);
+	Pthread_mutex_destroy(&dblp->gc_lk);
 	__os_free(dbenv, dblp);
 
 	dbenv->lg_handle = NULL;
@@ -903,6 +903,195 @@ __write_inmemory_buffer(dblp, write_all)
 }
 
 
+uint64_t bb_berkdb_fasttime(void);
+
+int gbl_log_group_commit = 0;
+int gbl_log_group_commit_wait_us = 200;
+
+/*
+ * Group commit.  Committers that need their commit record on disk queue
+ * their LSN and sleep.  A flusher thread per log handle holds each epoch
+ * open for up to log_group_commit_wait_us so that more committers can join
+ * (unless only one is waiting), makes the highest queued LSN durable with
+ * one write and sync, then hands the result to each committer of the epoch.
+ */
+struct __log_gc_waiter {
+	struct __log_gc_waiter *next;
+	int done;			/* Epoch flushed. */
+	int ret;			/* Result of this epoch's flush. */
+};
+
+static inline int
+__log_gc_bucket(u_int64_t v)
+{
+	int b;
+
+	for (b = 0; v > 1 && b < DB_LOG_GC_NBUCKETS - 1; b++)
+		v >>= 1;
+	return (b);
+}
+
+static void *
+__log_group_commit_td(arg)
+	void *arg;
+{
+	DB_ENV *dbenv;
+	DB_LOG *dblp;
+	DB_LSN lsn;
+	LOG *lp;
+	struct __log_gc_waiter *epoch, *w;
+	struct timespec ts;
+	u_int64_t start, us;
+	u_int32_t n;
+	int ret;
+
+	dblp = (DB_LOG *)arg;
+	dbenv = dblp->dbenv;
+	lp = dblp->reginfo.primary;
+
+	Pthread_mutex_lock(&dblp->gc_lk);
+	for (;;) {
+		while (dblp->gc_nwaiters == 0 &&
+		    dblp->gc_state == DBLOG_GC_RUNNING)
+			Pthread_cond_wait(&dblp->gc_work, &dblp->gc_lk);
+		if (dblp->gc_nwaiters == 0)
+			break;
+
+		/*
+		 * Hold the epoch open so that more committers can join, if
+		 * others are already queueing up behind the first one.
+		 */
+		if (gbl_log_group_commit_wait_us > 0 &&
+		    dblp->gc_nwaiters > 1 &&
+		    dblp->gc_state == DBLOG_GC_RUNNING) {
+			clock_gettime(CLOCK_REALTIME, &ts);
+			ts.tv_nsec += gbl_log_group_commit_wait_us * 1000L;
+			ts.tv_sec += ts.tv_nsec / 1000000000L;
+			ts.tv_nsec %= 1000000000L;
+			while (dblp->gc_state == DBLOG_GC_RUNNING &&
+			    pthread_cond_timedwait(&dblp->gc_work,
+			    &dblp->gc_lk, &ts) != ETIMEDOUT)
+				;
+		}
+
+		/* Close the epoch; later committers start the next one. */
+		epoch = dblp->gc_waiters;
+		lsn = dblp->gc_lsn;
+		n = dblp->gc_nwaiters;
+		dblp->gc_waiters = NULL;
+		dblp->gc_nwaiters = 0;
+		Pthread_mutex_unlock(&dblp->gc_lk);
+
+		start = bb_berkdb_fasttime();
+		R_LOCK(dbenv, &dblp->reginfo);
+		ret = __log_flush_int(dblp, &lsn, 1);
+		us = bb_berkdb_fasttime() - start;
+
+		lp->stat.st_gc_flushes++;
+		lp->stat.st_gc_commits += n;
+		if (us > lp->stat.st_gc_max_flush_us)
+			lp->stat.st_gc_max_flush_us = us;
+		lp->stat.st_gc_batch_hist[__log_gc_bucket(n)]++;
+		lp->stat.st_gc_flush_us_hist[__log_gc_bucket(us)]++;
+		R_UNLOCK(dbenv, &dblp->reginfo);
+
+		Pthread_mutex_lock(&dblp->gc_lk);
+		for (w = epoch; w != NULL; w = w->next) {
+			w->ret = ret;
+			w->done = 1;
+		}
+		Pthread_cond_broadcast(&dblp->gc_done);
+	}
+
+	Pthread_mutex_unlock(&dblp->gc_lk);
+	return NULL;
+}
+
+/*
+ * __log_group_commit_stop --
+ *	Flush what is queued for the group commit flusher, and stop and join
+ *	it.  Later commits flush inline.
+ *
+ * PUBLIC: void __log_group_commit_stop __P((DB_LOG *));
+ */
+void
+__log_group_commit_stop(dblp)
+	DB_LOG *dblp;
+{
+	int running;
+
+	Pthread_mutex_lock(&dblp->gc_lk);
+	running = dblp->gc_state == DBLOG_GC_RUNNING;
+	dblp->gc_state = running ? DBLOG_GC_STOPPING : DBLOG_GC_OFF;
+	Pthread_cond_signal(&dblp->gc_work);
+	Pthread_mutex_unlock(&dblp->gc_lk);
+
+	if (!running)
+		return;
+
+	pthread_join(dblp->gc_td, NULL);
+
+	Pthread_mutex_lock(&dblp->gc_lk);
+	dblp->gc_state = DBLOG_GC_OFF;
+	Pthread_mutex_unlock(&dblp->gc_lk);
+}
+
+/*
+ * __log_group_commit --
+ *	Queue a commit LSN for the flusher and wait until its epoch is on
+ *	disk.  Called, and returns, with the region locked.
+ */
+static int
+__log_group_commit(dblp, lsnp)
+	DB_LOG *dblp;
+	const DB_LSN *lsnp;
+{
+	DB_ENV *dbenv;
+	LOG *lp;
+	struct __log_gc_waiter w;
+	int ret;
+
+	dbenv = dblp->dbenv;
+	lp = dblp->reginfo.primary;
+
+	/* Already durable. */
+	if (log_compare(&lp->s_lsn, lsnp) > 0)
+		return (0);
+
+	Pthread_mutex_lock(&dblp->gc_lk);
+	if (dblp->gc_state == DBLOG_GC_IDLE) {
+		/* Started lazily, like the segmented log writer thread. */
+		if ((ret = pthread_create(&dblp->gc_td, NULL,
+		    __log_group_commit_td, dblp)) != 0) {
+			__db_err(dbenv,
+			    "DB_ENV->log_group_commit: error creating pthread");
+			dblp->gc_state = DBLOG_GC_OFF;
+		} else
+			dblp->gc_state = DBLOG_GC_RUNNING;
+	}
+	if (dblp->gc_state != DBLOG_GC_RUNNING) {
+		Pthread_mutex_unlock(&dblp->gc_lk);
+		return (__log_flush_int(dblp, lsnp, 1));
+	}
+
+	R_UNLOCK(dbenv, &dblp->reginfo);
+
+	if (log_compare(&dblp->gc_lsn, lsnp) < 0)
+		dblp->gc_lsn = *lsnp;
+	w.done = 0;
+	w.ret = 0;
+	w.next = dblp->gc_waiters;
+	dblp->gc_waiters = &w;
+	if (dblp->gc_nwaiters++ == 0)
+		Pthread_cond_signal(&dblp->gc_work);
+	while (!w.done)
+		Pthread_cond_wait(&dblp->gc_done, &dblp->gc_lk);
+	Pthread_mutex_unlock(&dblp->gc_lk);
+
+	R_LOCK(dbenv, &dblp->reginfo);
+	return (w.ret);
+}
+
 /*
  * __log_flush_commit --
  *	Flush a record.
@@ -931,9 +1120,12 @@ __log_flush_commit(dbenv, lsnp, flags)
 	 * DB_LOG_WRNOSYNC:
 	 *	If there's anything in the current log buffer, write it out.
 	 */
-	if (LF_ISSET(DB_FLUSH))
-		ret = __log_flush_int(dblp, &flush_lsn, 1);
-	else if (!__inmemory_buf_empty(lp)) {
+	if (LF_ISSET(DB_FLUSH)) {
+		if (gbl_log_group_commit)
+			ret = __log_group_commit(dblp, &flush_lsn);
+		else
+			ret = __log_flush_int(dblp, &flush_lsn, 1);
+	} else if (!__inmemory_buf_empty(lp)) {
 		if ((ret = __write_inmemory_buffer(dblp, 1)) == 0)
 			lp->b_off = 0;
 	}
@@ -40,6 +40,8 @@ typedef struct {
 } HS;
 
 static void __memp_bad_buffer __P((DB_MPOOL_HASH *));
+static int __memp_alloc_clock __P((DB_MPOOL *,
+    REGINFO *, MPOOLFILE *, size_t, roff_t *, void *));
 
 // PUBLIC: int __memp_dump_bufferpool_info __P((DB_ENV *, FILE *));
 int
@@ -201,6 +203,16 @@ static void dump_page_stats(DB_ENV *dbenv) {
 	logmsgf(LOGMSG_USER, out, "st_alloc_pages: %"PRId64"\n", mpool_stats->st_alloc_pages);
 	logmsgf(LOGMSG_USER, out, "st_alloc_max_pages: %"PRId64"\n",
 		mpool_stats->st_alloc_max_pages);
+	logmsgf(LOGMSG_USER, out, "st_evict_scan: %"PRId64"\n",
+		mpool_stats->st_evict_scan);
+	logmsgf(LOGMSG_USER, out, "st_evict_max_scan: %"PRId64"\n",
+		mpool_stats->st_evict_max_scan);
+	logmsgf(LOGMSG_USER, out, "st_evict_us: %"PRId64"\n",
+		mpool_stats->st_evict_us);
+	logmsgf(LOGMSG_USER, out, "st_evict_max_us: %"PRId64"\n",
+		mpool_stats->st_evict_max_us);
+	logmsgf(LOGMSG_USER, out, "st_freelist_pages: %"PRId64"\n",
+		mpool_stats->st_freelist_pages);
 
 	for(; fsp != NULL && *fsp != NULL; ++fsp)
 	{
@@ -225,6 +237,9 @@ static void dump_page_stats(DB_ENV *dbenv) {
 
 
 int gbl_debug_memp_alloc_size = 0;
+int gbl_memp_clock = 0;
+int gbl_memp_probation_pct = 25;
+int gbl_memp_evict_batch = 4;
 static pthread_mutex_t dump_once_lk = PTHREAD_MUTEX_INITIALIZER;
 /*
  * PUBLIC: int __memp_alloc_flags __P((DB_MPOOL *, REGINFO *,
@@ -259,6 +274,10 @@ __memp_alloc_flags(dbmp, memreg, mfp, len, offsetp, flags, retp)
 		       (mfp ? mfp->stat.st_pagesize : 0));
 	}
 
+	if (((MPOOL *)memreg->primary)->clock)
+		return (__memp_alloc_clock(dbmp,
+		    memreg, mfp, len, offsetp, retp));
+
 	dbenv = dbmp->dbenv;
 	c_mp = memreg->primary;
 	dbht = R_ADDR(memreg, c_mp->htab);
@@ -604,6 +623,483 @@ __memp_alloc(dbmp, memreg, mfp, len, offsetp, retp)
 	return __memp_alloc_flags(dbmp, memreg, mfp, len, offsetp, 0, retp);
 }
 
+/*
+ * __memp_clock_link --
+ *	Put a buffer just brought into the cache on the probation queue.
+ *	Called with the buffer's hash bucket locked.
+ *
+ * PUBLIC: void __memp_clock_link __P((DB_ENV *, MPOOL *, BH *));
+ */
+void
+__memp_clock_link(dbenv, c_mp, bhp)
+	DB_ENV *dbenv;
+	MPOOL *c_mp;
+	BH *bhp;
+{
+	MUTEX_LOCK(dbenv, &c_mp->clock_mutex);
+	bhp->cq_which = BH_CQ_PROB;
+	bhp->cq_ref = 0;
+	SH_TAILQ_INSERT_TAIL(&c_mp->probq, bhp, cq);
+	++c_mp->n_probq;
+	MUTEX_UNLOCK(dbenv, &c_mp->clock_mutex);
+}
+
+/*
+ * __memp_clock_unlink --
+ *	Take a buffer off the clock.  Called with the buffer's hash bucket
+ *	locked, before the buffer is freed or reused.
+ *
+ * PUBLIC: void __memp_clock_unlink __P((DB_ENV *, MPOOL *, BH *));
+ */
+void
+__memp_clock_unlink(dbenv, c_mp, bhp)
+	DB_ENV *dbenv;
+	MPOOL *c_mp;
+	BH *bhp;
+{
+	if (bhp->cq_which == BH_CQ_NONE)
+		return;
+
+	MUTEX_LOCK(dbenv, &c_mp->clock_mutex);
+	if (bhp->cq_which == BH_CQ_PROB) {
+		SH_TAILQ_REMOVE(&c_mp->probq, bhp, cq, __bh);
+		--c_mp->n_probq;
+	} else {
+		SH_TAILQ_REMOVE(&c_mp->clockq, bhp, cq, __bh);
+		--c_mp->n_clockq;
+	}
+	bhp->cq_which = BH_CQ_NONE;
+	MUTEX_UNLOCK(dbenv, &c_mp->clock_mutex);
+}
+
+/*
+ * __memp_freelist_put --
+ *	Park an evicted buffer on the free list for its page size.  Returns
+ *	non-zero if every free list slot is taken by another page size.
+ */
+static int
+__memp_freelist_put(dbenv, c_mp, pagesize, bhp)
+	DB_ENV *dbenv;
+	MPOOL *c_mp;
+	size_t pagesize;
+	BH *bhp;
+{
+	MPOOL_FREELIST *fl, *slot;
+	int i;
+
+	slot = NULL;
+	MUTEX_LOCK(dbenv, &c_mp->clock_mutex);
+	for (i = 0; i < MPOOL_NFREELIST; i++) {
+		fl = &c_mp->freelist[i];
+		if (fl->pagesize == pagesize) {
+			slot = fl;
+			break;
+		}
+		if (slot == NULL && fl->count == 0)
+			slot = fl;
+	}
+	if (slot != NULL) {
+		slot->pagesize = pagesize;
+		SH_TAILQ_INSERT_HEAD(&slot->head, bhp, cq, __bh);
+		++slot->count;
+	}
+	MUTEX_UNLOCK(dbenv, &c_mp->clock_mutex);
+
+	return (slot == NULL);
+}
+
+/*
+ * __memp_freelist_get --
+ *	Take a parked buffer for the given page size, or return NULL.
+ */
+static BH *
+__memp_freelist_get(dbenv, c_mp, pagesize)
+	DB_ENV *dbenv;
+	MPOOL *c_mp;
+	size_t pagesize;
+{
+	MPOOL_FREELIST *fl;
+	BH *bhp;
+	int i;
+
+	bhp = NULL;
+	MUTEX_LOCK(dbenv, &c_mp->clock_mutex);
+	for (i = 0; i < MPOOL_NFREELIST; i++) {
+		fl = &c_mp->freelist[i];
+		if (fl->pagesize != pagesize || fl->count == 0)
+			continue;
+		bhp = SH_TAILQ_FIRST(&fl->head, __bh);
+		SH_TAILQ_REMOVE(&fl->head, bhp, cq, __bh);
+		--fl->count;
+		break;
+	}
+	MUTEX_UNLOCK(dbenv, &c_mp->clock_mutex);
+
+	return (bhp);
+}
+
+/*
+ * __memp_freelist_drain --
+ *	Return every parked buffer to the region allocator so the space can
+ *	coalesce.  Called with the region locked; returns the number freed.
+ */
+static u_int32_t
+__memp_freelist_drain(dbenv, memreg)
+	DB_ENV *dbenv;
+	REGINFO *memreg;
+{
+	BHQ drain;
+	BH *bhp;
+	MPOOL *c_mp;
+	u_int32_t n;
+	int i;
+
+	c_mp = memreg->primary;
+	SH_TAILQ_INIT(&drain);
+	n = 0;
+
+	MUTEX_LOCK(dbenv, &c_mp->clock_mutex);
+	for (i = 0; i < MPOOL_NFREELIST; i++) {
+		while ((bhp = SH_TAILQ_FIRST(
+		    &c_mp->freelist[i].head, __bh)) != NULL) {
+			SH_TAILQ_REMOVE(&c_mp->freelist[i].head, bhp, cq, __bh);
+			SH_TAILQ_INSERT_HEAD(&drain, bhp, cq, __bh);
+		}
+		c_mp->freelist[i].count = 0;
+	}
+	MUTEX_UNLOCK(dbenv, &c_mp->clock_mutex);
+
+	while ((bhp = SH_TAILQ_FIRST(&drain, __bh)) != NULL) {
+		SH_TAILQ_REMOVE(&drain, bhp, cq, __bh);
+		__db_shalloc_free(memreg->addr, bhp);
+		c_mp->stat.st_pages--;
+		++n;
+	}
+	if (n != 0)
+		c_mp->alloc_full = 0;
+	return (n);
+}
+
+/*
+ * __memp_clock_victim --
+ *	Advance the clock hand to the next buffer worth evicting.  The
+ *	probation queue is worked while it holds more than memp_probation_pct
+ *	of the cache's buffers, the main ring otherwise.  A referenced buffer
+ *	on probation is promoted to the main ring; a referenced buffer on the
+ *	main ring has its bit cleared and goes round again.  Pinned buffers,
+ *	and dirty ones unless we are aggressive, are passed over.
+ *
+ *	Returns the buffer with its hash bucket locked, or NULL once the hand
+ *	has gone twice round without finding anything.
+ */
+static BH *
+__memp_clock_victim(dbmp, memreg, aggressive, scannedp, hpp)
+	DB_MPOOL *dbmp;
+	REGINFO *memreg;
+	int aggressive;
+	u_int32_t *scannedp;
+	DB_MPOOL_HASH **hpp;
+{
+	BH *bhp, *tbhp;
+	BHQ *q;
+	DB_ENV *dbenv;
+	DB_MPOOL_HASH *dbht, *hp;
+	MPOOL *c_mp;
+	db_pgno_t pgno;
+	roff_t mf_offset;
+	u_int32_t limit, target, turn;
+
+	dbenv = dbmp->dbenv;
+	c_mp = memreg->primary;
+	dbht = R_ADDR(memreg, c_mp->htab);
+	limit = 0;
+
+	for (turn = 0;; ++turn) {
+		MUTEX_LOCK(dbenv, &c_mp->clock_mutex);
+		if (limit == 0)
+			limit = 2 * (c_mp->n_probq + c_mp->n_clockq) + 1;
+		if (turn >= limit) {
+			MUTEX_UNLOCK(dbenv, &c_mp->clock_mutex);
+			return (NULL);
+		}
+
+		target = (u_int32_t)(((u_int64_t)c_mp->n_probq +
+		    c_mp->n_clockq) * gbl_memp_probation_pct / 100);
+		if (c_mp->n_probq != 0 &&
+		    (c_mp->n_probq > target || c_mp->n_clockq == 0))
+			q = &c_mp->probq;
+		else
+			q = &c_mp->clockq;
+		if ((bhp = SH_TAILQ_FIRST(q, __bh)) == NULL) {
+			MUTEX_UNLOCK(dbenv, &c_mp->clock_mutex);
+			return (NULL);
+		}
+		++*scannedp;
+
+		/* Move the hand past the buffer, whatever we decide. */
+		SH_TAILQ_REMOVE(q, bhp, cq, __bh);
+		if (bhp->cq_ref && bhp->priority != 0) {
+			bhp->cq_ref = 0;
+			if (bhp->cq_which == BH_CQ_PROB) {
+				--c_mp->n_probq;
+				++c_mp->n_clockq;
+				bhp->cq_which = BH_CQ_CLOCK;
+				++c_mp->stat.st_clock_promote;
+			}
+			SH_TAILQ_INSERT_TAIL(&c_mp->clockq, bhp, cq);
+			if (!aggressive) {
+				MUTEX_UNLOCK(dbenv, &c_mp->clock_mutex);
+				continue;
+			}
+		} else
+			SH_TAILQ_INSERT_TAIL(q, bhp, cq);
+
+		/*
+		 * The pin count and flags are read without the bucket lock;
+		 * they are checked again once we hold it.
+		 */
+		if (bhp->ref != 0 ||
+		    (!aggressive && F_ISSET(bhp, BH_DIRTY))) {
+			if (bhp->ref == 0)
+				++c_mp->stat.st_rw_evict_skip;
+			MUTEX_UNLOCK(dbenv, &c_mp->clock_mutex);
+			continue;
+		}
+
+		/*
+		 * The buffer can't be freed while it is on a queue, so its
+		 * identity is stable here.  Once we let go of the clock it
+		 * may be, so look it up again under the bucket lock.
+		 */
+		mf_offset = bhp->mf_offset;
+		pgno = bhp->pgno;
+		MUTEX_UNLOCK(dbenv, &c_mp->clock_mutex);
+
+		hp = &dbht[NBUCKET(c_mp, mf_offset, pgno)];
+		MUTEX_LOCK(dbenv, &hp->hash_mutex);
+		SH_TAILQ_FOREACH(tbhp, &hp->hash_bucket, hq, __bh)
+			if (tbhp == bhp)
+				break;
+		if (tbhp != NULL && bhp->mf_offset == mf_offset &&
+		    bhp->pgno == pgno && bhp->ref == 0) {
+			*hpp = hp;
+			return (bhp);
+		}
+		MUTEX_UNLOCK(dbenv, &hp->hash_mutex);
+	}
+	/* NOTREACHED */
+}
+
+/*
+ * __memp_alloc_clock --
+ *	__memp_alloc_flags for caches using clock/2Q replacement.
+ *
+ *	A page-sized request is served from the free list for its page size
+ *	if possible, which needs no region lock.  Otherwise we try the region
+ *	allocator, unless it came up empty last time and nothing was freed
+ *	to it since.  Failing that, the clock hand picks victims: the first
+ *	one of the right size is returned, and up to memp_evict_batch - 1
+ *	more are parked on the free list for the next callers.  Victims of
+ *	another size are freed back to the region until we have freed 3
+ *	times what we need, as in the hash bucket sweep.
+ */
+static int
+__memp_alloc_clock(dbmp, memreg, mfp, len, offsetp, retp)
+	DB_MPOOL *dbmp;
+	REGINFO *memreg;
+	MPOOLFILE *mfp;
+	size_t len;
+	roff_t *offsetp;
+	void *retp;
+{
+	BH *bhp;
+	DB_ENV *dbenv;
+	DB_MPOOL_HASH *hp;
+	MPOOL *c_mp;
+	MPOOLFILE *bh_mfp;
+	size_t freed_space, pagesize;
+	u_int32_t evicted, put_counter, scanned;
+	u_int64_t evict_us, start_us;
+	int aggressive, giveup, ret, sleeptime;
+	void *p;
+
+	dbenv = dbmp->dbenv;
+	c_mp = memreg->primary;
+	evicted = put_counter = scanned = 0;
+	aggressive = giveup = sleeptime = 0;
+	start_us = 0;
+	pagesize = 0;
+	p = NULL;
+
+	c_mp->stat.st_alloc++;
+
+	if (mfp != NULL) {
+		pagesize = mfp->stat.st_pagesize;
+		len = (sizeof(BH) - sizeof(u_int8_t)) + pagesize;
+		if ((p = __memp_freelist_get(dbenv, c_mp, pagesize)) != NULL) {
+			++c_mp->stat.st_alloc_freelist;
+			goto found;
+		}
+	}
+
+alloc:	R_LOCK(dbenv, memreg);
+	if (mfp == NULL || !c_mp->alloc_full) {
+		if ((ret = __db_shalloc(memreg->addr,
+		    len, MUTEX_ALIGN, &p)) == 0 ||
+		    (__memp_freelist_drain(dbenv, memreg) != 0 &&
+		    (ret = __db_shalloc(memreg->addr,
+		    len, MUTEX_ALIGN, &p)) == 0)) {
+			if (mfp != NULL)
+				c_mp->stat.st_pages++;
+			R_UNLOCK(dbenv, memreg);
+			goto found;
+		}
+		if (mfp != NULL)
+			c_mp->alloc_full = 1;
+	}
+	if (giveup || c_mp->stat.st_pages == 0) {
+		R_UNLOCK(dbenv, memreg);
+		logmsg(LOGMSG_FATAL,
+		    "unable to allocate space from the buffer cache\n");
+		abort();
+	}
+	R_UNLOCK(dbenv, memreg);
+
+	if (start_us == 0)
+		start_us = bb_berkdb_fasttime();
+	freed_space = 0;
+
+	for (;;) {
+		if ((bhp = __memp_clock_victim(dbmp,
+		    memreg, aggressive, &scanned, &hp)) == NULL) {
+			if (p != NULL)
+				goto found;
+			if (freed_space > 0)
+				goto alloc;
+
+			/* Same escalation as the hash bucket sweep. */
+			switch (++aggressive) {
+			case 1:
+				break;
+			case 2:
+				put_counter = c_mp->put_counter;
+				/* FALLTHROUGH */
+			case 3:
+			case 4:
+			case 5:
+			case 6:
+				(void)__memp_sync_int(dbenv, NULL, 0,
+				    DB_SYNC_ALLOC, NULL, 0, NULL, 0);
+
+				sleeptime++;
+				if (__gbl_max_mpalloc_sleeptime &&
+				    sleeptime > __gbl_max_mpalloc_sleeptime) {
+					Pthread_mutex_lock(&dump_once_lk);
+					alarm(10);
+					dump_page_stats(dbenv);
+					_exit(1);
+				}
+				(void)__os_sleep(dbenv, 1, 0);
+				break;
+			default:
+				aggressive = 1;
+				if (put_counter == c_mp->put_counter)
+					giveup = 1;
+				break;
+			}
+			goto alloc;
+		}
+
+		/* We hold the bucket lock and the buffer is unpinned. */
+		bh_mfp = R_ADDR(dbmp->reginfo, bhp->mf_offset);
+		if (F_ISSET(bhp, BH_PREFAULT))
+			++c_mp->stat.st_pf_evict;
+
+		ret = 0;
+		if (F_ISSET(bhp, BH_DIRTY)) {
+			if (!aggressive) {
+				++c_mp->stat.st_rw_evict_skip;
+				MUTEX_UNLOCK(dbenv, &hp->hash_mutex);
+				continue;
+			}
+			++bhp->ref;
+			ret = __memp_bhwrite(dbmp, hp, bh_mfp, bhp, 0);
+			--bhp->ref;
+			if (ret == 0) {
+				++c_mp->stat.st_rw_evict;
+				if (ISLEAF(bhp->buf))
+					++c_mp->stat.st_rw_levict;
+			}
+		} else {
+			++c_mp->stat.st_ro_evict;
+			if (ISLEAF(bhp->buf))
+				++c_mp->stat.st_ro_levict;
+		}
+
+		/* As in the sweep: a failed write or a new pin loses it. */
+		if (ret != 0 || bhp->ref != 0) {
+			MUTEX_UNLOCK(dbenv, &hp->hash_mutex);
+			continue;
+		}
+
+		if (bhp->cq_which == BH_CQ_PROB)
+			++c_mp->stat.st_probation_evict;
+		GET_BH_GEN(&bhp->buf) = 0;
+
+		if (mfp != NULL && bh_mfp->stat.st_pagesize == pagesize) {
+			__memp_bhfree(dbmp, hp, bhp, 0);
+			if (p == NULL)
+				p = bhp;
+			else if (__memp_freelist_put(dbenv,
+			    c_mp, pagesize, bhp) != 0) {
+				R_LOCK(dbenv, memreg);
+				__db_shalloc_free(memreg->addr, bhp);
+				c_mp->stat.st_pages--;
+				c_mp->alloc_full = 0;
+				R_UNLOCK(dbenv, memreg);
+				goto found;
+			}
+			if ((int)++evicted >= gbl_memp_evict_batch)
+				goto found;
+			continue;
+		}
+
+		/* Only batch buffers of the size we already have. */
+		if (p != NULL) {
+			MUTEX_UNLOCK(dbenv, &hp->hash_mutex);
+			goto found;
+		}
+
+		freed_space += __db_shsizeof(bhp);
+		__memp_bhfree(dbmp, hp, bhp, 1);
+		if (aggressive > 1)
+			aggressive = 1;
+		if (freed_space >= 3 * len)
+			goto alloc;
+	}
+
+found:	if (offsetp != NULL)
+		*offsetp = R_OFFSET(memreg, p);
+	*(void **)retp = p;
+
+	/*
+	 * Update the eviction statistics.  We're not holding the region
+	 * locked, these can't be trusted.
+	 */
+	if (scanned != 0) {
+		c_mp->stat.st_evict_scan += scanned;
+		if (scanned > c_mp->stat.st_evict_max_scan)
+			c_mp->stat.st_evict_max_scan = scanned;
+	}
+	if (start_us != 0) {
+		evict_us = bb_berkdb_fasttime() - start_us;
+		c_mp->stat.st_evict_us += evict_us;
+		if (evict_us > c_mp->stat.st_evict_max_us)
+			c_mp->stat.st_evict_max_us = evict_us;
+	}
+	return (0);
+}
+
 
 /*
  * __memp_bad_buffer --
@@ -1256,6 +1256,7 @@ __memp_bhfree(dbmp, hp, bhp, free_mem)
 	dbenv = dbmp->dbenv;
 	mp = dbmp->reginfo[0].primary;
 	n_cache = NCACHE(mp, bhp->mf_offset, bhp->pgno);
+	c_mp = dbmp->reginfo[n_cache].primary;
 
 	/*
 	 * Delete the buffer header from the hash bucket queue and reset
@@ -1267,6 +1268,9 @@ __memp_bhfree(dbmp, hp, bhp, free_mem)
 		    SH_TAILQ_FIRST(&hp->hash_bucket, __bh) == NULL ?
 		    0 : SH_TAILQ_FIRST(&hp->hash_bucket, __bh)->priority;
 
+	/* Take it off the clock before anyone can reuse the memory. */
+	__memp_clock_unlink(dbenv, c_mp, bhp);
+
 	/*
 	 * Discard the hash bucket's mutex, it's no longer needed, and
 	 * we don't want to be holding it when acquiring other locks.
@@ -1299,8 +1303,8 @@ __memp_bhfree(dbmp, hp, bhp, free_mem)
 	 */
 	if (free_mem) {
 		__db_shalloc_free(dbmp->reginfo[n_cache].addr, bhp);
-		c_mp = dbmp->reginfo[n_cache].primary;
 		c_mp->stat.st_pages--;
+		c_mp->alloc_full = 0;
 	}
 	R_UNLOCK(dbenv, &dbmp->reginfo[n_cache]);
 }
@@ -565,6 +565,7 @@ alloc:		/*
 				__db_shalloc_free(
 				    dbmp->reginfo[n_cache].addr, alloc_bhp);
 				c_mp->stat.st_pages--;
+				c_mp->alloc_full = 0;
 				R_UNLOCK(dbenv, &dbmp->reginfo[n_cache]);
 
 				alloc_bhp = NULL;
@@ -610,6 +611,7 @@ alloc:		/*
 		R_LOCK(dbenv, &dbmp->reginfo[n_cache]);
 		__db_shalloc_free(dbmp->reginfo[n_cache].addr, alloc_bhp);
 		c_mp->stat.st_pages--;
+		c_mp->alloc_full = 0;
 		alloc_bhp = NULL;
 		R_UNLOCK(dbenv, &dbmp->reginfo[n_cache]);
 
@@ -658,6 +660,9 @@ alloc:		/*
 		hp->hash_priority =
 		    SH_TAILQ_FIRST(&hp->hash_bucket, __bh)->priority;
 
+		if (c_mp->clock)
+			__memp_clock_link(dbenv, c_mp, bhp);
+
 		/* If we extended the file, make sure the page is never lost. */
 		if (extending) {
 			ATOMIC_ADD(hp->hash_page_dirty, 1);
@@ -747,6 +752,10 @@ alloc:		/*
 
 	DB_ASSERT(bhp->ref != 0);
 
+	/* A hit: the clock hand gives the buffer another pass. */
+	if (state != SECOND_MISS)
+		bhp->cq_ref = 1;
+
 	/*
 	 * If we're the only reference, update buffer and bucket priorities.
 	 * We may be about to release the hash bucket lock, and everything
@@ -858,6 +867,7 @@ err:	/*
 		R_LOCK(dbenv, &dbmp->reginfo[n_cache]);
 		__db_shalloc_free(dbmp->reginfo[n_cache].addr, alloc_bhp);
 		c_mp->stat.st_pages--;
+		c_mp->alloc_full = 0;
 		R_UNLOCK(dbenv, &dbmp->reginfo[n_cache]);
 	}
 
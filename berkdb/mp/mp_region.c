@@ -22,6 +22,7 @@ static const char revid[] = "$Id: mp_region.c,v 11.55 2003/06/30 17:20:19 bostic
 #include "dbinc/db_shash.h"
 #include "dbinc/mp.h"
 
+extern int gbl_memp_clock;
 
 static int __mpool_init __P((DB_ENV *, DB_MPOOL *, int, int));
 #ifdef HAVE_MUTEX_SYSTEM_RESOURCES
@@ -275,6 +276,15 @@ __mpool_init(dbenv, dbmp, reginfo_off, htab_buckets)
 	}
 	mp->htab_buckets = mp->stat.st_hash_buckets = htab_buckets;
 
+	if ((ret = __db_mutex_setup(dbenv,
+		    reginfo, &mp->clock_mutex, MUTEX_NO_RLOCK)) != 0)
+		return (ret);
+	SH_TAILQ_INIT(&mp->probq);
+	SH_TAILQ_INIT(&mp->clockq);
+	for (i = 0; i < MPOOL_NFREELIST; i++)
+		SH_TAILQ_INIT(&mp->freelist[i].head);
+	mp->clock = gbl_memp_clock;
+
 	/*
 	 * Only the environment creator knows the total cache size, fill in
 	 * those statistics now.
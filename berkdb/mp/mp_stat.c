@@ -83,7 +83,7 @@ __memp_stat(dbenv, gspp, fspp, flags)
 	MPOOL *c_mp, *mp;
 	MPOOLFILE *mfp;
 	size_t len, nlen, pagesize;
-	u_int32_t pages, dtmp, i;
+	u_int32_t pages, dtmp, i, j;
 	int ret;
 	char *name, *tname;
 
@@ -170,6 +170,23 @@ __memp_stat(dbenv, gspp, fspp, flags)
 				    c_mp->stat.st_alloc_max_pages;
 			sp->st_ckp_pages_sync += c_mp->stat.st_ckp_pages_sync;
 			sp->st_ckp_pages_skip += c_mp->stat.st_ckp_pages_skip;
+			sp->st_alloc_freelist += c_mp->stat.st_alloc_freelist;
+			sp->st_evict_scan += c_mp->stat.st_evict_scan;
+			if (sp->st_evict_max_scan < c_mp->stat.st_evict_max_scan)
+				sp->st_evict_max_scan =
+				    c_mp->stat.st_evict_max_scan;
+			sp->st_evict_us += c_mp->stat.st_evict_us;
+			if (sp->st_evict_max_us < c_mp->stat.st_evict_max_us)
+				sp->st_evict_max_us =
+				    c_mp->stat.st_evict_max_us;
+			sp->st_probation_evict += c_mp->stat.st_probation_evict;
+			sp->st_clock_promote += c_mp->stat.st_clock_promote;
+			/* Queue lengths are read without the clock mutex. */
+			sp->st_probation_pages += c_mp->n_probq;
+			sp->st_clock_pages += c_mp->n_clockq;
+			for (j = 0; j < MPOOL_NFREELIST; j++)
+				sp->st_freelist_pages +=
+				    c_mp->freelist[j].count;
 
 			if (LF_ISSET(DB_STAT_CLEAR)) {
 				dbmp->reginfo[i].rp->mutex.mutex_set_wait = 0;
@@ -1034,6 +1034,7 @@ init_trickle_threads(void)
 }
 
 int gbl_parallel_memptrickle = 1;
+extern int gbl_berkdb_iouring;
 
 extern int comdb2_time_epochms();
 void thdpool_process_message(struct thdpool *pool, char *line, int lline,
@@ -1354,7 +1355,11 @@ __memp_sync_int(dbenv, dbmfp, trickle_max, op, wrotep, restartable,
 	pt->dbmp = dbmp;
 	pt->op = op;
 	pt->restartable = restartable;
-	pt->sgio = dbenv->attr.sgio_enabled;
+	/*
+	 * With io_uring, a gathered run goes out as a batch of requests that
+	 * are all in flight at once, so always gather.
+	 */
+	pt->sgio = dbenv->attr.sgio_enabled || gbl_berkdb_iouring;
 			
 	pt->total_pages = pt->done_pages = pt->written_pages = 0;
 	pt->ret = pt->nwaits = 0;
@@ -44,7 +44,13 @@ static const char revid[] = "$Id: os_rw.c,v 11.30 2003/05/23 21:19:05 bostic Exp
 #include <string.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <time.h>
+#include <sys/uio.h>
+#endif
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
 #endif
 
 #include "db_int.h"
@@ -1076,6 +1082,186 @@ __berkdb_direct_pwritev(DB_ENV *dbenv,
 	    && ++nretries < dbenv->attr.num_write_retries);
 	return rc;
 }
+
+/*
+ * There's some events (aborts) that can legitimately write a zero LSN -
+ * check the first bunch of bytes in each buffer.
+ */
+static void
+__os_iov_check_zero_lsn(DB_ENV *dbenv,
+    DB_FH *fhp, db_pgno_t pgno, u_int8_t **bufs, size_t nobufs)
+{
+	static const char zerobuf[32];
+	int i;
+
+	if (!dbenv->attr.check_zero_lsn_writes ||
+	    !(dbenv->open_flags & DB_INIT_TXN))
+		return;
+
+	for (i = 0; i < nobufs; i++) {
+		if (memcmp(bufs[i], zerobuf, sizeof(zerobuf)) == 0)
+			break;
+	}
+	if (i < nobufs) {
+		if (fhp->name) {
+			__db_err(dbenv,
+			    "%s %s: zero LSN for page %u",
+			    __func__, fhp->name, pgno + i);
+		} else {
+			__db_err(dbenv,
+			    "%s fd %d: zero LSN for page %u",
+			    __func__, fhp->fd, pgno + i);
+		}
+		if (dbenv->attr.abort_zero_lsn_writes)
+			abort();
+	}
+}
+
+extern int gbl_berkdb_iouring;
+
+/*
+ * __os_iov_uring --
+ *	Move a run of contiguous pages as one batch of vectored requests of
+ *	at most sgio_max bytes each, all of them queued to io_uring together.
+ *	Direct I/O files are staged through the thread's aligned buffer.
+ *	Returns 0 only if every page was transferred; otherwise the caller
+ *	redoes the run on the synchronous path.
+ */
+static int
+__os_iov_uring(DB_ENV *dbenv, int op, DB_FH *fhp,
+    db_pgno_t pgno, size_t pagesize, u_int8_t **bufs, size_t nobufs,
+    size_t *niop)
+{
+	struct __os_uring_req *reqs;
+	struct iovec *iov;
+	u_int8_t *abuf;
+	size_t per_req, nreqs, i, j, n;
+	uint64_t x1 = 0, x2;
+	int direct, ret;
+
+	*niop = 0;
+	direct = F_ISSET(fhp, DB_FH_DIRECT);
+	abuf = NULL;
+	reqs = NULL;
+	iov = NULL;
+
+	per_req = dbenv->attr.sgio_max / pagesize;
+	if (per_req < 1)
+		per_req = 1;
+	if (per_req > IOV_MAX)
+		per_req = IOV_MAX;
+	nreqs = (nobufs + per_req - 1) / per_req;
+
+	if (direct) {
+		pthread_once(&once, init_iobuf);
+		if ((abuf = get_aligned_buffer(NULL,
+		    nobufs * pagesize, 0)) == NULL)
+			return (ENOMEM);
+		if (op == DB_IO_WRITE) {
+			for (i = 0; i < nobufs; i++)
+				memcpy(abuf + (i * pagesize),
+				    bufs[i], pagesize);
+		}
+	}
+
+	if ((ret = __os_malloc(dbenv,
+	    nreqs * sizeof(struct __os_uring_req), &reqs)) != 0)
+		goto done;
+	if ((ret = __os_malloc(dbenv,
+	    nobufs * sizeof(struct iovec), &iov)) != 0)
+		goto done;
+
+	for (i = 0; i < nobufs; i++) {
+		iov[i].iov_base = direct ? abuf + (i * pagesize) : bufs[i];
+		iov[i].iov_len = pagesize;
+	}
+	for (i = 0, j = 0; i < nreqs; i++, j += n) {
+		n = nobufs - j < per_req ? nobufs - j : per_req;
+		reqs[i].fd = fhp->fd;
+		reqs[i].iov = &iov[j];
+		reqs[i].iovcnt = n;
+		reqs[i].off = (off_t)(pgno + j) * pagesize;
+		reqs[i].len = n * pagesize;
+		reqs[i].res = 0;
+	}
+
+	if ((op == DB_IO_READ && __berkdb_read_alarm_ms) ||
+	    (op == DB_IO_WRITE && __berkdb_write_alarm_ms))
+		x1 = bb_berkdb_fasttime();
+
+	if ((ret = __os_uring_rw(dbenv, op, reqs, nreqs)) != 0)
+		goto done;
+
+	for (i = 0; i < nreqs; i++) {
+		if (reqs[i].res < 0) {
+			ret = -reqs[i].res;
+			break;
+		}
+		*niop += reqs[i].res;
+	}
+	if (ret == 0 && *niop != nobufs * pagesize)
+		ret = EIO;
+
+	if (x1) {
+		x2 = bb_berkdb_fasttime();
+		if (gbl_bb_berkdb_enable_thread_stats) {
+			struct bb_berkdb_thread_stats *p, *t;
+
+			t = bb_berkdb_get_thread_stats();
+			p = bb_berkdb_get_process_stats();
+			if (op == DB_IO_READ) {
+				p->n_preads++;
+				p->pread_bytes += *niop;
+				p->pread_time_us += (x2 - x1);
+				t->n_preads++;
+				t->pread_bytes += *niop;
+				t->pread_time_us += (x2 - x1);
+			} else {
+				p->n_pwrites++;
+				p->pwrite_bytes += *niop;
+				p->pwrite_time_us += (x2 - x1);
+				t->n_pwrites++;
+				t->pwrite_bytes += *niop;
+				t->pwrite_time_us += (x2 - x1);
+			}
+		}
+		if ((x2 - x1) > M2U(op == DB_IO_READ ?
+		    __berkdb_read_alarm_ms : __berkdb_write_alarm_ms) &&
+		    __berkdb_trace_func) {
+			char s[80];
+
+			snprintf(s, sizeof(s),
+			    "LONG URING %s (%d) %d ms fd %d\n",
+			    op == DB_IO_READ ? "PREADV" : "PWRITEV",
+			    (int)(*niop), U2M(x2 - x1), fhp->fd);
+			__berkdb_trace_func(s);
+		}
+	}
+
+	if (op == DB_IO_READ) {
+		if (ret == 0 && direct) {
+			for (i = 0; i < nobufs; i++)
+				memcpy(bufs[i],
+				    abuf + (i * pagesize), pagesize);
+		}
+		if (__berkdb_num_read_ios)
+			(*__berkdb_num_read_ios) += nreqs;
+		if (read_callback)
+			read_callback(*niop);
+	} else {
+		if (__berkdb_num_write_ios)
+			(*__berkdb_num_write_ios) += nreqs;
+		if (write_callback)
+			write_callback(*niop);
+	}
+
+done:
+	if (iov != NULL)
+		__os_free(dbenv, iov);
+	if (reqs != NULL)
+		__os_free(dbenv, reqs);
+	return (ret);
+}
 #endif
 
 /*
@@ -1120,38 +1306,24 @@ __os_iov(dbenv, op, fhp, pgno, pagesize, bufs, nobufs, niop)
 		}
 	}
 
+	if (gbl_berkdb_iouring && nobufs > 1 &&
+	    DB_GLOBAL(j_read) == NULL && DB_GLOBAL(j_write) == NULL) {
+		if (op == DB_IO_WRITE) {
+			__os_iov_check_zero_lsn(dbenv, fhp, pgno, bufs, nobufs);
+			__checkpoint_verify(dbenv);
+		}
+		if (__os_iov_uring(dbenv,
+		    op, fhp, pgno, pagesize, bufs, nobufs, niop) == 0)
+			return (0);
+	}
+
 	if (!F_ISSET(fhp, DB_FH_DIRECT))
 		goto slow;
 	if (nobufs == 1)
 		goto slow;
 
-	if (op == DB_IO_WRITE && dbenv->attr.check_zero_lsn_writes
-	    && (dbenv->open_flags & DB_INIT_TXN)) {
-		static const char zerobuf[32];
-
-		/* 
-		 * There's some events (aborts) that can legitimately
-		 * write a zero LSN - check the first bunch of bytes
-		 * in the buffer. 
-		 */
-		for (i = 0; i < nobufs; i++) {
-			if (memcmp(bufs[i], zerobuf, sizeof(zerobuf)) == 0)
-				break;
-		}
-		if (i < nobufs) {
-			if (fhp->name) {
-				__db_err(dbenv,
-				    "%s %s: zero LSN for page %u",
-				    __func__, fhp->name, pgno + i);
-			} else {
-				__db_err(dbenv,
-				    "%s fd %d: zero LSN for page %u",
-				    __func__, fhp->fd, pgno + i);
-			}
-			if (dbenv->attr.abort_zero_lsn_writes)
-				abort();
-		}
-	}
+	if (op == DB_IO_WRITE)
+		__os_iov_check_zero_lsn(dbenv, fhp, pgno, bufs, nobufs);
 
 	/* Check for illegal usage. */
 	DB_ASSERT(F_ISSET(fhp, DB_FH_OPENED) &&
@@ -0,0 +1,482 @@
+/*
+   Copyright 2019 Bloomberg Finance L.P.
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+/*
+ * Batched page I/O through io_uring.  Each thread that does batched I/O
+ * (the trickle/checkpoint writers, mostly) gets its own ring, created on
+ * first use.  A batch is a list of vectored requests; at most
+ * berkdb_iouring_depth of them are in flight at once.  When the kernel or
+ * headers don't support io_uring, __os_uring_rw returns EOPNOTSUPP and the
+ * caller uses its synchronous path.  A thread whose ring fails stops using
+ * io_uring until either tunable is changed.
+ */
+
+#include "db_config.h"
+
+#ifndef NO_SYSTEM_INCLUDES
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#endif
+
+#include "db_int.h"
+#include "logmsg.h"
+#include "locks_wrap.h"
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define HAVE_IO_URING 1
+#endif
+#endif
+
+#ifdef HAVE_IO_URING
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#include "comdb2_atomic.h"
+#endif
+
+int gbl_berkdb_iouring = 0;
+int gbl_berkdb_iouring_depth = 32;
+
+#define URING_MAX_DEPTH 4096
+
+static struct {
+	int64_t nbatches;
+	int64_t nsubmitted;
+	int64_t nbytes;
+	int64_t nshort;
+	int64_t nerrors;
+	int64_t nrings;
+	int max_inflight;
+	int nfailed;	/* threads whose ring failed */
+} uring_stats;
+
+/* Bumped when the tunables change, to retry rings that failed */
+static int uring_gen;
+
+#ifdef HAVE_IO_URING
+
+struct uring {
+	int fd;		/* -1 if the ring failed for this thread */
+	unsigned depth;
+	int gen;	/* uring_gen when the ring failed */
+
+	unsigned *sq_head;
+	unsigned *sq_tail;
+	unsigned *sq_mask;
+	unsigned *sq_array;
+	struct io_uring_sqe *sqes;
+
+	unsigned *cq_head;
+	unsigned *cq_tail;
+	unsigned *cq_mask;
+	struct io_uring_cqe *cqes;
+
+	void *sq_ptr;
+	void *cq_ptr;
+	size_t sq_sz;
+	size_t cq_sz;
+	size_t sqes_sz;
+};
+
+static pthread_key_t uring_key;
+static pthread_once_t uring_once = PTHREAD_ONCE_INIT;
+
+static void
+uring_free(struct uring *r)
+{
+	if (r->sqes != NULL && r->sqes != MAP_FAILED)
+		munmap(r->sqes, r->sqes_sz);
+	if (r->cq_ptr != NULL && r->cq_ptr != MAP_FAILED &&
+	    r->cq_ptr != r->sq_ptr)
+		munmap(r->cq_ptr, r->cq_sz);
+	if (r->sq_ptr != NULL && r->sq_ptr != MAP_FAILED)
+		munmap(r->sq_ptr, r->sq_sz);
+	if (r->fd >= 0)
+		close(r->fd);
+	free(r);
+}
+
+static void
+uring_destructor(void *p)
+{
+	uring_free(p);
+}
+
+static void
+uring_init_key(void)
+{
+	Pthread_key_create(&uring_key, uring_destructor);
+}
+
+static struct uring *
+uring_create(unsigned depth)
+{
+	struct io_uring_params p;
+	struct uring *r;
+	int single_mmap = 0;
+
+	if ((r = calloc(1, sizeof(struct uring))) == NULL)
+		return (NULL);
+
+	memset(&p, 0, sizeof(p));
+	r->fd = syscall(__NR_io_uring_setup, depth, &p);
+	if (r->fd < 0) {
+		logmsg(LOGMSG_WARN, "io_uring_setup depth %u: %s, "
+		    "using synchronous page I/O\n", depth, strerror(errno));
+		r->fd = -1;
+		goto err;
+	}
+	/* sq_entries may be rounded up; bound in-flight by what was asked */
+	r->depth = depth;
+
+	r->sq_sz = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	r->cq_sz = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+#ifdef IORING_FEAT_SINGLE_MMAP
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		single_mmap = 1;
+		if (r->cq_sz > r->sq_sz)
+			r->sq_sz = r->cq_sz;
+		r->cq_sz = r->sq_sz;
+	}
+#endif
+
+	r->sq_ptr = mmap(NULL, r->sq_sz, PROT_READ | PROT_WRITE,
+	    MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+	if (r->sq_ptr == MAP_FAILED)
+		goto err;
+	if (single_mmap)
+		r->cq_ptr = r->sq_ptr;
+	else {
+		r->cq_ptr = mmap(NULL, r->cq_sz, PROT_READ | PROT_WRITE,
+		    MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_CQ_RING);
+		if (r->cq_ptr == MAP_FAILED)
+			goto err;
+	}
+	r->sqes_sz = p.sq_entries * sizeof(struct io_uring_sqe);
+	r->sqes = mmap(NULL, r->sqes_sz, PROT_READ | PROT_WRITE,
+	    MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);
+	if (r->sqes == MAP_FAILED)
+		goto err;
+
+	r->sq_head = (unsigned *)((char *)r->sq_ptr + p.sq_off.head);
+	r->sq_tail = (unsigned *)((char *)r->sq_ptr + p.sq_off.tail);
+	r->sq_mask = (unsigned *)((char *)r->sq_ptr + p.sq_off.ring_mask);
+	r->sq_array = (unsigned *)((char *)r->sq_ptr + p.sq_off.array);
+	r->cq_head = (unsigned *)((char *)r->cq_ptr + p.cq_off.head);
+	r->cq_tail = (unsigned *)((char *)r->cq_ptr + p.cq_off.tail);
+	r->cq_mask = (unsigned *)((char *)r->cq_ptr + p.cq_off.ring_mask);
+	r->cqes = (struct io_uring_cqe *)((char *)r->cq_ptr + p.cq_off.cqes);
+
+	ATOMIC_ADD(uring_stats.nrings, 1);
+	return (r);
+
+err:
+	uring_free(r);
+	return (NULL);
+}
+
+/*
+ * Remember that this thread's ring failed, so that it doesn't retry on
+ * every batch.
+ */
+static void
+uring_set_failed(struct uring *r)
+{
+	struct uring *failed;
+
+	if (r != NULL) {
+		Pthread_setspecific(uring_key, NULL);
+		uring_free(r);
+	}
+	if ((failed = calloc(1, sizeof(struct uring))) == NULL)
+		return;
+	failed->fd = -1;
+	failed->gen = uring_gen;
+	Pthread_setspecific(uring_key, failed);
+	ATOMIC_ADD(uring_stats.nfailed, 1);
+}
+
+/* Return this thread's ring, (re)creating it if the depth tunable changed. */
+static struct uring *
+uring_get(void)
+{
+	struct uring *r;
+	unsigned depth;
+
+	pthread_once(&uring_once, uring_init_key);
+
+	r = pthread_getspecific(uring_key);
+	if (r != NULL && r->fd < 0) {
+		if (r->gen == uring_gen)
+			return (NULL);
+		/* the tunables changed since, try again */
+		Pthread_setspecific(uring_key, NULL);
+		uring_free(r);
+		ATOMIC_ADD(uring_stats.nfailed, -1);
+	}
+
+	depth = gbl_berkdb_iouring_depth;
+	if (depth < 1)
+		depth = 1;
+	if (depth > URING_MAX_DEPTH)
+		depth = URING_MAX_DEPTH;
+
+	r = pthread_getspecific(uring_key);
+	if (r != NULL && r->depth != depth) {
+		Pthread_setspecific(uring_key, NULL);
+		uring_free(r);
+		r = NULL;
+	}
+	if (r == NULL) {
+		if ((r = uring_create(depth)) == NULL) {
+			uring_set_failed(NULL);
+			return (NULL);
+		}
+		Pthread_setspecific(uring_key, r);
+	}
+	return (r);
+}
+
+static int
+uring_enter(struct uring *r, unsigned to_submit, unsigned min_complete)
+{
+	int rc;
+
+	for (;;) {
+		rc = syscall(__NR_io_uring_enter, r->fd, to_submit,
+		    min_complete, IORING_ENTER_GETEVENTS, NULL, 0);
+		if (rc >= 0)
+			return (0);
+		if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+			return (errno);
+		/* whatever the kernel did consume is reflected in sq_head */
+		to_submit = *r->sq_tail -
+		    __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE);
+	}
+}
+
+/*
+ * Finish a short transfer synchronously; the ring already moved res bytes.
+ */
+static void
+uring_finish_short(int op, struct __os_uring_req *req)
+{
+	struct iovec iov[req->iovcnt];
+	struct iovec *v;
+	ssize_t done, n;
+	int cnt;
+
+	done = req->res;
+	while (done < (ssize_t)req->len) {
+		/* skip what has been transferred */
+		memcpy(iov, req->iov, req->iovcnt * sizeof(struct iovec));
+		v = iov;
+		cnt = req->iovcnt;
+		for (n = done; n >= (ssize_t)v->iov_len; v++, cnt--)
+			n -= v->iov_len;
+		v->iov_base = (char *)v->iov_base + n;
+		v->iov_len -= n;
+
+		if (op == DB_IO_READ)
+			n = preadv(req->fd, v, cnt, req->off + done);
+		else
+			n = pwritev(req->fd, v, cnt, req->off + done);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			break;
+		done += n;
+	}
+	req->res = done;
+}
+
+/*
+ * The ring failed with requests in flight.  Take back what the kernel has
+ * not consumed, and wait for the rest to complete before the ring is torn
+ * down, since the kernel may still be using their buffers.
+ */
+static void
+uring_drain(struct uring *r, struct __os_uring_req *reqs, int *inflight)
+{
+	struct io_uring_cqe *cqe;
+	unsigned head, sq_head;
+
+	/* without SQPOLL, the kernel only reads the sq during io_uring_enter */
+	sq_head = __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE);
+	*inflight -= *r->sq_tail - sq_head;
+	__atomic_store_n(r->sq_tail, sq_head, __ATOMIC_RELEASE);
+
+	while (*inflight > 0) {
+		head = *r->cq_head;
+		while (head != __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE)) {
+			cqe = &r->cqes[head & *r->cq_mask];
+			reqs[cqe->user_data].res = cqe->res;
+			head++;
+			(*inflight)--;
+		}
+		__atomic_store_n(r->cq_head, head, __ATOMIC_RELEASE);
+		if (*inflight > 0 &&
+		    syscall(__NR_io_uring_enter, r->fd, 0, 1,
+			IORING_ENTER_GETEVENTS, NULL, 0) < 0)
+			usleep(1000);
+	}
+}
+
+#endif /* HAVE_IO_URING */
+
+void
+berkdb_iouring_reset(void)
+{
+	uring_gen++;
+}
+
+/*
+ * __os_uring_rw --
+ *	Run a batch of vectored reads or writes through this thread's ring,
+ *	keeping at most berkdb_iouring_depth requests in flight.  On return
+ *	each request's res holds the bytes transferred or a negative errno.
+ *	Short transfers are completed synchronously.  Returns EOPNOTSUPP if
+ *	io_uring is disabled or unavailable; the caller then does the I/O
+ *	itself.
+ *
+ * PUBLIC: int __os_uring_rw __P((DB_ENV *, int, struct __os_uring_req *,
+ * PUBLIC:     int));
+ */
+int
+__os_uring_rw(dbenv, op, reqs, nreqs)
+	DB_ENV *dbenv;
+	int op;
+	struct __os_uring_req *reqs;
+	int nreqs;
+{
+#ifdef HAVE_IO_URING
+	struct io_uring_sqe *sqe;
+	struct io_uring_cqe *cqe;
+	struct uring *r;
+	unsigned head, tail, idx, to_submit;
+	int next, inflight, done, i, ret;
+
+	if (!gbl_berkdb_iouring || (r = uring_get()) == NULL)
+		return (EOPNOTSUPP);
+
+	ATOMIC_ADD(uring_stats.nbatches, 1);
+	/* completions overwrite this; anything left is done synchronously */
+	for (i = 0; i < nreqs; i++)
+		reqs[i].res = -EINPROGRESS;
+	next = inflight = done = 0;
+	while (done < nreqs) {
+		to_submit = 0;
+		tail = *r->sq_tail;
+		while (next < nreqs && inflight < r->depth) {
+			idx = tail & *r->sq_mask;
+			sqe = &r->sqes[idx];
+			memset(sqe, 0, sizeof(*sqe));
+			sqe->opcode = (op == DB_IO_READ) ?
+			    IORING_OP_READV : IORING_OP_WRITEV;
+			sqe->fd = reqs[next].fd;
+			sqe->addr = (u_int64_t)(uintptr_t)reqs[next].iov;
+			sqe->len = reqs[next].iovcnt;
+			sqe->off = reqs[next].off;
+			sqe->user_data = next;
+			r->sq_array[idx] = idx;
+			tail++;
+			next++;
+			inflight++;
+			to_submit++;
+		}
+		if (to_submit) {
+			__atomic_store_n(r->sq_tail, tail, __ATOMIC_RELEASE);
+			ATOMIC_ADD(uring_stats.nsubmitted, to_submit);
+			if (inflight > uring_stats.max_inflight)
+				uring_stats.max_inflight = inflight;
+		}
+
+		if ((ret = uring_enter(r, to_submit, 1)) != 0) {
+			/*
+			 * Wait out what is in flight, stop using io_uring on
+			 * this thread and do the remaining requests
+			 * synchronously.
+			 */
+			__db_err(dbenv, "io_uring_enter: %s, disabling "
+			    "io_uring page I/O for this thread", strerror(ret));
+			ATOMIC_ADD(uring_stats.nerrors, 1);
+			uring_drain(r, reqs, &inflight);
+			uring_set_failed(r);
+			break;
+		}
+
+		head = *r->cq_head;
+		while (head != __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE)) {
+			cqe = &r->cqes[head & *r->cq_mask];
+			reqs[cqe->user_data].res = cqe->res;
+			head++;
+			inflight--;
+			done++;
+		}
+		__atomic_store_n(r->cq_head, head, __ATOMIC_RELEASE);
+	}
+
+	for (i = 0; i < nreqs; i++) {
+		if (reqs[i].res == -EINPROGRESS) {
+			/* not run on the ring */
+			reqs[i].res = 0;
+			uring_finish_short(op, &reqs[i]);
+			continue;
+		}
+		if (reqs[i].res < 0) {
+			ATOMIC_ADD(uring_stats.nerrors, 1);
+			continue;
+		}
+		if (reqs[i].res < (ssize_t)reqs[i].len) {
+			ATOMIC_ADD(uring_stats.nshort, 1);
+			uring_finish_short(op, &reqs[i]);
+		}
+		ATOMIC_ADD(uring_stats.nbytes, reqs[i].res);
+	}
+	return (0);
+#else
+	return (EOPNOTSUPP);
+#endif
+}
+
+void
+berkdb_iouring_stat(void)
+{
+#ifdef HAVE_IO_URING
+	logmsg(LOGMSG_USER, "io_uring page I/O: %s, depth %d\n",
+	    gbl_berkdb_iouring ? "enabled" : "disabled",
+	    gbl_berkdb_iouring_depth);
+	logmsg(LOGMSG_USER, "  failed rings %d\n", uring_stats.nfailed);
+	logmsg(LOGMSG_USER, "  rings        %" PRId64 "\n", uring_stats.nrings);
+	logmsg(LOGMSG_USER, "  batches      %" PRId64 "\n",
+	    uring_stats.nbatches);
+	logmsg(LOGMSG_USER, "  requests     %" PRId64 "\n",
+	    uring_stats.nsubmitted);
+	logmsg(LOGMSG_USER, "  bytes        %" PRId64 "\n", uring_stats.nbytes);
+	logmsg(LOGMSG_USER, "  short        %" PRId64 "\n", uring_stats.nshort);
+	logmsg(LOGMSG_USER, "  errors       %" PRId64 "\n", uring_stats.nerrors);
+	logmsg(LOGMSG_USER, "  max inflight %d\n", uring_stats.max_inflight);
+#else
+	logmsg(LOGMSG_USER, "io_uring page I/O: not supported on this build\n");
+#endif
+}
@@ -0,0 +1,284 @@
+/*
+   Copyright 2019 Bloomberg Finance L.P.
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+/*
+ * Replicant apply profile: per-stage latency histograms for incoming log
+ * records, with page apply broken down per file.  Stages are recorded once
+ * per message or per transaction (per file for page apply), never per log
+ * record, under a single mutex.  That is still a lock per replicated message,
+ * so profiling is off unless rep_apply_profile is turned on.
+ */
+
+#include "db_config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "db_int.h"
+#include "dbinc/log.h"
+#include "dbinc/rep_profile.h"
+#include "locks_wrap.h"
+
+int gbl_rep_apply_profile = 0;
+__thread int64_t rep_profile_recv_us = 0;
+
+struct rep_prof_hist {
+	int64_t count;
+	int64_t records;
+	int64_t total_us;
+	int64_t max_us;
+	/* bucket i counts values in [2^i, 2^(i+1)) */
+	u_int64_t buckets[REP_PROFILE_NBUCKETS];
+};
+
+struct rep_prof_file {
+	char *name;
+	struct rep_prof_hist hist;
+};
+
+/* Fileids are recycled, so remember which handle a fileid last mapped to. */
+struct rep_prof_slot {
+	DB *dbp;
+	struct rep_prof_file *file;
+};
+
+static const char *stage_names[REP_STAGE_MAX] = {
+	"receive", "enqueue", "queue", "apply", "getlocks", "page", "commit"
+};
+
+static pthread_mutex_t prof_lk = PTHREAD_MUTEX_INITIALIZER;
+static struct rep_prof_hist stages[REP_STAGE_MAX];
+static struct rep_prof_file **files = NULL;
+static int nfiles = 0;
+static struct rep_prof_slot *slots = NULL;
+static int nslots = 0;
+
+static inline int
+__rep_prof_bucket(u_int64_t v)
+{
+	int b;
+
+	for (b = 0; v > 1 && b < REP_PROFILE_NBUCKETS - 1; b++)
+		v >>= 1;
+	return (b);
+}
+
+static inline void
+__rep_prof_count(struct rep_prof_hist *h, int64_t us, int nrecs)
+{
+	if (us < 0)
+		us = 0;
+	h->count++;
+	h->records += nrecs;
+	h->total_us += us;
+	if (us > h->max_us)
+		h->max_us = us;
+	h->buckets[__rep_prof_bucket(us)]++;
+}
+
+void
+__rep_profile_add(int stage, int64_t us)
+{
+	if (!gbl_rep_apply_profile || stage < 0 || stage >= REP_STAGE_MAX)
+		return;
+	Pthread_mutex_lock(&prof_lk);
+	__rep_prof_count(&stages[stage], us, 1);
+	Pthread_mutex_unlock(&prof_lk);
+}
+
+static struct rep_prof_file *
+__rep_prof_find_file(const char *name)
+{
+	struct rep_prof_file *f, **nfiles_p;
+	int i;
+
+	for (i = 0; i < nfiles; i++) {
+		if (strcmp(files[i]->name, name) == 0)
+			return (files[i]);
+	}
+	if ((f = calloc(1, sizeof(*f))) == NULL ||
+	    (f->name = strdup(name)) == NULL) {
+		free(f);
+		return (NULL);
+	}
+	nfiles_p = realloc(files, (nfiles + 1) * sizeof(*files));
+	if (nfiles_p == NULL) {
+		free(f->name);
+		free(f);
+		return (NULL);
+	}
+	files = nfiles_p;
+	files[nfiles++] = f;
+	return (f);
+}
+
+/*
+ * Count page apply time for the records of one transaction that touched
+ * fileid.  The time also goes into the all-files page stage.
+ */
+void
+__rep_profile_file(DB_ENV *dbenv, int32_t fileid, int64_t us, int nrecs)
+{
+	DB_LOG *dblp;
+	DB *dbp = NULL;
+	struct rep_prof_file *f = NULL;
+	struct rep_prof_slot *nslots_p;
+	int i;
+
+	if (!gbl_rep_apply_profile)
+		return;
+
+	dblp = dbenv->lg_handle;
+
+	/* The log's thread mutex keeps dbentry and the handle's name stable. */
+	MUTEX_THREAD_LOCK(dbenv, dblp->mutexp);
+	if (fileid >= 0 && fileid < dblp->dbentry_cnt)
+		dbp = dblp->dbentry[fileid].dbp;
+
+	Pthread_mutex_lock(&prof_lk);
+	__rep_prof_count(&stages[REP_STAGE_PAGE], us, nrecs);
+	if (dbp != NULL && dbp->fname != NULL && fileid >= nslots) {
+		/* Out of memory only costs the per-file row. */
+		nslots_p = realloc(slots, (fileid + 1) * sizeof(*slots));
+		if (nslots_p == NULL) {
+			dbp = NULL;
+		} else {
+			slots = nslots_p;
+			for (i = nslots; i <= fileid; i++) {
+				slots[i].dbp = NULL;
+				slots[i].file = NULL;
+			}
+			nslots = fileid + 1;
+		}
+	}
+	if (dbp != NULL && dbp->fname != NULL) {
+		if (slots[fileid].dbp != dbp || slots[fileid].file == NULL) {
+			slots[fileid].dbp = dbp;
+			slots[fileid].file = __rep_prof_find_file(dbp->fname);
+		}
+		f = slots[fileid].file;
+	}
+	if (f != NULL)
+		__rep_prof_count(&f->hist, us, nrecs);
+	Pthread_mutex_unlock(&prof_lk);
+	MUTEX_THREAD_UNLOCK(dbenv, dblp->mutexp);
+}
+
+/* Percentile from a power-of-two histogram: the upper bound of the bucket
+ * holding the pct'th value, capped at the largest value seen. */
+static int64_t
+__rep_prof_pct(const struct rep_prof_hist *h, int pct)
+{
+	u_int64_t seen = 0;
+	int64_t bound;
+	int i;
+
+	if (h->count == 0)
+		return (0);
+	for (i = 0; i < REP_PROFILE_NBUCKETS; i++) {
+		seen += h->buckets[i];
+		if (seen * 100 >= (u_int64_t)h->count * pct)
+			break;
+	}
+	bound = (2LL << i) - 1;
+	return (bound < h->max_us ? bound : h->max_us);
+}
+
+static int
+__rep_prof_row(struct rep_apply_profile *row, const char *stage,
+    const char *file, const struct rep_prof_hist *h)
+{
+	memset(row, 0, sizeof(*row));
+	if ((row->stage = strdup(stage)) == NULL)
+		return (ENOMEM);
+	if (file != NULL && (row->file = strdup(file)) == NULL)
+		return (ENOMEM);
+	row->count = h->count;
+	row->records = h->records;
+	row->total_us = h->total_us;
+	row->max_us = h->max_us;
+	row->p50_us = __rep_prof_pct(h, 50);
+	row->p90_us = __rep_prof_pct(h, 90);
+	row->p99_us = __rep_prof_pct(h, 99);
+	return (0);
+}
+
+/*
+ * Return one row per stage, followed by one page-apply row per file.
+ * Stages that have not been hit are left out.
+ */
+int
+__rep_apply_profile_get(struct rep_apply_profile **rows, int *nrows)
+{
+	struct rep_apply_profile *out;
+	int i, n = 0, ret = 0;
+
+	*rows = NULL;
+	*nrows = 0;
+
+	Pthread_mutex_lock(&prof_lk);
+	if ((out = calloc(REP_STAGE_MAX + nfiles + 1, sizeof(*out))) == NULL) {
+		Pthread_mutex_unlock(&prof_lk);
+		return (ENOMEM);
+	}
+	for (i = 0; i < REP_STAGE_MAX && ret == 0; i++) {
+		if (stages[i].count == 0)
+			continue;
+		ret = __rep_prof_row(&out[n++], stage_names[i], NULL,
+		    &stages[i]);
+	}
+	for (i = 0; i < nfiles && ret == 0; i++) {
+		if (files[i]->hist.count == 0)
+			continue;
+		ret = __rep_prof_row(&out[n++], stage_names[REP_STAGE_PAGE],
+		    files[i]->name, &files[i]->hist);
+	}
+	Pthread_mutex_unlock(&prof_lk);
+
+	if (ret != 0) {
+		__rep_apply_profile_free(out, n);
+		return (ret);
+	}
+	*rows = out;
+	*nrows = n;
+	return (0);
+}
+
+void
+__rep_apply_profile_free(struct rep_apply_profile *rows, int nrows)
+{
+	int i;
+
+	for (i = 0; i < nrows; i++) {
+		free(rows[i].stage);
+		free(rows[i].file);
+	}
+	free(rows);
+}
+
+/* Zero all histograms.  Per-file rows are kept but emptied. */
+void
+__rep_apply_profile_reset(void)
+{
+	int i;
+
+	Pthread_mutex_lock(&prof_lk);
+	memset(stages, 0, sizeof(stages));
+	for (i = 0; i < nfiles; i++)
+		memset(&files[i]->hist, 0, sizeof(files[i]->hist));
+	Pthread_mutex_unlock(&prof_lk);
+}
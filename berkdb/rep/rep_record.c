@@ -51,6 +51,7 @@ static const char revid[] =
 #include <epochlib.h>
 #include "schema_lk.h"
 #include "logmsg.h"
+#include "dbinc/rep_profile.h"
 #include <errno.h>
 
 
@@ -415,6 +416,7 @@ struct queued_log {
 	u_int32_t gen;
 	u_int32_t size;
 	u_int32_t enqueued_time;
+	int64_t enqueued_us;
 	char *data;
 };
 
@@ -539,9 +541,14 @@ static void *apply_thread(void *arg)
 			rec.data = q->data;
 			rec.size = q->size;
 
+			if (gbl_rep_apply_profile && q->enqueued_us)
+				__rep_profile_add(REP_STAGE_QUEUE,
+					comdb2_time_epochus() - q->enqueued_us);
+
 			if (rep->gen == q->gen) {
 				static int last_print = 0, last_applying_print = 0;
 				static unsigned long long count = 0;
+				int64_t apply_us = 0;
 				int now;
 
 				if (gbl_verbose_fills && ((now = time(NULL)) -
@@ -551,7 +558,12 @@ static void *apply_thread(void *arg)
 					last_applying_print = now;
 				}
 
+				if (gbl_rep_apply_profile)
+					apply_us = comdb2_time_epochus();
 				ret = __rep_apply(dbenv, q->rp, &rec, &ret_lsnp, &q->gen, 1);
+				if (apply_us)
+					__rep_profile_add(REP_STAGE_APPLY,
+						comdb2_time_epochus() - apply_us);
 				Pthread_mutex_unlock(&rep_candidate_lock);
 				if (ret == 0 || ret == DB_REP_ISPERM) {
 					void bdb_set_seqnum(void *);
@@ -802,6 +814,7 @@ __rep_enqueue_log(dbenv, rp, rec, gen)
 {
 	int rc, now;
 	int start, elapsed;
+	int64_t enqueue_us;
 	static unsigned long long count=0;
 	struct queued_log *q = (struct queued_log *)malloc(
 			sizeof(struct queued_log));
@@ -816,6 +829,8 @@ __rep_enqueue_log(dbenv, rp, rec, gen)
 	q->gen = gen;
 	q->size = rec->size;
 	q->enqueued_time = comdb2_time_epochms();
+	q->enqueued_us = enqueue_us =
+		gbl_rep_apply_profile ? comdb2_time_epochus() : 0;
 	q->data = malloc(q->size);
 	memcpy(q->data, rec->data, q->size);
 	start = comdb2_time_epochms();
@@ -882,6 +897,11 @@ __rep_enqueue_log(dbenv, rp, rec, gen)
 				__LINE__, elapsed);
 	}
 
+	/* q belongs to the apply thread now */
+	if (enqueue_us)
+		__rep_profile_add(REP_STAGE_ENQUEUE,
+			comdb2_time_epochus() - enqueue_us);
+
 	return 0;
 }
 
@@ -1563,6 +1583,13 @@ more:		   if (type == REP_LOG_MORE) {
 		CLIENT_ONLY(rep, rp);
 		MASTER_CHECK(dbenv, *eidp, rep);
 		if (!IN_ELECTION_TALLY(rep)) {
+			int64_t apply_us = 0;
+			if (gbl_rep_apply_profile && rep_profile_recv_us) {
+				apply_us = comdb2_time_epochus();
+				__rep_profile_add(REP_STAGE_RECEIVE,
+					apply_us - rep_profile_recv_us);
+			}
+			rep_profile_recv_us = 0;
 			fromline = __LINE__;
 			if (gbl_decoupled_logputs) {
 				if ((ret = __rep_enqueue_log(dbenv, rp, rec, rp->gen))
@@ -1570,8 +1597,14 @@ more:		   if (type == REP_LOG_MORE) {
 					goto errlock;
 			} else {
 				fromline = __LINE__;
-				if ((ret = __rep_apply(dbenv, rp, rec, ret_lsnp,
-								commit_gen, 0)) != 0)
+				if (gbl_rep_apply_profile && !apply_us)
+					apply_us = comdb2_time_epochus();
+				ret = __rep_apply(dbenv, rp, rec, ret_lsnp,
+					commit_gen, 0);
+				if (apply_us)
+					__rep_profile_add(REP_STAGE_APPLY,
+						comdb2_time_epochus() - apply_us);
+				if (ret != 0)
 					goto errlock;
 			}
 		} else {
@@ -3888,21 +3921,93 @@ size_t __dbenv_get_log_header_size(DB_ENV* dbenv)
 
 u_int32_t gbl_rep_lockid;
 
+/* Apply one record of a recovery queue.  Records that weren't cached are
+ * read through *logcp, which is opened on first use. */
+static void
+recovery_apply_record(dbenv, rp, rr, logcp, tmpdbt)
+	DB_ENV *dbenv;
+	struct __recovery_processor *rp;
+	struct __recovery_record *rr;
+	DB_LOGC **logcp;
+	DBT *tmpdbt;
+{
+	u_int32_t rectype;
+	DBT *dbt;
+	int rc;
+
+	if (rr->logdbt.data == NULL) {
+		if (*logcp == NULL) {
+			if (__log_cursor(dbenv, logcp)) {
+				__db_err(dbenv,
+					"worker can't get log cursor while processing %u:%u\n",
+					rr->lsn.file, rr->lsn.offset);
+				abort();
+			}
+			bzero(tmpdbt, sizeof(DBT));
+			tmpdbt->flags = DB_DBT_REALLOC;
+		}
+		if ((rc = __log_c_get(*logcp, &rr->lsn, tmpdbt, DB_SET))) {
+			__db_err(dbenv, "worker can't get lsn %u:%u\n",
+				rr->lsn.file, rr->lsn.offset);
+			abort();
+		}
+		dbt = tmpdbt;
+	} else
+		dbt = &rr->logdbt;
+
+	LOGCOPY_32(&rectype, dbt->data);
+	dbt->app_data = &rp->context;
+
+	/* Map the txnid to the context */
+	if (dispatch_rectype(rectype)) {
+		rc = __db_dispatch(dbenv, dbenv->recover_dtab,
+			dbenv->recover_dtab_size, dbt, &rr->lsn,
+			DB_TXN_APPLY, rp->txninfo);
+	} else
+		rc = 0;
+
+	/* TODO: what do I do on an error? */
+	if (rc) {
+		__db_err(dbenv, "transaction failed at %lu:%lu rc=%d",
+			(u_long)rr->lsn.file, (u_long)rr->lsn.offset, rc);
+		/* and now? */
+		abort();
+	}
+}
+
+static void
+recovery_close_logc(dbenv, logc, tmpdbt)
+	DB_ENV *dbenv;
+	DB_LOGC *logc;
+	DBT *tmpdbt;
+{
+	int rc;
+
+	if (logc) {
+		if (tmpdbt->data)
+			free(tmpdbt->data);
+		if ((rc = __log_c_close(logc))) {
+			__db_err(dbenv, "__log_c_close rc %d\n", rc);
+			abort();
+		}
+	}
+}
+
 static void
 worker_thd(struct thdpool *pool, void *work, void *thddata, int op)
 {
 	struct __recovery_processor *rp;
 	struct __recovery_queue *rq;
 	struct __recovery_record *rr;
-	int rc;
 	DB_ENV *dbenv;
 	DB_LOGC *logc = NULL;
 	DBT tmpdbt;
-	u_int32_t rectype;
 	int recnum = 0;
+	int64_t start_us;
 	LISTC_T(struct recovery_record) q;
 
 	listc_init(&q, offsetof(struct __recovery_record, lnk));
+	start_us = gbl_rep_apply_profile ? comdb2_time_epochus() : 0;
 
 	/* TODO: pass empty dbt if a transaction gets large - worker 
 	 * should then get a cursor and read the record itself */
@@ -3915,53 +4020,7 @@ worker_thd(struct thdpool *pool, void *work, void *thddata, int op)
 
 	while (rr) {
 		recnum++;
-		if (rr->logdbt.data == NULL) {
-			if (logc == NULL) {
-				if (__log_cursor(dbenv, &logc)) {
-					__db_err(dbenv,
-						"worker can't get log cursor while processing %u:%u\n",
-						rr->lsn.file, rr->lsn.offset);
-					abort();
-				}
-				bzero(&tmpdbt, sizeof(DBT));
-				tmpdbt.flags = DB_DBT_REALLOC;
-			}
-			if ((rc = __log_c_get(logc, &rr->lsn, &tmpdbt, DB_SET))) {
-				__db_err(dbenv, "worker can't get lsn %u:%u\n",
-					rr->lsn.file, rr->lsn.offset);
-				abort();
-			}
-			LOGCOPY_32(&rectype, tmpdbt.data);
-			tmpdbt.app_data = &rp->context;
-
-			/* Map the txnid to the context */
-			if (dispatch_rectype(rectype)) {
-				rc = __db_dispatch(dbenv, dbenv->recover_dtab,
-					dbenv->recover_dtab_size, &tmpdbt, &rr->lsn,
-					DB_TXN_APPLY, rq->processor->txninfo);
-			} else
-				rc = 0;
-		} else {
-
-			LOGCOPY_32(&rectype, rr->logdbt.data);
-
-			rr->logdbt.app_data = &rp->context;
-			if (dispatch_rectype(rectype)) {
-				rc = __db_dispatch(dbenv, dbenv->recover_dtab,
-					dbenv->recover_dtab_size, &rr->logdbt,
-					&rr->lsn, DB_TXN_APPLY,
-					rq->processor->txninfo);
-			} else
-				rc = 0;
-		}
-
-		/* TODO: what do I do on an error? */
-		if (rc) {
-			__db_err(dbenv, "transaction failed at %lu:%lu rc=%d",
-				(u_long)rr->lsn.file, (u_long)rr->lsn.offset, rc);
-			/* and now? */
-			abort();
-		}
+		recovery_apply_record(dbenv, rp, rr, &logc, &tmpdbt);
 
 		/* mempool? */
 		listc_abl(&q, rr);
@@ -3969,14 +4028,11 @@ worker_thd(struct thdpool *pool, void *work, void *thddata, int op)
 		rr = listc_rtl(&rq->records);
 	}
 
-	if (logc) {
-		if (tmpdbt.data)
-			free(tmpdbt.data);
-		if ((rc = __log_c_close(logc))) {
-			__db_err(dbenv, "__log_c_close rc %d\n", rc);
-			abort();
-		}
-	}
+	recovery_close_logc(dbenv, logc, &tmpdbt);
+
+	if (start_us)
+		__rep_profile_file(dbenv, rq->fileid,
+			comdb2_time_epochus() - start_us, recnum);
 
 	Pthread_mutex_lock(&rq->processor->lk);
 	rr = listc_rtl(&q);
@@ -3993,6 +4049,420 @@ worker_thd(struct thdpool *pool, void *work, void *thddata, int op)
 	Pthread_mutex_unlock(&rq->processor->lk);
 }
 
+/*
+ * Page-level scheduling of a large recovery queue.  The records of one file
+ * in a transaction normally run in order on a single worker.  When there
+ * are enough of them, the processor instead builds a dependency graph: each
+ * record waits for the previous record touching any of the same pages, and
+ * records whose pages we can't tell (or that touch in-memory file state)
+ * act as barriers.  Records are then applied by several workers in any
+ * order the graph allows, so per-page LSN order is kept.
+ */
+int gbl_rep_page_parallel = 0;
+int gbl_rep_page_parallel_min_records = 2000;
+int gbl_rep_page_parallel_threads = 4;
+int64_t gbl_rep_page_parallel_queues = 0;
+int64_t gbl_rep_page_parallel_records = 0;
+
+struct page_dep_node {
+	struct __recovery_record *rr;
+	int ndeps;		/* predecessors not yet applied */
+	int nsucc;
+	int succ_alloc;
+	int *succ;
+};
+
+struct page_dep_graph {
+	struct __recovery_queue *rq;
+	pthread_mutex_t lk;
+	pthread_cond_t cond;
+	struct page_dep_node *nodes;
+	int nnodes;
+	int ndone;
+	int *ready;		/* FIFO of runnable nodes */
+	int ready_head;
+	int ready_tail;
+	int nhelpers;		/* helpers that haven't exited */
+	int64_t start_us;
+};
+
+/*
+ * Fill pgnos with the pages a record reads or writes when it is applied.
+ * Returns the number of pages, or -1 if the record must be treated as a
+ * barrier.
+ */
+static int
+page_dep_record_pages(dbenv, rectype, dbt, pgnos)
+	DB_ENV *dbenv;
+	u_int32_t rectype;
+	DBT *dbt;
+	db_pgno_t *pgnos;
+{
+	void *argp = NULL;
+	int n = -1;
+
+	if (!dispatch_rectype(rectype))
+		return (0);
+
+#define	PAGE_DEP_READ(name) \
+	__##name##_args *a; \
+	if (__##name##_read(dbenv, dbt->data, &a) != 0) \
+		return (-1); \
+	argp = a; \
+	n = 0
+#define	PAGE_DEP_ADD(pg) pgnos[n++] = (pg)
+#define	PAGE_DEP_ADD_VALID(pg) \
+	if ((pg) != PGNO_INVALID) \
+		pgnos[n++] = (pg)
+
+	switch (rectype) {
+	case DB___db_addrem: {
+		PAGE_DEP_READ(db_addrem);
+		PAGE_DEP_ADD(a->pgno);
+		break;
+	}
+	case DB___db_big: {
+		PAGE_DEP_READ(db_big);
+		PAGE_DEP_ADD(a->pgno);
+		PAGE_DEP_ADD_VALID(a->prev_pgno);
+		PAGE_DEP_ADD_VALID(a->next_pgno);
+		break;
+	}
+	case DB___db_ovref: {
+		PAGE_DEP_READ(db_ovref);
+		PAGE_DEP_ADD(a->pgno);
+		break;
+	}
+	case DB___db_relink: {
+		PAGE_DEP_READ(db_relink);
+		PAGE_DEP_ADD(a->pgno);
+		PAGE_DEP_ADD_VALID(a->prev);
+		PAGE_DEP_ADD_VALID(a->next);
+		break;
+	}
+	case DB___db_pg_alloc: {
+		PAGE_DEP_READ(db_pg_alloc);
+		PAGE_DEP_ADD(a->meta_pgno);
+		PAGE_DEP_ADD(a->pgno);
+		break;
+	}
+	case DB___db_pg_free: {
+		PAGE_DEP_READ(db_pg_free);
+		PAGE_DEP_ADD(a->meta_pgno);
+		PAGE_DEP_ADD(a->pgno);
+		break;
+	}
+	case DB___db_pg_freedata: {
+		PAGE_DEP_READ(db_pg_freedata);
+		PAGE_DEP_ADD(a->meta_pgno);
+		PAGE_DEP_ADD(a->pgno);
+		break;
+	}
+	case DB___bam_split: {
+		PAGE_DEP_READ(bam_split);
+		/* Root splits rewrite the root in place: keep them ordered. */
+		if (a->root_pgno != PGNO_INVALID) {
+			n = -1;
+			break;
+		}
+		PAGE_DEP_ADD(a->left);
+		PAGE_DEP_ADD(a->right);
+		PAGE_DEP_ADD_VALID(a->npgno);
+		break;
+	}
+	case DB___bam_adj: {
+		PAGE_DEP_READ(bam_adj);
+		PAGE_DEP_ADD(a->pgno);
+		break;
+	}
+	case DB___bam_cadjust: {
+		PAGE_DEP_READ(bam_cadjust);
+		PAGE_DEP_ADD(a->pgno);
+		break;
+	}
+	case DB___bam_cdel: {
+		PAGE_DEP_READ(bam_cdel);
+		PAGE_DEP_ADD(a->pgno);
+		break;
+	}
+	case DB___bam_repl: {
+		PAGE_DEP_READ(bam_repl);
+		PAGE_DEP_ADD(a->pgno);
+		break;
+	}
+	default:
+		/* rsplit and root also update the handle's cached root */
+		break;
+	}
+
+#undef	PAGE_DEP_READ
+#undef	PAGE_DEP_ADD
+#undef	PAGE_DEP_ADD_VALID
+
+	if (argp)
+		__os_free(dbenv, argp);
+	return (n);
+}
+
+static int
+page_dep_add_edge(dbenv, g, from, to)
+	DB_ENV *dbenv;
+	struct page_dep_graph *g;
+	int from;
+	int to;
+{
+	struct page_dep_node *f = &g->nodes[from];
+	int ret;
+
+	/* Edges into a node are added together, so a repeat is the last one */
+	if (f->nsucc > 0 && f->succ[f->nsucc - 1] == to)
+		return (0);
+	if (f->nsucc == f->succ_alloc) {
+		if ((ret = __os_realloc(dbenv,
+		    (f->succ_alloc ? f->succ_alloc * 2 : 2) * sizeof(int),
+		    &f->succ)) != 0)
+			return (ret);
+		f->succ_alloc = f->succ_alloc ? f->succ_alloc * 2 : 2;
+	}
+	f->succ[f->nsucc++] = to;
+	g->nodes[to].ndeps++;
+	return (0);
+}
+
+static void
+page_dep_free(dbenv, g)
+	DB_ENV *dbenv;
+	struct page_dep_graph *g;
+{
+	int i;
+
+	if (g->nodes != NULL) {
+		for (i = 0; i < g->nnodes; i++)
+			__os_free(dbenv, g->nodes[i].succ);
+	}
+	__os_free(dbenv, g->nodes);
+	__os_free(dbenv, g->ready);
+	Pthread_mutex_destroy(&g->lk);
+	Pthread_cond_destroy(&g->cond);
+	__os_free(dbenv, g);
+}
+
+/* Build the graph for a queue, taking its records.  Returns NULL, leaving
+ * the queue as it was, if it is mostly barriers and is better run on a
+ * single worker, or if there is not enough memory for the graph. */
+static struct page_dep_graph *
+page_dep_build(dbenv, rq)
+	DB_ENV *dbenv;
+	struct __recovery_queue *rq;
+{
+	struct page_dep_graph *g;
+	struct __recovery_record *rr;
+	db_pgno_t *keys = NULL;
+	int *last = NULL, *since_barrier = NULL;
+	int i, j, n, npages = 0, nsince = 0, nbarriers = 0, barrier = -1;
+	unsigned int h, mask, tblsz;
+
+	n = listc_size(&rq->records);
+	LISTC_FOR_EACH(&rq->records, rr, lnk) {
+		if (rr->npgnos < 0)
+			nbarriers++;
+		else
+			npages += rr->npgnos;
+	}
+	if (nbarriers * 4 > n)
+		return (NULL);
+
+	for (tblsz = 16; tblsz < (unsigned int)npages * 2; tblsz <<= 1)
+		;
+	mask = tblsz - 1;
+
+	if (__os_calloc(dbenv, 1, sizeof(*g), &g) != 0)
+		return (NULL);
+	Pthread_mutex_init(&g->lk, NULL);
+	Pthread_cond_init(&g->cond, NULL);
+	g->rq = rq;
+	g->nnodes = n;
+	if (__os_calloc(dbenv, n, sizeof(struct page_dep_node),
+	    &g->nodes) != 0 ||
+	    __os_malloc(dbenv, n * sizeof(int), &g->ready) != 0 ||
+	    __os_malloc(dbenv, tblsz * sizeof(db_pgno_t), &keys) != 0 ||
+	    __os_malloc(dbenv, tblsz * sizeof(int), &last) != 0 ||
+	    __os_malloc(dbenv, n * sizeof(int), &since_barrier) != 0)
+		goto err;
+	for (h = 0; h < tblsz; h++)
+		last[h] = -1;
+
+	/* The records stay on the queue until the graph is complete, so a
+	 * failure leaves it for worker_thd to apply serially. */
+	i = 0;
+	LISTC_FOR_EACH(&rq->records, rr, lnk) {
+		g->nodes[i].rr = rr;
+
+		if (rr->npgnos < 0) {
+			/* Waits for everything since the last barrier, which
+			 * in turn waited for everything before it. */
+			for (j = 0; j < nsince; j++) {
+				if (page_dep_add_edge(dbenv, g,
+				    since_barrier[j], i) != 0)
+					goto err;
+			}
+			if (nsince == 0 && barrier >= 0 &&
+			    page_dep_add_edge(dbenv, g, barrier, i) != 0)
+				goto err;
+			barrier = i;
+			nsince = 0;
+			i++;
+			continue;
+		}
+
+		if (barrier >= 0 &&
+		    page_dep_add_edge(dbenv, g, barrier, i) != 0)
+			goto err;
+		for (j = 0; j < rr->npgnos; j++) {
+			db_pgno_t pg = rr->pgnos[j];
+
+			for (h = (pg * 2654435761U) & mask;
+			    last[h] != -1 && keys[h] != pg; h = (h + 1) & mask)
+				;
+			/* Anything before the barrier is already ordered */
+			if (last[h] > barrier &&
+			    page_dep_add_edge(dbenv, g, last[h], i) != 0)
+				goto err;
+			keys[h] = pg;
+			last[h] = i;
+		}
+		since_barrier[nsince++] = i;
+		i++;
+	}
+
+	for (i = 0; i < n; i++) {
+		listc_rtl(&rq->records);
+		if (g->nodes[i].ndeps == 0)
+			g->ready[g->ready_tail++] = i;
+	}
+
+	__os_free(dbenv, keys);
+	__os_free(dbenv, last);
+	__os_free(dbenv, since_barrier);
+	return (g);
+
+err:	__os_free(dbenv, keys);
+	__os_free(dbenv, last);
+	__os_free(dbenv, since_barrier);
+	page_dep_free(dbenv, g);
+	return (NULL);
+}
+
+/* A pool task: apply runnable records of the graph until all are done. */
+static void
+page_dep_thd(struct thdpool *pool, void *work, void *thddata, int op)
+{
+	struct page_dep_graph *g = work;
+	struct __recovery_processor *rp = g->rq->processor;
+	DB_ENV *dbenv = rp->dbenv;
+	DB_LOGC *logc = NULL;
+	DBT tmpdbt;
+	struct page_dep_node *node;
+	int i, idx, nready, last;
+
+	Pthread_mutex_lock(&g->lk);
+	while (g->ndone < g->nnodes) {
+		if (g->ready_head == g->ready_tail) {
+			Pthread_cond_wait(&g->cond, &g->lk);
+			continue;
+		}
+		idx = g->ready[g->ready_head++];
+		Pthread_mutex_unlock(&g->lk);
+
+		node = &g->nodes[idx];
+		recovery_apply_record(dbenv, rp, node->rr, &logc, &tmpdbt);
+
+		Pthread_mutex_lock(&g->lk);
+		g->ndone++;
+		nready = 0;
+		for (i = 0; i < node->nsucc; i++) {
+			if (--g->nodes[node->succ[i]].ndeps == 0) {
+				g->ready[g->ready_tail++] = node->succ[i];
+				nready++;
+			}
+		}
+		if (nready > 1 || g->ndone == g->nnodes)
+			Pthread_cond_broadcast(&g->cond);
+		else if (nready == 1)
+			Pthread_cond_signal(&g->cond);
+	}
+	last = (--g->nhelpers == 0);
+	Pthread_mutex_unlock(&g->lk);
+
+	recovery_close_logc(dbenv, logc, &tmpdbt);
+
+	if (last && g->start_us)
+		__rep_profile_file(dbenv, g->rq->fileid,
+			comdb2_time_epochus() - g->start_us, g->nnodes);
+
+	Pthread_mutex_lock(&rp->lk);
+	if (last) {
+		for (i = 0; i < g->nnodes; i++)
+			pool_relablk(rp->recpool, g->nodes[i].rr);
+	}
+	rp->num_busy_workers--;
+	Pthread_cond_signal(&rp->wait);
+	Pthread_mutex_unlock(&rp->lk);
+
+	if (last)
+		page_dep_free(dbenv, g);
+}
+
+/*
+ * Run a queue through the page graph if it is big enough.  The queue was
+ * counted once in num_busy_workers; each extra helper adds one.  If
+ * run_inline is set, one helper runs on the calling thread.  Returns 0 if
+ * the queue was left for worker_thd.
+ */
+static int
+page_dep_dispatch(rp, rq, run_inline)
+	struct __recovery_processor *rp;
+	struct __recovery_queue *rq;
+	int run_inline;
+{
+	struct page_dep_graph *g;
+	DB_ENV *dbenv = rp->dbenv;
+	int64_t start_us;
+	int i, nhelpers;
+
+	if (listc_size(&rq->records) < gbl_rep_page_parallel_min_records)
+		return (0);
+
+	start_us = gbl_rep_apply_profile ? comdb2_time_epochus() : 0;
+	if ((g = page_dep_build(dbenv, rq)) == NULL)
+		return (0);
+	g->start_us = start_us;
+
+	nhelpers = gbl_rep_page_parallel_threads;
+	if (nhelpers < 1)
+		nhelpers = 1;
+	if (nhelpers > g->nnodes)
+		nhelpers = g->nnodes;
+	g->nhelpers = nhelpers;
+
+	gbl_rep_page_parallel_queues++;
+	gbl_rep_page_parallel_records += g->nnodes;
+
+	Pthread_mutex_lock(&rp->lk);
+	rp->num_busy_workers += nhelpers - 1;
+	Pthread_mutex_unlock(&rp->lk);
+
+	for (i = run_inline ? 1 : 0; i < nhelpers; i++) {
+		/* Any one helper can finish the graph alone */
+		if (thdpool_enqueue(dbenv->recovery_workers, page_dep_thd, g,
+			0, NULL, 0) != 0)
+			page_dep_thd(NULL, g, NULL, -1);
+	}
+	if (run_inline)
+		page_dep_thd(NULL, g, NULL, -1);
+	return (1);
+}
+
 /* note: must be called under the dbenv->recover_lk lock */
 void
 in_order_commit_check(DB_LSN *lsn)
@@ -4068,6 +4538,8 @@ processor_thd(struct thdpool *pool, void *work, void *thddata, int op)
 	int ret, t_ret = 0, last_fileid = -1;
 	DB_LSN *lsnp;
 	int j;
+	int64_t commit_us = 0;
+	int page_deps;
 	LISTC_T(struct __recovery_queue) queues;
 
 	DB_REP *db_rep;
@@ -4155,9 +4627,14 @@ processor_thd(struct thdpool *pool, void *work, void *thddata, int op)
 	/* First, bucket records per queue. */
 	data_dbt.flags = DB_DBT_REALLOC;
 
+	/* Only large transactions are worth parsing for page numbers */
+	page_deps = gbl_rep_page_parallel &&
+		rp->lc.nlsns >= gbl_rep_page_parallel_min_records;
+
 	for (i = 0; i < rp->lc.nlsns; i++) {
 		int fileid;
 		u_int32_t rectype;
+		DBT *recdbt;
 
 		lsnp = &rp->lc.array[i].lsn;
 
@@ -4171,16 +4648,14 @@ processor_thd(struct thdpool *pool, void *work, void *thddata, int op)
 					(u_long)lsnp->file, (u_long)lsnp->offset);
 				goto err;
 			}
-			LOGCOPY_32(&rectype, data_dbt.data);
-			fileid =
-				(int)file_id_for_recovery_record(dbenv, NULL,
-				rectype, &data_dbt);
-		} else {
-			LOGCOPY_32(&rectype, rp->lc.array[i].rec.data);
-			fileid =
-				(int)file_id_for_recovery_record(dbenv, NULL,
-				rectype, &rp->lc.array[i].rec);
-		}
+			recdbt = &data_dbt;
+		} else
+			recdbt = &rp->lc.array[i].rec;
+
+		LOGCOPY_32(&rectype, recdbt->data);
+		fileid =
+			(int)file_id_for_recovery_record(dbenv, NULL,
+			rectype, recdbt);
 
 		if (fileid >= 0) {
 			last_fileid = fileid;
@@ -4226,6 +4701,8 @@ processor_thd(struct thdpool *pool, void *work, void *thddata, int op)
 			rr->logdbt.data = NULL;
 		rr->lsn = *lsnp;
 		rr->fileid = fileid;
+		rr->npgnos = page_deps ?
+			page_dep_record_pages(dbenv, rectype, recdbt, rr->pgnos) : -1;
 
 		listc_abl(&rp->recovery_queues[fileid]->records, rr);
 	}
@@ -4242,7 +4719,10 @@ processor_thd(struct thdpool *pool, void *work, void *thddata, int op)
 		while (rq) {
 			rq->used = 0;
 			gbl_rep_trans_inline++;
-			worker_thd(NULL, rq, NULL, -1);
+			if (page_deps && page_dep_dispatch(rp, rq, 1))
+				inline_worker = 0;
+			else
+				worker_thd(NULL, rq, NULL, -1);
 			rq = listc_rtl(&queues);
 		}
 	}
@@ -4258,8 +4738,9 @@ processor_thd(struct thdpool *pool, void *work, void *thddata, int op)
 				abort();
 			}
 			rq->used = 0;
-			thdpool_enqueue(dbenv->recovery_workers, worker_thd, rq,
-				0, NULL, 0);
+			if (!page_deps || !page_dep_dispatch(rp, rq, 0))
+				thdpool_enqueue(dbenv->recovery_workers, worker_thd,
+					rq, 0, NULL, 0);
 			rq = listc_rtl(&queues);
 		}
 	}
@@ -4298,6 +4779,8 @@ processor_thd(struct thdpool *pool, void *work, void *thddata, int op)
 		Pthread_mutex_unlock(&rp->lk);
 	}
 
+	if (gbl_rep_apply_profile)
+		commit_us = comdb2_time_epochus();
 
 #if 0
 	{
@@ -4410,6 +4893,10 @@ err:
 		Pthread_rwlock_unlock(&dbenv->ser_lk);
 	}
 
+	if (commit_us)
+		__rep_profile_add(REP_STAGE_COMMIT,
+			comdb2_time_epochus() - commit_us);
+
 	bdb_thread_done_rw();
 }
 
@@ -4504,6 +4991,7 @@ __rep_process_txn_int(dbenv, rctl, rec, ltrans, maxlsn, commit_gen, lockid, rp,
 	int get_locks_and_ack = 1;
 	void *pglogs = NULL;
 	u_int32_t keycnt = 0;
+	int64_t getlocks_us, stage_us = 0;
 
 	logmsg(LOGMSG_DEBUG, "%s processing [%d:%d]\n", __func__, maxlsn.file,
 			maxlsn.offset);
@@ -4704,6 +5192,7 @@ __rep_process_txn_int(dbenv, rctl, rec, ltrans, maxlsn, commit_gen, lockid, rp,
 				LOCK_GET_LIST_GETLOCK | (gbl_rep_printlock ?
 				LOCK_GET_LIST_PRINTLOCK : 0);
 			assert(gbl_rep_lock_time_ms == 0);
+			getlocks_us = gbl_rep_apply_profile ? comdb2_time_epochus() : 0;
 			gbl_rep_lock_time_ms = comdb2_time_epochms();
 			ret =
 				__lock_get_list_context(dbenv, lockid, flags,
@@ -4711,6 +5200,9 @@ __rep_process_txn_int(dbenv, rctl, rec, ltrans, maxlsn, commit_gen, lockid, rp,
 				&pglogs, &keycnt);
 			assert(gbl_rep_lock_time_ms != 0);
 			gbl_rep_lock_time_ms = 0;
+			if (getlocks_us)
+				__rep_profile_add(REP_STAGE_GETLOCKS,
+					comdb2_time_epochus() - getlocks_us);
 			if (ret != 0) {
 				line = __LINE__;
 				goto err;
@@ -4725,12 +5217,16 @@ __rep_process_txn_int(dbenv, rctl, rec, ltrans, maxlsn, commit_gen, lockid, rp,
 				LOCK_GET_LIST_GETLOCK | (gbl_rep_printlock ?
 				LOCK_GET_LIST_PRINTLOCK : 0);
 			assert(gbl_rep_lock_time_ms == 0);
+			getlocks_us = gbl_rep_apply_profile ? comdb2_time_epochus() : 0;
 			gbl_rep_lock_time_ms = comdb2_time_epochms();
 			ret =
 				__lock_get_list(dbenv, lockid, flags, DB_LOCK_WRITE,
 				lock_dbt, &(rctl->lsn), &pglogs, &keycnt, stdout);
 			assert(gbl_rep_lock_time_ms != 0);
 			gbl_rep_lock_time_ms = 0;
+			if (getlocks_us)
+				__rep_profile_add(REP_STAGE_GETLOCKS,
+					comdb2_time_epochus() - getlocks_us);
 			if (ret != 0) {
 				line = __LINE__;
 				goto err;
@@ -4835,6 +5331,8 @@ __rep_process_txn_int(dbenv, rctl, rec, ltrans, maxlsn, commit_gen, lockid, rp,
 	}
 
 	/* Phase 2: Apply updates. */
+	if (gbl_rep_apply_profile)
+		stage_us = comdb2_time_epochus();
 	for (i = 0; i < lc.nlsns; i++) {
 		DBT lcin_dbt = { 0 };
 		uint32_t rectype = 0;
@@ -4891,6 +5389,13 @@ __rep_process_txn_int(dbenv, rctl, rec, ltrans, maxlsn, commit_gen, lockid, rp,
 	}
 
 err:
+	/* This path doesn't bucket records by file, so page apply is only
+	 * counted in the all-files row. */
+	if (stage_us) {
+		int64_t now_us = comdb2_time_epochus();
+		__rep_profile_file(dbenv, -1, now_us - stage_us, lc.nlsns);
+		stage_us = now_us;
+	}
 
 	memset(&req, 0, sizeof(req));
 
@@ -4938,6 +5443,10 @@ err:
 		unlock_schema_lk();
 	}
 
+	if (stage_us)
+		__rep_profile_add(REP_STAGE_COMMIT,
+			comdb2_time_epochus() - stage_us);
+
 err1:
 	if (ret != 0 && ret != DB_LOCK_DEADLOCK) {
 		logmsg(LOGMSG_ERROR, "%s failed at line %d with %d\n", __func__,
@@ -5178,6 +5687,7 @@ __rep_process_txn_concurrent_int(dbenv, rctl, rec, ltrans, ctrllsn, maxlsn,
 	void *pglogs = NULL;
 	u_int32_t keycnt = 0;
 	int got_schema_lk = 0;
+	int64_t getlocks_us;
 
 	Pthread_mutex_lock(&dbenv->recover_lk);
 	rp = listc_rtl(&dbenv->inactive_transactions);
@@ -5425,12 +5935,16 @@ bad_resize:	;
 			LOCK_GET_LIST_GETLOCK | (gbl_rep_printlock ?
 			LOCK_GET_LIST_PRINTLOCK : 0);
 		assert(gbl_rep_lock_time_ms == 0);
+		getlocks_us = gbl_rep_apply_profile ? comdb2_time_epochus() : 0;
 		gbl_rep_lock_time_ms = comdb2_time_epochms();
 		ret =
 			__lock_get_list_context(dbenv, lockid, flags, DB_LOCK_WRITE,
 			lock_dbt, &rp->context, &(rctl->lsn), &pglogs, &keycnt);
 		assert(gbl_rep_lock_time_ms != 0);
 		gbl_rep_lock_time_ms = 0;
+		if (getlocks_us)
+			__rep_profile_add(REP_STAGE_GETLOCKS,
+				comdb2_time_epochus() - getlocks_us);
 		if (ret != 0)
 			goto err;
 
@@ -5443,12 +5957,16 @@ bad_resize:	;
 			LOCK_GET_LIST_GETLOCK | (gbl_rep_printlock ?
 			LOCK_GET_LIST_PRINTLOCK : 0);
 		assert(gbl_rep_lock_time_ms == 0);
+		getlocks_us = gbl_rep_apply_profile ? comdb2_time_epochus() : 0;
 		gbl_rep_lock_time_ms = comdb2_time_epochms();
 		ret =
 			__lock_get_list(dbenv, lockid, flags, DB_LOCK_WRITE,
 			lock_dbt, &(rctl->lsn), &pglogs, &keycnt, stdout);
 		assert(gbl_rep_lock_time_ms != 0);
 		gbl_rep_lock_time_ms = 0;
+		if (getlocks_us)
+			__rep_profile_add(REP_STAGE_GETLOCKS,
+				comdb2_time_epochus() - getlocks_us);
 		if (ret != 0)
 			goto err;
 
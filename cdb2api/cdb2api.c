@@ -851,6 +851,19 @@ typedef struct cdb2_query_list_item {
     struct cdb2_query_list_item *next;
 } cdb2_query_list;
 
+/* A statement sent by cdb2_run_statement_async() whose result is pending */
+typedef struct cdb2_async_stmt {
+    int has_response;
+    struct cdb2_async_stmt *next;
+} cdb2_async_stmt;
+
+/* Cap on unread results.  This bounds the bookkeeping, it does not prevent
+ * deadlock: requests are written with blocking writes, so if the pending
+ * results fill the server's send buffer and ours while we are still writing
+ * requests, both sides block.  Callers pipelining statements with large
+ * results have to collect them before sending more. */
+#define CDB2_MAX_ASYNC_STATEMENTS 128
+
 #if WITH_SSL
 typedef struct cdb2_ssl_sess {
     char host[64];
@@ -951,6 +964,18 @@ struct cdb2_hndl {
     unsigned long long rows_read;
     int read_intrans_results;
     int first_record_read;
+    /* Cursor over lastresponse when it is a ROW_BATCH */
+    int batch_nrows;
+    int batch_row;
+    int batch_capacity;
+    struct cdb2_batch_col *batch_cols;
+    uint64_t *batch_slots; /* aligned copies of fixed width values */
+    int batch_nslots;
+    /* Statements sent with cdb2_run_statement_async(), oldest first */
+    cdb2_async_stmt *async_head;
+    cdb2_async_stmt *async_tail;
+    int n_async;
+    int defer_flush;
     char **commands;
     int ack;
     int is_hasql;
@@ -982,6 +1007,15 @@ struct cdb2_hndl {
     cdb2_event events;
 };
 
+/* One column of a ROW_BATCH response, pointing into lastresponse */
+struct cdb2_batch_col {
+    int width; /* 0 for variable length values */
+    int slot;  /* index of this column's value copy in batch_slots */
+    const uint8_t *nulls;
+    const uint8_t *offsets;
+    const uint8_t *data;
+};
+
 static int cdb2_tcpconnecth_to(cdb2_hndl_tp *hndl, const char *host, int port,
                                int myport, int timeoutms)
 {
@@ -2495,6 +2529,7 @@ static int cdb2_convert_error_code(int rc)
 
 static void clear_responses(cdb2_hndl_tp *hndl)
 {
+    hndl->batch_nrows = 0;
     if (hndl->lastresponse) {
         cdb2__sqlresponse__free_unpacked(hndl->lastresponse, NULL);
         free((void *)hndl->last_buf);
@@ -2667,6 +2702,7 @@ static int cdb2_send_query(cdb2_hndl_tp *hndl, cdb2_hndl_tp *event_hndl,
 
     if (hndl) { 
         features[n_features++] = CDB2_CLIENT_FEATURES__ALLOW_MASTER_DBINFO;
+        features[n_features++] = CDB2_CLIENT_FEATURES__ROW_BATCH;
         if ((hndl->flags & CDB2_DIRECT_CPU) ||
             (retries_done >= (hndl->num_hosts * 2 - 1) && hndl->master ==
              hndl->connected_host)) {
@@ -2750,7 +2786,8 @@ static int cdb2_send_query(cdb2_hndl_tp *hndl, cdb2_hndl_tp *event_hndl,
     if (rc != len)
         debugprint("sbuf2write rc = %d (len = %d)\n", rc, len);
 
-    rc = sbuf2flush(sb);
+    /* Pipelined statements are flushed when their results are read */
+    rc = (hndl && hndl->defer_flush) ? 0 : sbuf2flush(sb);
     if (rc < 0) {
         debugprint("sbuf2flush rc = %d\n", rc);
         free(buf);
@@ -2808,6 +2845,7 @@ static int is_retryable(cdb2_hndl_tp *hndl, int err_val)
 
 static int retry_queries_and_skip(cdb2_hndl_tp *hndl, int num_retry,
                                   int skip_nrows);
+static int cdb2_drain_async(cdb2_hndl_tp *hndl);
 
 #define PRINT_RETURN(rcode)                                                    \
     do {                                                                       \
@@ -2827,6 +2865,108 @@ static int retry_queries_and_skip(cdb2_hndl_tp *hndl, int num_retry,
         return (rcode);                                                        \
     } while (0)
 
+static inline uint32_t cdb2_batch_u32(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return ntohl(v);
+}
+
+/* Index the columns of a ROW_BATCH response. The layout is described next to
+ * newsql_send_row_batch() in the newsql plugin. */
+static int cdb2_parse_row_batch(cdb2_hndl_tp *hndl)
+{
+    CDB2SQLRESPONSE *r = hndl->lastresponse;
+    const uint8_t *p = r->row_batch.data;
+    const uint8_t *end = p + r->row_batch.len;
+
+    hndl->batch_nrows = 0;
+    if (!r->has_row_batch || end - p < 2 * sizeof(uint32_t))
+        return -1;
+
+    uint32_t nrows = cdb2_batch_u32(p);
+    uint32_t ncols = cdb2_batch_u32(p + sizeof(uint32_t));
+    p += 2 * sizeof(uint32_t);
+    if (nrows == 0 || nrows > INT_MAX || ncols != hndl->firstresponse->n_value)
+        return -1;
+
+    if (hndl->batch_capacity < ncols) {
+        struct cdb2_batch_col *cols =
+            realloc(hndl->batch_cols, ncols * sizeof(struct cdb2_batch_col));
+        if (cols == NULL)
+            return -1;
+        hndl->batch_cols = cols;
+        hndl->batch_capacity = ncols;
+    }
+
+    size_t nullsz = (nrows + 7) / 8;
+    int nslots = 0;
+    for (int i = 0; i < ncols; i++) {
+        struct cdb2_batch_col *c = &hndl->batch_cols[i];
+        if (end - p < 2 * sizeof(uint32_t))
+            return -1;
+        c->width = cdb2_batch_u32(p);
+        uint32_t len = cdb2_batch_u32(p + sizeof(uint32_t));
+        p += 2 * sizeof(uint32_t);
+
+        if (end - p < nullsz)
+            return -1;
+        c->nulls = p;
+        p += nullsz;
+
+        if (c->width == 0) {
+            if ((end - p) / sizeof(uint32_t) < nrows + 1)
+                return -1;
+            c->offsets = p;
+            p += (nrows + 1) * sizeof(uint32_t);
+            /* offsets have to be ascending and end at the data length */
+            uint32_t prev = 0;
+            for (uint32_t row = 0; row <= nrows; row++) {
+                uint32_t off =
+                    cdb2_batch_u32(c->offsets + row * sizeof(uint32_t));
+                if (off < prev)
+                    return -1;
+                prev = off;
+            }
+            if (prev != len)
+                return -1;
+        } else {
+            c->offsets = NULL;
+            if (c->width < 0 || len / c->width != nrows ||
+                len % c->width != 0)
+                return -1;
+            /* values are unaligned in the batch, cdb2_column_value returns
+             * a copy */
+            c->slot = nslots;
+            nslots += (c->width + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+        }
+
+        if (end - p < len)
+            return -1;
+        c->data = p;
+        p += len;
+    }
+
+    if (hndl->batch_nslots < nslots) {
+        uint64_t *slots =
+            realloc(hndl->batch_slots, nslots * sizeof(uint64_t));
+        if (slots == NULL)
+            return -1;
+        hndl->batch_slots = slots;
+        hndl->batch_nslots = nslots;
+    }
+
+    hndl->batch_row = 0;
+    hndl->batch_nrows = nrows;
+    return 0;
+}
+
+static inline int cdb2_batch_isnull(cdb2_hndl_tp *hndl, int col)
+{
+    int row = hndl->batch_row;
+    return hndl->batch_cols[col].nulls[row / 8] & (1 << (row % 8));
+}
+
 static int cdb2_next_record_int(cdb2_hndl_tp *hndl, int shouldretry)
 {
     int len;
@@ -2843,6 +2983,15 @@ retry_next_record:
     if (hndl->firstresponse->error_code)
         PRINT_RETURN_OK(hndl->firstresponse->error_code);
 
+    /* Rows left in the current batch don't need another read */
+    if (hndl->batch_row + 1 < hndl->batch_nrows) {
+        hndl->batch_row++;
+        hndl->rows_read++;
+        if (hndl->in_trans)
+            hndl->error_in_trans = 0;
+        PRINT_RETURN_OK(CDB2_OK);
+    }
+
     if (hndl->lastresponse) {
         if (hndl->lastresponse->response_type == RESPONSE_TYPE__LAST_ROW) {
             PRINT_RETURN_OK(CDB2_OK_DONE);
@@ -2901,6 +3050,7 @@ retry_next_record:
     }
 
     /* free previous response */
+    hndl->batch_nrows = 0;
     if (hndl->lastresponse)
         cdb2__sqlresponse__free_unpacked(hndl->lastresponse, NULL);
 
@@ -2936,6 +3086,19 @@ retry_next_record:
         PRINT_RETURN_OK(rc);
     }
 
+    if (hndl->lastresponse->response_type == RESPONSE_TYPE__ROW_BATCH) {
+        if (cdb2_parse_row_batch(hndl)) {
+            newsql_disconnect(hndl, hndl->sb, __LINE__);
+            sprintf(hndl->errstr, "%s: Invalid row batch from server",
+                    __func__);
+            PRINT_RETURN_OK(-1);
+        }
+        hndl->rows_read++;
+        if (hndl->in_trans)
+            hndl->error_in_trans = 0;
+        PRINT_RETURN_OK(CDB2_OK);
+    }
+
     if (hndl->lastresponse->response_type == RESPONSE_TYPE__LAST_ROW) {
         int ii = 0;
 
@@ -2985,6 +3148,9 @@ int cdb2_next_record(cdb2_hndl_tp *hndl)
         hndl->first_record_read = 1;
         if (hndl->lastresponse->response_type == RESPONSE_TYPE__COLUMN_VALUES) {
             rc = hndl->lastresponse->error_code;
+        } else if (hndl->lastresponse->response_type ==
+                   RESPONSE_TYPE__ROW_BATCH) {
+            rc = CDB2_OK;
         } else if (hndl->lastresponse->response_type ==
                    RESPONSE_TYPE__LAST_ROW) {
             if (hndl->num_set_commands) {
@@ -3016,6 +3182,9 @@ int cdb2_get_effects(cdb2_hndl_tp *hndl, cdb2_effects_tp *effects)
 {
     int rc = 0;
 
+    if (hndl->async_head && cdb2_drain_async(hndl) != 0)
+        return -1;
+
     while (cdb2_next_record_int(hndl, 0) == CDB2_OK)
         ;
 
@@ -3077,6 +3246,9 @@ int cdb2_close(cdb2_hndl_tp *hndl)
     if (hndl->ack)
         ack(hndl);
 
+    if (hndl->async_head)
+        cdb2_drain_async(hndl);
+
     if (hndl->sb && !hndl->in_trans && hndl->firstresponse &&
         (!hndl->lastresponse ||
          (hndl->lastresponse->response_type != RESPONSE_TYPE__LAST_ROW))) {
@@ -3115,6 +3287,9 @@ int cdb2_close(cdb2_hndl_tp *hndl)
         cdb2__sqlresponse__free_unpacked(hndl->lastresponse, NULL);
         free((void *)hndl->last_buf);
     }
+    free(hndl->batch_cols);
+    free(hndl->batch_slots);
+
     if (hndl->num_set_commands) {
         while (hndl->num_set_commands) {
             hndl->num_set_commands--;
@@ -3835,6 +4010,10 @@ static int cdb2_run_statement_typed_int(cdb2_hndl_tp *hndl, const char *sql,
 
     debugprint("running '%s' from line %d\n", sql, line);
 
+    /* Results of pipelined statements come first on the wire */
+    if (hndl->async_head && (rc = cdb2_drain_async(hndl)) != 0)
+        PRINT_RETURN(rc);
+
     consume_previous_query(hndl);
     if (!sql)
         return 0;
@@ -4540,6 +4719,200 @@ after_callback:
     return rc;
 }
 
+/*
+  Send a statement without waiting for its result. The current bindings are
+  packed into the request, so they may be cleared and rebound as soon as this
+  returns. Results are collected in order with cdb2_next_async_result().
+  Pipelined statements are never retried on another node.
+*/
+int cdb2_run_statement_async(cdb2_hndl_tp *hndl, const char *sql)
+{
+    cdb2_async_stmt *stmt = NULL;
+    int rc = 0;
+
+    sql = cdb2_skipws(sql);
+    if (strncasecmp(sql, "set", 3) == 0 || strncasecmp(sql, "begin", 5) == 0 ||
+        strncasecmp(sql, "commit", 6) == 0 ||
+        strncasecmp(sql, "rollback", 8) == 0) {
+        sprintf(hndl->errstr, "%s: Use cdb2_run_statement for '%s'",
+                __func__, sql);
+        rc = CDB2ERR_NOTSUPPORTED;
+        goto done;
+    }
+    if ((hndl->is_hasql && !hndl->in_trans) || hndl->temp_trans) {
+        sprintf(hndl->errstr, "%s: HASQL statements must run in a transaction",
+                __func__);
+        rc = CDB2ERR_NOTSUPPORTED;
+        goto done;
+    }
+    if (hndl->in_trans && hndl->error_in_trans) {
+        rc = hndl->error_in_trans;
+        goto done;
+    }
+    if (hndl->n_async >= CDB2_MAX_ASYNC_STATEMENTS) {
+        sprintf(hndl->errstr, "%s: Too many pending results", __func__);
+        rc = CDB2ERR_REJECTED;
+        goto done;
+    }
+
+    if (hndl->sb == NULL) {
+        cdb2_connect_sqlhost(hndl);
+        if (hndl->sb == NULL) {
+            sprintf(hndl->errstr, "%s: Can't connect to db", __func__);
+            rc = CDB2ERR_CONNECT_ERROR;
+            goto done;
+        }
+    }
+
+    if (!hndl->in_trans) {
+        clear_snapshot_info(hndl, __LINE__);
+        if ((rc = next_cnonce(hndl)) != 0)
+            goto done;
+    }
+
+    /* Allocated before the query goes out, so that every statement sent
+       has its pending result accounted for */
+    stmt = malloc(sizeof(cdb2_async_stmt));
+    if (stmt == NULL) {
+        sprintf(hndl->errstr, "%s: malloc failed", __func__);
+        rc = CDB2ERR_MALLOC;
+        goto done;
+    }
+
+    hndl->is_read = is_sql_read(sql);
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    hndl->timestampus = ((uint64_t)tv.tv_sec) * 1000000 + tv.tv_usec;
+
+    hndl->defer_flush = 1;
+    if (hndl->in_trans) {
+        hndl->query_no++;
+        rc = cdb2_send_query(hndl, hndl, hndl->sb, hndl->dbname, sql, 0, 0,
+                             NULL, hndl->n_bindvars, hndl->bindvars, 0, NULL,
+                             0, 0, 0, 1, __LINE__);
+        if (rc != 0)
+            hndl->query_no--;
+    } else {
+        hndl->query_no = 0;
+        rc = cdb2_send_query(hndl, hndl, hndl->sb, hndl->dbname, sql,
+                             hndl->num_set_commands,
+                             hndl->num_set_commands_sent, hndl->commands,
+                             hndl->n_bindvars, hndl->bindvars, 0, NULL, 0, 0,
+                             0, 0, __LINE__);
+        hndl->num_set_commands_sent = hndl->num_set_commands;
+    }
+    hndl->defer_flush = 0;
+    if (rc) {
+        sprintf(hndl->errstr, "%s: Can't send query to the db", __func__);
+        newsql_disconnect(hndl, hndl->sb, __LINE__);
+        free(stmt);
+        rc = CDB2ERR_CONNECT_ERROR;
+        goto done;
+    }
+
+    /* Writes in a transaction get no reply unless intrans results are on */
+    stmt->has_response =
+        !hndl->in_trans || hndl->read_intrans_results || hndl->is_read;
+    stmt->next = NULL;
+    if (hndl->async_tail)
+        hndl->async_tail->next = stmt;
+    else
+        hndl->async_head = stmt;
+    hndl->async_tail = stmt;
+    hndl->n_async++;
+
+done:
+    if (log_calls)
+        fprintf(stderr, "%p> cdb2_run_statement_async(%p, \"%s\") = %d\n",
+                (void *)pthread_self(), hndl, sql, rc);
+    return rc;
+}
+
+/*
+  Wait for the result of the oldest statement sent with
+  cdb2_run_statement_async(). On success its rows can be read with
+  cdb2_next_record() and its effects with cdb2_get_effects(), exactly as after
+  cdb2_run_statement(). Returns CDB2_OK_DONE if no statement is pending.
+*/
+int cdb2_next_async_result(cdb2_hndl_tp *hndl)
+{
+    cdb2_async_stmt *stmt = hndl->async_head;
+    int rc, len, type = 0;
+
+    if (stmt == NULL)
+        return CDB2_OK_DONE;
+    hndl->async_head = stmt->next;
+    if (hndl->async_head == NULL)
+        hndl->async_tail = NULL;
+    hndl->n_async--;
+
+    consume_previous_query(hndl);
+    hndl->first_record_read = 0;
+
+    if (!stmt->has_response) {
+        free(stmt);
+        return CDB2_OK;
+    }
+    free(stmt);
+
+    if (hndl->sb == NULL || sbuf2flush(hndl->sb) < 0) {
+        sprintf(hndl->errstr, "%s: Can't send query to the db", __func__);
+        rc = CDB2ERR_CONNECT_ERROR;
+        goto done;
+    }
+
+    rc = cdb2_read_record(hndl, &hndl->first_buf, &len, &type);
+    if (rc || hndl->first_buf == NULL ||
+        type != RESPONSE_HEADER__SQL_RESPONSE) {
+        sprintf(hndl->errstr,
+                "%s: Timeout while reading response from server", __func__);
+        rc = CDB2ERR_CONNECT_ERROR;
+        goto done;
+    }
+    hndl->firstresponse = cdb2__sqlresponse__unpack(NULL, len, hndl->first_buf);
+    if (hndl->firstresponse == NULL ||
+        hndl->firstresponse->response_type != RESPONSE_TYPE__COLUMN_NAMES) {
+        sprintf(hndl->errstr, "%s: Unknown response type", __func__);
+        rc = CDB2ERR_CONNECT_ERROR;
+        goto done;
+    }
+
+    if (hndl->firstresponse->error_code) {
+        rc = cdb2_convert_error_code(hndl->firstresponse->error_code);
+        if (hndl->in_trans)
+            hndl->error_in_trans = rc;
+        return rc;
+    }
+
+    rc = cdb2_next_record_int(hndl, 0);
+    if (rc == CDB2_OK || rc == CDB2_OK_DONE)
+        return CDB2_OK;
+    return cdb2_convert_error_code(rc);
+
+done:
+    /* The rest of the pipeline is lost with the connection */
+    newsql_disconnect(hndl, hndl->sb, __LINE__);
+    while ((stmt = hndl->async_head) != NULL) {
+        hndl->async_head = stmt->next;
+        free(stmt);
+    }
+    hndl->async_tail = NULL;
+    hndl->n_async = 0;
+    return rc;
+}
+
+/* Read every pending pipelined result; returns the first error */
+static int cdb2_drain_async(cdb2_hndl_tp *hndl)
+{
+    int rc, first_rc = 0;
+    while ((rc = cdb2_next_async_result(hndl)) != CDB2_OK_DONE) {
+        if (rc != CDB2_OK && first_rc == 0)
+            first_rc = rc;
+    }
+    consume_previous_query(hndl);
+    return first_rc;
+}
+
 int cdb2_numcolumns(cdb2_hndl_tp *hndl)
 {
     int rc;
@@ -4662,6 +5035,15 @@ int cdb2_column_type(cdb2_hndl_tp *hndl, int col)
 
 int cdb2_column_size(cdb2_hndl_tp *hndl, int col)
 {
+    if (hndl->batch_nrows) {
+        struct cdb2_batch_col *c = &hndl->batch_cols[col];
+        if (cdb2_batch_isnull(hndl, col))
+            return 0;
+        if (c->width)
+            return c->width;
+        const uint8_t *off = c->offsets + hndl->batch_row * sizeof(uint32_t);
+        return cdb2_batch_u32(off + sizeof(uint32_t)) - cdb2_batch_u32(off);
+    }
     if ((hndl->lastresponse == NULL) || (hndl->lastresponse->value == NULL))
         return -1;
     return hndl->lastresponse->value[col]->value.len;
@@ -4669,6 +5051,21 @@ int cdb2_column_size(cdb2_hndl_tp *hndl, int col)
 
 void *cdb2_column_value(cdb2_hndl_tp *hndl, int col)
 {
+    if (hndl->batch_nrows) {
+        struct cdb2_batch_col *c = &hndl->batch_cols[col];
+        if (cdb2_batch_isnull(hndl, col))
+            return NULL;
+        if (c->width) {
+            void *slot = &hndl->batch_slots[c->slot];
+            memcpy(slot, c->data + hndl->batch_row * c->width, c->width);
+            return slot;
+        }
+        const uint8_t *off = c->offsets + hndl->batch_row * sizeof(uint32_t);
+        uint32_t start = cdb2_batch_u32(off);
+        if (cdb2_batch_u32(off + sizeof(uint32_t)) == start)
+            return (void *)"";
+        return (void *)(c->data + start);
+    }
     if ((hndl->lastresponse == NULL) || (hndl->lastresponse->value == NULL))
         return NULL;
     if (hndl->lastresponse->value[col]->value.len == 0 &&
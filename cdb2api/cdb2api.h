@@ -204,6 +204,8 @@ int cdb2_close(cdb2_hndl_tp *hndl);
 int cdb2_run_statement(cdb2_hndl_tp *hndl, const char *sql);
 int cdb2_run_statement_typed(cdb2_hndl_tp *hndl, const char *sql, int ntypes,
                              int *types);
+int cdb2_run_statement_async(cdb2_hndl_tp *hndl, const char *sql);
+int cdb2_next_async_result(cdb2_hndl_tp *hndl);
 
 int cdb2_numcolumns(cdb2_hndl_tp *hndl);
 const char *cdb2_column_name(cdb2_hndl_tp *hndl, int col);
@@ -23,6 +23,11 @@
  * of this when doing appsock stuff!
  */
 
+#include <errno.h>
+#include <unistd.h>
+#ifdef _LINUX_SOURCE
+#include <sys/epoll.h>
+#endif
 #include <lockmacro.h>
 #include "util.h"
 #include "comdb2.h"
@@ -60,6 +65,9 @@ int active_appsock_conns = 0;
 /* HASH of all registered appsock handlers (one handler per appsock type) */
 hash_t *gbl_appsock_hash;
 
+/* Park idle connections on the appsock poller between requests */
+int gbl_appsock_park_idle = 0;
+
 static unsigned long long total_appsock_conns = 0;
 static unsigned long long num_bad_toks = 0;
 static unsigned long long total_toks = 0;
@@ -68,6 +76,8 @@ static pthread_mutex_t appsock_conn_lk = PTHREAD_MUTEX_INITIALIZER;
 
 static void appsock_thd_start(struct thdpool *pool, void *thddata);
 static void appsock_thd_end(struct thdpool *pool, void *thddata);
+static int appsock_poller_init(void);
+static void appsock_poller_stat(void);
 
 void close_appsock(SBUF2 *sb)
 {
@@ -102,7 +112,7 @@ int appsock_init(void)
 
     thdpool_set_mem_size(gbl_appsock_thdpool, 4 * 1024);
 
-    return 0;
+    return appsock_poller_init();
 }
 
 int destroy_appsock(void)
@@ -118,6 +128,7 @@ void appsock_quick_stat(void)
     logmsg(LOGMSG_USER, "num active appsock connections %d\n",
            active_appsock_conns);
     logmsg(LOGMSG_USER, "num appsock commands    %llu\n", total_toks);
+    appsock_poller_stat();
 }
 
 void appsock_stat(void)
@@ -301,6 +312,248 @@ static void appsock_work_pp(struct thdpool *pool, void *work, void *thddata,
     free(w);
 }
 
+/*
+ * Appsock poller
+ *
+ * A connection that is idle between requests can be parked here instead of
+ * blocking an appsock thread in a read. A single thread waits on all parked
+ * sockets with epoll, and hands a socket back to the appsock pool as soon as
+ * the next request starts arriving (or the peer goes away). An idle pooled
+ * connection then costs its client state and nothing else.
+ *
+ * Only the poller thread removes connections from the epoll set and the
+ * parked list, so no parked connection is ever resumed twice.
+ */
+struct appsock_parked {
+    SBUF2 *sb;
+    appsock_resume_fn *fn;
+    void *arg;
+    int ready;
+    int idle_timeout;
+    int parked_at;
+    LINKC_T(struct appsock_parked) lnk;
+};
+
+#define APPSOCK_POLLER_MAXEVENTS 256
+
+static int appsock_epfd = -1;
+static pthread_mutex_t appsock_parked_lk = PTHREAD_MUTEX_INITIALIZER;
+static LISTC_T(struct appsock_parked) appsock_parked_list;
+static unsigned long long total_appsock_parks = 0;
+static unsigned long long total_appsock_wakeups = 0;
+static unsigned long long total_appsock_idle_timeouts = 0;
+
+static void appsock_resume_work(struct thdpool *pool, void *work,
+                                void *thddata)
+{
+    struct appsock_thd_state *state = thddata;
+    struct appsock_parked *p = work;
+    int fd = sbuf2fileno(p->sb);
+
+    thrman_setfd(state->thr_self, fd);
+    p->fn(state->thr_self, p->sb, p->arg, p->ready);
+    thrman_setfd(state->thr_self, -1);
+    thrman_where(state->thr_self, NULL);
+
+    if (thrman_get_type(state->thr_self) != THRTYPE_APPSOCK_POOL)
+        thrman_change_type(state->thr_self, THRTYPE_APPSOCK_POOL);
+}
+
+static void appsock_resume_work_pp(struct thdpool *pool, void *work,
+                                   void *thddata, int op)
+{
+    struct appsock_parked *p = work;
+
+    switch (op) {
+    case THD_RUN:
+        appsock_resume_work(pool, work, thddata);
+        break;
+
+    case THD_FREE:
+        /* let the owner release its state and close the socket */
+        p->fn(NULL, p->sb, p->arg, 0);
+        break;
+
+    default:
+        abort();
+    }
+    free(p);
+}
+
+/* Called by the poller thread only, once p is off the parked list. */
+static void appsock_unpark(struct appsock_parked *p, int ready)
+{
+#ifdef _LINUX_SOURCE
+    epoll_ctl(appsock_epfd, EPOLL_CTL_DEL, sbuf2fileno(p->sb), NULL);
+#endif
+    p->ready = ready;
+    if (ready)
+        total_appsock_wakeups++;
+    else
+        total_appsock_idle_timeouts++;
+
+    /* This connection was admitted when it was first accepted; don't make it
+     * compete with new connections for a pool thread. */
+    if (thdpool_enqueue(gbl_appsock_thdpool, appsock_resume_work_pp, p, 0,
+                        NULL, THDPOOL_FORCE_DISPATCH) != 0) {
+        logmsg(LOGMSG_ERROR, "%s: thdpool_enqueue error, closing fd %d\n",
+               __func__, sbuf2fileno(p->sb));
+        p->fn(NULL, p->sb, p->arg, 0);
+        free(p);
+    }
+}
+
+#ifdef _LINUX_SOURCE
+static void *appsock_poller_thd(void *unused)
+{
+    struct epoll_event events[APPSOCK_POLLER_MAXEVENTS];
+    LISTC_T(struct appsock_parked) expired;
+    struct appsock_parked *p, *tmp;
+    int last_sweep = 0;
+    int now, n, i;
+
+    listc_init(&expired, offsetof(struct appsock_parked, lnk));
+
+    while (!gbl_exit) {
+        n = epoll_wait(appsock_epfd, events, APPSOCK_POLLER_MAXEVENTS, 1000);
+        if (n < 0 && errno != EINTR) {
+            logmsg(LOGMSG_ERROR, "%s: epoll_wait rc %d errno %d\n", __func__,
+                   n, errno);
+            sleep(1);
+            continue;
+        }
+
+        /* data, EOF or an error: the owner will find out which on read */
+        for (i = 0; i < n; i++) {
+            p = events[i].data.ptr;
+            LOCK(&appsock_parked_lk)
+            {
+                listc_rfl(&appsock_parked_list, p);
+            }
+            UNLOCK(&appsock_parked_lk);
+            appsock_unpark(p, 1);
+        }
+
+        now = comdb2_time_epoch();
+        if (now == last_sweep)
+            continue;
+        last_sweep = now;
+
+        LOCK(&appsock_parked_lk)
+        {
+            LISTC_FOR_EACH_SAFE(&appsock_parked_list, p, tmp, lnk)
+            {
+                if (p->idle_timeout > 0 &&
+                    (now - p->parked_at) > p->idle_timeout) {
+                    listc_rfl(&appsock_parked_list, p);
+                    listc_abl(&expired, p);
+                }
+            }
+        }
+        UNLOCK(&appsock_parked_lk);
+
+        while ((p = listc_rtl(&expired)) != NULL)
+            appsock_unpark(p, 0);
+    }
+    return NULL;
+}
+#endif
+
+static int appsock_poller_init(void)
+{
+    listc_init(&appsock_parked_list, offsetof(struct appsock_parked, lnk));
+#ifdef _LINUX_SOURCE
+    pthread_t tid;
+    int rc;
+
+    appsock_epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (appsock_epfd == -1) {
+        logmsg(LOGMSG_ERROR, "%s: epoll_create1 errno %d, idle connections "
+                             "will not be parked\n",
+               __func__, errno);
+        return 0;
+    }
+    rc = pthread_create(&tid, &gbl_pthread_attr_detached, appsock_poller_thd,
+                        NULL);
+    if (rc) {
+        logmsg(LOGMSG_ERROR, "%s: pthread_create rc %d\n", __func__, rc);
+        close(appsock_epfd);
+        appsock_epfd = -1;
+        if (gbl_exit_on_pthread_create_fail)
+            return -1;
+    }
+#endif
+    return 0;
+}
+
+int appsock_park(SBUF2 *sb, int idle_timeout_sec, appsock_resume_fn *fn,
+                 void *arg)
+{
+#ifdef _LINUX_SOURCE
+    struct appsock_parked *p;
+    struct epoll_event ev = {0};
+
+    if (!gbl_appsock_park_idle || appsock_epfd == -1 || gbl_exit)
+        return -1;
+
+    /* whatever was already read off the socket would never wake us up */
+    if (sbuf2rpending(sb) != 0)
+        return -1;
+
+    p = calloc(1, sizeof(struct appsock_parked));
+    if (p == NULL)
+        return -1;
+    p->sb = sb;
+    p->fn = fn;
+    p->arg = arg;
+    p->idle_timeout = idle_timeout_sec;
+    p->parked_at = comdb2_time_epoch();
+
+    /* The connection is on the list before it can possibly fire, so the
+     * poller always finds it there. */
+    LOCK(&appsock_parked_lk)
+    {
+        listc_atl(&appsock_parked_list, p);
+        total_appsock_parks++;
+    }
+    UNLOCK(&appsock_parked_lk);
+
+    ev.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+    ev.data.ptr = p;
+    if (epoll_ctl(appsock_epfd, EPOLL_CTL_ADD, sbuf2fileno(sb), &ev) != 0) {
+        logmsg(LOGMSG_ERROR, "%s: epoll_ctl fd %d errno %d\n", __func__,
+               sbuf2fileno(sb), errno);
+        LOCK(&appsock_parked_lk)
+        {
+            listc_rfl(&appsock_parked_list, p);
+            total_appsock_parks--;
+        }
+        UNLOCK(&appsock_parked_lk);
+        free(p);
+        return -1;
+    }
+    return 0;
+#else
+    return -1;
+#endif
+}
+
+static void appsock_poller_stat(void)
+{
+    int nparked;
+    LOCK(&appsock_parked_lk)
+    {
+        nparked = appsock_parked_list.count;
+    }
+    UNLOCK(&appsock_parked_lk);
+    logmsg(LOGMSG_USER, "num parked idle conns   %d\n", nparked);
+    logmsg(LOGMSG_USER, "num appsock parks       %llu\n", total_appsock_parks);
+    logmsg(LOGMSG_USER, "num appsock wakeups     %llu\n",
+           total_appsock_wakeups);
+    logmsg(LOGMSG_USER, "num idle conn timeouts  %llu\n",
+           total_appsock_idle_timeouts);
+}
+
 int gbl_appsock_connection_warn_threshold = 80;
 
 void dump_appsock_threads(void)
@@ -0,0 +1,293 @@
+/*
+   Copyright 2019 Bloomberg Finance L.P.
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "plhash.h"
+#include "clrucache.h"
+#include "comdb2_atomic.h"
+#include "locks_wrap.h"
+#include <mem_uncategorized.h>
+#include <mem_override.h>
+#include <logmsg.h>
+
+#define CLRUCACHE_DEFAULT_SHARDS 16
+
+struct clrucache_shard {
+    pthread_rwlock_t lk;
+    hash_t *h;
+    void **ents; /* CLOCK ring */
+    int nents;
+    int alloc;
+    int hand;
+    /* keep shards on separate cache lines */
+    char pad[64];
+};
+
+struct clrucache {
+    hashfunc_t *hashfunc;
+    void (*freefunc)(void *);
+    int offset;
+    int keyoff;
+    int keysz;
+    int maxent; /* per shard */
+    int nshards;
+    struct clrucache_shard *shards;
+};
+
+static inline struct clrucache_link *link_of(struct clrucache *cache,
+                                             void *ent)
+{
+    return (struct clrucache_link *)((uintptr_t)ent + cache->offset);
+}
+
+static inline struct clrucache_shard *shard_of(struct clrucache *cache,
+                                               const void *key)
+{
+    unsigned int h = cache->hashfunc(key, cache->keysz);
+    /* plhash buckets on the same hash, so mix before picking a shard */
+    h *= 0x9e3779b1U;
+    return &cache->shards[(h >> 16) % cache->nshards];
+}
+
+struct clrucache *clrucache_init(hashfunc_t *hashfunc, cmpfunc_t *cmpfunc,
+                                 void (*freefunc)(void *), int offset,
+                                 int keyoff, int keysz, int maxent,
+                                 int nshards)
+{
+    struct clrucache *cache;
+    int i;
+
+    if (nshards <= 0)
+        nshards = CLRUCACHE_DEFAULT_SHARDS;
+
+    cache = calloc(1, sizeof(struct clrucache));
+    cache->hashfunc = hashfunc;
+    cache->freefunc = freefunc;
+    cache->offset = offset;
+    cache->keyoff = keyoff;
+    cache->keysz = keysz;
+    cache->nshards = nshards;
+    cache->shards = calloc(nshards, sizeof(struct clrucache_shard));
+    for (i = 0; i < nshards; i++) {
+        Pthread_rwlock_init(&cache->shards[i].lk, NULL);
+        cache->shards[i].h = hash_init_user(hashfunc, cmpfunc, keyoff, keysz);
+    }
+    clrucache_set_maxent(cache, maxent);
+
+    return cache;
+}
+
+void clrucache_set_maxent(struct clrucache *cache, int maxent)
+{
+    int per_shard = (maxent + cache->nshards - 1) / cache->nshards;
+    /* shrinking takes effect as new entries are added */
+    cache->maxent = per_shard > 0 ? per_shard : 1;
+}
+
+int clrucache_hasentry(struct clrucache *cache, const void *key)
+{
+    struct clrucache_shard *shard = shard_of(cache, key);
+    void *ent;
+
+    Pthread_rwlock_rdlock(&shard->lk);
+    ent = hash_find_readonly(shard->h, key);
+    Pthread_rwlock_unlock(&shard->lk);
+
+    return ent != NULL;
+}
+
+void *clrucache_find(struct clrucache *cache, const void *key)
+{
+    struct clrucache_shard *shard = shard_of(cache, key);
+    struct clrucache_link *lent;
+    void *ent;
+
+    Pthread_rwlock_rdlock(&shard->lk);
+    ent = hash_find_readonly(shard->h, key);
+    if (ent) {
+        lent = link_of(cache, ent);
+        ATOMIC_ADD(lent->ref, 1);
+        ATOMIC_ADD(lent->hits, 1);
+        lent->clock = 1;
+    }
+    Pthread_rwlock_unlock(&shard->lk);
+
+    return ent;
+}
+
+void clrucache_release(struct clrucache *cache, const void *key)
+{
+    struct clrucache_shard *shard = shard_of(cache, key);
+    struct clrucache_link *lent;
+    void *ent;
+    int ref;
+
+    Pthread_rwlock_rdlock(&shard->lk);
+    ent = hash_find_readonly(shard->h, key);
+    if (ent == NULL) {
+        Pthread_rwlock_unlock(&shard->lk);
+        logmsg(LOGMSG_ERROR, "releasing key, but not found?\n");
+        return;
+    }
+    lent = link_of(cache, ent);
+    ref = ATOMIC_ADD(lent->ref, -1);
+    Pthread_rwlock_unlock(&shard->lk);
+
+    if (ref < 0)
+        logmsg(LOGMSG_ERROR, "key released more often than found, ref %d\n",
+               ref);
+}
+
+/* Remove the entry at ring slot i; caller holds the shard write lock. */
+static void evict_slot(struct clrucache *cache, struct clrucache_shard *shard,
+                       int i)
+{
+    void *ent = shard->ents[i];
+
+    shard->ents[i] = shard->ents[--shard->nents];
+    if (shard->hand >= shard->nents)
+        shard->hand = 0;
+    if (hash_del(shard->h, ent) != 0) {
+        logmsg(LOGMSG_ERROR, "NOT DELETED.\n");
+        return;
+    }
+    cache->freefunc(ent);
+}
+
+/* CLOCK sweep: skip referenced entries, give recently found entries a second
+ * chance.  Returns 0 if nothing could be evicted. */
+static int evict_one(struct clrucache *cache, struct clrucache_shard *shard)
+{
+    struct clrucache_link *lent;
+    int steps;
+
+    for (steps = 2 * shard->nents; steps > 0 && shard->nents > 0; steps--) {
+        lent = link_of(cache, shard->ents[shard->hand]);
+        if (lent->ref == 0 && !lent->clock) {
+            evict_slot(cache, shard, shard->hand);
+            return 1;
+        }
+        if (lent->ref == 0)
+            lent->clock = 0;
+        shard->hand = (shard->hand + 1) % shard->nents;
+    }
+    return 0;
+}
+
+int clrucache_add(struct clrucache *cache, void *item)
+{
+    struct clrucache_shard *shard;
+    struct clrucache_link *lent;
+    const void *key = (const char *)item + cache->keyoff;
+
+    shard = shard_of(cache, key);
+    lent = link_of(cache, item);
+    lent->ref = 0;
+    lent->hits = 0;
+    lent->clock = 0;
+
+    Pthread_rwlock_wrlock(&shard->lk);
+    if (hash_find_readonly(shard->h, key)) {
+        Pthread_rwlock_unlock(&shard->lk);
+        return 1;
+    }
+    while (shard->nents >= cache->maxent && evict_one(cache, shard))
+        ;
+    if (shard->nents == shard->alloc) {
+        shard->alloc = shard->alloc ? shard->alloc * 2 : 16;
+        shard->ents = realloc(shard->ents, shard->alloc * sizeof(void *));
+    }
+    shard->ents[shard->nents++] = item;
+    hash_add(shard->h, item);
+    Pthread_rwlock_unlock(&shard->lk);
+
+    return 0;
+}
+
+void clrucache_clear(struct clrucache *cache)
+{
+    struct clrucache_shard *shard;
+    int i, j;
+
+    for (i = 0; i < cache->nshards; i++) {
+        shard = &cache->shards[i];
+        Pthread_rwlock_wrlock(&shard->lk);
+        for (j = shard->nents - 1; j >= 0; j--) {
+            if (link_of(cache, shard->ents[j])->ref == 0)
+                evict_slot(cache, shard, j);
+        }
+        Pthread_rwlock_unlock(&shard->lk);
+    }
+}
+
+void clrucache_destroy(struct clrucache *cache)
+{
+    struct clrucache_shard *shard;
+    int i, used_count;
+
+    clrucache_clear(cache);
+    used_count = clrucache_count(cache);
+    if (used_count != 0) {
+        logmsg(LOGMSG_WARN,
+               "trying to destroy cache with in-use entries: %d entries\n",
+               used_count);
+        return;
+    }
+
+    for (i = 0; i < cache->nshards; i++) {
+        shard = &cache->shards[i];
+        hash_free(shard->h);
+        free(shard->ents);
+        Pthread_rwlock_destroy(&shard->lk);
+    }
+    free(cache->shards);
+    free(cache);
+}
+
+int clrucache_count(struct clrucache *cache)
+{
+    int i, count = 0;
+
+    for (i = 0; i < cache->nshards; i++) {
+        Pthread_rwlock_rdlock(&cache->shards[i].lk);
+        count += cache->shards[i].nents;
+        Pthread_rwlock_unlock(&cache->shards[i].lk);
+    }
+    return count;
+}
+
+void clrucache_foreach(struct clrucache *cache, void (*display)(void *, void *),
+                       void *usrptr)
+{
+    struct clrucache_shard *shard;
+    int i, j;
+
+    for (i = 0; i < cache->nshards; i++) {
+        shard = &cache->shards[i];
+        Pthread_rwlock_rdlock(&shard->lk);
+        if (shard->nents > 0)
+            logmsg(LOGMSG_USER, "shard %d: %d entries\n", i, shard->nents);
+        for (j = 0; j < shard->nents; j++)
+            display(shard->ents[j], usrptr);
+        Pthread_rwlock_unlock(&shard->lk);
+    }
+}
@@ -0,0 +1,59 @@
+/*
+   Copyright 2019 Bloomberg Finance L.P.
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef INCLUDED_CLRUCACHE_H
+#define INCLUDED_CLRUCACHE_H
+
+#include "plhash.h"
+
+/* Concurrent counterpart of lrucache.  Entries are spread over shards by key
+ * hash; each shard has its own rwlock and evicts with a CLOCK sweep, so a
+ * lookup only takes its shard's read lock and never reorders a list.
+ * Callers do not need an external mutex.  Entries returned by
+ * clrucache_find() stay valid until the matching clrucache_release(). */
+
+typedef struct clrucache clrucache;
+
+struct clrucache_link {
+    int ref;
+    int hits;
+    int clock; /* set on every find, cleared by the eviction sweep */
+};
+
+typedef struct clrucache_link clrucache_link;
+
+/* nshards <= 0 picks a default */
+struct clrucache *clrucache_init(hashfunc_t *hashfunc, cmpfunc_t *cmpfunc,
+                                 void (*freefunc)(void *), int offset,
+                                 int keyoff, int keysz, int maxent,
+                                 int nshards);
+void *clrucache_find(struct clrucache *cache, const void *key);
+int clrucache_hasentry(struct clrucache *cache, const void *key);
+
+/* Returns 0 if item was added, 1 if the key is already cached (item is
+ * untouched and still owned by the caller). */
+int clrucache_add(struct clrucache *cache, void *item);
+void clrucache_release(struct clrucache *cache, const void *key);
+
+/* Free every entry that is not referenced. */
+void clrucache_clear(struct clrucache *cache);
+void clrucache_destroy(struct clrucache *cache);
+void clrucache_foreach(struct clrucache *cache, void (*display)(void *, void *),
+                       void *usrptr);
+void clrucache_set_maxent(struct clrucache *cache, int maxent);
+int clrucache_count(struct clrucache *cache);
+
+#endif
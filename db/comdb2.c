@@ -212,6 +212,8 @@ int gbl_osql_blockproc_timeout_sec = 5;  /* wait for 5 seconds for a blocproc*/
 int gbl_osql_max_throttle_sec = 60 * 10; /* 10-minute default */
 int gbl_osql_bkoff_netsend_lmt = 5 * 60 * 1000; /* 5 mins */
 int gbl_osql_bkoff_netsend = 100;               /* wait 100 msec */
+int gbl_osql_frame_bytes = 0; /* batch row ops into frames up to this size */
+int gbl_osql_frame_compress = 1;
 int gbl_net_max_queue = 25000;
 int gbl_net_max_mem = 0;
 int gbl_net_poll = 100;
@@ -749,6 +751,12 @@ int gbl_bbenv;
 extern int gbl_legacy_defaults;
 
 int64_t gbl_temptable_spills = 0;
+int64_t gbl_temptable_mem_tables = 0;
+int64_t gbl_temptable_mem_spills = 0;
+int64_t gbl_temptable_mem_inuse = 0;
+int64_t gbl_sql_stmt_cache_hits = 0;
+int64_t gbl_sql_stmt_cache_misses = 0;
+int64_t gbl_sql_stmt_cache_flushed = 0;
 int gbl_osql_odh_blob = 1;
 
 comdb2_tunables *gbl_tunables; /* All registered tunables */
@@ -1553,6 +1553,8 @@ extern int gbl_osql_heartbeat_send;
 extern int gbl_osql_heartbeat_alert;
 extern int gbl_osql_bkoff_netsend_lmt;
 extern int gbl_osql_bkoff_netsend;
+extern int gbl_osql_frame_bytes;
+extern int gbl_osql_frame_compress;
 extern int gbl_osql_max_queue;
 extern int gbl_net_poll;
 extern int gbl_osql_net_poll;
@@ -2471,11 +2473,17 @@ int lite_get_keys_auxdb(int auxdb, struct ireq *iq, void *firstkey,
 
 /* queue databases */
 int dbq_add(struct ireq *iq, void *trans, const void *dta, size_t dtalen);
+int dbq_add_partition(struct ireq *iq, void *trans, const void *dta,
+                      size_t dtalen, int partition);
 int dbq_consume(struct ireq *iq, void *trans, int consumer, const void *fnd);
 int dbq_consume_genid(struct ireq *, void *trans, int consumer, const genid_t);
 int dbq_get(struct ireq *iq, int consumer, const struct dbq_cursor *prevcursor,
             void **fnddta, size_t *fnddtalen, size_t *fnddtaoff,
             struct dbq_cursor *fndcursor, unsigned int *epoch);
+int dbq_get_batch(struct ireq *iq, int consumer,
+                  const struct dbq_cursor *prevcursor, int max, void **fnddta,
+                  size_t *fnddtalen, size_t *fnddtaoff,
+                  struct dbq_cursor *fndcursor, int *nfound);
 void dbq_get_item_info(const void *fnd, size_t *dtaoff, size_t *dtalen);
 unsigned long long dbq_item_genid(const void *dta);
 typedef int (*dbq_walk_callback_t)(int consumern, size_t item_length,
@@ -3346,6 +3354,8 @@ FILE *io_override_get_std(void);
 void reqlog_set_origin(struct reqlogger *logger, const char *fmt, ...);
 const char *reqlog_get_origin(struct reqlogger *logger);
 void berkdb_iopool_process_message(char *line, int lline, int st);
+void berkdb_iouring_stat(void);
+void berkdb_iouring_reset(void);
 
 uint8_t *db_info2_iostats_put(const struct db_info2_iostats *p_iostats,
                               uint8_t *p_buf, const uint8_t *p_buf_end);
@@ -3600,6 +3610,12 @@ int repopulate_lrl(const char *p_lrl_fname_out);
 void plugin_post_dbenv_hook(struct dbenv *dbenv);
 
 extern int64_t gbl_temptable_spills;
+extern int64_t gbl_temptable_mem_tables;
+extern int64_t gbl_temptable_mem_spills;
+extern int64_t gbl_temptable_mem_inuse;
+extern int64_t gbl_sql_stmt_cache_hits;
+extern int64_t gbl_sql_stmt_cache_misses;
+extern int64_t gbl_sql_stmt_cache_flushed;
 
 extern int gbl_disable_tpsc_tblvers;
 
@@ -22,6 +22,7 @@
 #include "metrics.h"
 #include "bdb_api.h"
 #include "net.h"
+#include "osqlcomm.h"
 
 #include <sys/time.h>
 #include <sys/resource.h>
@@ -76,7 +77,20 @@ struct comdb2_metrics_store {
     double handle_buf_queue_time;
     int64_t denied_appsock_connections;
     int64_t locks;
+    int64_t log_group_commit_flushes;
+    int64_t log_group_commit_commits;
+    int64_t log_group_commit_flush_p50_us;
+    int64_t log_group_commit_flush_p99_us;
+    int64_t osql_frames_sent;
+    int64_t osql_frame_ops_sent;
+    int64_t osql_frame_bytes_saved;
+    int64_t sql_stmt_cache_hits;
+    int64_t sql_stmt_cache_misses;
+    int64_t sql_stmt_cache_flushed;
     int64_t temptable_spills;
+    int64_t temptable_mem_tables;
+    int64_t temptable_mem_spills;
+    int64_t temptable_mem_inuse;
     int64_t net_drops;
     int64_t net_queue_size;
     int64_t rep_deadlocks;
@@ -202,10 +216,60 @@ comdb2_metric gbl_metrics[] = {
      &stats.denied_appsock_connections, NULL},
     {"locks", "Number of currently held locks", STATISTIC_INTEGER,
      STATISTIC_COLLECTION_TYPE_LATEST, &stats.locks, NULL},
+    {"log_group_commit_flushes", "Log syncs done by the group-commit flusher",
+     STATISTIC_INTEGER, STATISTIC_COLLECTION_TYPE_CUMULATIVE,
+     &stats.log_group_commit_flushes, NULL},
+    {"log_group_commit_commits",
+     "Commits made durable by the group-commit flusher", STATISTIC_INTEGER,
+     STATISTIC_COLLECTION_TYPE_CUMULATIVE, &stats.log_group_commit_commits,
+     NULL},
+    {"log_group_commit_flush_p50_us",
+     "Median group-commit flush latency (microseconds, power-of-two bound)",
+     STATISTIC_INTEGER, STATISTIC_COLLECTION_TYPE_LATEST,
+     &stats.log_group_commit_flush_p50_us, NULL},
+    {"log_group_commit_flush_p99_us",
+     "99th percentile group-commit flush latency (microseconds, power-of-two "
+     "bound)",
+     STATISTIC_INTEGER, STATISTIC_COLLECTION_TYPE_LATEST,
+     &stats.log_group_commit_flush_p99_us, NULL},
+    {"osql_frames_sent", "Frames of batched osql ops sent to the master",
+     STATISTIC_INTEGER, STATISTIC_COLLECTION_TYPE_CUMULATIVE,
+     &stats.osql_frames_sent, NULL},
+    {"osql_frame_ops_sent", "Osql ops sent to the master inside frames",
+     STATISTIC_INTEGER, STATISTIC_COLLECTION_TYPE_CUMULATIVE,
+     &stats.osql_frame_ops_sent, NULL},
+    {"osql_frame_bytes_saved", "Bytes saved by compressing osql frames",
+     STATISTIC_INTEGER, STATISTIC_COLLECTION_TYPE_CUMULATIVE,
+     &stats.osql_frame_bytes_saved, NULL},
+    {"sql_stmt_cache_hits",
+     "SQL statements run from a thread's prepared statement cache",
+     STATISTIC_INTEGER, STATISTIC_COLLECTION_TYPE_CUMULATIVE,
+     &stats.sql_stmt_cache_hits, NULL},
+    {"sql_stmt_cache_misses",
+     "SQL statements that had to be prepared because the running thread had "
+     "not cached them",
+     STATISTIC_INTEGER, STATISTIC_COLLECTION_TYPE_CUMULATIVE,
+     &stats.sql_stmt_cache_misses, NULL},
+    {"sql_stmt_cache_flushed",
+     "Prepared statements dropped when a thread flushed its whole statement "
+     "cache",
+     STATISTIC_INTEGER, STATISTIC_COLLECTION_TYPE_CUMULATIVE,
+     &stats.sql_stmt_cache_flushed, NULL},
     {"temptable_spills",
      "Number of temptables that had to be spilled to disk-backed tables",
      STATISTIC_INTEGER, STATISTIC_COLLECTION_TYPE_CUMULATIVE,
      &stats.temptable_spills, NULL},
+    {"temptable_mem_tables", "Number of temptables created in memory",
+     STATISTIC_INTEGER, STATISTIC_COLLECTION_TYPE_CUMULATIVE,
+     &stats.temptable_mem_tables, NULL},
+    {"temptable_mem_spills",
+     "Number of in-memory temptables that outgrew their budget and were "
+     "moved to disk-backed tables",
+     STATISTIC_INTEGER, STATISTIC_COLLECTION_TYPE_CUMULATIVE,
+     &stats.temptable_mem_spills, NULL},
+    {"temptable_mem_inuse", "Bytes held by in-memory temptables",
+     STATISTIC_INTEGER, STATISTIC_COLLECTION_TYPE_LATEST,
+     &stats.temptable_mem_inuse, NULL},
     {"net_drops",
      "Number of packets that didn't fit on network queue and were dropped",
      STATISTIC_INTEGER, STATISTIC_COLLECTION_TYPE_CUMULATIVE, &stats.net_drops,
@@ -336,6 +400,19 @@ int refresh_metrics(void)
         return 1;
     }
 
+    rc = bdb_get_log_group_commit_counters(
+        thedb->bdb_env, &stats.log_group_commit_flushes,
+        &stats.log_group_commit_commits, &stats.log_group_commit_flush_p50_us,
+        &stats.log_group_commit_flush_p99_us);
+    if (rc) {
+        logmsg(LOGMSG_ERROR, "failed to refresh statistics (%s:%d)\n", __FILE__,
+               __LINE__);
+        return 1;
+    }
+
+    osql_comm_frame_stats(&stats.osql_frames_sent, &stats.osql_frame_ops_sent,
+                          &stats.osql_frame_bytes_saved);
+
     pstats = bdb_get_process_stats();
     stats.preads = pstats->n_preads;
     stats.pwrites = pstats->n_pwrites;
@@ -424,7 +501,13 @@ int refresh_metrics(void)
     stats.denied_appsock_connections = gbl_denied_appsock_connection_count;
     if (bdb_lock_stats(thedb->bdb_env, &stats.locks))
         stats.locks = 0;
+    stats.sql_stmt_cache_hits = gbl_sql_stmt_cache_hits;
+    stats.sql_stmt_cache_misses = gbl_sql_stmt_cache_misses;
+    stats.sql_stmt_cache_flushed = gbl_sql_stmt_cache_flushed;
     stats.temptable_spills = gbl_temptable_spills;
+    stats.temptable_mem_tables = gbl_temptable_mem_tables;
+    stats.temptable_mem_spills = gbl_temptable_mem_spills;
+    stats.temptable_mem_inuse = gbl_temptable_mem_inuse;
 
     struct net_stats net_stats;
     rc = net_get_stats(thedb->handle_sibling, &net_stats);
@@ -219,6 +219,33 @@ extern int gbl_logdelete_lock_trace;
 extern int gbl_flush_log_at_checkpoint;
 extern int gbl_online_recovery;
 extern int gbl_forbid_remote_admin;
+extern int gbl_appsock_park_idle;
+extern int gbl_newsql_row_batch;
+extern int gbl_newsql_row_batch_bytes;
+extern int gbl_dohast_stripe_threads;
+extern int gbl_ondisk_decode_plan;
+extern int gbl_berkdb_iouring;
+extern int gbl_berkdb_iouring_depth;
+extern int gbl_log_group_commit;
+extern int gbl_log_group_commit_wait_us;
+extern int gbl_osql_parallel_apply_threads;
+extern int gbl_osql_parallel_apply_min_ops;
+extern int gbl_rep_apply_profile;
+extern int gbl_rep_page_parallel;
+extern int gbl_rep_page_parallel_min_records;
+extern int gbl_rep_page_parallel_threads;
+extern int gbl_net_writev;
+extern int gbl_net_writev_max_bytes;
+extern int gbl_net_compress;
+extern int gbl_net_compress_min_bytes;
+extern int gbl_physrep_fetch_queue_bytes;
+extern int gbl_physrep_checkpoint_ms;
+extern int gbl_exact_row_counts;
+extern int gbl_fdb_pushdown;
+extern int gbl_fdb_join_batch;
+extern int gbl_memp_clock;
+extern int gbl_memp_probation_pct;
+extern int gbl_memp_evict_batch;
 
 extern long long sampling_threshold;
 
@@ -478,6 +505,16 @@ static int retry_update(void *context, void *value)
     return 0;
 }
 
+/* Let threads whose io_uring failed try again with the new settings */
+static int berkdb_iouring_update(void *context, void *value)
+{
+    comdb2_tunable *tunable = (comdb2_tunable *)context;
+
+    *(int *)tunable->var = *(int *)value;
+    berkdb_iouring_reset();
+    return 0;
+}
+
 static int maxt_update(void *context, void *value)
 {
     comdb2_tunable *tunable = (comdb2_tunable *)context;
@@ -1664,4 +1664,198 @@ REGISTER_TUNABLE(
     "Number of iterations of PBKDF2 algorithm for password hashing.",
     TUNABLE_INTEGER, &gbl_pbkdf2_iterations, NOZERO | SIGNED, NULL, NULL,
     pbkdf2_iterations_update, NULL);
+
+REGISTER_TUNABLE("appsock_park_idle",
+                 "Park SQL connections that are idle between requests "
+                 "on an epoll thread instead of holding an appsock "
+                 "thread. (Default: off)",
+                 TUNABLE_BOOLEAN, &gbl_appsock_park_idle, NOARG, NULL, NULL,
+                 NULL, NULL);
+
+REGISTER_TUNABLE("newsql_row_batch",
+                 "Number of rows the server packs into a single "
+                 "columnar row batch for clients that support it. 0 to "
+                 "disable. (Default: 0)",
+                 TUNABLE_INTEGER, &gbl_newsql_row_batch, 0, NULL, NULL, NULL,
+                 NULL);
+
+REGISTER_TUNABLE("newsql_row_batch_bytes",
+                 "Send a row batch once its values take this many "
+                 "bytes. (Default: 65536)",
+                 TUNABLE_INTEGER, &gbl_newsql_row_batch_bytes, 0, NULL, NULL,
+                 NULL, NULL);
+
+REGISTER_TUNABLE("dohast_stripe_threads",
+                 "Split qualifying single table scans in up to this "
+                 "many parallel engines, each reading a range of the "
+                 "data stripes. 0 disables. (Default: 0)",
+                 TUNABLE_INTEGER, &gbl_dohast_stripe_threads, 0, NULL, NULL,
+                 NULL, NULL);
+
+REGISTER_TUNABLE("ondisk_decode_plan",
+                 "Decode fixed-width ondisk fields through a "
+                 "per-schema decode plan instead of the generic type "
+                 "converters. (Default: on)",
+                 TUNABLE_BOOLEAN, &gbl_ondisk_decode_plan, 0, NULL, NULL, NULL,
+                 NULL);
+
+REGISTER_TUNABLE("berkdb_iouring",
+                 "Issue gathered page reads and writes through "
+                 "io_uring, falling back to synchronous I/O when it is "
+                 "unavailable. (Default: off)",
+                 TUNABLE_BOOLEAN, &gbl_berkdb_iouring, 0, NULL, NULL,
+                 berkdb_iouring_update, NULL);
+
+REGISTER_TUNABLE("berkdb_iouring_depth",
+                 "Maximum io_uring page requests in flight per thread. "
+                 "(Default: 32)",
+                 TUNABLE_INTEGER, &gbl_berkdb_iouring_depth, 0, NULL, NULL,
+                 berkdb_iouring_update, NULL);
+
+REGISTER_TUNABLE("log_group_commit",
+                 "Make commit records durable through a dedicated "
+                 "flusher thread that syncs each epoch of waiting "
+                 "committers with one log write and sync. (Default: "
+                 "off)",
+                 TUNABLE_BOOLEAN, &gbl_log_group_commit, 0, NULL, NULL, NULL,
+                 NULL);
+
+REGISTER_TUNABLE("log_group_commit_wait_us",
+                 "How long the group-commit flusher holds an epoch "
+                 "open for more committers, in microseconds, when more "
+                 "than one is waiting. (Default: 200)",
+                 TUNABLE_INTEGER, &gbl_log_group_commit_wait_us, 0, NULL, NULL,
+                 NULL, NULL);
+
+REGISTER_TUNABLE("osql_frame_bytes",
+                 "Batch osql row ops sent to the master into frames of "
+                 "up to this many bytes (0 disables)",
+                 TUNABLE_INTEGER, &gbl_osql_frame_bytes, 0, NULL, NULL, NULL,
+                 NULL);
+
+REGISTER_TUNABLE("osql_frame_compress",
+                 "LZ4-compress osql frames when it saves space",
+                 TUNABLE_BOOLEAN, &gbl_osql_frame_compress, 0, NULL, NULL, NULL,
+                 NULL);
+
+REGISTER_TUNABLE("osql_parallel_apply_threads",
+                 "Number of threads applying a large insert-only bplog "
+                 "on the master (0 or 1 disables).",
+                 TUNABLE_INTEGER, &gbl_osql_parallel_apply_threads, 0, NULL,
+                 NULL, NULL, NULL);
+
+REGISTER_TUNABLE("osql_parallel_apply_min_ops",
+                 "Minimum number of bplog ops before it is applied in "
+                 "parallel.",
+                 TUNABLE_INTEGER, &gbl_osql_parallel_apply_min_ops, 0, NULL,
+                 NULL, NULL, NULL);
+
+REGISTER_TUNABLE("rep_apply_profile",
+                 "Record per-stage latency histograms for replicated "
+                 "log records (see comdb2_repl_apply_profile).",
+                 TUNABLE_BOOLEAN, &gbl_rep_apply_profile, 0, NULL, NULL, NULL,
+                 NULL);
+
+REGISTER_TUNABLE("rep_page_parallel",
+                 "Apply the records of large replicated transactions "
+                 "in parallel by page, not by file.",
+                 TUNABLE_BOOLEAN, &gbl_rep_page_parallel, 0, NULL, NULL, NULL,
+                 NULL);
+
+REGISTER_TUNABLE("rep_page_parallel_min_records",
+                 "Minimum number of records of one file in a "
+                 "transaction before rep_page_parallel schedules them "
+                 "by page.",
+                 TUNABLE_INTEGER, &gbl_rep_page_parallel_min_records, 0, NULL,
+                 NULL, NULL, NULL);
+
+REGISTER_TUNABLE("rep_page_parallel_threads",
+                 "Number of recovery workers that apply one "
+                 "page-scheduled file queue.",
+                 TUNABLE_INTEGER, &gbl_rep_page_parallel_threads, 0, NULL, NULL,
+                 NULL, NULL);
+
+REGISTER_TUNABLE("net_writev",
+                 "Coalesce queued net messages into writev calls "
+                 "instead of copying them through the socket buffer. "
+                 "(Default: off)",
+                 TUNABLE_BOOLEAN, &gbl_net_writev, 0, NULL, NULL, NULL, NULL);
+
+REGISTER_TUNABLE("net_writev_max_bytes",
+                 "Maximum bytes the net writer sends in a single "
+                 "writev call. (Default: 1048576)",
+                 TUNABLE_INTEGER, &gbl_net_writev_max_bytes, 0, NULL, NULL,
+                 NULL, NULL);
+
+REGISTER_TUNABLE("net_compress",
+                 "LZ4 compress batches of replication and other user "
+                 "messages sent to peers that can decompress them. "
+                 "(Default: off)",
+                 TUNABLE_BOOLEAN, &gbl_net_compress, 0, NULL, NULL, NULL, NULL);
+
+REGISTER_TUNABLE("net_compress_min_bytes",
+                 "Smallest run of queued user messages the net writer "
+                 "will compress. (Default: 1024)",
+                 TUNABLE_INTEGER, &gbl_net_compress_min_bytes, 0, NULL, NULL,
+                 NULL, NULL);
+
+REGISTER_TUNABLE("physrep_fetch_queue_bytes",
+                 "Bytes of fetched log records a physical replicant "
+                 "may hold ahead of applying them. (Default: 64MB)",
+                 TUNABLE_INTEGER, &gbl_physrep_fetch_queue_bytes, 0, NULL, NULL,
+                 NULL, NULL);
+
+REGISTER_TUNABLE("physrep_checkpoint_ms",
+                 "How often a physical replicant flushes the log "
+                 "records it has applied. (Default: 1000)",
+                 TUNABLE_INTEGER, &gbl_physrep_checkpoint_ms, 0, NULL, NULL,
+                 NULL, NULL);
+
+REGISTER_TUNABLE("exact_row_counts",
+                 "Answer COUNT(*) and analyze row estimates from row "
+                 "counts maintained by every write transaction. Counts "
+                 "are built by the next analyze of each table. Each "
+                 "commit to a counted table updates its count in llmeta. "
+                 "The counts of all tables share a few llmeta pages, which "
+                 "stay locked until commit, so writers to different "
+                 "counted tables serialize on them. (Default: off)",
+                 TUNABLE_BOOLEAN, &gbl_exact_row_counts, 0, NULL, NULL, NULL,
+                 NULL);
+
+REGISTER_TUNABLE("fdb_pushdown",
+                 "Push column projections, LIMIT and count(*) of "
+                 "remote table scans into the remote query.",
+                 TUNABLE_BOOLEAN, &gbl_fdb_pushdown, 0, NULL, NULL, NULL, NULL);
+
+REGISTER_TUNABLE("fdb_join_batch",
+                 "Rows prefetched by a remote index cursor doing "
+                 "repeated equality lookups, as the inner side of a "
+                 "join; 0 or 1 disables batching, and a cursor stops "
+                 "batching if its batches are rarely hit (Default: 0)",
+                 TUNABLE_INTEGER, &gbl_fdb_join_batch, 0, NULL, NULL, NULL,
+                 NULL);
+
+REGISTER_TUNABLE("memp_clock",
+                 "Evict buffer pool pages with a clock over a probation "
+                 "queue and a main ring (2Q) instead of sweeping hash "
+                 "buckets by priority. Pages read once, as by a scan, are "
+                 "evicted before pages that were used again. Takes effect "
+                 "when the cache is created. (Default: off)",
+                 TUNABLE_BOOLEAN, &gbl_memp_clock, READONLY | NOARG, NULL,
+                 NULL, NULL, NULL);
+
+REGISTER_TUNABLE("memp_probation_pct",
+                 "With memp_clock, the share of the buffer pool the "
+                 "probation queue may hold before the clock moves on to "
+                 "the main ring. (Default: 25)",
+                 TUNABLE_INTEGER, &gbl_memp_probation_pct, 0, NULL, NULL,
+                 NULL, NULL);
+
+REGISTER_TUNABLE("memp_evict_batch",
+                 "With memp_clock, the number of buffers of the same page "
+                 "size an allocation evicts at once. The extra buffers are "
+                 "kept on a free list in the cache region for the next "
+                 "allocations. (Default: 4)",
+                 TUNABLE_INTEGER, &gbl_memp_evict_batch, 0, NULL, NULL, NULL,
+                 NULL);
 #endif /* _DB_TUNABLES_H */
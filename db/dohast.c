@@ -23,9 +23,11 @@
 
 int gbl_dohast_disable = 0;
 int gbl_dohast_verbose = 0;
+int gbl_dohast_stripe_threads = 0;
 
 static void node_free(dohsql_node_t **pnode, sqlite3 *db);
 static void _save_params(Parse *pParse, dohsql_node_t *node);
+static int _stripe_plan_ok(Vdbe *v);
 
 static char *_gen_col_expr(Vdbe *v, Expr *expr, const char **tblname,
                            struct params_info **pParamsOut);
@@ -344,6 +346,9 @@ static void node_free(dohsql_node_t **pnode, sqlite3 *db)
     if ((*pnode)->order_dir) {
         free((*pnode)->order_dir);
     }
+    if ((*pnode)->aggs) {
+        free((*pnode)->aggs);
+    }
     free(*pnode);
     *pnode = NULL;
 }
@@ -482,6 +487,246 @@ static int skip_tables(Select *p)
     return 0;
 }
 
+/* how partial results of an aggregate column are combined, if they can be */
+static enum dohsql_agg stripe_agg_op(Table *pTab, Expr *expr)
+{
+    const char *fname = expr->u.zToken;
+    Expr *arg;
+
+    if (ExprHasProperty(expr, EP_Distinct | EP_WinFunc))
+        return DOHSQL_AGG_NONE;
+
+    if (!expr->x.pList)
+        return (strcasecmp(fname, "count") == 0) ? DOHSQL_AGG_COUNT
+                                                 : DOHSQL_AGG_NONE;
+    if (expr->x.pList->nExpr != 1)
+        return DOHSQL_AGG_NONE;
+
+    arg = expr->x.pList->a[0].pExpr;
+    if (arg->op != TK_COLUMN || arg->iColumn < 0)
+        return DOHSQL_AGG_NONE;
+
+    if (strcasecmp(fname, "count") == 0)
+        return DOHSQL_AGG_COUNT;
+    if (strcasecmp(fname, "min") == 0)
+        return DOHSQL_AGG_MIN;
+    if (strcasecmp(fname, "max") == 0)
+        return DOHSQL_AGG_MAX;
+    if (strcasecmp(fname, "sum") == 0) {
+        /* partial sums are added up as int64/double; no decimals */
+        char aff = pTab->aCol[arg->iColumn].affinity;
+        if (aff == SQLITE_AFF_INTEGER || aff == SQLITE_AFF_REAL)
+            return DOHSQL_AGG_SUM;
+    }
+    return DOHSQL_AGG_NONE;
+}
+
+/* result columns of a stripe scan; if these are aggregates, *paggs returns
+   how each column is combined by the coordinator */
+static char *stripe_columns(Vdbe *v, Select *p, Table *pTab,
+                            enum dohsql_agg **paggs,
+                            struct params_info **pParamsOut)
+{
+    ExprList *c = p->pEList;
+    enum dohsql_agg *aggs;
+    char *cols = NULL;
+    char *col;
+    char *tmp;
+    int i;
+
+    *paggs = NULL;
+    for (i = 0; i < c->nExpr; i++) {
+        if (c->a[i].pExpr->op == TK_AGG_FUNCTION)
+            break;
+    }
+    if (i == c->nExpr)
+        return generate_columns(v, c, NULL, pParamsOut);
+
+    aggs = (enum dohsql_agg *)calloc(c->nExpr, sizeof(enum dohsql_agg));
+    if (!aggs)
+        return NULL;
+
+    for (i = 0; i < c->nExpr; i++) {
+        Expr *expr = c->a[i].pExpr;
+        const char *name = c->a[i].zName ? c->a[i].zName : c->a[i].zSpan;
+
+        /* no mix of aggregates and plain columns */
+        if (expr->op != TK_AGG_FUNCTION ||
+            (aggs[i] = stripe_agg_op(pTab, expr)) == DOHSQL_AGG_NONE)
+            goto error;
+
+        if (expr->x.pList)
+            col = sqlite3_mprintf(
+                "%s(\"%w\")", expr->u.zToken,
+                pTab->aCol[expr->x.pList->a[0].pExpr->iColumn].zName);
+        else
+            col = sqlite3_mprintf("%s(*)", expr->u.zToken);
+        if (!col)
+            goto error;
+
+        /* keep the column names the client would see without the split */
+        if (name)
+            tmp = sqlite3_mprintf("%s%s%s aS \"%w\"", cols ? cols : "",
+                                  cols ? ", " : "", col, name);
+        else
+            tmp = sqlite3_mprintf("%s%s%s", cols ? cols : "", cols ? ", " : "",
+                                  col);
+        sqlite3_free(col);
+        sqlite3_free(cols);
+        cols = tmp;
+        if (!cols)
+            goto error;
+    }
+
+    *paggs = aggs;
+    return cols;
+
+error:
+    sqlite3_free(cols);
+    free(aggs);
+    return NULL;
+}
+
+static char *stripe_select(Vdbe *v, Select *p, Table *pTab,
+                           enum dohsql_agg **paggs, int *order_size,
+                           int **order_dir, struct params_info **pParamsOut)
+{
+    char *cols = NULL;
+    char *where = NULL;
+    char *orderby = NULL;
+    char *select = NULL;
+    int i;
+
+    cols = stripe_columns(v, p, pTab, paggs, pParamsOut);
+    if (!cols)
+        return NULL;
+
+    if (p->pWhere) {
+        where = sqlite3ExprDescribeParams(v, p->pWhere, pParamsOut);
+        if (!where)
+            goto done;
+    }
+
+    if (p->pOrderBy) {
+        /* aggregates return one row; otherwise the coordinator merges sorted
+           rows on their leading columns, so the sort keys must be those */
+        if (*paggs)
+            goto done;
+        for (i = 0; i < p->pOrderBy->nExpr; i++) {
+            if (p->pOrderBy->a[i].u.x.iOrderByCol != i + 1)
+                goto done;
+        }
+        orderby =
+            describeExprList(v, p->pOrderBy, order_size, order_dir, pParamsOut);
+        if (!orderby)
+            goto done;
+    }
+
+    /* NOT INDEXED: the engines split the table by data stripes */
+    select = sqlite3_mprintf("SeLeCT %s FRoM \"%w\" NoT INDeXeD%s%s%s%s",
+                             cols, pTab->zName, (where) ? " WHeRe " : "",
+                             (where) ? where : "",
+                             (orderby) ? " oRDeR By " : "",
+                             (orderby) ? orderby : "");
+
+done:
+    if (!select && *paggs) {
+        free(*paggs);
+        *paggs = NULL;
+    }
+    sqlite3_free(orderby);
+    sqlite3_free(where);
+    sqlite3_free(cols);
+    return select;
+}
+
+/**
+ * Split a single table scan in engines that each read a range of the
+ * table data stripes; rows are merged by the coordinator as for a union,
+ * and decomposable aggregates are combined from each engine's partial result
+ *
+ */
+static dohsql_node_t *gen_stripes(Vdbe *v, Select *p)
+{
+    struct SrcList_item *src = &p->pSrc->a[0];
+    Table *pTab = src->pTab;
+    struct dbtable *db;
+    dohsql_node_t *node;
+    int nthreads;
+    int stripe;
+    int i;
+
+    if (gbl_dohast_stripe_threads < 2)
+        return NULL;
+
+    if (p->recording || p->pWith || p->pHaving || p->pGroupBy || p->pLimit ||
+        p->pWin || (p->selFlags & SF_Distinct))
+        return NULL;
+
+    if (!pTab || pTab->pSelect || IsVirtual(pTab) || src->zDatabase ||
+        src->fg.isIndexedBy)
+        return NULL;
+
+    db = get_dbtable_by_name(pTab->zName);
+    if (!db || db->dtastripe < 2)
+        return NULL;
+
+    nthreads = (gbl_dohast_stripe_threads < db->dtastripe)
+                   ? gbl_dohast_stripe_threads
+                   : db->dtastripe;
+
+    node = (dohsql_node_t *)calloc(1, sizeof(dohsql_node_t) +
+                                          nthreads * sizeof(void *));
+    if (!node)
+        return NULL;
+
+    node->type = AST_TYPE_UNION;
+    node->nodes = (dohsql_node_t **)(node + 1);
+    node->ncols = p->pEList->nExpr;
+
+    for (i = 0, stripe = 0; i < nthreads; i++) {
+        dohsql_node_t *sub;
+        enum dohsql_agg *aggs = NULL;
+        int order_size = 0;
+        int *order_dir = NULL;
+
+        sub = (dohsql_node_t *)calloc(1, sizeof(dohsql_node_t));
+        if (!sub)
+            goto error;
+        node->nodes[node->nnodes++] = sub;
+
+        sub->type = AST_TYPE_SELECT;
+        sub->ncols = node->ncols;
+        sub->stripe = stripe;
+        sub->nstripes =
+            db->dtastripe / nthreads + ((i < db->dtastripe % nthreads) ? 1 : 0);
+        stripe += sub->nstripes;
+
+        /* all the engines run the same query; first one sets up the merge */
+        if (i == 0)
+            sub->sql = stripe_select(v, p, pTab, &node->aggs, &node->order_size,
+                                     &node->order_dir, &sub->params);
+        else {
+            sub->sql = stripe_select(v, p, pTab, &aggs, &order_size, &order_dir,
+                                     &sub->params);
+            free(aggs);
+            free(order_dir);
+        }
+        if (!sub->sql)
+            goto error;
+    }
+
+    node->sql = sqlite3_mprintf("%s", node->nodes[0]->sql);
+    if (!node->sql)
+        goto error;
+
+    return node;
+
+error:
+    node_free(&node, v->db);
+    return NULL;
+}
+
 static dohsql_node_t *gen_select(Vdbe *v, Select *p)
 {
     Select *crt;
@@ -513,9 +758,11 @@ static dohsql_node_t *gen_select(Vdbe *v, Select *p)
     )
         return NULL;
 
-    if (p->op == TK_SELECT)
-        ret = gen_oneselect(v, p, NULL, NULL, NULL);
-    else
+    if (p->op == TK_SELECT) {
+        ret = gen_stripes(v, p);
+        if (!ret)
+            ret = gen_oneselect(v, p, NULL, NULL, NULL);
+    } else
         ret = gen_union(v, p, span);
 
     return ret;
@@ -647,6 +894,14 @@ int comdb2_check_parallel(Parse *pParse)
 
     node = (dohsql_node_t *)ast->stack[0].obj;
 
+    if (node->type == AST_TYPE_UNION && node->nodes[0]->nstripes &&
+        !_stripe_plan_ok(pParse->pVdbe)) {
+        if (gbl_dohast_verbose)
+            logmsg(LOGMSG_DEBUG, "%lx Plan not suitable for stripe scan\n",
+                   pthread_self());
+        return 0;
+    }
+
     if (pParse->explain) {
         if (pParse->explain == 3)
             explain_distribution(node);
@@ -692,6 +947,41 @@ int comdb2_check_parallel(Parse *pParse)
     return 0;
 }
 
+/**
+ * Engines of a stripe scan only see their stripes when walking the table
+ * forward; index lookups, rowid seeks, reverse scans or btree counts would
+ * not honour the split
+ *
+ */
+static int _stripe_plan_ok(Vdbe *v)
+{
+    int i;
+
+    if (!v)
+        return 0;
+
+    for (i = 0; i < v->nOp; i++) {
+        switch (v->aOp[i].opcode) {
+        case OP_OpenRead:
+            if (v->aOp[i].p4type == P4_KEYINFO)
+                return 0;
+            break;
+        case OP_SeekRowid:
+        case OP_NotExists:
+        case OP_DeferredSeek:
+        case OP_SeekGE:
+        case OP_SeekGT:
+        case OP_SeekLE:
+        case OP_SeekLT:
+        case OP_Last:
+        case OP_Prev:
+        case OP_Count:
+            return 0;
+        }
+    }
+    return 1;
+}
+
 static int _exprCallback(Walker *pWalker, Expr *pExpr)
 {
     switch (pExpr->op) {
@@ -19,6 +19,7 @@ limitations under the License.
 #include "sql.h"
 #include "shard_range.h"
 #include "sqliteInt.h"
+#include "vdbeInt.h"
 #include "queue.h"
 #include "dohsql.h"
 #include "sqlinterfaces.h"
@@ -93,6 +94,7 @@ struct dohsql {
     int row_src;
     int rc;
     int child_err; /* if a child error occurred, which one?*/
+    int agg_overflow; /* combining integer partial sums overflowed */
     /* LIMIT support */
     int limitRegs[MAX_MEM_IDX]; /* sqlite engine limit registers*/
     int limit;                  /* any limit */
@@ -108,6 +110,9 @@ struct dohsql {
     int order_size;
     int *order_dir;
     int nparams;
+    /* partial aggregates support */
+    enum dohsql_agg *aggs; /* how to combine each column */
+    row_t *agg;            /* combined row */
     /* stats */
     dohsql_req_stats_t stats;
     struct plugin_callbacks backup;
@@ -136,6 +141,8 @@ static void sqlengine_work_shard(struct thdpool *pool, void *work,
 static int order_init(dohsql_t *conns, dohsql_node_t *node);
 static int dohsql_dist_next_row_ordered(struct sqlclntstate *clnt,
                                         sqlite3_stmt *stmt);
+static int dohsql_dist_next_row_agg(struct sqlclntstate *clnt,
+                                    sqlite3_stmt *stmt);
 static int _param_index(dohsql_connector_t *conn, const char *b, int64_t *c);
 static int _param_value(dohsql_connector_t *conn, struct param_data *b, int c,
                         const char *src);
@@ -415,6 +422,8 @@ static int dohsql_dist_column_count(struct sqlclntstate *clnt, sqlite3_stmt *_)
                                          sqlite3_stmt *stmt, int iCol)         \
     {                                                                          \
         dohsql_t *conns = clnt->conns;                                         \
+        if (conns->agg)                                                        \
+            return sqlite3_value_##type(&conns->agg[iCol]);                    \
         if (conns->row_src == 0)                                               \
             return sqlite3_column_##type(stmt, iCol);                          \
         return sqlite3_value_##type(&conns->row[iCol]);                        \
@@ -433,6 +442,8 @@ static const intv_t *dohsql_dist_column_interval(struct sqlclntstate *clnt,
                                                  int type)
 {
     dohsql_t *conns = clnt->conns;
+    if (conns->agg)
+        return sqlite3_value_interval(&conns->agg[iCol], type);
     if (conns->row_src == 0)
         return sqlite3_column_interval(stmt, iCol, type);
     return sqlite3_value_interval(&conns->row[iCol], type);
@@ -443,6 +454,9 @@ static sqlite3_value *dohsql_dist_column_value(struct sqlclntstate *clnt,
 {
     dohsql_t *conns = clnt->conns;
 
+    if (conns->agg)
+        return &conns->agg[i];
+
     if (conns->row_src == 0)
         return sqlite3_column_value(stmt, i);
 
@@ -738,6 +752,114 @@ got_row:
     return SQLITE_ROW;
 }
 
+/* fold one engine's partial aggregate into the combined value; like serial
+   sum(), integer overflow is an error */
+static int _agg_combine(dohsql_t *conns, int col, Mem *val)
+{
+    Mem *acc = &conns->agg[col];
+    i64 sum;
+
+    if (val->flags & MEM_Null)
+        return SQLITE_OK;
+    if (acc->flags & MEM_Null) {
+        sqlite3VdbeMemCopy(acc, val);
+        return SQLITE_OK;
+    }
+
+    switch (conns->aggs[col]) {
+    case DOHSQL_AGG_COUNT:
+    case DOHSQL_AGG_SUM:
+        if ((acc->flags & MEM_Int) && (val->flags & MEM_Int)) {
+            if (__builtin_add_overflow(acc->u.i, val->u.i, &sum)) {
+                conns->agg_overflow = 1;
+                return SQLITE_ERROR;
+            }
+            sqlite3VdbeMemSetInt64(acc, sum);
+        } else {
+            sqlite3VdbeMemSetDouble(acc, sqlite3_value_double(acc) +
+                                             sqlite3_value_double(val));
+        }
+        break;
+    case DOHSQL_AGG_MIN:
+        if (sqlite3MemCompare(val, acc, NULL) < 0)
+            sqlite3VdbeMemCopy(acc, val);
+        break;
+    case DOHSQL_AGG_MAX:
+        if (sqlite3MemCompare(val, acc, NULL) > 0)
+            sqlite3VdbeMemCopy(acc, val);
+        break;
+    default:
+        abort();
+    }
+    return SQLITE_OK;
+}
+
+/**
+ * this combines the partial aggregates returned by N engines in one row
+ *
+ */
+static int dohsql_dist_next_row_agg(struct sqlclntstate *clnt,
+                                    sqlite3_stmt *stmt)
+{
+    dohsql_t *conns = clnt->conns;
+    row_t *row;
+    int rc;
+    int i;
+
+    /* the combined row was already returned */
+    if (conns->agg)
+        return SQLITE_DONE;
+
+    /* coordinator's share */
+    row_t *agg = (row_t *)calloc(conns->ncols, sizeof(row_t));
+    if (!agg) {
+        _signal_children_master_is_done(conns);
+        return SQLITE_NOMEM;
+    }
+    for (i = 0; i < conns->ncols; i++)
+        sqlite3VdbeMemInit(&agg[i], NULL, MEM_Null);
+
+    conns->agg = agg;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        for (i = 0; i < conns->ncols && rc == SQLITE_ROW; i++)
+            rc = _agg_combine(conns, i, (Mem *)sqlite3_column_value(stmt, i))
+                     ? SQLITE_ERROR
+                     : SQLITE_ROW;
+        if (rc != SQLITE_ROW)
+            break;
+    }
+    if (rc != SQLITE_DONE) {
+        _signal_children_master_is_done(conns);
+        return rc;
+    }
+    conns->conns[0].rc = SQLITE_DONE;
+
+    /* the other engines' shares */
+    do {
+        rc = _get_a_parallel_row(conns, &row, &conns->child_err);
+        if (rc == SQLITE_ROW) {
+            for (i = 0; i < conns->ncols; i++) {
+                if (_agg_combine(conns, i, &row[i])) {
+                    _signal_children_master_is_done(conns);
+                    return SQLITE_ERROR;
+                }
+            }
+        } else if (rc == SQLITE_OK) {
+            poll(NULL, 0, 10);
+        }
+    } while (rc == SQLITE_ROW || rc == SQLITE_OK);
+
+    if (gbl_dohsql_verbose)
+        logmsg(LOGMSG_DEBUG, "%lx %s: combined %d engines rc %d\n",
+               pthread_self(), __func__, conns->nconns, rc);
+
+    if (rc != SQLITE_DONE)
+        return rc;
+
+    conns->nrows++;
+    return SQLITE_ROW;
+}
+
 static int dohsql_write_response(struct sqlclntstate *c, int t, void *a, int i)
 {
     if (gbl_plugin_api_debug)
@@ -1099,8 +1221,12 @@ static void _master_clnt_set(struct sqlclntstate *clnt)
     clnt->conns->backup = clnt->plugin;
 
     clnt->plugin.column_count = dohsql_dist_column_count;
-    clnt->plugin.next_row = (clnt->conns->order) ? dohsql_dist_next_row_ordered
-                                                 : dohsql_dist_next_row;
+    if (clnt->conns->aggs)
+        clnt->plugin.next_row = dohsql_dist_next_row_agg;
+    else if (clnt->conns->order)
+        clnt->plugin.next_row = dohsql_dist_next_row_ordered;
+    else
+        clnt->plugin.next_row = dohsql_dist_next_row;
     clnt->plugin.column_type = dohsql_dist_column_type;
     clnt->plugin.column_int64 = dohsql_dist_column_int64;
     clnt->plugin.column_double = dohsql_dist_column_double;
@@ -1170,6 +1296,8 @@ int dohsql_distribute(dohsql_node_t *node)
     conns->nconns = node->nnodes;
     conns->ncols = node->ncols;
     conns->nparams = node->nparams;
+    conns->aggs = node->aggs;
+    node->aggs = NULL;
 
     if (node->order_size) {
         if (order_init(conns, node)) {
@@ -1189,6 +1317,8 @@ int dohsql_distribute(dohsql_node_t *node)
         if ((rc = _shard_connect(clnt, &conns->conns[i], node->nodes[i]->sql,
                                  nparams, params)) != 0)
             return rc;
+        conns->conns[i].clnt->scan_stripe = node->nodes[i]->stripe;
+        conns->conns[i].clnt->scan_nstripes = node->nodes[i]->nstripes;
 
         if (i > 0) {
             /* launch the new sqlite engine a the next shard */
@@ -1202,6 +1332,11 @@ int dohsql_distribute(dohsql_node_t *node)
         }
     }
 
+    /* stripe scan: coordinator runs the first share; set only once every
+       peer is running, a failed setup falls back to a full serial scan */
+    clnt->scan_stripe = node->nodes[0]->stripe;
+    clnt->scan_nstripes = node->nodes[0]->nstripes;
+
     if (gbl_dohsql_track_stats) {
         gbl_dohsql_stats_dirty.num_reqs++;
         if (gbl_dohsql_stats_dirty.max_distribution < conns->nconns)
@@ -1291,6 +1426,14 @@ int dohsql_end_distribute(struct sqlclntstate *clnt, struct reqlogger *logger)
         free(conns->order);
         free(conns->order_dir);
     }
+    if (conns->agg) {
+        for (i = 0; i < conns->ncols; i++)
+            sqlite3VdbeMemRelease(&conns->agg[i]);
+        free(conns->agg);
+    }
+    free(conns->aggs);
+    clnt->scan_stripe = 0;
+    clnt->scan_nstripes = 0;
     _master_clnt_reset(clnt);
     clnt->conns = NULL;
     free(conns);
@@ -1368,7 +1511,8 @@ void comdb2_register_offset(int iOffset, int iLimitOffset, int iSavedOffset)
 
 #define DOHSQL_MASTER                                                          \
     (clnt->plugin.next_row == dohsql_dist_next_row ||                          \
-     clnt->plugin.next_row == dohsql_dist_next_row_ordered)
+     clnt->plugin.next_row == dohsql_dist_next_row_ordered ||                  \
+     clnt->plugin.next_row == dohsql_dist_next_row_agg)
 
 void comdb2_handle_limit(Vdbe *v, Mem *m)
 {
@@ -1747,6 +1891,11 @@ int dohsql_error(struct sqlclntstate *clnt, const char **errstr)
 {
     struct sqlclntstate *child_clnt;
 
+    if (clnt && clnt->conns && clnt->conns->agg_overflow) {
+        *errstr = "integer overflow";
+        return SQLITE_ERROR;
+    }
+
     if (clnt && clnt->conns && clnt->conns->child_err) {
         child_clnt = clnt->conns->conns[clnt->conns->child_err].clnt;
         *errstr = child_clnt->saved_errstr;
@@ -1822,6 +1971,13 @@ void explain_distribution(dohsql_node_t *node)
             return;
 
         for (i = 0; i < node->nnodes; i++) {
+            if (node->nodes[i]->nstripes) {
+                snprintf(str, sizeof(str), "Stripes %d-%d",
+                         node->nodes[i]->stripe,
+                         node->nodes[i]->stripe + node->nodes[i]->nstripes - 1);
+                if (write_response(clnt, RESPONSE_ROW_STR, &pstr, 1))
+                    return;
+            }
             if (write_response(clnt, RESPONSE_ROW_STR, &node->nodes[i]->sql, 1))
                 return;
         }
@@ -25,6 +25,15 @@ struct params_info {
     struct param_data *params;
 };
 
+/* how the coordinator combines a column of partial aggregates */
+enum dohsql_agg {
+    DOHSQL_AGG_NONE = 0,
+    DOHSQL_AGG_COUNT = 1,
+    DOHSQL_AGG_SUM = 2,
+    DOHSQL_AGG_MIN = 3,
+    DOHSQL_AGG_MAX = 4
+};
+
 struct dohsql_node {
     enum ast_type type;
     char *sql;
@@ -35,6 +44,11 @@ struct dohsql_node {
     int *order_dir;
     int nparams;
     struct params_info *params;
+    /* stripe scans: data stripes visited by this engine */
+    int stripe;
+    int nstripes;
+    /* stripe scans: per column combine operation for partial aggregates */
+    enum dohsql_agg *aggs;
 };
 typedef struct dohsql_node dohsql_node_t;
 
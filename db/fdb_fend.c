@@ -62,6 +62,9 @@ extern int gbl_expressions_indexes;
 
 int gbl_fdb_track = 0;
 int gbl_fdb_track_times = 0;
+int gbl_fdb_pushdown = 0;
+int gbl_fdb_join_batch = 0;
+extern int gbl_time_fdb;
 
 struct fdb_tbl;
 struct fdb;
@@ -171,6 +174,16 @@ enum fdb_cur_stream_state {
     FDB_CUR_ERROR = 2
 };
 
+/* batches fetched before a cursor checks that batching pays off */
+#define FDB_JOIN_BATCH_PROBES 4
+
+/* index row prefetched for a batched equality lookup */
+typedef struct fdb_batch_row {
+    unsigned long long genid;
+    int datalen;
+    char *data;
+} fdb_batch_row_t;
+
 struct fdb_cursor {
     char *cid;             /* identity of cursor id */
     char *tid;             /* transaction id owning cursor */
@@ -190,6 +203,22 @@ struct fdb_cursor {
 
     Expr *hint;     /* expression passed down by sqlite */
     char *sql_hint; /* precreated sql query including hint */
+    long long limit;    /* most rows the query reads, 0 if unknown */
+    int limit_filtered; /* limit holds only if the hint is pushed too */
+    unsigned long long nrows;  /* rows fetched by this cursor */
+    unsigned long long nbytes; /* bytes fetched by this cursor */
+    fdb_batch_row_t *batch;    /* prefetched index rows, in index order */
+    int nbatch;                /* rows in batch */
+    int batch_end;      /* no remote rows follow the batch */
+    char *batch_low;    /* packed key the batch was fetched from */
+    int batch_lowlen;   /* length of batch_low */
+    int batch_nfields;  /* fields in batch_low */
+    int batch_pos;      /* row served from batch, -1 if reading msg */
+    int batch_run;      /* end of the rows matching the last find */
+    int nfinds;         /* equality finds, batching starts with the second */
+    int nbatches;       /* batches fetched */
+    int nlocal;         /* finds served from the batch */
+    int batch_off;      /* batches did not pay off, stop batching */
     int is_schema;  /* special processing for accessing remote sqlite_master */
     int isuuid;     /* use extended 128bit UUID instead of 64bit fastseed*/
 
@@ -229,6 +258,10 @@ static int fdb_cursor_find_last(BtCursor *pCur, Mem *key, int nfields,
                                 int bias);
 static int fdb_cursor_set_hint(BtCursor *pCur, void *hint);
 static void *fdb_cursor_get_hint(BtCursor *pCur);
+static int fdb_cursor_set_limit(BtCursor *pCur, long long limit, int filtered);
+static int fdb_cursor_count_sql(BtCursor *pCur, long long *count);
+static void fdb_cursor_fetched(fdb_cursor_t *fdbc);
+static void fdb_cursor_free_batch(fdb_cursor_t *fdbc);
 static int fdb_cursor_set_sql(BtCursor *pCur, const char *sql);
 static char *fdb_cursor_name(BtCursor *pCur);
 static char *fdb_cursor_tblname(BtCursor *pCur);
@@ -1584,6 +1617,13 @@ char *fdb_sqlexplain_get_name(int rootpage)
     return strdup(tmp);
 }
 
+int fdb_sqlexplain_is_index(int rootpage)
+{
+    fdb_tbl_ent_t *ent = get_fdb_tbl_ent_by_rootpage(rootpage);
+
+    return ent && ent->ixnum >= 0;
+}
+
 int create_sqlite_master_table(const char *etype, const char *name,
                                const char *tbl_name, int rootpage,
                                const char *sql, const char *csc2,
@@ -2367,6 +2407,8 @@ static fdb_cursor_if_t *_fdb_cursor_open_remote(struct sqlclntstate *clnt,
     fdbc_if->get_found_data = fdb_cursor_get_found_data;
     fdbc_if->set_hint = fdb_cursor_set_hint;
     fdbc_if->get_hint = fdb_cursor_get_hint;
+    fdbc_if->set_limit = fdb_cursor_set_limit;
+    fdbc_if->count = fdb_cursor_count_sql;
     fdbc_if->set_sql = fdb_cursor_set_sql;
     fdbc_if->name = fdb_cursor_name;
     fdbc_if->tblname = fdb_cursor_tblname;
@@ -2396,6 +2438,7 @@ static fdb_cursor_if_t *_fdb_cursor_open_remote(struct sqlclntstate *clnt,
     fdbc->flags = flags;
     fdbc->isuuid = isuuid;
     fdbc->need_ssl = use_ssl;
+    fdbc->batch_pos = -1;
 
     fdbc->intf = fdbc_if;
 
@@ -2558,6 +2601,7 @@ static void fdb_cursor_close_on_open(BtCursor *pCur, int cache)
             fdbc->fcon.sock.sb = NULL;
         }
 
+        fdb_cursor_free_batch(fdbc);
         fdb_msg_clean_message(fdbc->msg);
         free(pCur->fdbc);
         pCur->fdbc = NULL;
@@ -2575,6 +2619,15 @@ static int fdb_cursor_close(BtCursor *pCur)
 
         fdb_cursor_t *fdbc = pCur->fdbc->impl;
 
+        fdb_add_remote_fetched(pCur, fdbc->nrows, fdbc->nbytes);
+        if (gbl_time_fdb && fdbc->nrows)
+            logmsg(LOGMSG_USER,
+                   "fdb cursor %s.%s rows=%llu bytes=%llu batches=%d "
+                   "local finds=%d%s\n",
+                   fdb_cursor_dbname(pCur), fdb_cursor_name(pCur),
+                   fdbc->nrows, fdbc->nbytes, fdbc->nbatches, fdbc->nlocal,
+                   fdbc->batch_off ? " (batching stopped)" : "");
+
         fdb_send_close(fdbc->msg, fdbc->cid,
               (fdbc->trans) ? fdbc->trans->tid : 0, fdbc->isuuid,
               (fdbc->trans) ? fdbc->trans->seq : 0,
@@ -2590,6 +2643,43 @@ static int fdb_cursor_close(BtCursor *pCur)
     return FDB_NOERR;
 }
 
+/* Column list for a table scan that fetches only the columns sqlite reads
+ * from this cursor; the others come back as NULL so the row layout is
+ * unchanged.  Returns NULL if every column is needed.
+ */
+static char *_build_table_projection(BtCursor *pCur, fdb_cursor_t *fdbc)
+{
+    Table *pTab;
+    char *cols = NULL;
+    int i, nused = 0;
+
+    if (!gbl_fdb_pushdown || !pCur->has_col_mask || pCur->writeTransaction)
+        return NULL;
+
+    pTab = sqlite3FindTableCheckOnly(pCur->sqlite, fdbc->ent->name,
+                                     fdbc->ent->tbl->fdb->dbname);
+    if (!pTab)
+        return NULL;
+
+    for (i = 0; i < pTab->nCol; i++) {
+        if (pCur->col_mask & (1ULL << (i < 63 ? i : 63))) {
+            cols = sqlite3_mprintf("%z%s\"%w\"", cols, i ? ", " : "",
+                                   pTab->aCol[i].zName);
+            nused++;
+        } else {
+            cols = sqlite3_mprintf("%z%sNULL", cols, i ? ", " : "");
+        }
+        if (!cols)
+            return NULL;
+    }
+
+    if (nused == pTab->nCol) {
+        sqlite3_free(cols);
+        return NULL;
+    }
+    return cols;
+}
+
 static char *_build_run_sql_from_hint(BtCursor *pCur, Mem *m, int ncols,
                                       int bias, int *p_sqllen, int *error)
 {
@@ -2606,6 +2696,7 @@ static char *_build_run_sql_from_hint(BtCursor *pCur, Mem *m, int ncols,
     char *columnsDesc = NULL;
     int columnsDescLen = 0;
     int using_col_filter = 0;
+    char limitDesc[32] = "";
 
     if (!fdbc->ent) {
         tableName = "sqlite_master";
@@ -2637,6 +2728,12 @@ static char *_build_run_sql_from_hint(BtCursor *pCur, Mem *m, int ncols,
             using_col_filter = 1;
         } else {
             tableName = fdbc->ent->name;
+
+            columnsDesc = _build_table_projection(pCur, fdbc);
+            if (columnsDesc) {
+                columnsDescLen = strlen(columnsDesc);
+                using_col_filter = 1;
+            }
         }
     }
 
@@ -2647,6 +2744,13 @@ static char *_build_run_sql_from_hint(BtCursor *pCur, Mem *m, int ncols,
         }
     }
 
+    /* a limit counts rows after the WHERE clause, so it can be sent only
+       if the hint made it into the query */
+    if (gbl_fdb_pushdown && fdbc->limit > 0 &&
+        (!fdbc->limit_filtered || whereDesc)) {
+        snprintf(limitDesc, sizeof(limitDesc), " LIMIT %lld", fdbc->limit);
+    }
+
     if (whereDesc || hasCondition) {
         whereDescLen = strlen(" WHERE ") + (whereDesc ? strlen(whereDesc) : 0) +
                        1 /*terminating 0*/;
@@ -2669,6 +2773,7 @@ static char *_build_run_sql_from_hint(BtCursor *pCur, Mem *m, int ncols,
                  1 /*space*/ + whereDescLen + 5 /* possible " AND " */ +
                  orderLen;
     }
+    sqllen += strlen(limitDesc);
     sql = (char *)malloc(sqllen);
     if (!sql) {
         logmsg(LOGMSG_ERROR, "%s: malloc error %d bytes\n", __func__, sqllen);
@@ -2676,17 +2781,17 @@ static char *_build_run_sql_from_hint(BtCursor *pCur, Mem *m, int ncols,
     }
 
     if (whereDesc || hasCondition) {
-        snprintf(sql, sqllen, "SELECT %s%srowid FROM %s WHERE %s%s%s",
+        snprintf(sql, sqllen, "SELECT %s%srowid FROM %s WHERE %s%s%s%s",
                  (columnsDesc) ? columnsDesc : ((using_col_filter) ? "" : "*"),
                  (columnsDesc) ? ", " : ((using_col_filter) ? "" : ", "),
                  tableName, whereDesc ? whereDesc : "",
                  (whereDesc != NULL && hasCondition) ? " AND " : "",
-                 orderDesc ? orderDesc : "");
+                 orderDesc ? orderDesc : "", limitDesc);
     } else {
-        snprintf(sql, sqllen, "SELECT %s%srowid FROM %s%s",
+        snprintf(sql, sqllen, "SELECT %s%srowid FROM %s%s%s",
                  (columnsDesc) ? columnsDesc : ((using_col_filter) ? "" : "*"),
                  (columnsDesc) ? ", " : ((using_col_filter) ? "" : ", "),
-                 tableName, orderDesc ? orderDesc : "");
+                 tableName, orderDesc ? orderDesc : "", limitDesc);
     }
 
     /* lets get the actual size here
@@ -2718,10 +2823,23 @@ done:
 }
 
 
+/* Row served from the batch, or NULL if the cursor reads from msg */
+static fdb_batch_row_t *fdb_cursor_batch_row(fdb_cursor_t *fdbc)
+{
+    if (fdbc->batch_pos < 0 || fdbc->batch_pos >= fdbc->batch_run)
+        return NULL;
+    return &fdbc->batch[fdbc->batch_pos];
+}
+
 static char *fdb_cursor_get_data(BtCursor *pCur)
 {
+    fdb_batch_row_t *row;
+
     assert(pCur->fdbc != NULL);
 
+    if ((row = fdb_cursor_batch_row(pCur->fdbc->impl)) != NULL)
+        return row->data;
+
     if (gbl_fdb_track) {
         int len = fdb_msg_datalen(pCur->fdbc->impl->msg);
         logmsg(LOGMSG_USER, "XXXX: get data %d [", len);
@@ -2733,8 +2851,13 @@ static char *fdb_cursor_get_data(BtCursor *pCur)
 
 static int fdb_cursor_get_datalen(BtCursor *pCur)
 {
+    fdb_batch_row_t *row;
+
     assert(pCur->fdbc != NULL);
 
+    if ((row = fdb_cursor_batch_row(pCur->fdbc->impl)) != NULL)
+        return row->datalen;
+
     if (gbl_fdb_track) {
         logmsg(LOGMSG_USER, "XXXX: get datalen %d\n",
                 fdb_msg_datalen(pCur->fdbc->impl->msg));
@@ -2744,8 +2867,13 @@ static int fdb_cursor_get_datalen(BtCursor *pCur)
 
 static unsigned long long fdb_cursor_get_genid(BtCursor *pCur)
 {
+    fdb_batch_row_t *row;
+
     assert(pCur->fdbc != NULL);
 
+    if ((row = fdb_cursor_batch_row(pCur->fdbc->impl)) != NULL)
+        return row->genid;
+
     if (gbl_fdb_track) {
         logmsg(LOGMSG_USER, "XXXX: get genid %llx\n",
                 fdb_msg_genid(pCur->fdbc->impl->msg));
@@ -2757,6 +2885,7 @@ static void fdb_cursor_get_found_data(BtCursor *pCur, unsigned long long *genid,
                                       int *datalen, char **data)
 {
     fdb_cursor_t *cur;
+    fdb_batch_row_t *row;
 
     assert(pCur->fdbc != NULL);
 
@@ -2767,9 +2896,15 @@ static void fdb_cursor_get_found_data(BtCursor *pCur, unsigned long long *genid,
    assert(cur->msg.dr.rc == IX_FND || cur->msg.dr.rc == IX_FNDMORE || cur->msg.dr.rc == IX_NOTFND);
 #endif
 
-    *genid = fdb_msg_genid(cur->msg);
-    *datalen = fdb_msg_datalen(cur->msg);
-    *data = fdb_msg_data(cur->msg);
+    if ((row = fdb_cursor_batch_row(cur)) != NULL) {
+        *genid = row->genid;
+        *datalen = row->datalen;
+        *data = row->data;
+    } else {
+        *genid = fdb_msg_genid(cur->msg);
+        *datalen = fdb_msg_datalen(cur->msg);
+        *data = fdb_msg_data(cur->msg);
+    }
 
     if (gbl_fdb_track) {
         unsigned long long t = osql_log_time();
@@ -2883,6 +3018,8 @@ static int fdb_cursor_find_common(BtCursor *pCur, Mem *key, int nfields,
                         rc);
                 return FDB_ERR_READ_IO;
             }
+            if (rc == IX_FND || rc == IX_FNDMORE)
+                fdb_cursor_fetched(fdbc);
         }
     } else {
         logmsg(LOGMSG_ERROR, "%s: no fdbc cursor?\n", __func__);
@@ -2917,6 +3054,22 @@ static void *fdb_cursor_get_hint(BtCursor *pCur)
     return pCur->fdbc->impl->hint;
 }
 
+static int fdb_cursor_set_limit(BtCursor *pCur, long long limit, int filtered)
+{
+    assert(pCur->fdbc);
+    pCur->fdbc->impl->limit = limit;
+    pCur->fdbc->impl->limit_filtered = filtered;
+
+    return 0;
+}
+
+/* Account for the row just received */
+static void fdb_cursor_fetched(fdb_cursor_t *fdbc)
+{
+    fdbc->nrows++;
+    fdbc->nbytes += fdb_msg_datalen(fdbc->msg);
+}
+
 static int fdb_cursor_reopen(BtCursor *pCur)
 {
     struct sql_thread *thd;
@@ -2924,6 +3077,8 @@ static int fdb_cursor_reopen(BtCursor *pCur)
     int rc;
     fdb_tran_t *tran;
     int need_ssl = 0;
+    int nfinds;
+    int batch_off;
 
     thd = pthread_getspecific(query_info_key);
 
@@ -2934,6 +3089,8 @@ static int fdb_cursor_reopen(BtCursor *pCur)
     clnt = thd->clnt;
     tran = pCur->fdbc->impl->trans;
     need_ssl = pCur->fdbc->impl->need_ssl;
+    nfinds = pCur->fdbc->impl->nfinds;
+    batch_off = pCur->fdbc->impl->batch_off;
 
     if (tran)
         Pthread_mutex_lock(&clnt->dtran_mtx);
@@ -2950,6 +3107,8 @@ static int fdb_cursor_reopen(BtCursor *pCur)
         rc = clnt->fdb_state.xerr.errval;
         goto done;
     }
+    pCur->fdbc->impl->nfinds = nfinds;
+    pCur->fdbc->impl->batch_off = batch_off;
 
 done:
     if (tran)
@@ -2966,6 +3125,20 @@ static int fdb_cursor_move_sql(BtCursor *pCur, int how)
     unsigned long long start_rpc;
     unsigned long long end_rpc;
 
+    if (fdbc && fdbc->batch_pos >= 0) {
+        /* stepping through the rows matching a batched find */
+        if (how == CNEXT) {
+            if (fdbc->batch_pos + 1 >= fdbc->batch_run) {
+                fdbc->batch_pos = fdbc->batch_run;
+                return IX_PASTEOF;
+            }
+            fdbc->batch_pos++;
+            return (fdbc->batch_pos + 1 == fdbc->batch_run) ? IX_FND
+                                                            : IX_FNDMORE;
+        }
+        fdbc->batch_pos = -1;
+    }
+
     if (fdbc) {
         start_rpc = osql_log_time();
 
@@ -3084,6 +3257,8 @@ static int fdb_cursor_move_sql(BtCursor *pCur, int how)
             } else {
                 fdbc->streaming =
                     (rc == IX_FNDMORE) ? FDB_CUR_STREAMING : FDB_CUR_IDLE;
+                if (rc == IX_FND || rc == IX_FNDMORE)
+                    fdb_cursor_fetched(fdbc);
             }
         }
 
@@ -3144,6 +3319,248 @@ static int fdb_sqlite_unpacked_to_packed(Mem *m, int ncols, char **out,
     return FDB_NOERR;
 }
 
+static void fdb_cursor_free_batch(fdb_cursor_t *fdbc)
+{
+    int i;
+
+    for (i = 0; i < fdbc->nbatch; i++)
+        free(fdbc->batch[i].data);
+    free(fdbc->batch);
+    free(fdbc->batch_low);
+
+    fdbc->batch = NULL;
+    fdbc->nbatch = 0;
+    fdbc->batch_end = 0;
+    fdbc->batch_low = NULL;
+    fdbc->batch_lowlen = 0;
+    fdbc->batch_nfields = 0;
+    fdbc->batch_pos = -1;
+    fdbc->batch_run = 0;
+}
+
+/**
+ * Equality finds on a remote index, as done for every outer row of a nested
+ * loop join, can be served from a batch of index rows prefetched from the
+ * key onwards.  This holds only if the key alone selects the rows; a hint
+ * may refer to registers of the outer loop, so it disables batching.
+ */
+static int fdb_cursor_can_batch(BtCursor *pCur, fdb_cursor_t *fdbc, Mem *key,
+                                int nfields, int bias, int last)
+{
+    int i;
+
+    if (gbl_fdb_join_batch <= 1 || last || bias != OP_SeekGE ||
+        !pCur->is_equality || pCur->ixnum < 0 || !pCur->pKeyInfo ||
+        pCur->writeTransaction || fdbc->batch_off || !fdbc->ent ||
+        fdbc->sql_hint ||
+        fdbc->hint || fdbc->limit > 0)
+        return 0;
+
+    /* "=" never matches a null, sqlite compare does */
+    for (i = 0; i < nfields; i++) {
+        if (key[i].flags & MEM_Null)
+            return 0;
+    }
+
+    return 1;
+}
+
+/* Are all the index rows matching "key" in the batch? */
+static int fdb_cursor_batch_covers(fdb_cursor_t *fdbc, UnpackedRecord *key)
+{
+    fdb_batch_row_t *last;
+
+    if (!fdbc->batch_low || fdbc->batch_nfields != key->nField)
+        return 0;
+
+    /* rows before the key the batch was fetched from are not there */
+    if (sqlite3VdbeRecordCompare(fdbc->batch_lowlen, fdbc->batch_low, key) > 0)
+        return 0;
+
+    if (fdbc->batch_end)
+        return 1;
+
+    /* more rows follow the batch; the last row has to sort after the key,
+       otherwise some matches might have been left out */
+    last = &fdbc->batch[fdbc->nbatch - 1];
+    return sqlite3VdbeRecordCompare(last->datalen, last->data, key) > 0;
+}
+
+/**
+ * Fetch up to gbl_fdb_join_batch index rows starting at "key", in index
+ * order, with every index column filled in so they can be matched locally.
+ *
+ */
+static int fdb_cursor_fill_batch(BtCursor *pCur, Mem *key, int nfields)
+{
+    fdb_cursor_t *fdbc = pCur->fdbc->impl;
+    unsigned long long col_mask = pCur->col_mask;
+    int nbatch = gbl_fdb_join_batch;
+    fdb_batch_row_t *row;
+    unsigned long long start_rpc;
+    unsigned long long end_rpc;
+    char *sql;
+    char *batch_sql;
+    int sqllen;
+    int error = 0;
+    int rc;
+
+    fdb_cursor_free_batch(fdbc);
+
+    rc = fdb_sqlite_unpacked_to_packed(key, nfields, &fdbc->batch_low,
+                                       &fdbc->batch_lowlen);
+    if (rc)
+        return rc;
+    fdbc->batch_nfields = nfields;
+
+    fdbc->batch = (fdb_batch_row_t *)calloc(nbatch, sizeof(fdb_batch_row_t));
+    if (!fdbc->batch) {
+        logmsg(LOGMSG_ERROR, "%s: malloc %d rows\n", __func__, nbatch);
+        return FDB_ERR_MALLOC;
+    }
+
+    /* a range scan from the key instead of an equality */
+    pCur->is_equality = 0;
+    pCur->col_mask = ~0ULL;
+    sql = _build_run_sql_from_hint(pCur, key, nfields, OP_SeekGE, &sqllen,
+                                   &error);
+    pCur->is_equality = 1;
+    pCur->col_mask = col_mask;
+    if (!sql) {
+        if (error)
+            return FDB_ERR_INDEX_DESCRIBE;
+        return FDB_ERR_MALLOC;
+    }
+
+    sqllen += 32;
+    batch_sql = (char *)malloc(sqllen);
+    if (!batch_sql) {
+        free(sql);
+        return FDB_ERR_MALLOC;
+    }
+    snprintf(batch_sql, sqllen, "%s LIMIT %d", sql, nbatch);
+    free(sql);
+
+    start_rpc = osql_log_time();
+
+    rc = fdb_send_run_sql(fdbc->msg, fdbc->cid, strlen(batch_sql) + 1,
+                          batch_sql, fdb_table_version(fdbc->ent->tbl->version),
+                          0, NULL, FDB_RUN_SQL_TRIM, fdbc->isuuid,
+                          fdbc->fcon.sock.sb);
+    free(batch_sql);
+    if (rc)
+        return rc;
+
+    do {
+        rc = fdb_recv_row(fdbc->msg, fdbc->cid, fdbc->fcon.sock.sb);
+        if (rc != IX_FND && rc != IX_FNDMORE)
+            break;
+
+        if (fdbc->nbatch == nbatch) {
+            /* remote did not honor the limit */
+            fdbc->streaming = FDB_CUR_STREAMING;
+            return FDB_ERR_BUG;
+        }
+        row = &fdbc->batch[fdbc->nbatch];
+        row->genid = fdb_msg_genid(fdbc->msg);
+        row->datalen = fdb_msg_datalen(fdbc->msg);
+        row->data = (char *)malloc(row->datalen);
+        if (!row->data) {
+            fdbc->streaming =
+                (rc == IX_FNDMORE) ? FDB_CUR_STREAMING : FDB_CUR_IDLE;
+            return FDB_ERR_MALLOC;
+        }
+        memcpy(row->data, fdb_msg_data(fdbc->msg), row->datalen);
+        fdbc->nbatch++;
+        fdb_cursor_fetched(fdbc);
+    } while (rc == IX_FNDMORE);
+
+    if (rc != IX_FND && rc != IX_NOTFND && rc != IX_PASTEOF &&
+        rc != IX_EMPTY) {
+        if (rc != SQLITE_SCHEMA) {
+            logmsg(LOGMSG_ERROR, "%s: failed to retrieve batch rc=%d\n",
+                   __func__, rc);
+            fdbc->streaming = FDB_CUR_ERROR;
+        }
+        return rc;
+    }
+
+    fdbc->streaming = FDB_CUR_IDLE;
+    fdbc->batch_end = fdbc->nbatch < nbatch;
+    fdbc->nbatches++;
+
+    end_rpc = osql_log_time();
+    fdb_add_remote_time(pCur, start_rpc, end_rpc);
+
+    return FDB_NOERR;
+}
+
+/**
+ * Serve an equality find from the batch, fetching a new batch if the key
+ * is not covered by the current one.  Returns 0 if the find has to be sent
+ * to the remote as usual, otherwise 1 with the find result in "rc".
+ *
+ */
+static int fdb_cursor_find_batch(BtCursor *pCur, Mem *key, int nfields,
+                                 int *rc)
+{
+    fdb_cursor_t *fdbc = pCur->fdbc->impl;
+    UnpackedRecord r;
+    int lo, hi, mid;
+
+    memset(&r, 0, sizeof(r));
+    r.pKeyInfo = pCur->pKeyInfo;
+    r.aMem = key;
+    r.nField = nfields;
+    r.default_rc = 0;
+
+    if (fdb_cursor_batch_covers(fdbc, &r)) {
+        fdbc->nlocal++;
+    } else {
+        /* outer keys that are not sorted or clustered hardly ever hit the
+           batch; each miss then costs a larger fetch than a plain find */
+        if (fdbc->nbatches >= FDB_JOIN_BATCH_PROBES &&
+            fdbc->nlocal < fdbc->nbatches) {
+            fdb_cursor_free_batch(fdbc);
+            fdbc->batch_off = 1;
+            return 0;
+        }
+        *rc = fdb_cursor_fill_batch(pCur, key, nfields);
+        if (*rc) {
+            fdb_cursor_free_batch(fdbc);
+            /* a schema error is reported by the regular find */
+            return *rc != SQLITE_SCHEMA && *rc != FDB_ERR_INDEX_DESCRIBE;
+        }
+    }
+
+    /* first row not below the key, then the run of matching rows */
+    lo = 0;
+    hi = fdbc->nbatch;
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        if (sqlite3VdbeRecordCompare(fdbc->batch[mid].datalen,
+                                     fdbc->batch[mid].data, &r) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    for (hi = lo; hi < fdbc->nbatch; hi++) {
+        if (sqlite3VdbeRecordCompare(fdbc->batch[hi].datalen,
+                                     fdbc->batch[hi].data, &r) != 0)
+            break;
+    }
+
+    fdbc->batch_pos = lo;
+    fdbc->batch_run = hi;
+
+    if (lo == hi)
+        *rc = IX_EMPTY;
+    else
+        *rc = (hi - lo == 1) ? IX_FND : IX_FNDMORE;
+
+    return 1;
+}
+
 static int fdb_cursor_find_sql_common(BtCursor *pCur, Mem *key, int nfields,
                                       int bias, int last)
 {
@@ -3178,6 +3595,13 @@ static int fdb_cursor_find_sql_common(BtCursor *pCur, Mem *key, int nfields,
             }
             fdbc = pCur->fdbc->impl;
         }
+        fdbc->batch_pos = -1;
+
+        if (fdb_cursor_can_batch(pCur, fdbc, key, nfields, bias, last) &&
+            ++fdbc->nfinds > 1 &&
+            fdb_cursor_find_batch(pCur, key, nfields, &rc)) {
+            return rc;
+        }
 
         if (pCur->ixnum == -1) {
             if (bias != OP_NotExists) {
@@ -3275,6 +3699,8 @@ static int fdb_cursor_find_sql_common(BtCursor *pCur, Mem *key, int nfields,
             } else {
                 fdbc->streaming =
                     (rc == IX_FNDMORE) ? FDB_CUR_STREAMING : FDB_CUR_IDLE;
+                if (rc == IX_FND || rc == IX_FNDMORE)
+                    fdb_cursor_fetched(fdbc);
             }
 
             /* if we don't get a row here, it means the concocted sql did not
@@ -3314,6 +3740,81 @@ static int fdb_cursor_find_last_sql(BtCursor *pCur, Mem *key, int nfields,
     return fdb_cursor_find_sql_common(pCur, key, nfields, bias, 1);
 }
 
+/* Run count(*) on the remote instead of streaming every row back */
+static int fdb_cursor_count_sql(BtCursor *pCur, long long *count)
+{
+    fdb_cursor_t *fdbc = pCur->fdbc->impl;
+    unsigned long long start_rpc;
+    unsigned long long end_rpc;
+    unsigned int hdrsz;
+    u32 type;
+    Mem m = {{0}};
+    char *data;
+    char *sql;
+    int rc;
+
+    if (!fdbc->ent)
+        return FDB_ERR_BUG;
+
+    if (fdbc->streaming != FDB_CUR_IDLE) {
+        rc = fdb_cursor_reopen(pCur);
+        if (rc) {
+            logmsg(LOGMSG_ERROR, "%s: failed to reconnect rc=%d\n", __func__,
+                   rc);
+            return rc;
+        }
+        fdbc = pCur->fdbc->impl;
+    }
+
+    /* the backend takes the last 8 bytes of a row as its genid */
+    sql = sqlite3_mprintf("SELECT count(*), x'0000000000000000' FROM \"%w\"",
+                          fdbc->ent->tbl->name);
+    if (!sql)
+        return FDB_ERR_MALLOC;
+
+    start_rpc = osql_log_time();
+
+    rc = fdb_send_run_sql(fdbc->msg, fdbc->cid, strlen(sql) + 1, sql,
+                          fdb_table_version(fdbc->ent->tbl->version), 0, NULL,
+                          FDB_RUN_SQL_NORMAL, fdbc->isuuid, fdbc->fcon.sock.sb);
+    sqlite3_free(sql);
+    if (rc)
+        return rc;
+
+    rc = fdb_recv_row(fdbc->msg, fdbc->cid, fdbc->fcon.sock.sb);
+    if (rc != IX_FND && rc != IX_FNDMORE) {
+        if (rc == SQLITE_SCHEMA) {
+            char *errstr = fdbc->intf->data(pCur);
+
+            if (errstr)
+                fdbc->ent->tbl->need_version = atoll(errstr) + 1;
+            return SQLITE_SCHEMA_REMOTE;
+        }
+        logmsg(LOGMSG_ERROR, "%s: failed to retrieve count rc=%d\n",
+               __func__, rc);
+        fdbc->streaming = FDB_CUR_ERROR;
+        return rc;
+    }
+    fdbc->streaming = (rc == IX_FNDMORE) ? FDB_CUR_STREAMING : FDB_CUR_IDLE;
+    fdb_cursor_fetched(fdbc);
+
+    end_rpc = osql_log_time();
+    fdb_add_remote_time(pCur, start_rpc, end_rpc);
+
+    data = fdb_msg_data(fdbc->msg);
+    sqlite3GetVarint32((unsigned char *)data + sqlite3GetVarint32(
+                           (unsigned char *)data, &hdrsz),
+                       &type);
+    if ((int)hdrsz >= fdb_msg_datalen(fdbc->msg))
+        return FDB_ERR_BUG;
+    sqlite3VdbeSerialGet((unsigned char *)data + hdrsz, type, &m);
+    if (!(m.flags & MEM_Int))
+        return FDB_ERR_BUG;
+    *count = m.u.i;
+
+    return IX_FND;
+}
+
 /*
    This returns the sqlstats table under a mutex
  */
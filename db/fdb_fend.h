@@ -197,6 +197,8 @@ typedef struct fdb_cursor_if {
 
     int (*set_hint)(BtCursor *pCur, void *hint);
     void *(*get_hint)(BtCursor *pCur);
+    int (*set_limit)(BtCursor *pCur, long long limit, int filtered);
+    int (*count)(BtCursor *pCur, long long *count);
 
     int (*set_sql)(BtCursor *pCur, const char *sql);
     char *(*name)(BtCursor *pCur);
@@ -259,6 +261,12 @@ void *fdb_get_sqlite_master_entry(fdb_t *fdb, fdb_tbl_ent_t *ent);
  */
 char *fdb_sqlexplain_get_name(int rootpage);
 
+/**
+ * Return 1 if "rootpage" is a remote index, 0 if it is a table or unknown
+ *
+ */
+int fdb_sqlexplain_is_index(int rootpage);
+
 /**
  * Retrieve the field name for the table identified by "rootpage", index
  * "ixnum",
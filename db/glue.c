@@ -5223,6 +5223,13 @@ int lite_del_auxdb(int auxdb, struct ireq *iq, void *trans, void *key)
 /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 
 int dbq_add(struct ireq *iq, void *trans, const void *dta, size_t dtalen)
+{
+    return dbq_add_partition(iq, trans, dta, dtalen, -1);
+}
+
+/* partition < 0 adds to every consumer of the queue */
+int dbq_add_partition(struct ireq *iq, void *trans, const void *dta,
+                      size_t dtalen, int partition)
 {
     int bdberr;
     void *bdb_handle;
@@ -5231,7 +5238,11 @@ int dbq_add(struct ireq *iq, void *trans, const void *dta, size_t dtalen)
     if (!bdb_handle)
         return ERR_NO_AUXDB;
     iq->gluewhere = "bdb_queue_add";
-    bdb_queue_add(bdb_handle, trans, dta, dtalen, &bdberr, &genid);
+    if (partition < 0)
+        bdb_queue_add(bdb_handle, trans, dta, dtalen, &bdberr, &genid);
+    else
+        bdb_queue_add_partition(bdb_handle, trans, dta, dtalen, partition,
+                                &bdberr, &genid);
     iq->gluewhere = "bdb_queue_add done";
 
     if (bdberr == 0) {
@@ -5414,6 +5425,49 @@ retry:
     return rc;
 }
 
+int dbq_get_batch(struct ireq *iq, int consumer,
+                  const struct dbq_cursor *prevcursor, int max, void **fnddta,
+                  size_t *fnddtalen, size_t *fnddtaoff,
+                  struct dbq_cursor *fndcursor, int *nfound)
+{
+    int bdberr;
+    void *bdb_handle;
+    int retries = 0;
+    int rc;
+    *nfound = 0;
+    bdb_handle = get_bdb_handle_ireq(iq, AUXDB_NONE);
+    if (!bdb_handle)
+        return ERR_NO_AUXDB;
+
+retry:
+    iq->gluewhere = "bdb_queue_get_batch";
+    rc = bdb_queue_get_batch(bdb_handle, consumer,
+                             (const struct bdb_queue_cursor *)prevcursor, max,
+                             fnddta, fnddtalen, fnddtaoff,
+                             (struct bdb_queue_cursor *)fndcursor, nfound,
+                             &bdberr);
+    iq->gluewhere = "bdb_queue_get_batch done";
+    if (rc != 0) {
+        if (bdberr == BDBERR_DEADLOCK) {
+            iq->retries++;
+            if (++retries < gbl_maxretries) {
+                n_retries++;
+                poll(0, 0, (rand() % 500 + 10));
+                goto retry;
+            }
+            logmsg(LOGMSG_ERROR, "*ERROR* bdb_queue_get_batch too much contention "
+                   "%d count %d\n",
+                   bdberr, retries);
+            return ERR_INTERNAL;
+        } else if (bdberr == BDBERR_FETCH_DTA ||
+                   bdberr == BDBERR_LOCK_DESIRED) {
+            return IX_NOTFND;
+        }
+        return map_unhandled_bdb_rcode("bdb_queue_get_batch", bdberr, 0);
+    }
+    return rc;
+}
+
 unsigned long long dbq_item_genid(const void *dta)
 {
     return bdb_queue_item_genid(dta);
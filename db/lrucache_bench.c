@@ -0,0 +1,161 @@
+/*
+   Copyright 2019 Bloomberg Finance L.P.
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+/* Compare lrucache behind a global mutex (how its users run it) with
+ * clrucache under N threads doing find/release with add on miss. */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+
+#include "lrucache.h"
+#include "clrucache.h"
+#include "locks_wrap.h"
+#include <epochlib.h>
+#include <logmsg.h>
+
+struct bench_ent {
+    int key;
+    lrucache_link lnk;
+    clrucache_link clnk;
+};
+
+struct bench_arg {
+    int concurrent;
+    void *cache;
+    pthread_mutex_t *lk;
+    int ops;
+    int nkeys;
+    unsigned int seed;
+    int hits;
+    int misses;
+};
+
+static unsigned int bench_hash(const void *key, int len)
+{
+    return hash_default_fixedwidth((const unsigned char *)key, len);
+}
+
+static int bench_cmp(const void *key1, const void *key2, int len)
+{
+    return memcmp(key1, key2, len);
+}
+
+static void *bench_thd(void *p)
+{
+    struct bench_arg *arg = p;
+    struct bench_ent *ent;
+    int i, key;
+
+    for (i = 0; i < arg->ops; i++) {
+        /* skew towards a hot set: half the lookups hit the first 1/16th */
+        key = rand_r(&arg->seed) % arg->nkeys;
+        if (i & 1)
+            key /= 16;
+
+        if (arg->concurrent) {
+            ent = clrucache_find(arg->cache, &key);
+            if (ent) {
+                arg->hits++;
+                clrucache_release(arg->cache, &key);
+                continue;
+            }
+            arg->misses++;
+            ent = malloc(sizeof(struct bench_ent));
+            ent->key = key;
+            if (clrucache_add(arg->cache, ent) != 0)
+                free(ent);
+        } else {
+            Pthread_mutex_lock(arg->lk);
+            ent = lrucache_find(arg->cache, &key);
+            if (ent) {
+                arg->hits++;
+                lrucache_release(arg->cache, &key);
+            } else {
+                arg->misses++;
+                ent = malloc(sizeof(struct bench_ent));
+                ent->key = key;
+                lrucache_add(arg->cache, ent);
+            }
+            Pthread_mutex_unlock(arg->lk);
+        }
+    }
+    return NULL;
+}
+
+static void bench_run(int concurrent, int nthreads, int ops, int nkeys)
+{
+    pthread_mutex_t lk = PTHREAD_MUTEX_INITIALIZER;
+    pthread_t *tids = calloc(nthreads, sizeof(pthread_t));
+    struct bench_arg *args = calloc(nthreads, sizeof(struct bench_arg));
+    void *cache;
+    int i, start, elapsed, hits = 0, misses = 0;
+
+    if (concurrent)
+        cache = clrucache_init(bench_hash, bench_cmp, free,
+                               offsetof(struct bench_ent, clnk),
+                               offsetof(struct bench_ent, key), sizeof(int),
+                               nkeys / 4, 0);
+    else
+        cache = lrucache_init(bench_hash, bench_cmp, free,
+                              offsetof(struct bench_ent, lnk),
+                              offsetof(struct bench_ent, key), sizeof(int),
+                              nkeys / 4);
+
+    start = comdb2_time_epochms();
+    for (i = 0; i < nthreads; i++) {
+        args[i].concurrent = concurrent;
+        args[i].cache = cache;
+        args[i].lk = &lk;
+        args[i].ops = ops;
+        args[i].nkeys = nkeys;
+        args[i].seed = i + 1;
+        pthread_create(&tids[i], NULL, bench_thd, &args[i]);
+    }
+    for (i = 0; i < nthreads; i++) {
+        pthread_join(tids[i], NULL);
+        hits += args[i].hits;
+        misses += args[i].misses;
+    }
+    elapsed = comdb2_time_epochms() - start;
+
+    logmsg(LOGMSG_USER,
+           "%-9s threads %d ops %d elapsed %d ms ops/sec %lld hits %d "
+           "misses %d\n",
+           concurrent ? "clrucache" : "lrucache", nthreads, nthreads * ops,
+           elapsed,
+           elapsed ? (long long)nthreads * ops * 1000 / elapsed : 0LL, hits,
+           misses);
+
+    if (concurrent)
+        clrucache_destroy(cache);
+    else
+        lrucache_destroy(cache);
+    free(args);
+    free(tids);
+}
+
+void lrucache_bench(int nthreads, int ops, int nkeys)
+{
+    if (nthreads <= 0 || ops <= 0 || nkeys < 4) {
+        logmsg(LOGMSG_ERROR,
+               "lrucache_bench requires threads, ops-per-thread, keys>=4\n");
+        return;
+    }
+    bench_run(0, nthreads, ops, nkeys);
+    bench_run(1, nthreads, ops, nkeys);
+}
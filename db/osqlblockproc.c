@@ -64,10 +64,15 @@
 #include "comdb2uuid.h"
 #include "bpfunc.h"
 #include "logmsg.h"
+#include "comdb2_atomic.h"
+#include "translistener.h"
+#include "locks_wrap.h"
 
 int g_osql_blocksql_parallel_max = 5;
 int gbl_osql_check_replicant_numops = 1;
 extern int gbl_blocksql_grace;
+extern int gbl_max_wr_rows_per_txn;
+extern pthread_attr_t gbl_pthread_attr;
 
 
 struct blocksql_tran {
@@ -85,6 +90,7 @@ struct blocksql_tran {
     int dowait; /* mark this when session completes to avoid loosing signal */
     int delayed;
     int rows;
+    int serial_only; /* touches a table parallel apply cannot handle */
     bool iscomplete;
 };
 
@@ -103,6 +109,10 @@ static int apply_changes(struct ireq *iq, blocksql_tran_t *tran, void *iq_tran,
                                      blob_buffer_t blobs[MAXBLOBS], int,
                                      struct block_err *, int *, SBUF2 *));
 static int req2blockop(int reqtype);
+static int par_apply_table_ok(char *rpl);
+
+extern int gbl_osql_parallel_apply_threads;
+extern int gbl_goslow;
 
 #define CMP_KEY_MEMBER(k1, k2, var)                                            \
     if (k1->var < k2->var) {                                                   \
@@ -781,6 +791,10 @@ int osql_bplog_saveop(osql_sess_t *sess, char *rpl, int rplen,
 
     DEBUG_PRINT_TMPBL_SAVING();
 
+    if (type == OSQL_USEDB && gbl_osql_parallel_apply_threads > 1 &&
+        !tran->serial_only)
+        tran->serial_only = !par_apply_table_ok(rpl);
+
     rc_op = bdb_temp_table_put(thedb->bdb_env, tmptbl, &key, sizeof(key), rpl,
                                rplen, NULL, &bdberr);
     if (rc_op) {
@@ -1260,6 +1274,22 @@ get_next_merge_tmps(struct temp_cursor *dbc, struct temp_cursor *dbc_ins,
 #define DEBUG_PRINT_TMPBL_READ()
 #endif
 
+static void bplog_set_reqlog(struct ireq *iq, osql_sess_t *sess)
+{
+    unsigned long long rqid = osql_sess_getrqid(sess);
+    uuid_t uuid;
+
+    iq->queryid = osql_sess_queryid(sess);
+
+    osql_sess_getuuid(sess, uuid);
+
+    if (rqid != OSQL_RQID_USE_UUID)
+        reqlog_set_rqid(iq->reqlogger, &rqid, sizeof(unsigned long long));
+    else
+        reqlog_set_rqid(iq->reqlogger, uuid, sizeof(uuid));
+    reqlog_set_event(iq->reqlogger, "txn");
+}
+
 static int process_this_session(
     struct ireq *iq, void *iq_tran, osql_sess_t *sess, int *bdberr, int *nops,
     struct block_err *err, SBUF2 *logsb, struct temp_cursor *dbc,
@@ -1281,15 +1311,8 @@ static int process_this_session(
     int flags = 0;
     uuid_t uuid;
 
-    iq->queryid = osql_sess_queryid(sess);
-
     osql_sess_getuuid(sess, uuid);
-
-    if (rqid != OSQL_RQID_USE_UUID)
-        reqlog_set_rqid(iq->reqlogger, &rqid, sizeof(unsigned long long));
-    else
-        reqlog_set_rqid(iq->reqlogger, uuid, sizeof(uuid));
-    reqlog_set_event(iq->reqlogger, "txn");
+    bplog_set_reqlog(iq, sess);
 
 #if DEBUG_REORDER
     // if needed to check content of socksql temp table, dump with:
@@ -1406,6 +1429,429 @@ int osql_bplog_reqlog_queries(struct ireq *iq)
     return 0;
 }
 
+/* Parallel apply of one large bplog.
+ *
+ * The block processor keeps reading the bplog in order and hands each op to
+ * the worker that owns the op's table; every worker applies its ops in its
+ * own child of the block processor's transaction.  Only insert-only logs are
+ * eligible: update, delete and constraint processing share per-thread
+ * constraint tables (blkstate) and must stay on the block processor thread,
+ * so any log that marked the transaction as delayed is applied serially.
+ * If any worker fails (deadlock between siblings, dup key, ...) all children
+ * are aborted and the whole log is replayed serially, which also reports
+ * the error exactly as the serial path would.
+ */
+#define PAR_APPLY_QUEUE 256
+#define PAR_APPLY_MAX_THREADS 16
+#define PAR_APPLY_MAX_TABLES 64
+
+typedef int (*osql_apply_func_t)(struct ireq *, unsigned long long, uuid_t,
+                                 void *, char **, int, int *, int **,
+                                 blob_buffer_t blobs[MAXBLOBS], int,
+                                 struct block_err *, int *, SBUF2 *);
+
+struct par_apply;
+
+struct par_apply_op {
+    char *data;
+    int datalen;
+};
+
+struct par_apply_worker {
+    struct par_apply *par;
+    struct ireq iq; /* private copy: usedb and index state are per worker */
+    tran_type *trans;
+    pthread_t tid;
+    struct par_apply_op ops[PAR_APPLY_QUEUE];
+    int head;
+    int tail;
+    int rc;
+    int receivedrows;
+    struct block_err err;
+};
+
+struct par_apply {
+    pthread_mutex_t lk;
+    pthread_cond_t cond;
+    unsigned long long rqid;
+    uuid_t uuid;
+    osql_apply_func_t func;
+    int eof;
+    int failed;
+    int nworkers;
+    struct par_apply_worker *workers;
+    struct dbtable *tables[PAR_APPLY_MAX_TABLES];
+    int ntables;
+};
+
+int gbl_osql_parallel_apply_threads = 0;
+int gbl_osql_parallel_apply_min_ops = 10000;
+
+/* Checked for every table in the log as it is saved.  Inserts into a table
+   with constraints record the keys to verify in per-thread tables, which
+   the workers do not have and the parent would never see. */
+static int par_apply_table_ok(char *rpl)
+{
+    extern const char *get_tablename_from_rpl(const char *rpl);
+    const char *tablename = get_tablename_from_rpl(rpl);
+    struct dbtable *db;
+
+    if (!tablename)
+        return 0;
+    db = get_dbtable_by_name(tablename);
+    return db && db->n_constraints == 0;
+}
+
+void free_cached_idx(uint8_t **cached_idx);
+
+static int64_t par_apply_count;
+static int64_t par_apply_ops;
+static int64_t par_apply_fallbacks;
+
+void osql_bplog_parallel_apply_stat(void)
+{
+    logmsg(LOGMSG_USER,
+           "osql parallel apply txns %" PRId64 " ops %" PRId64
+           " serial fallbacks %" PRId64 "\n",
+           par_apply_count, par_apply_ops, par_apply_fallbacks);
+}
+
+static int par_apply_eligible(struct ireq *iq, blocksql_tran_t *tran,
+                              void *iq_tran)
+{
+    if (gbl_osql_parallel_apply_threads < 2)
+        return 0;
+    if (tran->rows < gbl_osql_parallel_apply_min_ops)
+        return 0;
+    /* delayed is set by any op that is not an insert; inserts into tables
+       with constraints only set it when they are applied, so those tables
+       are caught as the log is saved */
+    if (tran->delayed || tran->serial_only || gbl_goslow)
+        return 0;
+    if (iq->tranddl || iq->sc_pending || iq->__limits.maxcost)
+        return 0;
+    if (is_rowlocks_transaction(iq_tran))
+        return 0;
+    if (javasp_trans_care_about(iq->jsph, JAVASP_TRANS_LISTEN_AFTER_ADD))
+        return 0;
+    return 1;
+}
+
+static void par_apply_free_op(struct par_apply_op *op)
+{
+    free(op->data);
+    op->data = NULL;
+}
+
+static void *par_apply_worker_thd(void *arg)
+{
+    struct par_apply_worker *w = arg;
+    struct par_apply *par = w->par;
+    blob_buffer_t blobs[MAXBLOBS] = {{0}};
+    int *updCols = NULL;
+    int flags = 0;
+    int step = 0;
+    int rc = 0;
+
+    backend_thread_event(thedb, COMDB2_THR_EVENT_START_RDWR);
+
+    while (1) {
+        struct par_apply_op op;
+
+        Pthread_mutex_lock(&par->lk);
+        while (w->head == w->tail && !par->eof && !par->failed)
+            Pthread_cond_wait(&par->cond, &par->lk);
+        if (par->failed || w->head == w->tail) {
+            Pthread_mutex_unlock(&par->lk);
+            break;
+        }
+        op = w->ops[w->head % PAR_APPLY_QUEUE];
+        w->head++;
+        Pthread_cond_broadcast(&par->cond);
+        Pthread_mutex_unlock(&par->lk);
+
+        rc = par->func(&w->iq, par->rqid, par->uuid, w->trans, &op.data,
+                       op.datalen, &flags, &updCols, blobs, step, &w->err,
+                       &w->receivedrows, NULL);
+        par_apply_free_op(&op);
+        if (rc) {
+            Pthread_mutex_lock(&par->lk);
+            w->rc = rc;
+            par->failed = 1;
+            Pthread_cond_broadcast(&par->cond);
+            Pthread_mutex_unlock(&par->lk);
+            break;
+        }
+        step++;
+    }
+
+    /* ops left over after a failure */
+    Pthread_mutex_lock(&par->lk);
+    while (w->head != w->tail) {
+        par_apply_free_op(&w->ops[w->head % PAR_APPLY_QUEUE]);
+        w->head++;
+    }
+    Pthread_cond_broadcast(&par->cond);
+    Pthread_mutex_unlock(&par->lk);
+
+    free_blob_buffers(blobs, MAXBLOBS);
+    free(updCols);
+    if (w->iq.idxInsert || w->iq.idxDelete) {
+        free_cached_idx(w->iq.idxInsert);
+        free_cached_idx(w->iq.idxDelete);
+        free(w->iq.idxInsert);
+        free(w->iq.idxDelete);
+        w->iq.idxInsert = w->iq.idxDelete = NULL;
+    }
+
+    backend_thread_event(thedb, COMDB2_THR_EVENT_DONE_RDWR);
+    return NULL;
+}
+
+/* Queue an op for worker w; returns non-zero if the apply already failed. */
+static int par_apply_enqueue(struct par_apply *par, struct par_apply_worker *w,
+                             char *data, int datalen)
+{
+    Pthread_mutex_lock(&par->lk);
+    while (w->tail - w->head == PAR_APPLY_QUEUE && !par->failed)
+        Pthread_cond_wait(&par->cond, &par->lk);
+    if (par->failed) {
+        Pthread_mutex_unlock(&par->lk);
+        free(data);
+        return -1;
+    }
+    w->ops[w->tail % PAR_APPLY_QUEUE].data = data;
+    w->ops[w->tail % PAR_APPLY_QUEUE].datalen = datalen;
+    w->tail++;
+    Pthread_cond_broadcast(&par->cond);
+    Pthread_mutex_unlock(&par->lk);
+    return 0;
+}
+
+/* Tables are dealt to workers round robin in the order they show up. */
+static struct par_apply_worker *par_apply_route(struct par_apply *par,
+                                                const char *tablename)
+{
+    struct dbtable *db = get_dbtable_by_name(tablename);
+    int i;
+
+    if (!db || db->n_constraints)
+        return NULL;
+    for (i = 0; i < par->ntables; i++) {
+        if (par->tables[i] == db)
+            return &par->workers[i % par->nworkers];
+    }
+    if (par->ntables == PAR_APPLY_MAX_TABLES)
+        return NULL;
+    par->tables[par->ntables++] = db;
+    return &par->workers[i % par->nworkers];
+}
+
+/* Returns -1 if nothing was applied and the caller has to fall back to
+   serial apply, ERR_NOMASTER if the master is going away, otherwise the
+   result of the closing op, which runs in the parent once the children are
+   committed into it. */
+static int par_apply_session(struct ireq *iq, void *iq_tran,
+                             osql_sess_t *sess, int *bdberr, int *nops,
+                             struct block_err *err, SBUF2 *logsb,
+                             struct temp_cursor *dbc,
+                             struct temp_cursor *dbc_ins,
+                             osql_apply_func_t func)
+{
+    struct par_apply par = {{{0}}};
+    struct par_apply_worker *cur = NULL;
+    blob_buffer_t blobs[MAXBLOBS] = {{0}};
+    int *updCols = NULL;
+    int flags = 0, receivedrows = 0;
+    int written_row_count = iq->written_row_count;
+    int nworkers = gbl_osql_parallel_apply_threads;
+    int i, rc, out_rc = 0, started = 0, ndispatched = 0;
+    char *done = NULL;
+    int donelen = 0;
+
+    if (nworkers > PAR_APPLY_MAX_THREADS)
+        nworkers = PAR_APPLY_MAX_THREADS;
+
+    Pthread_mutex_init(&par.lk, NULL);
+    Pthread_cond_init(&par.cond, NULL);
+    par.rqid = osql_sess_getrqid(sess);
+    osql_sess_getuuid(sess, par.uuid);
+    par.func = func;
+    par.nworkers = nworkers;
+    par.workers = calloc(nworkers, sizeof(struct par_apply_worker));
+    if (!par.workers) {
+        out_rc = -1;
+        goto cleanup;
+    }
+
+    /* children are begun (and ended) here: berkdb does not let siblings
+       change their parent's list of kids concurrently */
+    for (i = 0; i < nworkers; i++) {
+        struct par_apply_worker *w = &par.workers[i];
+        w->par = &par;
+        w->iq = *iq;
+        w->iq.usedb = NULL;
+        w->iq.idxInsert = w->iq.idxDelete = NULL;
+        w->iq.debug = 0;
+        w->iq.reqlogger = NULL; /* the request logger is not thread safe */
+        if (trans_start_set_retries(iq, iq_tran, &w->trans, 0) != 0) {
+            w->trans = NULL;
+            out_rc = -1;
+            goto cleanup;
+        }
+    }
+    for (i = 0; i < nworkers; i++) {
+        if (pthread_create(&par.workers[i].tid, &gbl_pthread_attr,
+                           par_apply_worker_thd, &par.workers[i]) != 0) {
+            Pthread_mutex_lock(&par.lk);
+            par.failed = 1;
+            Pthread_cond_broadcast(&par.cond);
+            Pthread_mutex_unlock(&par.lk);
+            out_rc = -1;
+            break;
+        }
+        started++;
+    }
+
+    rc = bdb_temp_table_first(thedb->bdb_env, dbc, bdberr);
+    oplog_key_t *opkey = rc ? NULL : (oplog_key_t *)bdb_temp_table_key(dbc);
+    oplog_key_t *opkey_ins = NULL;
+    uint8_t add_stripe = 0;
+    bool drain_adds = false;
+    if (!rc)
+        rc = init_ins_tbl(iq->reqlogger, dbc_ins, &opkey_ins, &add_stripe,
+                          bdberr);
+
+    while (!rc && !out_rc) {
+        char *data = NULL;
+        int datalen = 0;
+        int type = 0;
+        const uint8_t *p_buf;
+
+        get_tmptbl_data_and_len(dbc, dbc_ins, drain_adds, &data, &datalen);
+        bdb_temp_table_reset_datapointers(drain_adds ? dbc_ins : dbc);
+
+        if (bdb_lock_desired(thedb->bdb_env)) {
+            free(data);
+            out_rc = ERR_NOMASTER;
+            break;
+        }
+
+        p_buf = (const uint8_t *)data;
+        buf_get(&type, sizeof(type), p_buf, p_buf + sizeof(type));
+
+        switch (type) {
+        case OSQL_USEDB: {
+            extern const char *get_tablename_from_rpl(const char *rpl);
+            cur = par_apply_route(&par, get_tablename_from_rpl(data));
+            if (!cur) {
+                free(data);
+                out_rc = -1;
+                break;
+            }
+        } /* FALL THROUGH: the worker needs the usedb too */
+        case OSQL_INSREC:
+        case OSQL_INSERT:
+        case OSQL_INSIDX:
+        case OSQL_DELIDX:
+        case OSQL_QBLOB:
+            if (!cur || par_apply_enqueue(&par, cur, data, datalen))
+                out_rc = -1;
+            else
+                ndispatched++;
+            break;
+        case OSQL_STARTGEN:
+            /* no transaction work, check it in place */
+            rc = func(iq, par.rqid, par.uuid, iq_tran, &data, datalen, &flags,
+                      &updCols, blobs, 0, err, &receivedrows, NULL);
+            free(data);
+            if (rc)
+                out_rc = -1;
+            break;
+        case OSQL_DONE:
+        case OSQL_DONE_SNAP:
+        case OSQL_DONE_STATS:
+            done = data;
+            donelen = datalen;
+            break;
+        default:
+            free(data);
+            out_rc = -1;
+            break;
+        }
+        if (done || out_rc)
+            break;
+
+        rc = get_next_merge_tmps(dbc, dbc_ins, &opkey, &opkey_ins, &drain_adds,
+                                 bdberr, add_stripe);
+    }
+    if (rc && rc != IX_PASTEOF && rc != IX_EMPTY && rc != IX_NOTFND)
+        out_rc = -1;
+
+    Pthread_mutex_lock(&par.lk);
+    if (out_rc || !done)
+        par.failed = 1;
+    par.eof = 1;
+    Pthread_cond_broadcast(&par.cond);
+    Pthread_mutex_unlock(&par.lk);
+
+    for (i = 0; i < started; i++)
+        pthread_join(par.workers[i].tid, NULL);
+
+    if (!out_rc && !done)
+        out_rc = -1;
+    for (i = 0; i < nworkers && !out_rc; i++) {
+        if (par.workers[i].rc)
+            out_rc = -1;
+        iq->written_row_count += par.workers[i].iq.written_row_count -
+                                 written_row_count;
+        receivedrows += par.workers[i].receivedrows;
+    }
+    if (!out_rc && gbl_max_wr_rows_per_txn &&
+        iq->written_row_count > gbl_max_wr_rows_per_txn)
+        out_rc = -1;
+
+cleanup:
+    for (i = 0; par.workers && i < nworkers; i++) {
+        if (!par.workers[i].trans)
+            continue;
+        if (out_rc)
+            rc = trans_abort(iq, par.workers[i].trans);
+        else
+            rc = trans_commit(iq, par.workers[i].trans, gbl_mynode);
+        if (rc) {
+            logmsg(LOGMSG_ERROR, "%s: failed to %s child rc=%d\n", __func__,
+                   out_rc ? "abort" : "commit", rc);
+            if (!out_rc) {
+                /* siblings already merged into the parent cannot be backed
+                   out alone; let the whole transaction retry */
+                out_rc = RC_INTERNAL_RETRY;
+            }
+        }
+    }
+
+    if (out_rc == -1 || out_rc == ERR_NOMASTER) {
+        iq->written_row_count = written_row_count;
+    } else if (!out_rc) {
+        ATOMIC_ADD(par_apply_count, 1);
+        ATOMIC_ADD(par_apply_ops, ndispatched);
+        out_rc = func(iq, par.rqid, par.uuid, iq_tran, &done, donelen, &flags,
+                      &updCols, blobs, ndispatched, err, &receivedrows, logsb);
+        if (out_rc == OSQL_RC_DONE) {
+            *nops += receivedrows;
+            out_rc = 0;
+        }
+    }
+    free(done);
+
+    free_blob_buffers(blobs, MAXBLOBS);
+    free(updCols);
+    free(par.workers);
+    Pthread_cond_destroy(&par.cond);
+    Pthread_mutex_destroy(&par.lk);
+    return out_rc;
+}
+
 static int apply_changes(struct ireq *iq, blocksql_tran_t *tran, void *iq_tran,
                          int *nops, struct block_err *err, SBUF2 *logsb,
                          int (*func)(struct ireq *, unsigned long long, uuid_t,
@@ -1464,8 +1910,26 @@ static int apply_changes(struct ireq *iq, blocksql_tran_t *tran, void *iq_tran,
 
     /* go through the complete list and apply all the changes */
     if (tran->iscomplete) {
-        out_rc = process_this_session(iq, iq_tran, tran->sess, &bdberr, nops,
-                                      err, logsb, dbc, dbc_ins, func);
+        out_rc = -1;
+        if (par_apply_eligible(iq, tran, iq_tran)) {
+            bplog_set_reqlog(iq, tran->sess);
+            out_rc = par_apply_session(iq, iq_tran, tran->sess, &bdberr, nops,
+                                       err, logsb, dbc, dbc_ins, func);
+            if (out_rc == ERR_NOMASTER) {
+                logmsg(LOGMSG_ERROR,
+                       "%lu %s:%d blocksql session closing early\n",
+                       pthread_self(), __FILE__, __LINE__);
+                err->blockop_num = 0;
+                err->errcode = ERR_NOMASTER;
+                err->ixnum = 0;
+                reqlog_set_error(iq->reqlogger, "ERR_NOMASTER", ERR_NOMASTER);
+            } else if (out_rc == -1) {
+                ATOMIC_ADD(par_apply_fallbacks, 1);
+            }
+        }
+        if (out_rc == -1)
+            out_rc = process_this_session(iq, iq_tran, tran->sess, &bdberr,
+                                          nops, err, logsb, dbc, dbc_ins, func);
     }
 
     Pthread_mutex_unlock(&tran->store_mtx);
@@ -143,6 +143,12 @@ void osql_bplog_setlimit(int limit);
  */
 int osql_bplog_reqlog_queries(struct ireq *iq);
 
+/**
+ * Print parallel bplog apply counters
+ *
+ */
+void osql_bplog_parallel_apply_stat(void);
+
 /**
  * Debugging support
  * Prints all the timings recorded for this bplog
@@ -46,6 +46,8 @@
 #include <strbuf.h>
 #include <logmsg.h>
 #include "views.h"
+#include "comdb2_atomic.h"
+#include "bdb_api.h"
 #include "str0.h"
 #include "sc_struct.h"
 #include <compat.h>
@@ -2845,6 +2847,39 @@ static inline int osql_nettype_is_uuid(int type)
 
 static osql_stats_t stats[OSQL_MAX_REQ] = {{0}};
 
+/* Row ops bound for a remote master are collected per client into frames
+   of at most gbl_osql_frame_bytes and shipped as one NET_OSQL_FRAME.  The
+   frame hangs off clnt->osql, so it follows the transaction from one sql
+   thread to the next.  Any other message sent for the client flushes the
+   pending frame first, so the master still sees the ops in order.  A frame
+   is:
+     header: version, flags, usertype, nops, rawlen, wirelen
+     body:   nops x (oplen, op), LZ4'd if OSQL_FRAME_LZ4 is set
+ */
+#define OSQL_FRAME_VERSION 1
+#define OSQL_FRAME_LZ4 0x1
+#define OSQL_FRAME_HDR_LEN (6 * sizeof(int))
+#define OSQL_FRAME_MIN_COMPRESS 512
+
+struct osql_frame {
+    const char *host;
+    int usertype;
+    int nops;
+    int len; /* header included */
+    int alloc;
+    uint8_t *buf;
+};
+
+static struct osql_frame_stats {
+    int64_t snd_frames;
+    int64_t snd_ops;
+    int64_t snd_rawbytes;
+    int64_t snd_wirebytes;
+    int64_t rcv_frames;
+    int64_t rcv_ops;
+    int64_t rcv_failed;
+} frame_stats;
+
 /* echo service */
 #define MAX_ECHOES 256
 #define MAX_LATENCY 1000
@@ -2909,6 +2944,12 @@ static int osql_check_version(int type);
 static int offload_net_send_tails(const char *host, int usertype, void *data,
                                   int datalen, int nodelay, int ntails,
                                   void **tails, int *tailens);
+static int osql_frame_send(const char *host, int usertype, void *data,
+                           int datalen, void *tail, int tailen);
+static int osql_frame_flush_pending(struct osql_frame *f);
+static void net_osql_frame(void *hndl, void *uptr, char *fromnode,
+                           int usertype, void *dtap, int dtalen,
+                           uint8_t is_tcp);
 static int get_blkout(time_t now, char *nodes[REPMAX], int *nds);
 
 static int sorese_rcvreq(char *fromhost, void *dtap, int dtalen, int type,
@@ -3066,6 +3107,9 @@ int osql_comm_init(struct dbenv *dbenv)
     net_register_handler(tmp->handle_sibling, NET_OSQL_MASTER_CHECKED_UUID,
                          "osql_master_checked_uuid", net_osql_master_checked);
 
+    net_register_handler(tmp->handle_sibling, NET_OSQL_FRAME, "osql_frame",
+                         net_osql_frame);
+
     /* this guy will terminate pending requests */
     net_register_hostdown(tmp->handle_sibling, net_osql_nodedwn);
 
@@ -3755,7 +3799,7 @@ int osql_send_updcols(char *tohost, unsigned long long rqid, uuid_t uuid,
         sbuf2flush(logsb);
     }
 
-    rc = offload_net_send(tohost, type, buf, totlen, 0);
+    rc = osql_frame_send(tohost, type, buf, totlen, NULL, 0);
 
     if (didmalloc)
         free(buf);
@@ -3835,9 +3879,8 @@ int osql_send_index(char *tohost, unsigned long long rqid, uuid_t uuid,
         sbuf2flush(logsb);
     }
 
-    rc = (nData > 0)
-             ? offload_net_send_tail(tohost, type, buf, msglen, 0, pData, nData)
-             : offload_net_send(tohost, type, buf, msglen, 0);
+    rc = (nData > 0) ? osql_frame_send(tohost, type, buf, msglen, pData, nData)
+                     : osql_frame_send(tohost, type, buf, msglen, NULL, 0);
 
     return rc;
 }
@@ -3945,10 +3988,10 @@ int osql_send_qblob(char *tohost, unsigned long long rqid, uuid_t uuid,
 #endif
 
     if (datalen > sent)
-        rc = offload_net_send_tail(tohost, type, buf, msgsz, 0, data + sent,
-                                   datalen - sent);
+        rc = osql_frame_send(tohost, type, buf, msgsz, data + sent,
+                             datalen - sent);
     else
-        rc = offload_net_send(tohost, type, buf, msgsz, 0);
+        rc = osql_frame_send(tohost, type, buf, msgsz, NULL, 0);
 
     return rc;
 }
@@ -4052,9 +4095,9 @@ int osql_send_updrec(char *tohost, unsigned long long rqid, uuid_t uuid,
         sbuf2flush(logsb);
     }
 
-    rc = (nData > sent) ? offload_net_send_tail(tohost, type, &buf, msgsz, 0,
-                                                pData + sent, nData - sent)
-                        : offload_net_send(tohost, type, &buf, msgsz, 0);
+    rc = (nData > sent) ? osql_frame_send(tohost, type, &buf, msgsz,
+                                          pData + sent, nData - sent)
+                        : osql_frame_send(tohost, type, &buf, msgsz, NULL, 0);
 
     return rc;
 }
@@ -4329,9 +4372,9 @@ int osql_send_insrec(char *tohost, unsigned long long rqid, uuid_t uuid,
         sbuf2flush(logsb);
     }
 
-    rc = (nData > sent) ? offload_net_send_tail(tohost, type, buf, msglen, 0,
-                                                pData + sent, nData - sent)
-                        : offload_net_send(tohost, type, buf, msglen, 0);
+    rc = (nData > sent) ? osql_frame_send(tohost, type, buf, msglen,
+                                          pData + sent, nData - sent)
+                        : osql_frame_send(tohost, type, buf, msglen, NULL, 0);
 
     return rc;
 }
@@ -4450,7 +4493,7 @@ int osql_send_delrec(char *tohost, unsigned long long rqid, uuid_t uuid,
         sbuf2flush(logsb);
     }
 
-    rc = offload_net_send(tohost, type, &buf, msgsz, 0);
+    rc = osql_frame_send(tohost, type, &buf, msgsz, NULL, 0);
 
     return rc;
 }
@@ -5354,9 +5397,24 @@ int osql_comm_quick_stat(void)
                reqtypes[i], stats[i].snd, stats[i].snd_failed, stats[i].rcv,
                stats[i].rcv_failed, stats[i].rcv_rdndt);
     }
+    logmsg(LOGMSG_USER,
+           "osql frames snd %" PRId64 " ops %" PRId64 " bytes %" PRId64
+           " wire %" PRId64 " rcv %" PRId64 " ops %" PRId64 " failed %" PRId64
+           "\n",
+           frame_stats.snd_frames, frame_stats.snd_ops,
+           frame_stats.snd_rawbytes, frame_stats.snd_wirebytes,
+           frame_stats.rcv_frames, frame_stats.rcv_ops,
+           frame_stats.rcv_failed);
     return 0;
 }
 
+void osql_comm_frame_stats(int64_t *frames, int64_t *ops, int64_t *bytes_saved)
+{
+    *frames = frame_stats.snd_frames;
+    *ops = frame_stats.snd_ops;
+    *bytes_saved = frame_stats.snd_rawbytes - frame_stats.snd_wirebytes;
+}
+
 int osql_comm_diffstat(struct reqlogger *statlogger, int *have_scon_header)
 {
     static osql_stats_t last[OSQL_MAX_REQ], diff[OSQL_MAX_REQ];
@@ -5932,6 +5990,153 @@ out:
     return rc;
 }
 
+static int osql_frame_flush(struct osql_frame *f)
+{
+    uint8_t *wire = f->buf;
+    uint8_t *zbuf = NULL;
+    uint8_t *p_buf, *p_buf_end;
+    int version = OSQL_FRAME_VERSION;
+    int flags = 0;
+    int nops = f->nops;
+    int rawlen = f->len - OSQL_FRAME_HDR_LEN;
+    int wirelen = rawlen;
+    int rc;
+
+    if (nops == 0)
+        return 0;
+
+    /* reset first; the send below must not see a pending frame */
+    f->nops = 0;
+    f->len = 0;
+
+    if (gbl_osql_frame_compress && rawlen >= OSQL_FRAME_MIN_COMPRESS) {
+        zbuf = malloc(OSQL_FRAME_HDR_LEN + rawlen);
+        if (zbuf) {
+            int zlen = bdb_compress_lz4(f->buf + OSQL_FRAME_HDR_LEN, rawlen,
+                                        zbuf + OSQL_FRAME_HDR_LEN, rawlen - 1);
+            if (zlen > 0) {
+                wire = zbuf;
+                wirelen = zlen;
+                flags |= OSQL_FRAME_LZ4;
+            }
+        }
+    }
+
+    p_buf = wire;
+    p_buf_end = wire + OSQL_FRAME_HDR_LEN;
+    p_buf = buf_put(&version, sizeof(version), p_buf, p_buf_end);
+    p_buf = buf_put(&flags, sizeof(flags), p_buf, p_buf_end);
+    p_buf = buf_put(&f->usertype, sizeof(f->usertype), p_buf, p_buf_end);
+    p_buf = buf_put(&nops, sizeof(nops), p_buf, p_buf_end);
+    p_buf = buf_put(&rawlen, sizeof(rawlen), p_buf, p_buf_end);
+    p_buf = buf_put(&wirelen, sizeof(wirelen), p_buf, p_buf_end);
+
+    rc = offload_net_send(f->host, NET_OSQL_FRAME, wire,
+                          OSQL_FRAME_HDR_LEN + wirelen, 0);
+    free(zbuf);
+
+    if (rc == 0) {
+        ATOMIC_ADD(frame_stats.snd_frames, 1);
+        ATOMIC_ADD(frame_stats.snd_ops, nops);
+        ATOMIC_ADD(frame_stats.snd_rawbytes, rawlen);
+        ATOMIC_ADD(frame_stats.snd_wirebytes, wirelen);
+    }
+    return rc;
+}
+
+/* Frame of the client running on this sql thread, if any */
+static struct osql_frame *osql_frame_get(int create)
+{
+    struct sql_thread *thd = pthread_getspecific(query_info_key);
+    struct sqlclntstate *clnt = thd ? thd->clnt : NULL;
+
+    if (!clnt)
+        return NULL;
+    if (!clnt->osql.frame && create)
+        clnt->osql.frame = calloc(1, sizeof(struct osql_frame));
+    return clnt->osql.frame;
+}
+
+void osql_comm_frame_discard(struct sqlclntstate *clnt)
+{
+    struct osql_frame *f = clnt->osql.frame;
+
+    if (!f)
+        return;
+    free(f->buf);
+    free(f);
+    clnt->osql.frame = NULL;
+}
+
+/* Ship what the client has batched and drop the buffer; called before any
+   message that is not framed, which is usually the end of a transaction. */
+static int osql_frame_flush_pending(struct osql_frame *f)
+{
+    int rc = osql_frame_flush(f);
+
+    free(f->buf);
+    f->buf = NULL;
+    f->alloc = 0;
+    return rc;
+}
+
+static int osql_frame_send(const char *host, int usertype, void *data,
+                           int datalen, void *tail, int tailen)
+{
+    struct osql_frame *f;
+    int oplen = datalen + tailen;
+    int need = sizeof(int) + oplen;
+    uint8_t *p_buf, *p_buf_end;
+    int rc;
+
+    if (host == gbl_mynode)
+        host = NULL;
+
+    /* local requests are routed in-process, nothing to save */
+    if (gbl_osql_frame_bytes <= 0 || !host ||
+        OSQL_FRAME_HDR_LEN + need > gbl_osql_frame_bytes)
+        goto unframed;
+
+    if ((f = osql_frame_get(1)) == NULL)
+        goto unframed;
+
+    if (f->nops && (f->host != host || f->usertype != usertype ||
+                    f->len + need > gbl_osql_frame_bytes)) {
+        if ((rc = osql_frame_flush(f)) != 0)
+            return rc;
+    }
+
+    if (f->nops == 0) {
+        f->host = host;
+        f->usertype = usertype;
+        f->len = OSQL_FRAME_HDR_LEN;
+    }
+
+    if (f->len + need > f->alloc) {
+        uint8_t *buf = realloc(f->buf, gbl_osql_frame_bytes);
+        if (!buf)
+            goto unframed;
+        f->buf = buf;
+        f->alloc = gbl_osql_frame_bytes;
+    }
+
+    p_buf = f->buf + f->len;
+    p_buf_end = f->buf + f->alloc;
+    p_buf = buf_put(&oplen, sizeof(oplen), p_buf, p_buf_end);
+    p_buf = buf_no_net_put(data, datalen, p_buf, p_buf_end);
+    if (tailen > 0)
+        p_buf = buf_no_net_put(tail, tailen, p_buf, p_buf_end);
+    f->len += need;
+    f->nops++;
+    return 0;
+
+unframed:
+    /* offload_net_send* flush a pending frame first */
+    return (tailen > 0) ? offload_net_send_tail(host, usertype, data, datalen,
+                                                0, tail, tailen)
+                        : offload_net_send(host, usertype, data, datalen, 0);
+}
+
 /* this wrapper tries to provide a reliable net_send that will prevent loosing
    packets
    due to queue being full */
@@ -5946,6 +6151,13 @@ static int offload_net_send(const char *host, int usertype, void *data,
         }
     }
 
+    struct osql_frame *f = osql_frame_get(0);
+    if (f && f->nops) {
+        int frc = osql_frame_flush_pending(f);
+        if (frc)
+            return frc;
+    }
+
     if (host == gbl_mynode)
         host = NULL;
 
@@ -6054,6 +6266,11 @@ static int offload_net_send_tails(const char *host, int usertype, void *data,
     int unknownerror_retry = 0;
     int rc = -1;
 
+    struct osql_frame *f = osql_frame_get(0);
+    if (f && f->nops && (rc = osql_frame_flush_pending(f)) != 0)
+        return rc;
+    rc = -1;
+
     while (rc) {
         if (host == gbl_mynode)
             host = NULL;
@@ -6229,6 +6446,122 @@ static void net_osql_rpl(void *hndl, void *uptr, char *fromnode, int usertype,
         stats[netrpl2req(usertype)].rcv_rdndt++;
 }
 
+/* Master side of osql_frame_send: unpack the ops of a frame and save each
+   run that belongs to one session with a single session lookup. */
+static void net_osql_frame(void *hndl, void *uptr, char *fromnode,
+                           int usertype, void *dtap, int dtalen, uint8_t is_tcp)
+{
+    const uint8_t *p_buf = dtap;
+    const uint8_t *p_buf_end = p_buf + dtalen;
+    uint8_t *raw = NULL;
+    int version, flags, optype, nops, rawlen, wirelen;
+    int *types = NULL, *lens = NULL;
+    void **ops = NULL;
+    unsigned long long *rqids = NULL;
+    uuid_t *uuids = NULL;
+    int i, j, req, found, rc = 0;
+
+    p_buf = buf_get(&version, sizeof(version), p_buf, p_buf_end);
+    p_buf = buf_get(&flags, sizeof(flags), p_buf, p_buf_end);
+    p_buf = buf_get(&optype, sizeof(optype), p_buf, p_buf_end);
+    p_buf = buf_get(&nops, sizeof(nops), p_buf, p_buf_end);
+    p_buf = buf_get(&rawlen, sizeof(rawlen), p_buf, p_buf_end);
+    p_buf = buf_get(&wirelen, sizeof(wirelen), p_buf, p_buf_end);
+    if (!p_buf || version != OSQL_FRAME_VERSION || nops <= 0 ||
+        rawlen < nops * (int)sizeof(int) || wirelen != p_buf_end - p_buf) {
+        logmsg(LOGMSG_ERROR, "%s: malformed frame from %s\n", __func__,
+               fromnode);
+        ATOMIC_ADD(frame_stats.rcv_failed, 1);
+        return;
+    }
+    req = netrpl2req(optype);
+
+    if (flags & OSQL_FRAME_LZ4) {
+        raw = malloc(rawlen);
+        if (!raw || bdb_decompress_lz4(p_buf, wirelen, raw, rawlen)) {
+            logmsg(LOGMSG_ERROR, "%s: failed to decompress frame from %s\n",
+                   __func__, fromnode);
+            rc = -1;
+            goto done;
+        }
+        p_buf = raw;
+        p_buf_end = raw + rawlen;
+    } else if (rawlen != wirelen) {
+        rc = -1;
+        goto done;
+    }
+
+    types = malloc(nops * sizeof(int));
+    lens = malloc(nops * sizeof(int));
+    ops = malloc(nops * sizeof(void *));
+    rqids = malloc(nops * sizeof(unsigned long long));
+    uuids = malloc(nops * sizeof(uuid_t));
+    if (!types || !lens || !ops || !rqids || !uuids) {
+        rc = -1;
+        goto done;
+    }
+
+    for (i = 0; i < nops; i++) {
+        p_buf = buf_get(&lens[i], sizeof(lens[i]), p_buf, p_buf_end);
+        if (!p_buf || lens[i] <= 0 || lens[i] > p_buf_end - p_buf) {
+            rc = -1;
+            goto done;
+        }
+        ops[i] = (void *)p_buf;
+
+        if (osql_nettype_is_uuid(optype)) {
+            osql_uuid_rpl_t hdr;
+            if (!osqlcomm_uuid_rpl_type_get(&hdr, p_buf, p_buf + lens[i])) {
+                rc = -1;
+                goto done;
+            }
+            rqids[i] = OSQL_RQID_USE_UUID;
+            comdb2uuidcpy(uuids[i], hdr.uuid);
+            types[i] = hdr.type;
+        } else {
+            osql_rpl_t hdr;
+            if (!osqlcomm_rpl_type_get(&hdr, p_buf, p_buf + lens[i])) {
+                rc = -1;
+                goto done;
+            }
+            rqids[i] = hdr.sid;
+            comdb2uuid_clear(uuids[i]);
+            types[i] = hdr.type;
+        }
+        p_buf += lens[i];
+    }
+
+    ATOMIC_ADD(frame_stats.rcv_frames, 1);
+    ATOMIC_ADD(frame_stats.rcv_ops, nops);
+    stats[req].rcv += nops;
+
+    for (i = 0; i < nops; i = j) {
+        for (j = i + 1; j < nops; j++) {
+            if (rqids[j] != rqids[i] || comdb2uuidcmp(uuids[j], uuids[i]))
+                break;
+        }
+        found = 0;
+        if (osql_sess_rcvops(rqids[i], uuids[i], j - i, &types[i], &ops[i],
+                             &lens[i], &found))
+            stats[req].rcv_failed += j - i;
+        if (!found)
+            stats[req].rcv_rdndt += j - i;
+    }
+
+done:
+    if (rc) {
+        logmsg(LOGMSG_ERROR, "%s: dropping malformed frame from %s\n",
+               __func__, fromnode);
+        ATOMIC_ADD(frame_stats.rcv_failed, 1);
+    }
+    free(uuids);
+    free(rqids);
+    free(ops);
+    free(lens);
+    free(types);
+    free(raw);
+}
+
 static int check_master(const char *tohost)
 {
 
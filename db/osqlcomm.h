@@ -272,6 +272,21 @@ int osql_comm_signal_sqlthr_rc(sorese_info_t *sorese, struct errstat *xerr,
  */
 int osql_comm_quick_stat(void);
 
+/**
+ * Frames and ops shipped by osql_frame_send, and bytes saved by compressing
+ * them
+ *
+ */
+void osql_comm_frame_stats(int64_t *frames, int64_t *ops,
+                           int64_t *bytes_saved);
+
+/**
+ * Drop the ops "clnt" has batched but not shipped yet; used when a session
+ * is started or replayed from scratch, and when the client goes away
+ *
+ */
+void osql_comm_frame_discard(struct sqlclntstate *clnt);
+
 /**
  * Change the rqid and to allow reusing the request
  *
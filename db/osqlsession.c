@@ -595,6 +595,81 @@ int osql_sess_rcvop(unsigned long long rqid, uuid_t uuid, int type, void *data,
     return rc_out ? rc_out : rc;
 }
 
+/**
+ * Handles a run of ops for session "rqid" unpacked from one osql frame.
+ * Same as osql_sess_rcvop, but the session is looked up and checked once
+ * for the whole run.  Frames never carry a done/xerr op.
+ * Return 0 if success
+ * Set found if the session is found or not
+ *
+ */
+int osql_sess_rcvops(unsigned long long rqid, uuid_t uuid, int nops,
+                     int *types, void **data, int *datalens, int *found)
+{
+    int rc = 0;
+    int rc_out = 0;
+    int i;
+
+    osql_sess_t *sess = osql_repository_get(rqid, uuid, 0);
+    if (!sess) {
+        uuidstr_t us;
+        comdb2uuidstr(uuid, us);
+        logmsg(LOGMSG_ERROR,
+               "discarding %d packets for %llx %s, session not found\n", nops,
+               rqid, us);
+        *found = 0;
+        return 0;
+    }
+
+    *found = 1;
+
+    Pthread_mutex_lock(&sess->completed_lock);
+    if (sess->completed || sess->dispatched || sess->terminate) {
+        uuidstr_t us;
+        Pthread_mutex_unlock(&sess->completed_lock);
+        if ((rc = osql_repository_put(sess, 0)) != 0) {
+            logmsg(LOGMSG_ERROR,
+                   "%s:%d osql_repository_put failed with rc %d\n", __func__,
+                   __LINE__, rc);
+        }
+        comdb2uuidstr(uuid, us);
+        logmsg(LOGMSG_INFO,
+               "%s: rqid=%llx, uuid=%s is already done, ignoring packages\n",
+               __func__, rqid, us);
+        return 0;
+    }
+    Pthread_mutex_unlock(&sess->completed_lock);
+
+    for (i = 0; i < nops; i++) {
+        rc_out = osql_bplog_saveop(sess, data[i], datalens[i], rqid, uuid,
+                                   types[i]);
+        if (rc_out)
+            break;
+
+        /* Must increment seq under completed_lock */
+        Pthread_mutex_lock(&sess->completed_lock);
+        if (sess->rqid == rqid || (rqid == OSQL_RQID_USE_UUID &&
+                                   comdb2uuidcmp(sess->uuid, uuid) == 0)) {
+            sess->seq++;
+            sess->last_row = time(NULL);
+        }
+        Pthread_mutex_unlock(&sess->completed_lock);
+    }
+
+    if ((rc = osql_repository_put(sess, 0)) != 0) {
+        logmsg(LOGMSG_ERROR, "%s: osql_repository_put rc =%d\n", __func__, rc);
+    }
+
+    if (rc_out && osql_session_is_sorese(sess))
+        return rc_out;
+
+    if (rc || rc_out) {
+        sess->terminate = OSQL_TERMINATE;
+    }
+
+    return rc_out ? rc_out : rc;
+}
+
 /**
  * Mark the session terminated if the node "arg"
  * machine the provided session "obj",
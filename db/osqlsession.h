@@ -240,6 +240,15 @@ int osql_sess_unlock_complete(osql_sess_t *sess);
 int osql_sess_rcvop(unsigned long long rqid, uuid_t uuid, int type, void *data,
                     int datalen, int *found);
 
+/**
+ * Handles a run of ops for one session unpacked from an osql frame
+ * Return 0 if success
+ * Set found if the session is found or not
+ *
+ */
+int osql_sess_rcvops(unsigned long long rqid, uuid_t uuid, int nops,
+                     int *types, void **data, int *datalens, int *found);
+
 /**
  * If the node "arg" machine the provided session
  * "obj", mark the session terminated
@@ -691,6 +691,9 @@ int osql_sock_start(struct sqlclntstate *clnt, int type, int keep_rqid)
 
     osql->is_reorder_on = gbl_reorder_socksql_no_deadlock;
 
+    /* nothing batched for an earlier session may follow the new one */
+    osql_comm_frame_discard(clnt);
+
     /* lets reset error, this could be a retry */
     osql->xerr.errval = 0;
     osql->xerr.errstr[0] = '\0';
@@ -836,6 +839,9 @@ int osql_sock_restart(struct sqlclntstate *clnt, int maxretries,
         cheap_stack_trace();
     }
 
+    /* ops batched for the aborted attempt must not reach the master */
+    osql_comm_frame_discard(clnt);
+
     do {
         retries++;
         sentops = 0;
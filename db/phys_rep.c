@@ -6,6 +6,8 @@
 #include <string.h>
 #include <pthread.h>
 #include <stdint.h>
+#include <stddef.h>
+#include <inttypes.h>
 #include <unistd.h>
 #include <time.h>
 
@@ -18,6 +20,8 @@
 
 #include <parse_lsn.h>
 #include <logmsg.h>
+#include <locks_wrap.h>
+#include <epochlib.h>
 
 /* internal implementation */
 typedef struct DB_Connection {
@@ -43,7 +47,8 @@ static time_t retry_time = 3;
 static DB_Connection *get_connect(char *hostname);
 static int insert_connect(char *hostname, char *dbname, size_t tier);
 static void delete_connect(DB_Connection *cnct);
-static LOG_INFO handle_record(LOG_INFO prev_info);
+struct physrep_rec;
+static LOG_INFO handle_record(LOG_INFO prev_info, struct physrep_rec *rec);
 static int find_new_repl_db(void);
 static DB_Connection *get_rand_connect(size_t tier);
 static void *keep_in_sync(void *args);
@@ -119,18 +124,295 @@ void close_repl_connection(void)
 int gbl_physrep_register_interval = 3600;
 static int last_register;
 int gbl_blocking_physrep = 0;
+int gbl_physrep_fetch_queue_bytes = 64 * 1024 * 1024;
+int gbl_physrep_checkpoint_ms = 1000;
+
+/* Records are fetched from the source by a fetcher thread and queued for
+ * keep_in_sync, which applies them.  The fetcher starts its next query as
+ * soon as one runs dry instead of waiting for the records to be applied.
+ * Besides log records, the fetcher queues a marker when its stream breaks
+ * so that the apply side can react once everything before it is applied. */
+enum {
+    PHYSREP_REC_LOG = 0,
+    PHYSREP_REC_TRUNCATE,  /* source generation changed, or stream broke */
+    PHYSREP_REC_RECONNECT, /* couldn't query the source */
+};
+
+struct physrep_rec {
+    struct physrep_rec *next;
+    int type;
+    unsigned int file;
+    unsigned int offset;
+    int has_timestamp;
+    int64_t timestamp;
+    int len;
+    uint8_t data[1];
+};
+
+static struct {
+    pthread_mutex_t lk;
+    pthread_cond_t cond;
+    struct physrep_rec *head;
+    struct physrep_rec *tail;
+    int64_t bytes;
+    int count;
+    int stop;
+    int running;
+    pthread_t tid;
+    LOG_INFO start;
+} fetch = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER};
+
+static volatile int64_t highest_gen = 0;
+
+/* Lockless, it's just stats */
+static struct {
+    int64_t queries;
+    int64_t fetched_recs;
+    int64_t fetched_bytes;
+    int64_t applied_recs;
+    int64_t applied_bytes;
+    LOG_INFO fetched;
+    LOG_INFO applied;
+    LOG_INFO durable;
+    int64_t last_timestamp; /* source commit time of the last applied txn */
+    int64_t start_ms;
+} physrep_stats;
+
+static int fetch_stopping(void)
+{
+    return fetch.stop || !do_repl;
+}
 
-static void *keep_in_sync(void *args)
+/* Queue a record, waiting while the queue is over its byte budget. */
+static void fetch_push(struct physrep_rec *rec)
+{
+    Pthread_mutex_lock(&fetch.lk);
+    while (fetch.count > 0 && fetch.bytes >= gbl_physrep_fetch_queue_bytes &&
+           !fetch_stopping())
+        Pthread_cond_wait(&fetch.cond, &fetch.lk);
+    rec->next = NULL;
+    if (fetch.tail)
+        fetch.tail->next = rec;
+    else
+        fetch.head = rec;
+    fetch.tail = rec;
+    fetch.bytes += rec->len;
+    fetch.count++;
+    Pthread_cond_broadcast(&fetch.cond);
+    Pthread_mutex_unlock(&fetch.lk);
+}
+
+static void fetch_push_marker(int type)
+{
+    struct physrep_rec *rec = calloc(1, sizeof(struct physrep_rec));
+    if (rec == NULL) {
+        logmsg(LOGMSG_FATAL, "%s: out of memory\n", __func__);
+        abort();
+    }
+    rec->type = type;
+    fetch_push(rec);
+}
+
+/* Take the next record, waiting up to a second for one. */
+static struct physrep_rec *fetch_pop(void)
+{
+    struct physrep_rec *rec;
+    struct timespec ts;
+
+    Pthread_mutex_lock(&fetch.lk);
+    if (fetch.head == NULL && fetch.running && do_repl) {
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_sec += 1;
+        pthread_cond_timedwait(&fetch.cond, &fetch.lk, &ts);
+    }
+    if ((rec = fetch.head) != NULL) {
+        fetch.head = rec->next;
+        if (fetch.head == NULL)
+            fetch.tail = NULL;
+        fetch.bytes -= rec->len;
+        fetch.count--;
+        Pthread_cond_broadcast(&fetch.cond);
+    }
+    Pthread_mutex_unlock(&fetch.lk);
+    return rec;
+}
+
+/* Turn the current row of repl_db into a queued record. */
+static struct physrep_rec *decode_record(void)
+{
+    struct physrep_rec *rec;
+    char *lsn = (char *)cdb2_column_value(repl_db, 0);
+    int64_t *timestamp = (int64_t *)cdb2_column_value(repl_db, 3);
+    void *blob = cdb2_column_value(repl_db, 4);
+    int blob_len = cdb2_column_size(repl_db, 4);
+
+    rec = malloc(offsetof(struct physrep_rec, data) + blob_len);
+    if (rec == NULL) {
+        logmsg(LOGMSG_FATAL, "%s: out of memory for %d bytes\n", __func__,
+               blob_len);
+        abort();
+    }
+    rec->type = PHYSREP_REC_LOG;
+    rec->len = blob_len;
+    memcpy(rec->data, blob, blob_len);
+    rec->has_timestamp = (timestamp != NULL);
+    rec->timestamp = timestamp ? *timestamp : 0;
+    if (lsn == NULL || char_to_lsn(lsn, &rec->file, &rec->offset) != 0) {
+        logmsg(LOGMSG_ERROR, "Could not parse lsn:%s\n", lsn ? lsn : "null");
+        rec->file = rec->offset = 0;
+    }
+    return rec;
+}
+
+static void *fetch_logs(void *args)
 {
-    /* vars for syncing */
-    int rc;
-    volatile int64_t gen, highest_gen = 0;
     size_t sql_cmd_len = 150;
     char sql_cmd[sql_cmd_len];
+    unsigned int file = fetch.start.file, offset = fetch.start.offset;
+    int rc, nrecs;
+
+    while (!fetch_stopping()) {
+        if (gbl_blocking_physrep) {
+            rc = snprintf(
+                sql_cmd, sql_cmd_len,
+                "select * from comdb2_transaction_logs('{%u:%u}', NULL, 1)",
+                file, offset);
+        } else {
+            rc = snprintf(sql_cmd, sql_cmd_len,
+                          "select * from comdb2_transaction_logs('{%u:%u}')",
+                          file, offset);
+        }
+        if (rc < 0 || rc >= sql_cmd_len)
+            logmsg(LOGMSG_ERROR, "sql_cmd buffer is not long enough!\n");
+
+        physrep_stats.queries++;
+        if ((rc = cdb2_run_statement(repl_db, sql_cmd)) != CDB2_OK) {
+            logmsg(LOGMSG_ERROR, "Couldn't query the database, retrying\n");
+            fetch_push_marker(PHYSREP_REC_RECONNECT);
+            break;
+        }
+
+        /* the first record is the one we already have */
+        if ((rc = cdb2_next_record(repl_db)) != CDB2_OK) {
+            if (gbl_verbose_physrep)
+                logmsg(LOGMSG_USER, "%s can't find the next record\n",
+                       __func__);
+            fetch_push_marker(PHYSREP_REC_RECONNECT);
+            break;
+        }
+
+        nrecs = 0;
+        while (!fetch_stopping() &&
+               (rc = cdb2_next_record(repl_db)) == CDB2_OK) {
+            /* check the generation id to make sure the master hasn't
+             * switched */
+            int64_t *rec_gen = (int64_t *)cdb2_column_value(repl_db, 2);
+            if (rec_gen && *rec_gen > highest_gen) {
+                if (gbl_verbose_physrep) {
+                    logmsg(LOGMSG_USER,
+                           "%s: My master changed, set truncate flag\n",
+                           __func__);
+                    logmsg(LOGMSG_USER,
+                           "%s: highest gen: %" PRId64 ", rec_gen: %" PRId64
+                           "\n",
+                           __func__, highest_gen, *rec_gen);
+                }
+                highest_gen = *rec_gen;
+                fetch_push_marker(PHYSREP_REC_TRUNCATE);
+                goto out;
+            }
+
+            struct physrep_rec *rec = decode_record();
+            file = rec->file;
+            offset = rec->offset;
+            physrep_stats.fetched_recs++;
+            physrep_stats.fetched_bytes += rec->len;
+            physrep_stats.fetched.file = file;
+            physrep_stats.fetched.offset = offset;
+            fetch_push(rec);
+            nrecs++;
+        }
+
+        if (fetch_stopping())
+            break;
+
+        if (rc != CDB2_OK_DONE) {
+            fetch_push_marker(PHYSREP_REC_TRUNCATE);
+            break;
+        }
+
+        /* caught up with the source: poll rather than spin */
+        if (nrecs == 0)
+            sleep(1);
+    }
+
+out:
+    return NULL;
+}
+
+static void start_fetcher(LOG_INFO start)
+{
+    fetch.start = start;
+    fetch.stop = 0;
+    if (pthread_create(&fetch.tid, NULL, fetch_logs, NULL)) {
+        logmsg(LOGMSG_ERROR, "Couldn't create thread to fetch logs\n");
+        return;
+    }
+    fetch.running = 1;
+}
+
+/* Stop the fetcher and drop whatever it fetched but we haven't applied. */
+static void stop_fetcher(void)
+{
+    struct physrep_rec *rec;
+
+    if (!fetch.running)
+        return;
+
+    Pthread_mutex_lock(&fetch.lk);
+    fetch.stop = 1;
+    Pthread_cond_broadcast(&fetch.cond);
+    Pthread_mutex_unlock(&fetch.lk);
+
+    pthread_join(fetch.tid, NULL);
+
+    Pthread_mutex_lock(&fetch.lk);
+    while ((rec = fetch.head) != NULL) {
+        fetch.head = rec->next;
+        free(rec);
+    }
+    fetch.tail = NULL;
+    fetch.bytes = 0;
+    fetch.count = 0;
+    fetch.running = 0;
+    Pthread_mutex_unlock(&fetch.lk);
+}
+
+/* Flush the local log so that restarts resume from what has been applied
+ * rather than fetching it again. */
+static void checkpoint_applied(void)
+{
+    static int64_t last_ckp_ms = 0;
+    int64_t now = comdb2_time_epochms();
+    DB_ENV *dbenv = thedb->bdb_env->dbenv;
+
+    if (now - last_ckp_ms < gbl_physrep_checkpoint_ms)
+        return;
+    last_ckp_ms = now;
+
+    if (dbenv->log_flush(dbenv, NULL) == 0)
+        physrep_stats.durable = physrep_stats.applied;
+}
+
+static void *keep_in_sync(void *args)
+{
+    /* vars for syncing */
+    volatile int64_t gen;
     int do_truncate = 0;
     int now;
     LOG_INFO info;
     LOG_INFO prev_info;
+    struct physrep_rec *rec;
 
     do_repl = 1;
 
@@ -139,11 +421,12 @@ static void *keep_in_sync(void *args)
         sleep(1);
 
     backend_thread_event(thedb, COMDB2_THR_EVENT_START_RDWR);
+    physrep_stats.start_ms = comdb2_time_epochms();
 
-repl_loop:
     while (do_repl) {
         if (repl_db_connected && ((now = time(NULL)) - last_register) >
                                      gbl_physrep_register_interval) {
+            stop_fetcher();
             close_repl_connection();
             if (gbl_verbose_physrep) {
                 logmsg(LOGMSG_USER, "%s: forcing re-registration\n", __func__);
@@ -152,7 +435,6 @@ repl_loop:
         if (repl_db_connected == 0) {
             if (find_new_repl_db() == 0) {
                 /* do truncation to start fresh */
-                info = get_last_lsn(thedb->bdb_env);
                 do_truncate = 1;
             } else {
                 sleep(1);
@@ -161,6 +443,7 @@ repl_loop:
         }
 
         if (do_truncate) {
+            stop_fetcher();
             info = get_last_lsn(thedb->bdb_env);
             prev_info = handle_truncation(repl_db, info);
             if (prev_info.file == 0) {
@@ -177,71 +460,41 @@ repl_loop:
         if (repl_db_connected == 0)
             continue;
 
-        info = get_last_lsn(thedb->bdb_env);
-        if (info.file > 0) {
-            prev_info = info;
-
-            if (gbl_blocking_physrep) {
-                rc = snprintf(
-                    sql_cmd, sql_cmd_len,
-                    "select * from comdb2_transaction_logs('{%u:%u}', NULL, 1)",
-                    info.file, info.offset);
-            } else {
-                rc =
-                    snprintf(sql_cmd, sql_cmd_len,
-                             "select * from comdb2_transaction_logs('{%u:%u}')",
-                             info.file, info.offset);
-            }
-            if (rc < 0 || rc >= sql_cmd_len)
-                logmsg(LOGMSG_ERROR, "sql_cmd buffer is not long enough!\n");
-
-            if ((rc = cdb2_run_statement(repl_db, sql_cmd)) != CDB2_OK) {
-                logmsg(LOGMSG_ERROR, "Couldn't query the database, retrying\n");
-                close_repl_connection();
+        if (!fetch.running) {
+            info = get_last_lsn(thedb->bdb_env);
+            if (info.file == 0) {
+                sleep(1);
                 continue;
             }
-
-            if ((rc = cdb2_next_record(repl_db)) != CDB2_OK) {
-                if (gbl_verbose_physrep)
-                    logmsg(LOGMSG_USER, "%s can't find the next record\n",
-                           __func__);
-                close_repl_connection();
+            prev_info = info;
+            start_fetcher(info);
+            if (!fetch.running) {
+                sleep(1);
                 continue;
             }
+        }
 
-            /* our log matches, so apply each record log received */
-            while (do_repl && !do_truncate &&
-                   (rc = cdb2_next_record(repl_db)) == CDB2_OK) {
-                /* check the generation id to make sure the master hasn't
-                 * switched */
-                int64_t *rec_gen = (int64_t *)cdb2_column_value(repl_db, 2);
-                if (rec_gen && *rec_gen > highest_gen) {
-                    int64_t new_gen = *rec_gen;
-                    if (gbl_verbose_physrep) {
-                        logmsg(LOGMSG_USER,
-                               "%s: My master changed, set "
-                               "truncate flag\n",
-                               __func__);
-                        logmsg(LOGMSG_USER,
-                               "%s: gen: %" PRId64 ", rec_gen: %" PRId64 "\n",
-                               __func__, gen, *rec_gen);
-                    }
-                    do_truncate = 1;
-                    highest_gen = new_gen;
-                    goto repl_loop;
-                }
-                prev_info = handle_record(prev_info);
-            }
+        if ((rec = fetch_pop()) == NULL)
+            continue;
 
-            if (rc != CDB2_OK_DONE || do_truncate) {
-                do_truncate = 1;
-                continue;
-            }
+        switch (rec->type) {
+        case PHYSREP_REC_LOG:
+            prev_info = handle_record(prev_info, rec);
+            checkpoint_applied();
+            break;
+        case PHYSREP_REC_TRUNCATE:
+            do_truncate = 1;
+            stop_fetcher();
+            break;
+        case PHYSREP_REC_RECONNECT:
+            stop_fetcher();
+            close_repl_connection();
+            break;
         }
-
-        sleep(1);
+        free(rec);
     }
 
+    stop_fetcher();
     close_repl_connection();
 
     backend_thread_event(thedb, COMDB2_THR_EVENT_DONE_RDWR);
@@ -249,6 +502,45 @@ repl_loop:
     return NULL;
 }
 
+void physrep_print_stats(void)
+{
+    int64_t secs = (comdb2_time_epochms() - physrep_stats.start_ms) / 1000;
+
+    if (!running) {
+        logmsg(LOGMSG_USER, "physical replication is not running\n");
+        return;
+    }
+    if (secs <= 0)
+        secs = 1;
+
+    logmsg(LOGMSG_USER, "source: %s@%s\n",
+           curr_cnct ? curr_cnct->dbname : "-",
+           curr_cnct ? curr_cnct->hostname : "-");
+    logmsg(LOGMSG_USER, "queries: %" PRId64 "\n", physrep_stats.queries);
+    logmsg(LOGMSG_USER,
+           "records fetched: %" PRId64 " (%" PRId64 " bytes) through {%u:%u}\n",
+           physrep_stats.fetched_recs, physrep_stats.fetched_bytes,
+           physrep_stats.fetched.file, physrep_stats.fetched.offset);
+    logmsg(LOGMSG_USER,
+           "records applied: %" PRId64 " (%" PRId64 " bytes) through {%u:%u}\n",
+           physrep_stats.applied_recs, physrep_stats.applied_bytes,
+           physrep_stats.applied.file, physrep_stats.applied.offset);
+    logmsg(LOGMSG_USER, "durable through: {%u:%u}\n",
+           physrep_stats.durable.file, physrep_stats.durable.offset);
+    logmsg(LOGMSG_USER, "queued: %d records, %" PRId64 " bytes\n",
+           fetch.count, fetch.bytes);
+    logmsg(LOGMSG_USER, "apply rate: %" PRId64 " bytes/sec\n",
+           physrep_stats.applied_bytes / secs);
+    /* lag is the age of the last applied commit while there is more to
+     * apply */
+    if (physrep_stats.fetched.file == physrep_stats.applied.file &&
+        physrep_stats.fetched.offset == physrep_stats.applied.offset)
+        logmsg(LOGMSG_USER, "lag: 0 secs\n");
+    else if (physrep_stats.last_timestamp)
+        logmsg(LOGMSG_USER, "lag: %" PRId64 " secs\n",
+               (int64_t)time(NULL) - physrep_stats.last_timestamp);
+}
+
 int stop_replication()
 {
     do_repl = 0;
@@ -285,37 +577,24 @@ int apply_log_procedure(unsigned int file, unsigned int offset, void *blob,
 }
 
 /* privates */
-static LOG_INFO handle_record(LOG_INFO prev_info)
+static LOG_INFO handle_record(LOG_INFO prev_info, struct physrep_rec *rec)
 {
-    /* vars for 1 record */
-    void *blob;
-    int blob_len;
-    char *lsn;
-    int64_t *timestamp;
     int rc;
-    unsigned int file, offset;
-
-    lsn = (char *)cdb2_column_value(repl_db, 0);
-    timestamp = (int64_t *)cdb2_column_value(repl_db, 3);
-    blob = cdb2_column_value(repl_db, 4);
-    blob_len = cdb2_column_size(repl_db, 4);
+    unsigned int file = rec->file, offset = rec->offset;
 
-    if ((rc = char_to_lsn(lsn, &file, &offset)) != 0) {
-        logmsg(LOGMSG_ERROR, "Could not parse lsn:%s\n", lsn);
-    }
-
-    if (gbl_deferred_phys_flag && timestamp) {
+    if (gbl_deferred_phys_flag && rec->has_timestamp) {
         time_t curr_time = time(NULL);
         /* Change this to sleep only once a second to test the
          * value of tunable */
-        while (do_repl && (*timestamp + gbl_deferred_phys_update) > curr_time) {
+        while (do_repl &&
+               (rec->timestamp + gbl_deferred_phys_update) > curr_time) {
             sleep(1);
             curr_time = time(NULL);
             if (gbl_verbose_physrep) {
                 logmsg(LOGMSG_USER,
-                       "Deferring update, commit-ts %ld, "
+                       "Deferring update, commit-ts %" PRId64 ", "
                        "target %ld\n",
-                       *timestamp, curr_time + gbl_deferred_phys_update);
+                       rec->timestamp, curr_time + gbl_deferred_phys_update);
             }
         }
     }
@@ -328,8 +607,8 @@ static LOG_INFO handle_record(LOG_INFO prev_info)
                            REP_NEWFILE, NULL, 0);
         }
 
-        rc = apply_log(thedb->bdb_env->dbenv, file, offset, REP_LOG, blob,
-                       blob_len);
+        rc = apply_log(thedb->bdb_env->dbenv, file, offset, REP_LOG, rec->data,
+                       rec->len);
     } else {
         logmsg(LOGMSG_WARN, "Been asked to stop, drop LSN {%u:%u}\n", file,
                offset);
@@ -343,7 +622,13 @@ static LOG_INFO handle_record(LOG_INFO prev_info)
     LOG_INFO next_info;
     next_info.file = file;
     next_info.offset = offset;
-    next_info.size = blob_len;
+    next_info.size = rec->len;
+
+    physrep_stats.applied_recs++;
+    physrep_stats.applied_bytes += rec->len;
+    physrep_stats.applied = next_info;
+    if (rec->has_timestamp)
+        physrep_stats.last_timestamp = rec->timestamp;
 
     return next_info;
 }
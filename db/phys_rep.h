@@ -14,6 +14,9 @@ int start_replication();
 
 int stop_replication();
 
+/* fetch/apply progress, lag and throughput */
+void physrep_print_stats(void);
+
 /* expose as a hook for apply_log */
 int apply_log_procedure(unsigned int file, unsigned int offset, void *blob,
                         int blob_len, int newfile);
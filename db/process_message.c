@@ -80,6 +80,7 @@ extern int __berkdb_read_alarm_ms;
 #include <sc_stripes.h>
 #include <sc_global.h>
 #include <logmsg.h>
+#include <dbinc/rep_profile.h>
 
 extern int gbl_exit_alarm_sec;
 extern int gbl_disable_rowlocks_logging;
@@ -132,6 +133,7 @@ void rowlocks_bench(void *, int, int);
 void rowlocks_lock1_bench(void *, int, int);
 void rowlocks_lock2_bench(void *, int, int);
 void commit_bench(void *, int, int);
+void lrucache_bench(int, int, int);
 void bdb_detect(void *);
 void enable_ack_trace(void);
 void disable_ack_trace(void);
@@ -1678,6 +1680,7 @@ clipper_usage:
                    gbl_rowlocks ? "enabled" : "disabled");
             appsock_quick_stat();
             osql_comm_quick_stat();
+            osql_bplog_parallel_apply_stat();
             logmsg(LOGMSG_USER, "elect timeout           %f (%s)\n",
                    (get_elect_time_microsecs() / 1000000.00),
                    gbl_elect_time_secs != 0 ? "local config" : "global config");
@@ -1698,6 +1701,8 @@ clipper_usage:
             analyze_dump_stats();
         } else if (tokcmp(tok, ltok, "iopool") == 0) {
             berkdb_iopool_process_message("stat", 4, 0);
+        } else if (tokcmp(tok, ltok, "iouring") == 0) {
+            berkdb_iouring_stat();
         } else if (tokcmp(tok, ltok, "reqrates") == 0) {
             logmsg(LOGMSG_ERROR, "Service time rates:\n");
             logmsg(LOGMSG_ERROR, "Non-sql requests this minute:\n");
@@ -3222,30 +3227,69 @@ clipper_usage:
                 gbl_slow_rep_process_txn_freq);
     }
 
-    else if (tokcmp(tok, ltok, "netuse") == 0) {
-        unsigned long long read, written, waits, reorders;
+    else if (tokcmp(tok, ltok, "physrep_stats") == 0) {
+        extern void physrep_print_stats(void);
+        physrep_print_stats();
+    } else if (tokcmp(tok, ltok, "netuse") == 0) {
+        unsigned long long read, written, waits, reorders, syscalls, items;
+        unsigned long long nshort;
         int rc;
         const char *hosts[REPMAX];
         int num_nodes;
         rc = net_get_network_usage(thedb->handle_sibling, &written, &read,
                                    &waits, &reorders);
+        net_get_write_syscalls(thedb->handle_sibling, NULL, &syscalls, &items,
+                               &nshort);
         logmsg(LOGMSG_USER, 
             "Read: %llu    Written: %llu    Throttles: %llu   Reorders: %llu\n",
             read, written, waits, reorders);
+        logmsg(LOGMSG_USER,
+               "Write syscalls: %llu    Per MB: %.2f    Writev items: %llu    "
+               "Short writevs: %llu\n",
+               syscalls, written ? syscalls * 1048576.0 / written : 0.0, items,
+               nshort);
         num_nodes = net_get_all_nodes(thedb->handle_sibling, hosts);
         if (num_nodes > 0) {
             int i;
             const char *host;
-            logmsg(LOGMSG_USER, "%5s %15s %15s %15s %15s\n", "Node", "Read", "Written",
-                   "Throttles", "Reorders");
+            logmsg(LOGMSG_USER, "%5s %15s %15s %15s %15s %15s\n", "Node", "Read",
+                   "Written", "Throttles", "Reorders", "Syscalls/MB");
             for (i = 0; i < num_nodes; i++) {
                 host = hosts[i];
                 rc = net_get_host_network_usage(thedb->handle_sibling, host,
                                                 &written, &read, &waits,
                                                 &reorders);
                 if (rc == 0)
-                    logmsg(LOGMSG_USER, "%20s %15llu %15llu %15llu %15llu\n", host, read,
-                           written, waits, reorders);
+                    rc = net_get_write_syscalls(thedb->handle_sibling, host,
+                                                &syscalls, &items, &nshort);
+                if (rc == 0)
+                    logmsg(LOGMSG_USER,
+                           "%20s %15llu %15llu %15llu %15llu %15.2f\n", host,
+                           read, written, waits, reorders,
+                           written ? syscalls * 1048576.0 / written : 0.0);
+            }
+        }
+        unsigned long long zframes, zin, zout, zus, uframes, uin, uout, uus;
+        rc = net_get_compress_stats(thedb->handle_sibling, NULL, &zframes, &zin,
+                                    &zout, &zus, &uframes, &uin, &uout, &uus);
+        if (rc == 0 && (zframes || uframes) && num_nodes > 0) {
+            int i;
+            const char *host;
+            logmsg(LOGMSG_USER, "%5s %15s %15s %10s %12s %15s %10s %12s\n",
+                   "Node", "Sent-frames", "Sent-bytes", "Ratio", "Compress-us",
+                   "Recv-frames", "Ratio", "Inflate-us");
+            for (i = 0; i < num_nodes; i++) {
+                host = hosts[i];
+                rc = net_get_compress_stats(thedb->handle_sibling, host,
+                                            &zframes, &zin, &zout, &zus,
+                                            &uframes, &uin, &uout, &uus);
+                if (rc == 0)
+                    logmsg(LOGMSG_USER,
+                           "%20s %15llu %15llu %10.2f %12llu %15llu %10.2f "
+                           "%12llu\n",
+                           host, zframes, zout,
+                           zout ? (double)zin / zout : 0.0, zus, uframes,
+                           uin ? (double)uout / uin : 0.0, uus);
             }
         }
     } else if (tokcmp(tok, ltok, "sc_del_unused_files_threshold") == 0) {
@@ -4204,6 +4248,9 @@ clipper_usage:
         bdb_dump_logical_tranlist(thedb->bdb_env, stderr);
     } else if (tokcmp(tok, ltok, "clear_rowlocks_stats") == 0) {
         rowlocks_clear_stats();
+    } else if (tokcmp(tok, ltok, "clear_rep_apply_profile") == 0) {
+        __rep_apply_profile_reset();
+        logmsg(LOGMSG_USER, "Cleared replication apply profile\n");
     } else if (tokcmp(tok, ltok, "print_rowlocks_stats") == 0) {
         rowlocks_print_stats(stdout);
     } else if (tokcmp(tok, ltok, "rep_process_txn_trace") == 0) {
@@ -4292,6 +4339,21 @@ clipper_usage:
             commit_bench(thedb->bdb_env, tcnt, cnt);
             Pthread_mutex_unlock(&testguard);
         }
+    } else if (tokcmp(tok, ltok, "lrucache_bench") == 0) {
+        int nthds = 0;
+        int ops = 0;
+        int nkeys = 10000;
+        tok = segtok(line, lline, &st, &ltok);
+        if (ltok > 0) {
+            nthds = toknum(tok, ltok);
+            tok = segtok(line, lline, &st, &ltok);
+            if (ltok > 0)
+                ops = toknum(tok, ltok);
+            tok = segtok(line, lline, &st, &ltok);
+            if (ltok > 0)
+                nkeys = toknum(tok, ltok);
+        }
+        lrucache_bench(nthds, ops, nkeys);
     } else if (tokcmp(tok, ltok, "rowlocks_bench") == 0) {
         int lcnt = 0;
         int pcnt = 0;
@@ -105,6 +105,8 @@ typedef struct fdbtimings {
         total_time; /* total time for doing remote access, synchronous part */
     unsigned long long total_calls; /* total number of remote rcp calls */
     unsigned long long max_call;    /* longest sync call */
+    unsigned long long total_rows;  /* rows fetched from remote cursors */
+    unsigned long long total_bytes; /* bytes fetched from remote cursors */
 } fdbtimings_t;
 
 typedef struct {
@@ -112,6 +114,8 @@ typedef struct {
     genid_t genid;
 } shadbq_t;
 
+struct osql_frame;
+
 typedef struct osqlstate {
 
     /* == sql_thread == */
@@ -130,6 +134,8 @@ typedef struct osqlstate {
     osql_sqlthr_t *
         sess_blocksock; /* pointer to osql thread registration entry */
 
+    struct osql_frame *frame; /* row ops batched but not yet sent to master */
+
     /* == sqlclntstate == */
 
     int count_changes;   /* enable pragma count_changes=1, for rr, sosql, recom,
@@ -701,6 +707,10 @@ struct sqlclntstate {
     int nconns;
     int conns_idx;
     int shard_slice;
+    /* parallel stripe scan: table cursors only visit data stripes
+       [scan_stripe, scan_stripe + scan_nstripes); 0 means all */
+    int scan_stripe;
+    int scan_nstripes;
 
     char *argv0;
     char *stack;
@@ -902,6 +912,7 @@ struct BtCursor {
 
     unsigned long long col_mask; /* tracking first 63 columns, if bit is set,
                                     column is needed */
+    unsigned char has_col_mask;  /* col_mask was set by sqlite */
 
     unsigned long long keyDdl; /* rowid for side DDL row */
     char *dataDdl;             /* DDL row, cached during CREATE operations */
@@ -1020,6 +1031,8 @@ unsigned long long comdb2_table_version(const char *tablename);
 
 int fdb_add_remote_time(BtCursor *pCur, unsigned long long start,
                         unsigned long long end);
+void fdb_add_remote_fetched(BtCursor *pCur, unsigned long long rows,
+                            unsigned long long bytes);
 
 int sqlite3LockStmtTables(sqlite3_stmt *pStmt);
 int sqlite3UnlockStmtTablesRemotes(struct sqlclntstate *clnt);
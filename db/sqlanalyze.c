@@ -37,6 +37,8 @@
 #include <ctrace.h>
 #include <logmsg.h>
 
+extern int gbl_exact_row_counts;
+
 /* amount of thread-memory initialized for this thread */
 #ifndef PER_THREAD_MALLOC
 static int analyze_thread_memory = 1048576;
@@ -471,8 +473,13 @@ int64_t analyze_get_nrecs(int iTable)
     /* grab sampled table descriptor */
     s_ix = find_sampled_index(client, db->tablename, ixnum);
 
-    /* return -1 if not sampled.  Sqlite will use the value it calculated. */
+    /* if not sampled, use the maintained row count if there is one, or
+     * return -1 and sqlite will use the value it calculated. */
     if (!s_ix) {
+        int64_t count;
+        if (gbl_exact_row_counts && !gbl_rowlocks && !db->ix_partial &&
+            bdb_rowcount_get(db->handle, &count) == 0)
+            return count;
         return -1;
     }
 
@@ -725,6 +732,17 @@ static int analyze_table_int(table_descriptor_t *td,
         return TABLE_SKIPPED;
     }
 
+    /* start maintaining the table's row count; later analyzes and the
+     * planner read it instead of counting */
+    if (gbl_exact_row_counts && !gbl_rowlocks) {
+        int64_t count;
+        int bdberr;
+        if (bdb_rowcount_get(tbl->handle, &count) == 1 &&
+            bdb_rowcount_init(tbl->handle, &bdberr) && bdberr != BDBERR_READONLY)
+            logmsg(LOGMSG_ERROR, "%s: failed to build row count for %s, bdberr %d\n",
+                   __func__, td->table, bdberr);
+    }
+
     /* pass flush_resp fsql_write_response in sqlinterfaces.c
      * to catch where write to stdout is occurring put in gdb:
      * b write if 1==$rdi
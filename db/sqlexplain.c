@@ -45,6 +45,7 @@ char hex[] = {'0', '1', '2', '3', '4', '5', '6', '7',
               '8', '9', 'a', 'b', 'c', 'd', 'e', 'f'};
 
 int all_opcodes = 0;
+extern int gbl_fdb_pushdown;
 
 static char *entity_type(struct cursor_info *cinfo)
 {
@@ -795,6 +796,8 @@ void get_one_explain_line(sqlite3 *hndl, strbuf *out, Vdbe *v, int indent,
         strbuf_appendf(out, "R%d = select count(*) from cursor [%d] on ",
                        op->p2, op->p1);
         print_cursor_description(out, &cur[op->p1]);
+        if (cur[op->p1].remote && gbl_fdb_pushdown)
+            strbuf_append(out, " (pushed to remote)");
         break;
     case OP_Savepoint:
         strbuf_appendf(
@@ -1100,11 +1103,16 @@ void get_one_explain_line(sqlite3 *hndl, strbuf *out, Vdbe *v, int indent,
     case OP_CursorHint:
         strbuf_appendf(out, "Cursor [%d] table ", op->p1);
         print_cursor_description(out, &cur[op->p1]);
-        char *descr = sqlite3ExprDescribe(hndl->pVdbe, op->p4.pExpr);
-        strbuf_appendf(out, " hint \"%s\"",
-                       (descr) ? descr : "(expression not parseable, see 592)");
-        if (descr)
-            sqlite3_free(descr);
+        if (op->p4.pExpr) {
+            char *descr = sqlite3ExprDescribe(hndl->pVdbe, op->p4.pExpr);
+            strbuf_appendf(out, " hint \"%s\"",
+                           (descr) ? descr
+                                   : "(expression not parseable, see 592)");
+            if (descr)
+                sqlite3_free(descr);
+        }
+        if (op->p2 && gbl_fdb_pushdown)
+            strbuf_appendf(out, " limit R%d", op->p2);
         break;
     case OP_SorterOpen:
         strbuf_appendf(out, "Open sorter new table with %d field(s) and cursor "
@@ -1187,6 +1195,28 @@ void get_one_explain_line(sqlite3 *hndl, strbuf *out, Vdbe *v, int indent,
 
         strbuf_appendf(out, "Cursor [%d] using column mask %s", op->p1,
                        maskStr);
+
+        /* remote index cursors always fetch only these columns, table
+           cursors do so when pushdown is enabled */
+        if (cur[op->p1].remote &&
+            (gbl_fdb_pushdown || fdb_sqlexplain_is_index(cur[op->p1].rootpage))) {
+            char buf[256];
+            int first = 1;
+
+            strbuf_append(out, ", remote fetches (");
+            for (i = 0; i < 64; i++) {
+                if (!((mask >> i) & 1))
+                    continue;
+                if (i == 63) {
+                    strbuf_appendf(out, "%s...", first ? "" : ", ");
+                    break;
+                }
+                print_field(v, &cur[op->p1], i, buf);
+                strbuf_appendf(out, "%s%s", first ? "" : ", ", buf);
+                first = 0;
+            }
+            strbuf_append(out, ")");
+        }
     } break;
     case OP_OpFuncLoad:
         strbuf_appendf(out, "Load OpFunc P4(%s) into R%d",
@@ -168,7 +168,9 @@ extern int sqldbgflag;
 extern int gbl_notimeouts;
 extern int gbl_move_deadlk_max_attempt;
 extern int gbl_fdb_track;
+extern int gbl_fdb_pushdown;
 extern int gbl_selectv_rangechk;
+extern int gbl_exact_row_counts;
 extern volatile int gbl_schema_change_in_progress;
 
 unsigned long long gbl_sql_deadlock_reconstructions = 0;
@@ -788,6 +790,174 @@ void done_sql_thread(void)
     }
 }
 
+/* Per-schema decode plan: fixed-width fields that are not descending can be
+ * decoded straight into a Mem without going through the generic type
+ * converters.  Everything else takes the DECODE_GENERIC path in get_data. */
+enum {
+    DECODE_GENERIC = 0,
+    DECODE_BINT2,
+    DECODE_BINT4,
+    DECODE_BINT8,
+    DECODE_UINT2,
+    DECODE_UINT4,
+    DECODE_UINT8,
+    DECODE_BREAL4,
+    DECODE_BREAL8,
+    DECODE_DATETIME,
+    DECODE_DATETIMEUS
+};
+
+struct ondisk_decode_plan {
+    int nfields;
+    int has_descend; /* any INDEX_DESCEND field to flip back */
+    uint8_t op[1];
+};
+
+int gbl_ondisk_decode_plan = 1;
+static pthread_mutex_t decode_plan_lk = PTHREAD_MUTEX_INITIALIZER;
+
+static uint8_t decode_plan_op(const struct field *f)
+{
+    if (f->flags & INDEX_DESCEND)
+        return DECODE_GENERIC;
+
+    switch (f->type) {
+    case SERVER_BINT:
+        return f->len == 3 ? DECODE_BINT2
+                           : f->len == 5 ? DECODE_BINT4
+                                         : f->len == 9 ? DECODE_BINT8
+                                                       : DECODE_GENERIC;
+    case SERVER_UINT:
+        return f->len == 3 ? DECODE_UINT2
+                           : f->len == 5 ? DECODE_UINT4
+                                         : f->len == 9 ? DECODE_UINT8
+                                                       : DECODE_GENERIC;
+    case SERVER_BREAL:
+        return f->len == 5 ? DECODE_BREAL4
+                           : f->len == 9 ? DECODE_BREAL8 : DECODE_GENERIC;
+    case SERVER_DATETIME:
+        return f->len == sizeof(server_datetime_t) ? DECODE_DATETIME
+                                                   : DECODE_GENERIC;
+    case SERVER_DATETIMEUS:
+        return f->len == sizeof(server_datetimeus_t) ? DECODE_DATETIMEUS
+                                                     : DECODE_GENERIC;
+    default:
+        return DECODE_GENERIC;
+    }
+}
+
+static struct ondisk_decode_plan *get_decode_plan(struct schema *sc)
+{
+    struct ondisk_decode_plan *plan = sc->decode_plan;
+    int i;
+
+    if (plan)
+        return plan;
+
+    Pthread_mutex_lock(&decode_plan_lk);
+    plan = sc->decode_plan;
+    if (plan == NULL) {
+        plan = malloc(offsetof(struct ondisk_decode_plan, op) +
+                      sc->nmembers + 1);
+        if (plan) {
+            plan->nfields = sc->nmembers;
+            plan->has_descend = 0;
+            for (i = 0; i < sc->nmembers; i++) {
+                plan->op[i] = decode_plan_op(&sc->member[i]);
+                if (sc->member[i].flags & INDEX_DESCEND)
+                    plan->has_descend = 1;
+            }
+            sc->decode_plan = plan;
+        }
+    }
+    Pthread_mutex_unlock(&decode_plan_lk);
+
+    return plan;
+}
+
+/* Decode a non-null fixed-width field; in points at the field header byte.
+ * Returns 1 for values the generic converters have to handle. */
+static inline int decode_fixed(uint8_t op, const uint8_t *in, Mem *m,
+                               const char *tzname)
+{
+    const uint8_t *p = in + 1;
+    uint16_t u2;
+    uint32_t u4;
+    uint64_t u8;
+
+    switch (op) {
+    case DECODE_BINT2:
+        memcpy(&u2, p, sizeof(u2));
+        m->u.i = (int16_t)(ntohs(u2) ^ 0x8000U);
+        m->flags = MEM_Int;
+        break;
+    case DECODE_BINT4:
+        memcpy(&u4, p, sizeof(u4));
+        m->u.i = (int32_t)(ntohl(u4) ^ 0x80000000U);
+        m->flags = MEM_Int;
+        break;
+    case DECODE_BINT8:
+        memcpy(&u8, p, sizeof(u8));
+        m->u.i = (i64)(flibc_ntohll(u8) ^ 0x8000000000000000ULL);
+        m->flags = MEM_Int;
+        break;
+    case DECODE_UINT2:
+        memcpy(&u2, p, sizeof(u2));
+        m->u.i = ntohs(u2);
+        m->flags = MEM_Int;
+        break;
+    case DECODE_UINT4:
+        memcpy(&u4, p, sizeof(u4));
+        m->u.i = ntohl(u4);
+        m->flags = MEM_Int;
+        break;
+    case DECODE_UINT8:
+        memcpy(&u8, p, sizeof(u8));
+        u8 = flibc_ntohll(u8);
+        /* too large for an i64, leave the error to the generic path */
+        if (u8 > INT64_MAX)
+            return 1;
+        m->u.i = (i64)u8;
+        m->flags = MEM_Int;
+        break;
+    case DECODE_BREAL4: {
+        float fval;
+        memcpy(&u4, p, sizeof(u4));
+        ieee4b_to_ieee4(ntohl(u4), &fval);
+        m->u.r = fval;
+        m->flags = MEM_Real;
+        break;
+    }
+    case DECODE_BREAL8:
+        memcpy(&u8, p, sizeof(u8));
+        ieee8b_to_ieee8(flibc_ntohll(u8), &m->u.r);
+        m->flags = MEM_Real;
+        break;
+    case DECODE_DATETIME:
+    case DECODE_DATETIMEUS:
+        bzero(&m->du.dt, sizeof(dttz_t));
+        memcpy(&u8, p, sizeof(u8));
+        u8 = flibc_ntohll(u8);
+        /* a zero header byte marks the old, unbiased datetime format */
+        if (in[0] != 0)
+            u8 ^= 0x8000000000000000ULL;
+        m->du.dt.dttz_sec = (db_time_t)u8;
+        if (op == DECODE_DATETIME) {
+            memcpy(&u2, p + sizeof(db_time_t), sizeof(u2));
+            m->du.dt.dttz_frac = ntohs(u2);
+            m->du.dt.dttz_prec = DTTZ_PREC_MSEC;
+        } else {
+            memcpy(&u4, p + sizeof(db_time_t), sizeof(u4));
+            m->du.dt.dttz_frac = ntohl(u4);
+            m->du.dt.dttz_prec = DTTZ_PREC_USEC;
+        }
+        m->flags = MEM_Datetime;
+        m->tz = (char *)tzname;
+        break;
+    }
+    return 0;
+}
+
 static int ondisk_to_sqlite_tz(struct dbtable *db, struct schema *s, void *inp,
                                int rrn, unsigned long long genid, void *outp,
                                int maxout, int nblobs, void **blob,
@@ -808,6 +978,7 @@ static int ondisk_to_sqlite_tz(struct dbtable *db, struct schema *s, void *inp,
     int ncols = 0;
     int nField;
     int rec_srt_off = gbl_sort_nulls_correctly ? 0 : 1;
+    struct ondisk_decode_plan *plan;
 
     /* Raw index optimization */
     if (pCur && pCur->nCookFields >= 0)
@@ -892,7 +1063,8 @@ static int ondisk_to_sqlite_tz(struct dbtable *db, struct schema *s, void *inp,
 
 done:
     /* revert back the flipped fields */
-    for (i = 0; i < nField; i++) {
+    plan = get_decode_plan(s);
+    for (i = 0; i < nField && (!plan || plan->has_descend); i++) {
         f = &s->member[i];
         if (f->flags & INDEX_DESCEND) {
             xorbuf(in + f->offset + rec_srt_off, f->len - rec_srt_off);
@@ -2892,6 +3064,38 @@ static int cursor_move_remote(BtCursor *pCur, int *pRes, int how)
     return SQLITE_OK;
 }
 
+static int cursor_count_remote(BtCursor *pCur, long long *count)
+{
+    struct sqlclntstate *clnt = pCur->clnt;
+    int rc;
+
+    if (authenticate_cursor(pCur, AUTHENTICATE_READ) != 0)
+        return SQLITE_ACCESS;
+
+    rc = pCur->fdbc->count(pCur, count);
+    if (rc == IX_FND) {
+        pCur->nfind++;
+        return SQLITE_OK;
+    } else if (rc == IX_ACCESS) {
+        return SQLITE_ACCESS;
+    } else if (rc == SQLITE_SCHEMA_REMOTE) {
+        clnt->osql.error_is_remote = 1;
+        clnt->osql.xerr.errval = CDB2ERR_ASYNCERR;
+
+        errstat_set_strf(&clnt->osql.xerr,
+                         "schema change table \"%s\" from db \"%s\"",
+                         pCur->fdbc->dbname(pCur), pCur->fdbc->tblname(pCur));
+
+        fdb_clear_sqlite_cache(pCur->sqlite, pCur->fdbc->dbname(pCur),
+                               pCur->fdbc->tblname(pCur));
+
+        return SQLITE_SCHEMA_REMOTE;
+    }
+
+    logmsg(LOGMSG_ERROR, "%s rc %d\n", __func__, rc);
+    return SQLITE_INTERNAL;
+}
+
 static inline int sqlite3VdbeCompareRecordPacked(KeyInfo *pKeyInfo, int k1len,
                                                  const void *key1, int k2len,
                                                  const void *key2)
@@ -6710,6 +6914,21 @@ int get_data(BtCursor *pCur, struct schema *sc, uint8_t *in, int fnum, Mem *m,
     struct field *f = &(sc->member[fnum]);
     void *record = in;
     uint8_t *in_orig = in = in + f->offset;
+    struct ondisk_decode_plan *plan;
+    uint8_t op;
+
+    if (gbl_ondisk_decode_plan && (plan = get_decode_plan(sc)) != NULL &&
+        fnum < plan->nfields && (op = plan->op[fnum]) != DECODE_GENERIC &&
+        (op < DECODE_DATETIME || debug_switch_support_datetimes())) {
+        if (stype_is_null(in)) {
+            m->z = NULL;
+            m->n = 0;
+            m->flags = MEM_Null;
+            return 0;
+        }
+        if (decode_fixed(op, in, m, tzname) == 0)
+            return 0;
+    }
 
     if (f->flags & INDEX_DESCEND) {
         if (gbl_sort_nulls_correctly) {
@@ -7938,6 +8157,10 @@ sqlite3BtreeCursor_remote(Btree *pBt,      /* The btree */
         return SQLITE_ERROR;
     }
 
+    /* count(*) runs on the remote */
+    if (gbl_fdb_pushdown && cur->fdbc->count && cur->fdbc->table_entry(cur))
+        cur->cursor_count = cursor_count_remote;
+
     if (gbl_fdb_track) {
         if (cur->fdbc->isuuid(cur)) {
             uuidstr_t cus, tus;
@@ -8168,6 +8391,11 @@ sqlite3BtreeCursor_cursor(Btree *pBt,      /* The btree */
         return rc;
     }
 
+    /* parallel stripe scan: this engine only sees its share of the table */
+    if (clnt->scan_nstripes && cur->cursor_class == CURSORCLASS_TABLE)
+        bdb_cursor_set_stripes(cur->bdbcur, clnt->scan_stripe,
+                               clnt->scan_nstripes);
+
     if (gbl_expressions_indexes && !clnt->isselect && cur->db->ix_expr) {
         if (!clnt->idxInsert)
             clnt->idxInsert = calloc(MAXINDEX, sizeof(uint8_t *));
@@ -10426,6 +10654,18 @@ int sqlite3BtreeCount(BtCursor *pCur, i64 *pnEntry)
         rc = SQLITE_OK;
     } else if (pCur->cursor_count) {
         rc = pCur->cursor_count(pCur, &count);
+    } else if (gbl_exact_row_counts && !gbl_rowlocks &&
+               !pCur->clnt->intrans &&
+               pCur->clnt->dbtran.mode != TRANLEVEL_SNAPISOL &&
+               pCur->clnt->dbtran.mode != TRANLEVEL_SERIAL &&
+               (pCur->cursor_class == CURSORCLASS_TABLE ||
+                (pCur->cursor_class == CURSORCLASS_INDEX &&
+                 !pCur->db->ix_partial)) &&
+               bdb_rowcount_get(pCur->db->handle, (int64_t *)&count) == 0) {
+        /* every row is in the table and in each non-partial index */
+        rc = SQLITE_OK;
+        pCur->nfind++;
+        thd->cost += pCur->find_cost;
     } else if (gbl_direct_count && !pCur->clnt->intrans &&
                pCur->clnt->dbtran.mode != TRANLEVEL_SNAPISOL &&
                pCur->clnt->dbtran.mode != TRANLEVEL_SERIAL &&
@@ -11041,6 +11281,19 @@ static void sqlite3BtreeCursorHint_Range(BtCursor *pCur, const Expr *pExpr)
     }
 }
 
+static void sqlite3BtreeCursorHint_Limit(BtCursor *pCur, i64 limit,
+                                         int filtered)
+{
+    if (pCur && pCur->bt && pCur->bt->is_remote && pCur->fdbc &&
+        pCur->fdbc->set_limit) {
+        pCur->fdbc->set_limit(pCur, limit, filtered);
+
+        if (gbl_fdb_track_hints)
+            logmsg(LOGMSG_USER, "Limit %lld%s\n", limit,
+                   filtered ? " after hint" : "");
+    }
+}
+
 /*
 ** Provide hints to the cursor.  The particular hint given (and the type
 ** and number of the varargs parameters) is determined by the eHintType
@@ -11073,6 +11326,15 @@ void sqlite3BtreeCursorHint(BtCursor *pCur, int eHintType, ...)
 
         break;
     }
+
+    case BTREE_HINT_LIMIT: {
+        i64 limit = va_arg(ap, i64);
+        int filtered = va_arg(ap, int);
+
+        sqlite3BtreeCursorHint_Limit(pCur, limit, filtered);
+
+        break;
+    }
     }
     va_end(ap);
 }
@@ -11263,6 +11525,18 @@ int fdb_add_remote_time(BtCursor *pCur, unsigned long long start,
     return 0;
 }
 
+void fdb_add_remote_fetched(BtCursor *pCur, unsigned long long rows,
+                            unsigned long long bytes)
+{
+    struct sql_thread *thd = pCur->thd;
+
+    if (!thd || !thd->clnt)
+        return;
+
+    thd->clnt->osql.fdbtimes.total_rows += rows;
+    thd->clnt->osql.fdbtimes.total_bytes += bytes;
+}
+
 int ctracewrap(const char *fmt, ...)
 {
     va_list args;
@@ -11687,6 +11961,7 @@ void sqlite3RegisterDateTimeFunctions(void) {}
 void sqlite3BtreeCursorSetFieldUsed(BtCursor *pCur, unsigned long long mask)
 {
     pCur->col_mask = mask;
+    pCur->has_col_mask = 1;
 }
 
 void clearClientSideRow(struct sqlclntstate *clnt)
@@ -86,7 +86,7 @@
 #include "flibc.h"
 
 #include "sp.h"
-#include "lrucache.h"
+#include "clrucache.h"
 
 #include <ctrace.h>
 #include <bb_oscompat.h>
@@ -2051,17 +2051,17 @@ static const char *osqlretrystr(int i)
   * certain sql control changes.
   **/
 
-lrucache *sql_hints = NULL;
+clrucache *sql_hints = NULL;
 
 /* sql_hint/sql_str/tag all point to mem (tag can also be NULL) */
 typedef struct {
     char *sql_hint;
     char *sql_str;
-    lrucache_link lnk;
+    clrucache_link lnk;
     char mem[0];
 } sql_hint_hash_entry_type;
 
-void delete_sql_hint_table() { lrucache_destroy(sql_hints); }
+void delete_sql_hint_table() { clrucache_destroy(sql_hints); }
 
 static unsigned int sqlhint_hash(const void *p, int len)
 {
@@ -2087,21 +2087,14 @@ int sqlhint_cmp(const void *key1, const void *key2, int len)
 
 void init_sql_hint_table()
 {
-    sql_hints = lrucache_init(sqlhint_hash, sqlhint_cmp, free,
-                              offsetof(sql_hint_hash_entry_type, lnk),
-                              offsetof(sql_hint_hash_entry_type, sql_hint),
-                              sizeof(char *), gbl_max_sql_hint_cache);
+    sql_hints = clrucache_init(sqlhint_hash, sqlhint_cmp, free,
+                               offsetof(sql_hint_hash_entry_type, lnk),
+                               offsetof(sql_hint_hash_entry_type, sql_hint),
+                               sizeof(char *), gbl_max_sql_hint_cache, 0);
 }
 
-void reinit_sql_hint_table()
-{
-    Pthread_mutex_lock(&gbl_sql_lock);
-    {
-        delete_sql_hint_table();
-        init_sql_hint_table();
-    }
-    Pthread_mutex_unlock(&gbl_sql_lock);
-}
+/* Entries still referenced by running statements are kept. */
+void reinit_sql_hint_table() { clrucache_clear(sql_hints); }
 
 static void add_sql_hint_table(char *sql_hint, char *sql_str)
 {
@@ -2116,26 +2109,16 @@ static void add_sql_hint_table(char *sql_hint, char *sql_str)
     entry->sql_str = entry->sql_hint + sql_hint_len;
     memcpy(entry->sql_str, sql_str, sql_len);
 
-    Pthread_mutex_lock(&gbl_sql_lock);
-    {
-        if (lrucache_hasentry(sql_hints, &sql_hint) == 0) {
-            lrucache_add(sql_hints, entry);
-        } else {
-            free(entry);
-            logmsg(LOGMSG_ERROR, "Client BUG: Two threads using same SQL tag.\n");
-        }
+    if (clrucache_add(sql_hints, entry) != 0) {
+        free(entry);
+        logmsg(LOGMSG_ERROR, "Client BUG: Two threads using same SQL tag.\n");
     }
-    Pthread_mutex_unlock(&gbl_sql_lock);
 }
 
 static int find_sql_hint_table(char *sql_hint, char **sql_str)
 {
     sql_hint_hash_entry_type *entry;
-    Pthread_mutex_lock(&gbl_sql_lock);
-    {
-        entry = lrucache_find(sql_hints, &sql_hint);
-    }
-    Pthread_mutex_unlock(&gbl_sql_lock);
+    entry = clrucache_find(sql_hints, &sql_hint);
     if (entry) {
         *sql_str = entry->sql_str;
         return 0;
@@ -2145,13 +2128,7 @@ static int find_sql_hint_table(char *sql_hint, char **sql_str)
 
 static int has_sql_hint_table(char *sql_hint)
 {
-    int ret;
-    Pthread_mutex_lock(&gbl_sql_lock);
-    {
-        ret = lrucache_hasentry(sql_hints, &sql_hint);
-    }
-    Pthread_mutex_unlock(&gbl_sql_lock);
-    return ret;
+    return clrucache_hasentry(sql_hints, &sql_hint);
 }
 
 #define SQLCACHEHINT "/*+ RUNCOMDB2SQL"
@@ -2406,6 +2383,8 @@ static int reload_analyze(struct sqlthdstate *thd, struct sqlclntstate *clnt,
 void delete_prepared_stmts(struct sqlthdstate *thd)
 {
     if (thd->stmt_caching_table) {
+        ATOMIC_ADD(gbl_sql_stmt_cache_flushed,
+                   hash_get_num_entries(thd->stmt_caching_table));
         delete_stmt_caching_table(thd->stmt_caching_table);
         init_stmt_caching_table(thd);
     }
@@ -2716,6 +2695,10 @@ static void get_cached_stmt(struct sqlthdstate *thd, struct sqlclntstate *clnt,
             rec->stmt = NULL;
         }
     }
+    if (rec->stmt)
+        ATOMIC_ADD(gbl_sql_stmt_cache_hits, 1);
+    else
+        ATOMIC_ADD(gbl_sql_stmt_cache_misses, 1);
 }
 
 /* This is called at the time of put_prepared_stmt_int()
@@ -2800,11 +2783,7 @@ void put_prepared_stmt_distributed(struct sqlthdstate *thd,
     }
     if ((rec->status & CACHE_HAS_HINT) && (rec->status & CACHE_FOUND_STR)) {
         char *k = rec->cache_hint;
-        Pthread_mutex_lock(&gbl_sql_lock);
-        {
-            lrucache_release(sql_hints, &k);
-        }
-        Pthread_mutex_unlock(&gbl_sql_lock);
+        clrucache_release(sql_hints, &k);
     }
 }
 
@@ -4692,6 +4671,8 @@ void cleanup_clnt(struct sqlclntstate *clnt)
     clnt->dml_tables = NULL;
     destroy_hash(clnt->ddl_contexts, free_clnt_ddl_context);
     clnt->ddl_contexts = NULL;
+
+    osql_comm_frame_discard(clnt);
 }
 
 void reset_clnt(struct sqlclntstate *clnt, SBUF2 *sb, int initial)
@@ -5867,8 +5848,10 @@ fdb:
     if (!gbl_time_fdb)
         return;
 
-    logmsg(LOGMSG_USER, "total=%llu msec (longest=%llu msec) calls=%llu\n",
-            fdbtms->total_time, fdbtms->max_call, fdbtms->total_calls);
+    logmsg(LOGMSG_USER, "total=%llu msec (longest=%llu msec) calls=%llu "
+                        "rows=%llu bytes=%llu\n",
+           fdbtms->total_time, fdbtms->max_call, fdbtms->total_calls,
+           fdbtms->total_rows, fdbtms->total_bytes);
 }
 
 static void sql_thread_describe(void *obj, FILE *out)
@@ -5913,11 +5896,7 @@ static void dump_sql_hint_entry(void *item, void *p)
 void sql_dump_hints(void)
 {
     int count = 0;
-    Pthread_mutex_lock(&gbl_sql_lock);
-    {
-        lrucache_foreach(sql_hints, dump_sql_hint_entry, &count);
-    }
-    Pthread_mutex_unlock(&gbl_sql_lock);
+    clrucache_foreach(sql_hints, dump_sql_hint_entry, &count);
 }
 
 /**
@@ -6835,6 +6835,10 @@ void freeschema_internals(struct schema *schema)
         free(schema->sqlitetag);
         schema->sqlitetag = NULL;
     }
+    if (schema->decode_plan) {
+        free(schema->decode_plan);
+        schema->decode_plan = NULL;
+    }
 }
 
 void freeschema(struct schema *schema)
@@ -71,6 +71,7 @@ struct schema {
     char *sqlitetag;
     int *datacopy;
     char *where;
+    struct ondisk_decode_plan *decode_plan; /* built lazily by sqlglue */
     LINKC_T(struct schema) lnk;
 };
 
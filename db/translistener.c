@@ -38,6 +38,7 @@
 #include <tcputil.h>
 #include <unistd.h>
 #include <logmsg.h>
+#include <crc32c.h>
 
 struct javasp_trans_state {
     /* Which events we are subscribed for. */
@@ -77,6 +78,9 @@ struct stored_proc {
 
     char *qname;
     int flags;
+    /* route events to npartitions sub-queues by a hash of this field */
+    int npartitions;
+    char *partkey;
     LISTC_T(struct sp_table) tables;
     LINKC_T(struct stored_proc) lnk;
 };
@@ -742,6 +746,28 @@ static void append_field(struct byte_buffer *bytes, struct field *f,
     }
 }
 
+/* Pick the partition for an event: a hash of the ondisk bytes of the
+ * partition key, taken from the new record if there is one.  Events for the
+ * same key value always land in the same partition, in commit order. */
+static int sp_partition(struct stored_proc *p, struct schema *s,
+                        struct javasp_rec *oldrec, struct javasp_rec *newrec)
+{
+    struct javasp_rec *rec = newrec ? newrec : oldrec;
+    int i;
+
+    if (p->npartitions <= 1 || rec == NULL)
+        return -1;
+    for (i = 0; i < s->nmembers; i++) {
+        struct field *f = &s->member[i];
+        if (strcasecmp(f->name, p->partkey) == 0)
+            return crc32c((const uint8_t *)rec->ondisk_dta + f->offset,
+                          f->len) %
+                   p->npartitions;
+    }
+    /* key column dropped by a later schema change */
+    return 0;
+}
+
 /* This is the actual "stored procedure" call. */
 static int sp_trigger_run(struct javasp_trans_state *javasp_trans_handle,
                           struct stored_proc *p, struct sp_table *t, int event,
@@ -832,8 +858,9 @@ static int sp_trigger_run(struct javasp_trans_state *javasp_trans_handle,
     /* post it to queue */
     usedb = javasp_trans_handle->iq->usedb;
     javasp_trans_handle->iq->usedb = getqueuebyname(p->qname);
-    rc = dbq_add(javasp_trans_handle->iq, javasp_trans_handle->trans,
-                 bytes.bytes, bytes.used);
+    rc = dbq_add_partition(javasp_trans_handle->iq, javasp_trans_handle->trans,
+                           bytes.bytes, bytes.used,
+                           sp_partition(p, s, oldrec, newrec));
     javasp_trans_handle->iq->usedb = usedb;
 
 done:
@@ -1019,6 +1046,7 @@ int javasp_unload_procedure_int(const char *name)
             free(sp->name);
             free(sp->param);
             free(sp->qname);
+            free(sp->partkey);
 
             t = listc_rtl(&sp->tables);
             while (t) {
@@ -1168,6 +1196,9 @@ int javasp_load_procedure_int(const char *name, const char *param,
         goto done;
     }
     p->name = strdup(name);
+    p->qname = NULL;
+    p->npartitions = 0;
+    p->partkey = NULL;
     if (!p->name) {
     oom:
         logmsg(LOGMSG_ERROR, "OOM %s\n", __func__);
@@ -1368,6 +1399,20 @@ int javasp_load_procedure_int(const char *name, const char *param,
             table->flags |= flags;
             listc_abl(&table->fields, field);
             p->flags |= flags;
+        } else if (strcasecmp(s, "partition") == 0) {
+            char *n = strtok_r(NULL, toksep, &endp);
+            char *key = strtok_r(NULL, toksep, &endp);
+            if (n == NULL || key == NULL || atoi(n) < 1 ||
+                atoi(n) > BDBQUEUE_MAX_PARTITIONS) {
+                logmsg(LOGMSG_ERROR,
+                       "partition takes a count (1-%d) and a field name\n",
+                       BDBQUEUE_MAX_PARTITIONS);
+                rc = -1;
+                goto done;
+            }
+            p->npartitions = atoi(n);
+            free(p->partkey);
+            p->partkey = strdup(key);
         } else {
             logmsg(LOGMSG_ERROR, 
                 "unknown translisten config directive %s (config file %s)\n", s,
@@ -1420,6 +1465,22 @@ int javasp_exists(const char *name)
     return sp != NULL;
 }
 
+int javasp_num_partitions(const char *name)
+{
+    struct stored_proc *sp;
+    int n = 0;
+    SP_READLOCK();
+    LISTC_FOR_EACH(&stored_procs, sp, lnk)
+    {
+        if (strcmp(sp->name, name) == 0) {
+            n = sp->npartitions;
+            break;
+        }
+    }
+    SP_RELLOCK();
+    return n;
+}
+
 static void get_trigger_info_int(const char *name, trigger_info *info)
 {
     listc_init(info, offsetof(trigger_tbl_info, lnk));
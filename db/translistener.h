@@ -193,6 +193,9 @@ int javasp_unload_procedure_int(const char *name);
 /* Check if stored procedure exists. */
 int javasp_exists(const char *name);
 
+/* Number of partitions of a trigger's queue; 0 if it isn't partitioned. */
+int javasp_num_partitions(const char *name);
+
 /* Get info for qdb, suitable for comdb2_triggers */
 #include <list.h>
 typedef struct trigger_col_info trigger_col_info;
@@ -138,6 +138,9 @@ typedef struct {
     struct ireq iq;
     struct consumer *consumer;
     genid_t genid;
+    genid_t *batch; // genids returned by the last get_batch()
+    int nbatch;
+    int partition; // of a partitioned queue; 0 otherwise
     int push_tid;
     int register_timeoutms;
     time_t registration_time;
@@ -668,15 +671,67 @@ static int dbq_pushargs(Lua L, dbconsumer_t *q, struct qfound *f)
     return rc;
 }
 
+// Push an array of up to max items read in one pass; remember their genids
+// for consume_batch().
+static int dbq_pushbatch(Lua L, dbconsumer_t *q, int max)
+{
+    void **items = malloc(max * sizeof(void *));
+    size_t *lens = malloc(max * sizeof(size_t));
+    size_t *offs = malloc(max * sizeof(size_t));
+    genid_t *batch = realloc(q->batch, max * sizeof(genid_t));
+    int n = 0;
+    int rc = -1;
+    if (batch) {
+        q->batch = batch;
+    }
+    if (items && lens && offs && batch) {
+        rc = dbq_get_batch(&q->iq, q->partition, NULL, max, items, lens,
+                           offs, NULL, &n);
+    }
+    Pthread_mutex_unlock(q->lock);
+    getsp(L)->num_instructions = 0;
+    if (rc != 0) {
+        free(items);
+        free(lens);
+        free(offs);
+        return (rc == IX_NOTFND) ? 0 : -1;
+    }
+    lua_createtable(L, n, 0);
+    for (int i = 0; i < n; ++i) {
+        struct qfound f = {.item = items[i], .len = lens[i], .dtaoff = offs[i]};
+        if ((rc = dbq_pushargs(L, q, &f)) != 1) {
+            while (++i < n) {
+                free(items[i]);
+            }
+            break;
+        }
+        lua_rawseti(L, -2, i + 1);
+        q->batch[i] = q->genid;
+    }
+    free(items);
+    free(lens);
+    free(offs);
+    q->genid = 0;
+    if (rc != 1) {
+        return rc;
+    }
+    q->nbatch = n;
+    return 1;
+}
+
 static const int dbq_delay = 1000; // ms
+static const int dbq_max_batch = 1024;
 // Call with q->lock held.
 // Unlocks q->lock on return.
 // Returns  -2:stopped -1:error  0:IX_NOTFND  1:IX_FND
-// If IX_FND will push Lua table on stack.
-static int dbq_poll_int(Lua L, dbconsumer_t *q)
+// If IX_FND will push Lua table on stack (an array of them if max > 0).
+static int dbq_poll_int(Lua L, dbconsumer_t *q, int max)
 {
+    if (max > 0) {
+        return dbq_pushbatch(L, q, max);
+    }
     struct qfound f = {0};
-    int rc = dbq_get(&q->iq, 0, NULL, (void**)&f.item, &f.len, &f.dtaoff, NULL, NULL);
+    int rc = dbq_get(&q->iq, q->partition, NULL, (void**)&f.item, &f.len, &f.dtaoff, NULL, NULL);
     Pthread_mutex_unlock(q->lock);
     getsp(L)->num_instructions = 0;
     if (rc == 0) {
@@ -688,7 +743,7 @@ static int dbq_poll_int(Lua L, dbconsumer_t *q)
     return -1;
 }
 
-static int dbq_poll(Lua L, dbconsumer_t *q, int delay)
+static int dbq_poll(Lua L, dbconsumer_t *q, int delay, int max)
 {
     SP sp = getsp(L);
     while (1) {
@@ -698,7 +753,7 @@ static int dbq_poll(Lua L, dbconsumer_t *q, int delay)
         int rc;
         Pthread_mutex_lock(q->lock);
 again:  if (*q->open) {
-            rc = dbq_poll_int(L, q); // call will release q->lock
+            rc = dbq_poll_int(L, q, max); // call will release q->lock
         } else {
             Pthread_mutex_unlock(q->lock);
             rc = -2;
@@ -730,12 +785,14 @@ again:  if (*q->open) {
 static int dbconsumer_get_int(Lua L, dbconsumer_t *q)
 {
     int rc;
-    while ((rc = dbq_poll(L, q, dbq_delay)) == 0)
+    q->nbatch = 0;
+    while ((rc = dbq_poll(L, q, dbq_delay, 0)) == 0)
         ;
     return rc;
 }
 
-static void dbconsumer_getargs(Lua L, int *push_tid, int *register_timeoutms)
+static void dbconsumer_getargs(Lua L, int *push_tid, int *register_timeoutms,
+                               int *partition)
 {
     if (lua_gettop(L) != 1) return;
     luaL_checktype(L, 1, LUA_TTABLE);
@@ -756,6 +813,10 @@ static void dbconsumer_getargs(Lua L, int *push_tid, int *register_timeoutms)
                 if (timeoutms > 0) {
                     *register_timeoutms = timeoutms;
                 }
+            } else if (strcasecmp(key, "partition") == 0) {
+                long long p = -1;
+                luabb_tointeger(L, -1, &p);
+                *partition = p;
             }
             lua_pop(L, 1);
         }
@@ -777,13 +838,49 @@ static int dbconsumer_poll(Lua L)
     lua_Integer delay; // ms
     lua_number2integer(delay, arg);
     delay += (dbq_delay - delay % dbq_delay); // multiple of dbq_delay
-    int rc = dbq_poll(L, q, delay);
+    q->nbatch = 0;
+    int rc = dbq_poll(L, q, delay, 0);
     if (rc >= 0) {
         return rc;
     }
     return luaL_error(L, getsp(L)->error);
 }
 
+// consumer:get_batch(n [, timeout_ms]) returns an array of up to n events.
+// Without a timeout it blocks until at least one is available; on timeout
+// the array is empty.
+static int dbconsumer_get_batch(Lua L)
+{
+    dbconsumer_t *q = luaL_checkudata(L, 1, dbtypes.dbconsumer);
+    lua_Number arg = luaL_checknumber(L, 2);
+    lua_Integer max;
+    lua_number2integer(max, arg);
+    luaL_argcheck(L, max > 0, 2, "batch size must be positive");
+    if (max > dbq_max_batch) {
+        max = dbq_max_batch;
+    }
+    q->nbatch = 0;
+    int rc;
+    if (lua_isnoneornil(L, 3)) {
+        while ((rc = dbq_poll(L, q, dbq_delay, max)) == 0)
+            ;
+    } else {
+        arg = luaL_checknumber(L, 3);
+        lua_Integer delay; // ms
+        lua_number2integer(delay, arg);
+        delay += (dbq_delay - delay % dbq_delay); // multiple of dbq_delay
+        rc = dbq_poll(L, q, delay, max);
+    }
+    if (rc == 0) {
+        lua_newtable(L);
+        return 1;
+    }
+    if (rc > 0) {
+        return rc;
+    }
+    return luaL_error(L, getsp(L)->error);
+}
+
 static inline int push_and_return(Lua L, int rc)
 {
     lua_pushinteger(L, rc);
@@ -798,7 +895,8 @@ static int in_parent_trans(SP sp)
     return (sp->in_parent_trans || !sp->make_parent_trans);
 }
 
-static int lua_trigger_impl(Lua L, dbconsumer_t *q)
+static int lua_trigger_impl(Lua L, dbconsumer_t *q, const genid_t *genids,
+                            int n)
 {
     SP sp = getsp(L);
     struct sqlclntstate *clnt = sp->clnt;
@@ -810,7 +908,11 @@ static int lua_trigger_impl(Lua L, dbconsumer_t *q)
         clnt->intrans = 1;
     }
     clnt->ctrl_sqlengine = SQLENG_INTRANS_STATE;
-    return osql_dbq_consume_logic(clnt, q->info.spname, q->genid);
+    int rc = 0;
+    for (int i = 0; i < n && rc == 0; ++i) {
+        rc = osql_dbq_consume_logic(clnt, q->info.spname, genids[i]);
+    }
+    return rc;
 }
 
 /*
@@ -818,8 +920,10 @@ static int lua_trigger_impl(Lua L, dbconsumer_t *q)
 ** (2) Have explicit db:begin(), but no writes yet.
 ** Start a new transaction in either case.
 ** Commit transaction only for (1)
+** All n genids are consumed in the same transaction.
 */
-static int lua_consumer_impl(Lua L, dbconsumer_t *q)
+static int lua_consumer_impl(Lua L, dbconsumer_t *q, const genid_t *genids,
+                             int n)
 {
     int rc = 0;
     SP sp = getsp(L);
@@ -831,7 +935,11 @@ static int lua_consumer_impl(Lua L, dbconsumer_t *q)
         }
         clnt->intrans = 1;
     }
-    if ((rc = osql_dbq_consume_logic(clnt, q->info.spname, q->genid)) != 0) {
+    // q->info names the partition claim; the queue is the sp's
+    for (int i = 0; i < n && rc == 0; ++i) {
+        rc = osql_dbq_consume_logic(clnt, sp->spname, genids[i]);
+    }
+    if (rc != 0) {
         if (start) {
             osql_sock_abort(clnt, OSQL_SOCK_REQ);
             clnt->intrans = 0;
@@ -856,12 +964,31 @@ static int dbconsumer_consume_int(Lua L, dbconsumer_t *q)
         return -1;
     }
     enum consumer_t type = dbqueue_consumer_type(q->consumer);
-    int rc = (type == CONSUMER_TYPE_LUA) ? lua_trigger_impl(L, q)
-                                         : lua_consumer_impl(L, q);
+    int rc = (type == CONSUMER_TYPE_LUA) ? lua_trigger_impl(L, q, &q->genid, 1)
+                                         : lua_consumer_impl(L, q, &q->genid, 1);
     q->genid = 0;
     return rc;
 }
 
+static int dbconsumer_consume_batch_int(Lua L, dbconsumer_t *q)
+{
+    if (q->nbatch == 0) {
+        return -1;
+    }
+    enum consumer_t type = dbqueue_consumer_type(q->consumer);
+    int rc = (type == CONSUMER_TYPE_LUA)
+                 ? lua_trigger_impl(L, q, q->batch, q->nbatch)
+                 : lua_consumer_impl(L, q, q->batch, q->nbatch);
+    q->nbatch = 0;
+    return rc;
+}
+
+static int dbconsumer_consume_batch(Lua L)
+{
+    dbconsumer_t *q = luaL_checkudata(L, 1, dbtypes.dbconsumer);
+    return push_and_return(L, dbconsumer_consume_batch_int(L, q));
+}
+
 static int dbconsumer_consume(Lua L)
 {
     dbconsumer_t *q = luaL_checkudata(L, 1, dbtypes.dbconsumer);
@@ -884,6 +1011,8 @@ static int dbconsumer_free(Lua L)
 {
     dbconsumer_t *q = luaL_checkudata(L, 1, dbtypes.dbconsumer);
     luabb_trigger_unregister(L, q);
+    free(q->batch);
+    q->batch = NULL;
     return 0;
 }
 
@@ -4172,8 +4301,8 @@ static int db_consumer(Lua L)
     luaL_checkudata(L, 1, dbtypes.db);
     lua_remove(L, 1);
 
-    int push_tid = 0, register_timeoutms = 0;
-    dbconsumer_getargs(L, &push_tid, &register_timeoutms);
+    int push_tid = 0, register_timeoutms = 0, partition = 0;
+    dbconsumer_getargs(L, &push_tid, &register_timeoutms, &partition);
 
     SP sp = getsp(L);
     struct sqlclntstate *clnt = sp->clnt;
@@ -4197,10 +4326,22 @@ static int db_consumer(Lua L)
         return luaL_error(L, "consumer not found for sp:%s", spname);
     }
 
+    int nparts = javasp_num_partitions(qname);
+    if (partition < 0 || partition >= (nparts > 0 ? nparts : 1)) {
+        return luaL_error(L, "no partition %d for sp:%s", partition, spname);
+    }
+    // partition 0 is claimed under the sp name itself
+    char claim[sizeof(spname) + 16];
+    if (partition > 0) {
+        snprintf(claim, sizeof(claim), "%s:%d", spname, partition);
+    } else {
+        strcpy(claim, spname);
+    }
+
     enum consumer_t type = dbqueue_consumer_type(consumer);
     trigger_reg_t *t;
     if (type == CONSUMER_TYPE_DYNLUA) {
-        trigger_reg_init(t, spname);
+        trigger_reg_init(t, claim);
         switch (luabb_trigger_register(L, t, register_timeoutms)) {
         case CDB2_TRIG_REQ_SUCCESS:
             break;
@@ -4217,13 +4358,14 @@ static int db_consumer(Lua L)
     }
 
     dbconsumer_t *q;
-    size_t sz = dbconsumer_sz(spname);
+    size_t sz = dbconsumer_sz(claim);
     new_lua_t_sz(L, q, dbconsumer_t, DBTYPES_DBCONSUMER, sz);
     if (setup_dbconsumer(q, consumer, db, t) != 0) {
         luabb_error(L, sp, "failed to register consumer with qdb");
         lua_pushnil(L);
         return 1;
     }
+    q->partition = partition;
     q->push_tid = push_tid;
     q->register_timeoutms = register_timeoutms;
     sp->parent->have_consumer = 1;
@@ -4417,8 +4559,10 @@ static void init_dbthread_funcs(Lua L)
 static const struct luaL_Reg dbconsumer_funcs[] = {
     {"__gc", dbconsumer_free},
     {"get", dbconsumer_get},
+    {"get_batch", dbconsumer_get_batch},
     {"poll", dbconsumer_poll},
     {"consume", dbconsumer_consume},
+    {"consume_batch", dbconsumer_consume_batch},
     {"emit", dbconsumer_emit},
     {NULL, NULL}
 };
@@ -60,6 +60,7 @@
 #include <dirent.h>
 #include <utime.h>
 #include <sys/time.h>
+#include <sys/uio.h>
 #include <poll.h>
 
 #include <bb_oscompat.h>
@@ -104,6 +105,7 @@
 #include "perf.h"
 
 #include <crc32c.h>
+#include <lz4.h>
 
 #ifdef UDP_DEBUG
 static int curr_udp_cnt = 0;
@@ -144,11 +146,20 @@ static int sbuf2read_wrapper(SBUF2 *sb, char *buf, int nbytes)
     return sbuf2unbufferedread(sb, buf, nbytes);
 }
 
+/* Set in each writer thread so that socket writes made through the sbuf can
+ * be counted against the host being written to. */
+static __thread host_node_type *writer_host = NULL;
+
 static int sbuf2write_wrapper(SBUF2 *sb, const char *buf, int nbytes)
 {
     if (debug_switch_verbose_sbuf())
         logmsg(LOGMSG_USER, "writing, writing %llu\n", gettmms());
 
+    if (writer_host) {
+        writer_host->stats.write_syscalls++;
+        writer_host->netinfo_ptr->stats.write_syscalls++;
+    }
+
     return sbuf2unbufferedwrite(sb, buf, nbytes);
 }
 
@@ -501,6 +512,7 @@ static void close_hostnode_ll(host_node_type *host_node_ptr)
            send to garbcan without notifying sql, or master, and they
            will never be applied */
         host_node_ptr->got_hello = 0;
+        host_node_ptr->peer_caps = 0;
 
         shutdown_hostnode_socket(host_node_ptr);
 
@@ -790,6 +802,21 @@ static int read_stream(netinfo_type *netinfo_ptr, host_node_type *host_node_ptr,
     uint8_t *ptr = inptr;
     const int fd = sbuf2fileno(sb);
     int nread = 0;
+
+    /* Messages from a compressed frame are read back before the socket.  A
+     * frame only ever holds whole messages, so a short read here means the
+     * frame was bad and the caller will treat it as an error. */
+    if (host_node_ptr &&
+        host_node_ptr->inflate_off < host_node_ptr->inflate_len) {
+        nread = host_node_ptr->inflate_len - host_node_ptr->inflate_off;
+        if (nread > maxbytes)
+            nread = maxbytes;
+        memcpy(ptr, host_node_ptr->inflate_buf + host_node_ptr->inflate_off,
+               nread);
+        host_node_ptr->inflate_off += nread;
+        return nread;
+    }
+
     while (nread < maxbytes) {
         if (host_node_ptr) /* not set by all callers */
             host_node_ptr->timestamp = time(NULL);
@@ -965,6 +992,53 @@ static ssize_t write_stream(netinfo_type *netinfo_ptr,
     return nwrite;
 }
 
+/* Write all of iov straight to the socket, bypassing the sbuf buffer.  The
+ * caller must hold write_lock and have flushed the sbuf.  iov is consumed. */
+static ssize_t writev_stream(netinfo_type *netinfo_ptr,
+                             host_node_type *hostinfo_ptr, SBUF2 *sb,
+                             struct iovec *iov, int niov)
+{
+    int fd = sbuf2fileno(sb);
+    ssize_t total = 0, n;
+    int zero = 0;
+
+    while (niov > 0) {
+        n = writev(fd, iov, niov);
+        hostinfo_ptr->stats.write_syscalls++;
+        netinfo_ptr->stats.write_syscalls++;
+        if (n < 0) {
+            if (errno == EINTR || errno == EAGAIN)
+                continue;
+            return -1;
+        }
+        if (n == 0) {
+            if (++zero > 5)
+                return -1;
+            continue;
+        }
+        zero = 0;
+        total += n;
+
+        /* skip what was written, then trim a partially written entry */
+        while (niov > 0 && n >= iov->iov_len) {
+            n -= iov->iov_len;
+            iov++;
+            niov--;
+        }
+        if (niov > 0) {
+            iov->iov_base = (uint8_t *)iov->iov_base + n;
+            iov->iov_len -= n;
+            hostinfo_ptr->stats.writev_short++;
+            netinfo_ptr->stats.writev_short++;
+        }
+    }
+
+    netinfo_ptr->stats.bytes_written += total;
+    hostinfo_ptr->stats.bytes_written += total;
+
+    return total;
+}
+
 #if WITH_SSL
 extern ssl_mode gbl_rep_ssl_mode;
 extern SSL_CTX *gbl_ssl_ctx;
@@ -1087,6 +1161,21 @@ static int read_connect_message(SBUF2 *sb, char hostname[], int hostnamel,
     return 0;
 }
 
+static void free_write_data(host_node_type *host_node_ptr, write_data *ptr)
+{
+    if (ptr->pooled) {
+        Pthread_mutex_lock(&(host_node_ptr->pool_lock));
+        pool_relablk(host_node_ptr->write_pool, ptr);
+        Pthread_mutex_unlock(&(host_node_ptr->pool_lock));
+    } else {
+#ifdef PER_THREAD_MALLOC
+        free(ptr);
+#else
+        comdb2_free(ptr);
+#endif
+    }
+}
+
 static int empty_write_list(host_node_type *host_node_ptr)
 {
     write_data *ptr, *nxt;
@@ -1096,19 +1185,7 @@ static int empty_write_list(host_node_type *host_node_ptr)
     nxt = ptr = host_node_ptr->write_head;
     while (nxt != NULL) {
         ptr = ptr->next;
-
-        if (nxt->pooled) {
-            Pthread_mutex_lock(&(host_node_ptr->pool_lock));
-            pool_relablk(host_node_ptr->write_pool, nxt);
-            Pthread_mutex_unlock(&(host_node_ptr->pool_lock));
-        } else {
-#ifdef PER_THREAD_MALLOC
-            free(nxt);
-#else
-            comdb2_free(nxt);
-#endif
-        }
-
+        free_write_data(host_node_ptr, nxt);
         nxt = ptr;
     }
     host_node_ptr->write_head = host_node_ptr->write_tail = NULL;
@@ -1363,6 +1440,21 @@ static int write_heartbeat(netinfo_type *netinfo_ptr,
                                  WRITE_MSG_NODELAY | WRITE_MSG_NOLIMIT);
 }
 
+int gbl_net_compress = 0;
+int gbl_net_compress_min_bytes = 1024;
+
+/* Size of the capabilities trailer appended to hello and hello reply. */
+#define HELLO_CAPS_LEN (2 * sizeof(int))
+
+static uint8_t *hello_caps_put(uint8_t *p_buf, const uint8_t *p_buf_end)
+{
+    int magic = NET_HELLO_CAPS_MAGIC;
+    int caps = NET_CAP_LZ4;
+
+    p_buf = buf_put(&magic, sizeof(int), p_buf, p_buf_end);
+    return buf_put(&caps, sizeof(int), p_buf, p_buf_end);
+}
+
 /*
   this is the protocol where each node advertises all the other nodes
   they know about so that eventually (quickly) every node know about
@@ -1392,7 +1484,8 @@ static int write_hello(netinfo_type *netinfo_ptr, host_node_type *host_node_ptr)
              (HOSTNAME_LEN * numhosts) + /* char host[16]... ( 1 per host ) */
              (sizeof(int) * numhosts) +  /* int port...      ( 1 per host ) */
              (sizeof(int) * numhosts) +  /* int node...      ( 1 per host ) */
-             (8 * numhosts);             /* some fluff space */
+             (8 * numhosts) +            /* some fluff space */
+             HELLO_CAPS_LEN;
 
     /* write long hostnames */
     for (tmp_host_ptr = netinfo_ptr->head; tmp_host_ptr != NULL;
@@ -1448,6 +1541,8 @@ static int write_hello(netinfo_type *netinfo_ptr, host_node_type *host_node_ptr)
                                p_buf, p_buf_end);
     }
 
+    p_buf = hello_caps_put(p_buf, p_buf_end);
+
     Pthread_rwlock_unlock(&(netinfo_ptr->lock));
 
     rc = write_message_nohello(netinfo_ptr, host_node_ptr, WIRE_HEADER_HELLO,
@@ -1480,7 +1575,8 @@ static int write_hello_reply(netinfo_type *netinfo_ptr,
              (HOSTNAME_LEN * numhosts) + /* char host[16]... ( 1 per host ) */
              (sizeof(int) * numhosts) +  /* int port...      ( 1 per host ) */
              (sizeof(int) * numhosts) +  /* int node...      ( 1 per host ) */
-             (8 * numhosts);             /* some fluff space */
+             (8 * numhosts) +            /* some fluff space */
+             HELLO_CAPS_LEN;
 
     /* write long hostnames */
     for (tmp_host_ptr = netinfo_ptr->head; tmp_host_ptr != NULL;
@@ -1539,6 +1635,8 @@ static int write_hello_reply(netinfo_type *netinfo_ptr,
                                p_buf, p_buf_end);
     }
 
+    p_buf = hello_caps_put(p_buf, p_buf_end);
+
     Pthread_rwlock_unlock(&(netinfo_ptr->lock));
 
     rc = write_message_nohello(netinfo_ptr, host_node_ptr,
@@ -3319,6 +3417,8 @@ netinfo_type *create_netinfo_int(char myhostname[], int myportnum, int myfd,
 
     netinfo_ptr->stats.bytes_read = netinfo_ptr->stats.bytes_written = 0;
     netinfo_ptr->stats.throttle_waits = netinfo_ptr->stats.reorders = 0;
+    netinfo_ptr->stats.write_syscalls = netinfo_ptr->stats.writev_items = 0;
+    netinfo_ptr->stats.writev_short = 0;
 
     host_node_ptr = add_to_netinfo(netinfo_ptr, myhostname, myportnum);
     if (host_node_ptr == NULL) {
@@ -3447,7 +3547,7 @@ void print_netinfo(netinfo_type *netinfo_ptr)
    number of entries actually returned
  */
 static int read_hostlist(netinfo_type *netinfo_ptr, SBUF2 *sb, char *hosts[],
-                         int ports[], int *numhosts)
+                         int ports[], int *numhosts, int *caps)
 {
     int datasz;
     int i;
@@ -3529,6 +3629,16 @@ static int read_hostlist(netinfo_type *netinfo_ptr, SBUF2 *sb, char *hosts[],
         }
     }
 
+    /* newer nodes follow the host list with their capabilities; older ones
+     * leave zeroed fluff space there */
+    *caps = 0;
+    if (num == *numhosts && p_buf && p_buf_end - p_buf >= (ptrdiff_t)HELLO_CAPS_LEN) {
+        int magic;
+        p_buf = (uint8_t *)buf_get(&magic, sizeof(int), p_buf, p_buf_end);
+        if (magic == NET_HELLO_CAPS_MAGIC)
+            buf_get(caps, sizeof(int), p_buf, p_buf_end);
+    }
+
     free(data);
 
     return 0;
@@ -4196,6 +4306,215 @@ void kill_subnet(const char *subnet)
 }
 
 int gbl_net_writer_thread_poll_ms = 1000;
+int gbl_net_writev = 0;
+int gbl_net_writev_max_bytes = 1024 * 1024;
+
+#define NET_WRITEV_MAX_IOV 128
+
+/* Scratch space for compressing a batch, owned by the writer thread. */
+struct net_zbuf {
+    uint8_t *raw;
+    size_t rawsz;
+    uint8_t *out;
+    size_t outsz;
+};
+
+static int64_t thread_cpu_us(void)
+{
+#ifdef CLOCK_THREAD_CPUTIME_ID
+    struct timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0)
+        return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+#endif
+    return comdb2_time_epochus();
+}
+
+/* Fill in the wire header at buf with the details of our current
+ * connection, in network byte order. */
+static void fill_wire_header(netinfo_type *netinfo_ptr,
+                             host_node_type *host_node_ptr, int type,
+                             uint8_t *buf)
+{
+    wire_header_type tmp_wire_hdr;
+
+    if (netinfo_ptr->myhostname_len > HOSTNAME_LEN) {
+        snprintf(tmp_wire_hdr.fromhost, sizeof(tmp_wire_hdr.fromhost), ".%d",
+                 netinfo_ptr->myhostname_len);
+    } else {
+        strncpy(tmp_wire_hdr.fromhost, netinfo_ptr->myhostname,
+                sizeof(tmp_wire_hdr.fromhost));
+    }
+    tmp_wire_hdr.fromport = netinfo_ptr->myport;
+    tmp_wire_hdr.fromnode = 0;
+    if (host_node_ptr->hostname_len > HOSTNAME_LEN) {
+        snprintf(tmp_wire_hdr.tohost, sizeof(tmp_wire_hdr.tohost), ".%d",
+                 host_node_ptr->hostname_len);
+    } else {
+        strncpy(tmp_wire_hdr.tohost, host_node_ptr->host,
+                sizeof(tmp_wire_hdr.tohost));
+    }
+    tmp_wire_hdr.toport = host_node_ptr->port;
+    tmp_wire_hdr.tonode = 0;
+    tmp_wire_hdr.type = type;
+
+    /* This shouldn't happen.. but for a while it was happening
+     * due to various races. */
+    if (tmp_wire_hdr.toport == 0)
+        host_node_errf(LOGMSG_WARN, host_node_ptr, "PORT IS ZERO! type %d\n",
+                       tmp_wire_hdr.type);
+
+    /* endianize this */
+    net_wire_header_put(&tmp_wire_hdr, buf, buf + sizeof(wire_header_type));
+}
+
+/* Replace each run of user messages in iov with a single compressed frame.
+ * Runs smaller than net_compress_min_bytes, and runs that don't shrink, are
+ * sent as they are.  Returns the new number of entries in iov. */
+static int compress_batch(netinfo_type *netinfo_ptr,
+                          host_node_type *host_node_ptr, struct iovec *iov,
+                          write_data **batch, int nitems, size_t nbytes,
+                          struct net_zbuf *z)
+{
+    struct iovec out[NET_WRITEV_MAX_IOV];
+    size_t prefix, need, outoff = 0;
+    int i, j, k, nout = 0;
+
+    prefix = sizeof(wire_header_type) + NET_COMPRESSED_HEADER_LEN;
+    if (netinfo_ptr->myhostname_len > HOSTNAME_LEN)
+        prefix += netinfo_ptr->myhostname_len;
+    if (host_node_ptr->hostname_len > HOSTNAME_LEN)
+        prefix += host_node_ptr->hostname_len;
+
+    if (nbytes > LZ4_MAX_INPUT_SIZE)
+        return nitems;
+    /* one frame per run at worst; each run's bound adds at most 16 bytes */
+    need = LZ4_compressBound(nbytes) + nitems * (prefix + 16);
+    if (z->rawsz < nbytes) {
+        uint8_t *raw = realloc(z->raw, nbytes);
+        if (raw == NULL)
+            return nitems;
+        z->raw = raw;
+        z->rawsz = nbytes;
+    }
+    if (z->outsz < need) {
+        uint8_t *o = realloc(z->out, need);
+        if (o == NULL)
+            return nitems;
+        z->out = o;
+        z->outsz = need;
+    }
+
+    for (i = 0; i < nitems; i = j) {
+        uint8_t *frame, *p_buf, *p_buf_end;
+        size_t runlen = 0, off = 0;
+        int64_t start;
+        int rawlen, zlen;
+
+        /* headers are already in network order, and the struct has no
+         * padding, so the type can be read back in place */
+        for (j = i; j < nitems && ntohl(batch[j]->payload.header.type) ==
+                                      WIRE_HEADER_USER_MSG;
+             j++)
+            runlen += iov[j].iov_len;
+
+        if (j == i) {
+            out[nout++] = iov[i];
+            j = i + 1;
+            continue;
+        }
+        if (runlen < (size_t)gbl_net_compress_min_bytes) {
+            for (k = i; k < j; k++)
+                out[nout++] = iov[k];
+            continue;
+        }
+
+        start = thread_cpu_us();
+        for (k = i; k < j; k++) {
+            memcpy(z->raw + off, iov[k].iov_base, iov[k].iov_len);
+            off += iov[k].iov_len;
+        }
+        frame = z->out + outoff;
+        zlen = LZ4_compress_default((char *)z->raw, (char *)frame + prefix,
+                                    runlen, z->outsz - outoff - prefix);
+        start = thread_cpu_us() - start;
+        host_node_ptr->stats.compress_us += start;
+        netinfo_ptr->stats.compress_us += start;
+
+        if (zlen <= 0 || zlen + prefix >= runlen) {
+            for (k = i; k < j; k++)
+                out[nout++] = iov[k];
+            continue;
+        }
+
+        fill_wire_header(netinfo_ptr, host_node_ptr, WIRE_HEADER_COMPRESSED,
+                         frame);
+        p_buf = frame + sizeof(wire_header_type);
+        p_buf_end = frame + prefix;
+        if (netinfo_ptr->myhostname_len > HOSTNAME_LEN)
+            p_buf = buf_no_net_put(netinfo_ptr->myhostname,
+                                   netinfo_ptr->myhostname_len, p_buf,
+                                   p_buf_end);
+        if (host_node_ptr->hostname_len > HOSTNAME_LEN)
+            p_buf = buf_no_net_put(host_node_ptr->host,
+                                   host_node_ptr->hostname_len, p_buf,
+                                   p_buf_end);
+        rawlen = runlen;
+        p_buf = buf_put(&rawlen, sizeof(int), p_buf, p_buf_end);
+        p_buf = buf_put(&zlen, sizeof(int), p_buf, p_buf_end);
+
+        out[nout].iov_base = frame;
+        out[nout].iov_len = prefix + zlen;
+        nout++;
+        outoff += prefix + zlen;
+
+        host_node_ptr->stats.compress_frames++;
+        host_node_ptr->stats.compress_in += runlen;
+        host_node_ptr->stats.compress_out += prefix + zlen;
+        netinfo_ptr->stats.compress_frames++;
+        netinfo_ptr->stats.compress_in += runlen;
+        netinfo_ptr->stats.compress_out += prefix + zlen;
+    }
+
+    memcpy(iov, out, nout * sizeof(struct iovec));
+    return nout;
+}
+
+/* Send a batch of queued items if send is set, then free them.  With z the
+ * batch is compressed first; without use_writev it goes through the sbuf. */
+static int write_batch(netinfo_type *netinfo_ptr, host_node_type *host_node_ptr,
+                       struct iovec *iov, write_data **batch, int nitems,
+                       size_t nbytes, int send, int use_writev,
+                       struct net_zbuf *z)
+{
+    ssize_t rc = -1;
+    int i, niov;
+
+    if (send) {
+        niov = nitems;
+        if (z)
+            niov = compress_batch(netinfo_ptr, host_node_ptr, iov, batch,
+                                  nitems, nbytes, z);
+        if (use_writev) {
+            rc = writev_stream(netinfo_ptr, host_node_ptr, host_node_ptr->sb,
+                               iov, niov);
+            if (rc >= 0) {
+                host_node_ptr->stats.writev_items += nitems;
+                netinfo_ptr->stats.writev_items += nitems;
+            }
+        } else {
+            rc = 0;
+            for (i = 0; i < niov && rc >= 0; i++)
+                rc = write_stream(netinfo_ptr, host_node_ptr,
+                                  host_node_ptr->sb, iov[i].iov_base,
+                                  iov[i].iov_len);
+        }
+    }
+
+    for (i = 0; i < nitems; i++)
+        free_write_data(host_node_ptr, batch[i]);
+
+    return rc < 0 ? -1 : 0;
+}
 
 static void *writer_thread(void *args)
 {
@@ -4203,6 +4522,11 @@ static void *writer_thread(void *args)
     host_node_type *host_node_ptr;
     write_data *write_list_ptr, *write_list_back;
     int rc, flags, maxage;
+    struct iovec iov[NET_WRITEV_MAX_IOV];
+    write_data *batch[NET_WRITEV_MAX_IOV];
+    int niov, use_writev, compress;
+    size_t batch_bytes;
+    struct net_zbuf zbuf = {0};
     struct timespec waittime;
 #ifndef HAS_CLOCK_GETTIME
     struct timeval tv;
@@ -4213,6 +4537,7 @@ static void *writer_thread(void *args)
     netinfo_ptr = host_node_ptr->netinfo_ptr;
 
     host_node_ptr->writer_thread_arch_tid = getarchtid();
+    writer_host = host_node_ptr;
     if (gbl_verbose_net)
         host_node_printf(LOGMSG_DEBUG, host_node_ptr, "%s: starting tid=%d\n", __func__,
                          host_node_ptr->writer_thread_arch_tid);
@@ -4254,13 +4579,26 @@ static void *writer_thread(void *args)
 
             Pthread_mutex_lock(&(host_node_ptr->write_lock));
             start_time = comdb2_time_epoch();
+
+            /* Coalesce items into writev calls that point straight at the
+             * queued buffers instead of copying them through the sbuf.  Flush
+             * the sbuf first so that whatever is already in it goes out
+             * ahead of them.  SSL connections must go through the sbuf.
+             * Batches are also used to compress user messages for peers
+             * that can read compressed frames. */
+            use_writev = gbl_net_writev && !sslio_has_ssl(host_node_ptr->sb);
+            compress =
+                gbl_net_compress && (host_node_ptr->peer_caps & NET_CAP_LZ4);
+            if (use_writev && sbuf2flush(host_node_ptr->sb) < 0)
+                rc = -1;
+            niov = 0;
+            batch_bytes = 0;
+
             while (write_list_ptr != NULL) {
                 /* stop writing if we've hit an error or if we've disconnected
                  */
                 if (!host_node_ptr->closed && rc >= 0) {
                     int age;
-                    wire_header_type *wire_header, tmp_wire_hdr;
-                    uint8_t *p_buf, *p_buf_end;
 
                     if (flags & WRITE_MSG_NODELAY) {
                         age = comdb2_time_epoch() - write_list_ptr->enque_time;
@@ -4270,41 +4608,31 @@ static void *writer_thread(void *args)
 
                     /* File in the wire header with correct details for our
                      * current connection. */
-
-                    wire_header = &write_list_ptr->payload.header;
-                    if (netinfo_ptr->myhostname_len > HOSTNAME_LEN) {
-                        snprintf(tmp_wire_hdr.fromhost,
-                                 sizeof(tmp_wire_hdr.fromhost), ".%d",
-                                 netinfo_ptr->myhostname_len);
-                    } else {
-                        strncpy(tmp_wire_hdr.fromhost, netinfo_ptr->myhostname,
-                                sizeof(tmp_wire_hdr.fromhost));
-                    }
-                    tmp_wire_hdr.fromport = netinfo_ptr->myport;
-                    tmp_wire_hdr.fromnode = 0;
-                    if (host_node_ptr->hostname_len > HOSTNAME_LEN) {
-                        snprintf(tmp_wire_hdr.tohost,
-                                 sizeof(tmp_wire_hdr.tohost), ".%d",
-                                 host_node_ptr->hostname_len);
-                    } else {
-                        strncpy(tmp_wire_hdr.tohost, host_node_ptr->host,
-                                sizeof(tmp_wire_hdr.tohost));
+                    fill_wire_header(
+                        netinfo_ptr, host_node_ptr,
+                        write_list_ptr->payload.header.type,
+                        (uint8_t *)&write_list_ptr->payload.header);
+
+                    if (use_writev || compress) {
+                        iov[niov].iov_base = write_list_ptr->payload.raw;
+                        iov[niov].iov_len = write_list_ptr->len;
+                        batch[niov++] = write_list_ptr;
+                        batch_bytes += write_list_ptr->len;
+                        flags |= write_list_ptr->flags;
+                        write_list_ptr = write_list_ptr->next;
+
+                        if (niov == NET_WRITEV_MAX_IOV ||
+                            batch_bytes >= (size_t)gbl_net_writev_max_bytes ||
+                            write_list_ptr == NULL) {
+                            rc = write_batch(netinfo_ptr, host_node_ptr, iov,
+                                             batch, niov, batch_bytes, 1,
+                                             use_writev,
+                                             compress ? &zbuf : NULL);
+                            niov = 0;
+                            batch_bytes = 0;
+                        }
+                        continue;
                     }
-                    tmp_wire_hdr.toport = host_node_ptr->port;
-                    tmp_wire_hdr.tonode = 0;
-                    tmp_wire_hdr.type = wire_header->type;
-
-                    /* This shouldn't happen.. but for a while it was happening
-                     * due to various races. */
-                    if (tmp_wire_hdr.toport == 0)
-                        host_node_errf(LOGMSG_WARN, host_node_ptr, "PORT IS ZERO! type %d\n",
-                                       tmp_wire_hdr.type);
-
-                    p_buf = (uint8_t *)wire_header;
-                    p_buf_end = ((uint8_t *)wire_header + sizeof(*wire_header));
-
-                    /* endianize this */
-                    net_wire_header_put(&tmp_wire_hdr, p_buf, p_buf_end);
 
                     rc = write_stream(
                         netinfo_ptr, host_node_ptr, host_node_ptr->sb,
@@ -4315,19 +4643,12 @@ static void *writer_thread(void *args)
 
                 write_list_back = write_list_ptr;
                 write_list_ptr = write_list_ptr->next;
-
-                if (write_list_back->pooled) {
-                    Pthread_mutex_lock(&(host_node_ptr->pool_lock));
-                    pool_relablk(host_node_ptr->write_pool, write_list_back);
-                    Pthread_mutex_unlock(&(host_node_ptr->pool_lock));
-                } else {
-#ifdef PER_THREAD_MALLOC
-                    free(write_list_back);
-#else
-                    comdb2_free(write_list_back);
-#endif
-                }
+                free_write_data(host_node_ptr, write_list_back);
             }
+            /* a close or error can leave part of a batch unsent */
+            if (niov > 0)
+                rc = write_batch(netinfo_ptr, host_node_ptr, iov, batch, niov,
+                                 batch_bytes, 0, 0, NULL);
             /* we seem to set nodelay on virtually every message.  try to get
              * slightly better streaming performance by moving the flush out of
              * the main loop. */
@@ -4379,6 +4700,9 @@ static void *writer_thread(void *args)
 done:
     Pthread_mutex_unlock(&(host_node_ptr->enquelk));
 
+    free(zbuf.raw);
+    free(zbuf.out);
+
     Pthread_mutex_lock(&(host_node_ptr->lock));
     host_node_ptr->have_writer_thread = 0;
     if (gbl_verbose_net)
@@ -4443,8 +4767,10 @@ static int process_hello_common(netinfo_type *netinfo_ptr,
     host_node_type *newhost, *fndhost;
     int rc;
     int numhosts = REPMAX;
+    int caps;
 
-    rc = read_hostlist(netinfo_ptr, host_node_ptr->sb, hosts, ports, &numhosts);
+    rc = read_hostlist(netinfo_ptr, host_node_ptr->sb, hosts, ports, &numhosts,
+                       &caps);
     if (rc < 0)
         return -1; /* reader thread cleans up */
     if (rc != 0) {
@@ -4472,12 +4798,100 @@ static int process_hello_common(netinfo_type *netinfo_ptr,
         host_node_ptr->got_hello = 1;
     }
 
+    if (caps != host_node_ptr->peer_caps && gbl_verbose_net)
+        host_node_printf(LOGMSG_USER, host_node_ptr, "peer capabilities %#x\n",
+                         caps);
+    host_node_ptr->peer_caps = caps;
+
     for (int i = 0; i < numhosts; i++)
         free(hosts[i]);
 
     return 0;
 }
 
+/* Read and decompress a frame sent by compress_batch().  The messages in it
+ * are then read back by read_stream() ahead of the socket. */
+static int process_compressed(netinfo_type *netinfo_ptr,
+                              host_node_type *host_node_ptr)
+{
+    uint8_t hdr[NET_COMPRESSED_HEADER_LEN];
+    const uint8_t *p_buf, *p_buf_end;
+    int rawlen, zlen, rc;
+    int64_t start;
+
+    /* frames only hold user messages, so they never nest */
+    if (host_node_ptr->inflate_off < host_node_ptr->inflate_len) {
+        host_node_errf(LOGMSG_ERROR, host_node_ptr,
+                       "%s: compressed frame inside compressed frame\n",
+                       __func__);
+        return -1;
+    }
+
+    rc = read_stream(netinfo_ptr, host_node_ptr, host_node_ptr->sb, hdr,
+                     sizeof(hdr));
+    if (rc != sizeof(hdr))
+        return -1;
+
+    p_buf = hdr;
+    p_buf_end = hdr + sizeof(hdr);
+    p_buf = buf_get(&rawlen, sizeof(int), p_buf, p_buf_end);
+    p_buf = buf_get(&zlen, sizeof(int), p_buf, p_buf_end);
+
+    if (rawlen <= 0 || zlen <= 0 || rawlen > LZ4_MAX_INPUT_SIZE ||
+        zlen > LZ4_compressBound(rawlen)) {
+        host_node_errf(LOGMSG_ERROR, host_node_ptr,
+                       "%s: bad compressed frame raw %d compressed %d\n",
+                       __func__, rawlen, zlen);
+        return -1;
+    }
+
+    if (host_node_ptr->inflate_in_sz < zlen) {
+        uint8_t *in = realloc(host_node_ptr->inflate_in, zlen);
+        if (in == NULL)
+            return -1;
+        host_node_ptr->inflate_in = in;
+        host_node_ptr->inflate_in_sz = zlen;
+    }
+    if (host_node_ptr->inflate_sz < rawlen) {
+        uint8_t *buf = realloc(host_node_ptr->inflate_buf, rawlen);
+        if (buf == NULL)
+            return -1;
+        host_node_ptr->inflate_buf = buf;
+        host_node_ptr->inflate_sz = rawlen;
+    }
+
+    rc = read_stream(netinfo_ptr, host_node_ptr, host_node_ptr->sb,
+                     host_node_ptr->inflate_in, zlen);
+    if (rc != zlen)
+        return -1;
+
+    start = thread_cpu_us();
+    rc = LZ4_decompress_safe((char *)host_node_ptr->inflate_in,
+                             (char *)host_node_ptr->inflate_buf, zlen, rawlen);
+    start = thread_cpu_us() - start;
+    host_node_ptr->stats.decompress_us += start;
+    netinfo_ptr->stats.decompress_us += start;
+
+    if (rc != rawlen) {
+        host_node_errf(LOGMSG_ERROR, host_node_ptr,
+                       "%s: decompressed %d bytes, expected %d\n", __func__, rc,
+                       rawlen);
+        return -1;
+    }
+
+    host_node_ptr->inflate_len = rawlen;
+    host_node_ptr->inflate_off = 0;
+
+    host_node_ptr->stats.decompress_frames++;
+    host_node_ptr->stats.decompress_in += zlen;
+    host_node_ptr->stats.decompress_out += rawlen;
+    netinfo_ptr->stats.decompress_frames++;
+    netinfo_ptr->stats.decompress_in += zlen;
+    netinfo_ptr->stats.decompress_out += rawlen;
+
+    return 0;
+}
+
 static void *reader_thread(void *arg)
 {
     netinfo_type *netinfo_ptr;
@@ -4611,6 +5025,16 @@ static void *reader_thread(void *arg)
             }
             break;
 
+        case WIRE_HEADER_COMPRESSED:
+            rc = process_compressed(netinfo_ptr, host_node_ptr);
+            if (rc != 0) {
+                logmsg(LOGMSG_ERROR,
+                       "reader thread: compressed frame error from host %s\n",
+                       host_node_ptr->host);
+                goto done;
+            }
+            break;
+
         default:
             logmsg(LOGMSG_ERROR, 
                    "reader thread: unknown wire_header.type: %d from host %s\n",
@@ -4625,6 +5049,12 @@ static void *reader_thread(void *arg)
 
 done:
 
+    free(host_node_ptr->inflate_buf);
+    free(host_node_ptr->inflate_in);
+    host_node_ptr->inflate_buf = host_node_ptr->inflate_in = NULL;
+    host_node_ptr->inflate_sz = host_node_ptr->inflate_in_sz = 0;
+    host_node_ptr->inflate_len = host_node_ptr->inflate_off = 0;
+
     Pthread_mutex_lock(&(host_node_ptr->lock));
     host_node_ptr->have_reader_thread = 0;
     if (gbl_verbose_net)
@@ -5121,8 +5551,9 @@ static void *connect_thread(void *arg)
             logmsg(LOGMSG_USER, "Setting wrapper\n");
             /* override sbuf2 defaults for testing */
             sbuf2setr(host_node_ptr->sb, sbuf2read_wrapper);
-            sbuf2setw(host_node_ptr->sb, sbuf2write_wrapper);
         }
+        /* the write wrapper also counts the writer thread's syscalls */
+        sbuf2setw(host_node_ptr->sb, sbuf2write_wrapper);
 
         /* doesn't matter - it's under lock ... */
         host_node_ptr->timestamp = time(NULL);
@@ -5796,8 +6227,8 @@ static void *accept_thread(void *arg)
         if (debug_switch_net_verbose()) {
             logmsg(LOGMSG_DEBUG, "Setting wrapper\n");
             sbuf2setr(sb, sbuf2read_wrapper);
-            sbuf2setw(sb, sbuf2write_wrapper);
         }
+        sbuf2setw(sb, sbuf2write_wrapper);
 
         sbuf2setbufsize(sb, netinfo_ptr->bufsz);
 
@@ -6722,6 +7153,75 @@ int net_get_network_usage(netinfo_type *netinfo_ptr,
     return 0;
 }
 
+int net_get_write_syscalls(netinfo_type *netinfo_ptr, const char *host,
+                           unsigned long long *syscalls,
+                           unsigned long long *writev_items,
+                           unsigned long long *writev_short)
+{
+    host_node_type *ptr;
+
+    if (host == NULL) {
+        *syscalls = netinfo_ptr->stats.write_syscalls;
+        *writev_items = netinfo_ptr->stats.writev_items;
+        *writev_short = netinfo_ptr->stats.writev_short;
+        return 0;
+    }
+
+    Pthread_rwlock_rdlock(&(netinfo_ptr->lock));
+    for (ptr = netinfo_ptr->head; ptr != NULL; ptr = ptr->next) {
+        if (ptr->host == host)
+            break;
+    }
+    Pthread_rwlock_unlock(&(netinfo_ptr->lock));
+
+    if (ptr == NULL)
+        return -1;
+
+    *syscalls = ptr->stats.write_syscalls;
+    *writev_items = ptr->stats.writev_items;
+    *writev_short = ptr->stats.writev_short;
+
+    return 0;
+}
+
+int net_get_compress_stats(netinfo_type *netinfo_ptr, const char *host,
+                           unsigned long long *frames_out,
+                           unsigned long long *bytes_in,
+                           unsigned long long *bytes_out,
+                           unsigned long long *cpu_us_out,
+                           unsigned long long *frames_in,
+                           unsigned long long *inflate_in,
+                           unsigned long long *inflate_out,
+                           unsigned long long *cpu_us_in)
+{
+    stats_type *stats = &netinfo_ptr->stats;
+    host_node_type *ptr;
+
+    if (host != NULL) {
+        Pthread_rwlock_rdlock(&(netinfo_ptr->lock));
+        for (ptr = netinfo_ptr->head; ptr != NULL; ptr = ptr->next) {
+            if (ptr->host == host)
+                break;
+        }
+        Pthread_rwlock_unlock(&(netinfo_ptr->lock));
+
+        if (ptr == NULL)
+            return -1;
+        stats = &ptr->stats;
+    }
+
+    *frames_out = stats->compress_frames;
+    *bytes_in = stats->compress_in;
+    *bytes_out = stats->compress_out;
+    *cpu_us_out = stats->compress_us;
+    *frames_in = stats->decompress_frames;
+    *inflate_in = stats->decompress_in;
+    *inflate_out = stats->decompress_out;
+    *cpu_us_in = stats->decompress_us;
+
+    return 0;
+}
+
 int net_get_my_port(netinfo_type *netinfo_ptr) { return netinfo_ptr->myport; }
 
 void net_trace(netinfo_type *netinfo_ptr, int on) { netinfo_ptr->trace = on; }
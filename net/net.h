@@ -194,7 +194,8 @@ enum {
     WIRE_HEADER_ACK = 6,
     WIRE_HEADER_HELLO_REPLY = 7,
     WIRE_HEADER_DECOM_NAME = 8,
-    WIRE_HEADER_ACK_PAYLOAD = 9
+    WIRE_HEADER_ACK_PAYLOAD = 9,
+    WIRE_HEADER_COMPRESSED = 10 /* only sent to peers advertising LZ4 */
 };
 
 /*
@@ -388,6 +389,27 @@ int net_get_network_usage(netinfo_type *netinfo_ptr,
                           unsigned long long *throttle_waits,
                           unsigned long long *reorders);
 
+/* Socket write syscalls made by the writer thread(s), how many queued items
+ * went out through writev and how many writevs were partial.  host NULL
+ * gives totals. */
+int net_get_write_syscalls(netinfo_type *netinfo_ptr, const char *host,
+                           unsigned long long *syscalls,
+                           unsigned long long *writev_items,
+                           unsigned long long *writev_short);
+
+/* Compression counters for a peer, or totals if host is NULL.  in/out are
+ * bytes before/after compression on the send side, and compressed/inflated
+ * bytes on the receive side. */
+int net_get_compress_stats(netinfo_type *netinfo_ptr, const char *host,
+                           unsigned long long *frames_out,
+                           unsigned long long *bytes_in,
+                           unsigned long long *bytes_out,
+                           unsigned long long *cpu_us_out,
+                           unsigned long long *frames_in,
+                           unsigned long long *inflate_in,
+                           unsigned long long *inflate_out,
+                           unsigned long long *cpu_us_in);
+
 int net_get_queue_size(netinfo_type *netinfo_type, const char *host, int *limit,
                        int *usage);
 
@@ -25,6 +25,7 @@
 
 #include <netinet/in.h>
 #include <pthread.h>
+#include <stdint.h>
 
 #include "list.h"
 #include "compile_time_assert.h"
@@ -63,6 +64,19 @@ enum { NET_WIRE_HEADER_TYPE_LEN = 16 + 4 + 4 + 16 + 4 + 4 + 4 };
 BB_COMPILE_TIME_ASSERT(net_write_header_type,
                        sizeof(wire_header_type) == NET_WIRE_HEADER_TYPE_LEN);
 
+/* Capabilities are advertised in a trailer after the host list of hello and
+ * hello reply messages.  Older nodes read the whole message and ignore it. */
+#define NET_HELLO_CAPS_MAGIC 0x43415053 /* "CAPS" */
+enum {
+    NET_CAP_LZ4 = 1 /* can read WIRE_HEADER_COMPRESSED frames */
+};
+
+/* A compressed frame is a wire header (plus long hostnames) followed by the
+ * raw and compressed lengths and an LZ4 block.  The block decompresses to
+ * complete WIRE_HEADER_USER_MSG messages exactly as they would otherwise
+ * have been written to the socket. */
+enum { NET_COMPRESSED_HEADER_LEN = 4 + 4 };
+
 typedef struct write_node_data {
     int flags;
     int enque_time;
@@ -123,6 +137,17 @@ typedef struct {
     unsigned long long bytes_read;
     unsigned long long throttle_waits;
     unsigned long long reorders;
+    unsigned long long write_syscalls; /* write/writev calls by the writer */
+    unsigned long long writev_items;   /* items sent with writev */
+    unsigned long long writev_short;   /* writev calls that came back short */
+    unsigned long long compress_frames;
+    unsigned long long compress_in;  /* bytes before compression */
+    unsigned long long compress_out; /* bytes sent, including frame headers */
+    unsigned long long compress_us;  /* writer cpu time compressing */
+    unsigned long long decompress_frames;
+    unsigned long long decompress_in;
+    unsigned long long decompress_out;
+    unsigned long long decompress_us; /* reader cpu time decompressing */
 } stats_type;
 
 struct host_node_tag {
@@ -154,6 +179,7 @@ struct host_node_tag {
     pthread_mutex_t write_lock;
     pthread_cond_t write_wakeup;
     int got_hello;
+    int peer_caps; /* NET_CAP_ flags from the peer's hello */
     int running_user_func; /* This is a count of how many are running */
     int closed;
     int really_closed;
@@ -195,6 +221,15 @@ struct host_node_tag {
 
     void *user_data_buf;
 
+    /* Owned by the reader thread: a decompressed frame whose messages are
+     * read back through read_stream before the socket is read again. */
+    uint8_t *inflate_buf;
+    int inflate_sz;
+    int inflate_len;
+    int inflate_off;
+    uint8_t *inflate_in;
+    int inflate_in_sz;
+
     HostInfo udp_info;
     int num_sends;
     unsigned long long num_flushes;
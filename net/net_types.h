@@ -81,6 +81,9 @@ enum {
     NET_AUTHENTICATION_CHECK = 170,
     NET_OSQL_UUID_REQUEST_MAX,
 
+    /* A frame of batched osql ops; each op inside carries its own type */
+    NET_OSQL_FRAME = 172,
+
     MAX_USER_TYPE
 };
 
@@ -565,6 +565,8 @@ static void stat_thread_int(struct dbtable *db, int fullstat, int walk_queue)
                bdbstats->n_new_way_frags_aborted,
                bdbstats->n_new_way_geese_consumed,
                bdbstats->n_old_way_frags_consumed);
+        logmsg(LOGMSG_USER, "  bdb batch gets     %u (%u items)\n",
+               bdbstats->n_batch_gets, bdbstats->n_batch_items_got);
 
         if (db->dbtype == DBTYPE_QUEUEDB)
             Pthread_rwlock_rdlock(&db->consumer_lk);
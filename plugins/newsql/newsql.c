@@ -37,6 +37,8 @@ struct sbuf2;
 extern char gbl_dbname[MAX_DBNAME_LENGTH];
 extern int gbl_sqlwrtimeoutms;
 extern int active_appsock_conns;
+extern int gbl_appsock_park_idle;
+extern int gbl_use_appsock_as_sqlthread;
 #if WITH_SSL
 extern ssl_mode gbl_client_ssl_mode;
 extern SSL_CTX *gbl_ssl_ctx;
@@ -56,6 +58,7 @@ int sbuf_is_local(SBUF2 *sb);
 static int newsql_clr_snapshot(struct sqlclntstate *);
 static int newsql_has_high_availability(struct sqlclntstate *);
 static int newsql_has_parallel_sql(struct sqlclntstate *);
+static int newsql_send_row_batch(struct sqlclntstate *);
 
 struct newsqlheader {
     int type;        /*  newsql request/response type */
@@ -117,6 +120,7 @@ struct newsql_appdata {
     CDB2QUERY *query;
     CDB2SQLQUERY *sqlquery;
     struct newsql_postponed_data *postponed;
+    struct newsql_row_batch *batch;
 
     /* row buf */
     size_t packed_capacity;
@@ -406,6 +410,8 @@ static int newsql_response_int(struct sqlclntstate *clnt,
 
     int rc;
     lock_client_write_lock(clnt);
+    if ((rc = newsql_send_row_batch(clnt)) != 0)
+        goto done;
     if ((rc = sbuf2write((char *)&hdr, sizeof(hdr), clnt->sb)) != sizeof(hdr))
         goto done;
     if ((rc = sbuf2write((char *)buf, len, clnt->sb)) != len)
@@ -424,6 +430,319 @@ static int newsql_response(struct sqlclntstate *c, const CDB2SQLRESPONSE *r,
     return newsql_response_int(c, r, RESPONSE_HEADER__SQL_RESPONSE, flush);
 }
 
+int gbl_newsql_row_batch = 0;
+int gbl_newsql_row_batch_bytes = 64 * 1024;
+
+/*
+  Clients with the ROW_BATCH feature get their rows collected column by column
+  and shipped as one ROW_BATCH response. Layout of the row_batch payload, with
+  all counts in network byte order and values encoded as in COLUMN_VALUES:
+
+    nrows, ncols
+    for each column:
+      width       value size of a fixed width column, 0 for text and blobs
+      datalen     size of data
+      nulls       (nrows + 7) / 8 bytes, bit set for a NULL value
+      offsets     nrows + 1 entries into data, variable width columns only
+      data        values back to back; NULLs of fixed width columns are zeroed
+*/
+struct newsql_batch_col {
+    int width;
+    uint8_t *nulls;
+    uint32_t *offsets;
+    uint8_t *data;
+    size_t len;
+    size_t capacity;
+};
+
+struct newsql_row_batch {
+    int nrows;
+    int ncols;
+    int row_capacity;
+    int col_capacity;
+    size_t bytes;
+    struct newsql_batch_col *cols;
+    size_t block_capacity;
+    uint8_t *block;
+    size_t packed_capacity;
+    uint8_t *packed;
+};
+
+static int newsql_batch_width(int type)
+{
+    switch (type) {
+    case SQLITE_INTEGER:
+        return sizeof(int64_t);
+    case SQLITE_FLOAT:
+        return sizeof(double);
+    case SQLITE_DATETIME:
+    case SQLITE_DATETIMEUS:
+        return sizeof(cdb2_client_datetime_t);
+    case SQLITE_INTERVAL_YM:
+        return sizeof(cdb2_client_intv_ym_t);
+    case SQLITE_INTERVAL_DS:
+    case SQLITE_INTERVAL_DSUS:
+        return sizeof(cdb2_client_intv_ds_t);
+    default:
+        return 0;
+    }
+}
+
+static void free_row_batch(struct newsql_row_batch *b)
+{
+    if (b == NULL) {
+        return;
+    }
+    for (int i = 0; i < b->col_capacity; ++i) {
+        free(b->cols[i].nulls);
+        free(b->cols[i].offsets);
+        free(b->cols[i].data);
+    }
+    free(b->cols);
+    free(b->block);
+    free(b->packed);
+    free(b);
+}
+
+static int newsql_can_batch(struct sqlclntstate *clnt,
+                            struct response_data *arg)
+{
+    if (gbl_newsql_row_batch < 2 || arg->pingpong || clnt->num_retry) {
+        return 0;
+    }
+    struct newsql_appdata *appdata = clnt->appdata;
+    CDB2SQLQUERY *sqlquery = appdata->sqlquery;
+    for (int i = 0; i < sqlquery->n_features; ++i) {
+        if (sqlquery->features[i] == CDB2_CLIENT_FEATURES__ROW_BATCH) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static uint8_t *newsql_put_u32(uint8_t *p, uint32_t v)
+{
+    v = htonl(v);
+    memcpy(p, &v, sizeof(v));
+    return p + sizeof(v);
+}
+
+/* Caller holds the client write lock */
+static int newsql_send_row_batch(struct sqlclntstate *clnt)
+{
+    struct newsql_appdata *appdata = clnt->appdata;
+    struct newsql_row_batch *b = appdata ? appdata->batch : NULL;
+    if (b == NULL || b->nrows == 0) {
+        return 0;
+    }
+    int nrows = b->nrows;
+    size_t nullsz = (nrows + 7) / 8;
+    size_t len = 2 * sizeof(uint32_t);
+    for (int i = 0; i < b->ncols; ++i) {
+        len += 2 * sizeof(uint32_t) + nullsz + b->cols[i].len;
+        if (b->cols[i].width == 0) {
+            len += (nrows + 1) * sizeof(uint32_t);
+        }
+    }
+    if (b->block_capacity < len) {
+        uint8_t *block = malloc_resize(b->block, len + 1024);
+        if (block == NULL) {
+            logmsg(LOGMSG_ERROR, "%s: malloc %zu bytes\n", __func__, len);
+            return -1;
+        }
+        b->block = block;
+        b->block_capacity = len + 1024;
+    }
+    uint8_t *p = newsql_put_u32(b->block, nrows);
+    p = newsql_put_u32(p, b->ncols);
+    for (int i = 0; i < b->ncols; ++i) {
+        struct newsql_batch_col *c = &b->cols[i];
+        p = newsql_put_u32(p, c->width);
+        p = newsql_put_u32(p, c->len);
+        memcpy(p, c->nulls, nullsz);
+        p += nullsz;
+        if (c->width == 0) {
+            for (int r = 0; r <= nrows; ++r) {
+                p = newsql_put_u32(p, c->offsets[r]);
+            }
+        }
+        memcpy(p, c->data, c->len);
+        p += c->len;
+    }
+    b->nrows = 0;
+
+    CDB2SQLRESPONSE r = CDB2__SQLRESPONSE__INIT;
+    r.response_type = RESPONSE_TYPE__ROW_BATCH;
+    r.has_row_batch = 1;
+    r.row_batch.data = b->block;
+    r.row_batch.len = len;
+    size_t packed_len = cdb2__sqlresponse__get_packed_size(&r);
+    if (b->packed_capacity < packed_len) {
+        uint8_t *packed = malloc_resize(b->packed, packed_len + 1024);
+        if (packed == NULL) {
+            logmsg(LOGMSG_ERROR, "%s: malloc %zu bytes\n", __func__,
+                   packed_len);
+            return -1;
+        }
+        b->packed = packed;
+        b->packed_capacity = packed_len + 1024;
+    }
+    cdb2__sqlresponse__pack(&r, b->packed);
+
+    struct newsqlheader hdr = {0};
+    hdr.type = ntohl(RESPONSE_HEADER__SQL_RESPONSE);
+    hdr.length = ntohl(packed_len);
+    if (sbuf2write((char *)&hdr, sizeof(hdr), clnt->sb) != sizeof(hdr))
+        return -1;
+    if (sbuf2write((char *)b->packed, packed_len, clnt->sb) != packed_len)
+        return -1;
+    return 0;
+}
+
+/* Returns non-zero if the batch could not be grown; it is left usable */
+static int newsql_batch_grow(struct newsql_row_batch *b, int ncols)
+{
+    if (b->col_capacity < ncols) {
+        struct newsql_batch_col *cols;
+        cols = realloc(b->cols, ncols * sizeof(struct newsql_batch_col));
+        if (cols == NULL) {
+            return -1;
+        }
+        b->cols = cols;
+        for (int i = b->col_capacity; i < ncols; ++i) {
+            struct newsql_batch_col *c = &b->cols[i];
+            memset(c, 0, sizeof(*c));
+            c->nulls = calloc((b->row_capacity + 7) / 8 + 1, 1);
+            c->offsets = calloc(b->row_capacity + 1, sizeof(uint32_t));
+            if (c->nulls == NULL || c->offsets == NULL) {
+                free(c->nulls);
+                free(c->offsets);
+                return -1;
+            }
+            b->col_capacity = i + 1;
+        }
+    }
+    if (b->nrows == b->row_capacity) {
+        int n = b->row_capacity ? b->row_capacity * 2 : 64;
+        for (int i = 0; i < b->col_capacity; ++i) {
+            struct newsql_batch_col *c = &b->cols[i];
+            uint8_t *nulls = realloc(c->nulls, (n + 7) / 8);
+            if (nulls == NULL) {
+                return -1;
+            }
+            c->nulls = nulls;
+            uint32_t *offsets = realloc(c->offsets, (n + 1) * sizeof(uint32_t));
+            if (offsets == NULL) {
+                return -1;
+            }
+            c->offsets = offsets;
+        }
+        b->row_capacity = n;
+    }
+    return 0;
+}
+
+/* Send what is batched so far; the row that did not fit goes on its own */
+static int newsql_batch_oom(struct sqlclntstate *clnt)
+{
+    logmsg(LOGMSG_WARN, "%s: out of memory, sending rows one at a time\n",
+           __func__);
+    int rc = newsql_send_row_batch(clnt);
+    unlock_client_write_lock(clnt);
+    return rc ? rc : 1;
+}
+
+/*
+  Add a row to the client's batch and send the batch once it is full.
+  Returns 1 if the row doesn't fit the batch layout and has to be sent on
+  its own.
+*/
+static int newsql_batch_row(struct sqlclntstate *clnt,
+                            CDB2SQLRESPONSE__Column *cols, int ncols)
+{
+    struct newsql_appdata *appdata = clnt->appdata;
+    int rc = 0;
+    lock_client_write_lock(clnt);
+    struct newsql_row_batch *b = appdata->batch;
+    if (b == NULL) {
+        b = appdata->batch = calloc(1, sizeof(struct newsql_row_batch));
+        if (b == NULL) {
+            return newsql_batch_oom(clnt);
+        }
+    } else if (b->nrows && b->ncols != ncols &&
+               (rc = newsql_send_row_batch(clnt)) != 0) {
+        unlock_client_write_lock(clnt);
+        return rc;
+    }
+    if (b->nrows == 0) {
+        if (newsql_batch_grow(b, ncols)) {
+            return newsql_batch_oom(clnt);
+        }
+        for (int i = 0; i < ncols; ++i) {
+            b->cols[i].width = newsql_batch_width(appdata->type[i]);
+            b->cols[i].len = 0;
+            b->cols[i].offsets[0] = 0;
+        }
+        b->ncols = ncols;
+        b->bytes = 0;
+    }
+    for (int i = 0; i < ncols; ++i) {
+        int width = b->cols[i].width;
+        if (width && !cols[i].isnull && cols[i].value.len != width) {
+            rc = newsql_send_row_batch(clnt);
+            unlock_client_write_lock(clnt);
+            return rc ? rc : 1;
+        }
+    }
+    if (newsql_batch_grow(b, ncols)) {
+        return newsql_batch_oom(clnt);
+    }
+    /* make room in every column before the row is added to any */
+    for (int i = 0; i < ncols; ++i) {
+        struct newsql_batch_col *c = &b->cols[i];
+        size_t len = c->width ? c->width : cols[i].value.len;
+        if (c->capacity < c->len + len) {
+            uint8_t *data = malloc_resize(c->data, (c->len + len) * 2);
+            if (data == NULL) {
+                return newsql_batch_oom(clnt);
+            }
+            c->data = data;
+            c->capacity = (c->len + len) * 2;
+        }
+    }
+    int row = b->nrows;
+    for (int i = 0; i < ncols; ++i) {
+        struct newsql_batch_col *c = &b->cols[i];
+        size_t len = c->width ? c->width : cols[i].value.len;
+        if (row % 8 == 0) {
+            c->nulls[row / 8] = 0;
+        }
+        if (cols[i].isnull) {
+            c->nulls[row / 8] |= 1 << (row % 8);
+            if (c->width == 0) {
+                len = 0;
+            }
+        }
+        if (cols[i].isnull) {
+            memset(c->data + c->len, 0, len);
+        } else {
+            memcpy(c->data + c->len, cols[i].value.data, len);
+        }
+        c->len += len;
+        if (c->width == 0) {
+            c->offsets[row + 1] = c->len;
+        }
+        b->bytes += len;
+    }
+    ++b->nrows;
+    if (b->nrows >= gbl_newsql_row_batch ||
+        b->bytes >= gbl_newsql_row_batch_bytes) {
+        rc = newsql_send_row_batch(clnt);
+    }
+    unlock_client_write_lock(clnt);
+    return rc;
+}
+
 static int get_col_type(struct sqlclntstate *clnt, sqlite3_stmt *stmt, int col)
 {
     struct newsql_appdata *appdata = clnt->appdata;
@@ -475,6 +794,7 @@ static void free_newsql_appdata(struct sqlclntstate *clnt)
         free(appdata->postponed);
         appdata->postponed = NULL;
     }
+    free_row_batch(appdata->batch);
     free(appdata->packed_buf);
     free(appdata);
     clnt->appdata = NULL;
@@ -598,7 +918,9 @@ static int newsql_error(struct sqlclntstate *c, char *r, int e)
 static int newsql_flush(struct sqlclntstate *clnt)
 {
     lock_client_write_lock(clnt);
-    int rc = sbuf2flush(clnt->sb);
+    int rc = newsql_send_row_batch(clnt);
+    if (rc == 0)
+        rc = sbuf2flush(clnt->sb);
     unlock_client_write_lock(clnt);
     return rc < 0;
 }
@@ -637,6 +959,8 @@ static int newsql_send_postponed_row(struct sqlclntstate *clnt)
     size_t len = appdata->postponed->len;
     int rc;
     lock_client_write_lock(clnt);
+    if ((rc = newsql_send_row_batch(clnt)) != 0)
+        goto done;
     if ((rc = sbuf2write(hdr, hdrsz, clnt->sb)) != hdrsz)
         goto done;
     if ((rc = sbuf2write(row, len, clnt->sb)) != len)
@@ -813,6 +1137,12 @@ static int newsql_row(struct sqlclntstate *clnt, struct response_data *arg,
             return -1;
         }
     }
+    if (!postpone && newsql_can_batch(clnt, arg)) {
+        int rc = newsql_batch_row(clnt, cols, ncols);
+        if (rc <= 0) {
+            return rc;
+        }
+    }
     CDB2SQLRESPONSE r = CDB2__SQLRESPONSE__INIT;
     r.response_type = RESPONSE_TYPE__COLUMN_VALUES;
     r.n_value = ncols;
@@ -830,6 +1160,18 @@ static int newsql_row(struct sqlclntstate *clnt, struct response_data *arg,
     return newsql_response(clnt, &r, 0);
 }
 
+/*
+  A pipelining client has already sent its next request when one is sitting
+  in our read buffer. Its reply will flush this one, so both go out in a
+  single write. Only a whole header counts: the client flushes everything it
+  has sent before it waits for a reply, so the rest of the request is on its
+  way and reading it can't block.
+*/
+static int newsql_request_pending(struct sqlclntstate *clnt)
+{
+    return sbuf2rpending(clnt->sb) >= sizeof(struct newsqlheader);
+}
+
 static int newsql_row_last(struct sqlclntstate *clnt)
 {
     CDB2SQLRESPONSE resp = CDB2__SQLRESPONSE__INIT;
@@ -837,7 +1179,7 @@ static int newsql_row_last(struct sqlclntstate *clnt)
     _has_effects(clnt, resp);
     _has_snapshot(clnt, resp);
     _has_features(clnt, resp);
-    return newsql_response(clnt, &resp, 1);
+    return newsql_response(clnt, &resp, !newsql_request_pending(clnt));
 }
 
 static int newsql_row_last_dummy(struct sqlclntstate *clnt)
@@ -953,6 +1295,12 @@ static int newsql_row_lua(struct sqlclntstate *clnt, struct response_data *arg)
             return -1;
         }
     }
+    if (newsql_can_batch(clnt, arg)) {
+        int rc = newsql_batch_row(clnt, cols, ncols);
+        if (rc <= 0) {
+            return rc;
+        }
+    }
     CDB2SQLRESPONSE r = CDB2__SQLRESPONSE__INIT;
     r.response_type = RESPONSE_TYPE__COLUMN_VALUES;
     r.n_value = ncols;
@@ -2079,12 +2427,104 @@ extern int gbl_allow_incoherent_sql;
 
 int64_t gbl_denied_appsock_connection_count = 0;
 
-#define APPDATA ((struct newsql_appdata *)(clnt.appdata))
+#define APPDATA ((struct newsql_appdata *)(clnt->appdata))
+
+/* Release everything held by this connection and close it. */
+static void newsql_cleanup(struct sqlclntstate *clnt, CDB2QUERY *query)
+{
+    SBUF2 *sb = clnt->sb;
+
+    sbuf2setclnt(sb, NULL);
+
+    if (clnt->ctrl_sqlengine == SQLENG_INTRANS_STATE) {
+        handle_sql_intrans_unrecoverable_error(clnt);
+    }
+
+    if (clnt->rawnodestats) {
+        release_node_stats(clnt->argv0, clnt->stack, clnt->origin);
+        clnt->rawnodestats = NULL;
+    }
+
+    if (clnt->argv0) {
+        free(clnt->argv0);
+        clnt->argv0 = NULL;
+    }
+
+    if (clnt->stack) {
+        free(clnt->stack);
+        clnt->stack = NULL;
+    }
+
+    close_sp(clnt);
+    osql_clean_sqlclntstate(clnt);
+
+    if (clnt->dbglog) {
+        sbuf2close(clnt->dbglog);
+        clnt->dbglog = NULL;
+    }
+
+    if (query) {
+        cdb2__query__free_unpacked(query, &pb_alloc);
+    }
+
+    free_newsql_appdata(clnt);
+
+    /* XXX free logical tran?  */
+    close_appsock(sb);
+    cleanup_clnt(clnt);
+
+    Pthread_mutex_destroy(&clnt->wait_mutex);
+    Pthread_cond_destroy(&clnt->wait_cond);
+    Pthread_mutex_destroy(&clnt->write_lock);
+    Pthread_cond_destroy(&clnt->write_cond);
+    Pthread_mutex_destroy(&clnt->dtran_mtx);
+
+    free(clnt);
+}
+
+static void newsql_loop(struct sqlclntstate *clnt, CDB2QUERY *query,
+                        struct thr_handle *thr_self);
+
+/* A parked connection has data (or went away, or idled out). */
+static void newsql_resume(struct thr_handle *thr_self, SBUF2 *sb, void *arg,
+                          int ready)
+{
+    struct sqlclntstate *clnt = arg;
+    CDB2QUERY *query = NULL;
+
+    if (ready && thr_self) {
+        thrman_change_type(thr_self, THRTYPE_APPSOCK_SQL);
+        query = read_newsql_query(thedb, clnt, sb);
+    }
+    if (query == NULL) {
+        newsql_cleanup(clnt, NULL);
+        return;
+    }
+    newsql_loop(clnt, query, thr_self);
+}
+
+/*
+  Between requests an idle connection outside of a transaction doesn't need
+  this thread. Give it to the appsock poller, which resumes it on a pool
+  thread once the next request arrives.
+*/
+static int newsql_park(struct sqlclntstate *clnt)
+{
+    if (!gbl_appsock_park_idle || gbl_use_appsock_as_sqlthread)
+        return 0;
+    if (clnt->ctrl_sqlengine != SQLENG_NORMAL_PROCESS ||
+        clnt->in_client_trans || clnt->osql.history)
+        return 0;
+    return appsock_park(clnt->sb,
+                        bdb_attr_get(thedb->bdb_attr,
+                                     BDB_ATTR_MAX_SQL_IDLE_TIME),
+                        newsql_resume, clnt) == 0;
+}
+
 static int handle_newsql_request(comdb2_appsock_arg_t *arg)
 {
     CDB2QUERY *query = NULL;
-    int rc = 0;
-    struct sqlclntstate clnt;
+    struct sqlclntstate *clnt;
     struct thr_handle *thr_self;
     struct sbuf2 *sb;
     struct dbenv *dbenv;
@@ -2137,19 +2577,26 @@ static int handle_newsql_request(comdb2_appsock_arg_t *arg)
     */
     thrman_change_type(thr_self, THRTYPE_APPSOCK_SQL);
 
-    reset_clnt(&clnt, sb, 1);
-    get_newsql_appdata(&clnt, 32);
-    plugin_set_callbacks(&clnt, newsql);
-    clnt.tzname[0] = '\0';
-    clnt.admin = arg->admin;
+    clnt = malloc(sizeof(struct sqlclntstate));
+    if (!clnt) {
+        logmsg(LOGMSG_ERROR, "%s: malloc failed for new connection\n",
+               __func__);
+        close_appsock(sb);
+        return APPSOCK_RETURN_OK;
+    }
+    reset_clnt(clnt, sb, 1);
+    get_newsql_appdata(clnt, 32);
+    plugin_set_callbacks(clnt, newsql);
+    clnt->tzname[0] = '\0';
+    clnt->admin = arg->admin;
 
-    Pthread_mutex_init(&clnt.wait_mutex, NULL);
-    Pthread_cond_init(&clnt.wait_cond, NULL);
-    Pthread_mutex_init(&clnt.write_lock, NULL);
-    Pthread_cond_init(&clnt.write_cond, NULL);
-    Pthread_mutex_init(&clnt.dtran_mtx, NULL);
+    Pthread_mutex_init(&clnt->wait_mutex, NULL);
+    Pthread_cond_init(&clnt->wait_cond, NULL);
+    Pthread_mutex_init(&clnt->write_lock, NULL);
+    Pthread_cond_init(&clnt->write_cond, NULL);
+    Pthread_mutex_init(&clnt->dtran_mtx, NULL);
 
-    if (!clnt.admin &&
+    if (!clnt->admin &&
         active_appsock_conns >
             bdb_attr_get(dbenv->bdb_attr, BDB_ATTR_MAXAPPSOCKSLIMIT)) {
         static time_t pr = 0;
@@ -2164,13 +2611,13 @@ static int handle_newsql_request(comdb2_appsock_arg_t *arg)
                    gbl_denied_appsock_connection_count);
             pr = now;
         }
-        newsql_error(&clnt, "Exhausted appsock connections.",
+        newsql_error(clnt, "Exhausted appsock connections.",
                      CDB2__ERROR_CODE__APPSOCK_LIMIT);
         goto done;
     }
 
     extern int gbl_allow_incoherent_sql;
-    if (!clnt.admin && !gbl_allow_incoherent_sql &&
+    if (!clnt->admin && !gbl_allow_incoherent_sql &&
         !bdb_am_i_coherent(thedb->bdb_env)) {
         logmsg(LOGMSG_ERROR,
                "%s:%d td %u new query on incoherent node, dropping socket\n",
@@ -2178,7 +2625,7 @@ static int handle_newsql_request(comdb2_appsock_arg_t *arg)
         goto done;
     }
 
-    query = read_newsql_query(dbenv, &clnt, sb);
+    query = read_newsql_query(dbenv, clnt, sb);
     if (query == NULL) {
         logmsg(LOGMSG_DEBUG, "Query is NULL.\n");
         goto done;
@@ -2191,12 +2638,12 @@ static int handle_newsql_request(comdb2_appsock_arg_t *arg)
 
     CDB2SQLQUERY *sql_query = query->sqlquery;
 
-    if (!clnt.admin && do_query_on_master_check(dbenv, &clnt, sql_query))
+    if (!clnt->admin && do_query_on_master_check(dbenv, clnt, sql_query))
         goto done;
 
-    clnt.osql.count_changes = 1;
-    clnt.dbtran.mode = tdef_to_tranlevel(gbl_sql_tranlevel_default);
-    newsql_clr_high_availability(&clnt);
+    clnt->osql.count_changes = 1;
+    clnt->dbtran.mode = tdef_to_tranlevel(gbl_sql_tranlevel_default);
+    newsql_clr_high_availability(clnt);
 
     int notimeout = disable_server_sql_timeouts();
     sbuf2settimeout(
@@ -2214,7 +2661,7 @@ static int handle_newsql_request(comdb2_appsock_arg_t *arg)
 
     net_add_watch_warning(
         sb, bdb_attr_get(thedb->bdb_attr, BDB_ATTR_MAX_SQL_IDLE_TIME),
-        wrtimeoutsec, &clnt, watcher_warning_function);
+        wrtimeoutsec, clnt, watcher_warning_function);
 
     /* appsock threads aren't sql threads so for appsock pool threads
      * sqlthd will be NULL */
@@ -2224,7 +2671,24 @@ static int handle_newsql_request(comdb2_appsock_arg_t *arg)
         sqlthd->clnt->origin[0] = 0;
     }
 
-    sbuf2setclnt(sb, &clnt);
+    sbuf2setclnt(sb, clnt);
+
+    newsql_loop(clnt, query, thr_self);
+    return APPSOCK_RETURN_OK;
+
+done:
+    newsql_cleanup(clnt, query);
+    return APPSOCK_RETURN_OK;
+}
+
+/* Serve requests until the connection is closed or parked. */
+static void newsql_loop(struct sqlclntstate *clnt, CDB2QUERY *query,
+                        struct thr_handle *thr_self)
+{
+    struct dbenv *dbenv = thedb;
+    SBUF2 *sb = clnt->sb;
+    CDB2SQLQUERY *sql_query;
+    int rc = 0;
 
     while (query) {
         sql_query = query->sqlquery;
@@ -2233,19 +2697,19 @@ static int handle_newsql_request(comdb2_appsock_arg_t *arg)
 #endif
         APPDATA->query = query;
         APPDATA->sqlquery = sql_query;
-        clnt.sql = sql_query->sql_query;
-        if (!clnt.in_client_trans) {
-            bzero(&clnt.effects, sizeof(clnt.effects));
-            bzero(&clnt.log_effects, sizeof(clnt.log_effects));
+        clnt->sql = sql_query->sql_query;
+        if (!clnt->in_client_trans) {
+            bzero(&clnt->effects, sizeof(clnt->effects));
+            bzero(&clnt->log_effects, sizeof(clnt->log_effects));
         }
-        if (clnt.dbtran.mode < TRANLEVEL_SOSQL) {
-            clnt.dbtran.mode = TRANLEVEL_SOSQL;
+        if (clnt->dbtran.mode < TRANLEVEL_SOSQL) {
+            clnt->dbtran.mode = TRANLEVEL_SOSQL;
         }
-        clnt.osql.sent_column_data = 0;
-        clnt.stop_this_statement = 0;
+        clnt->osql.sent_column_data = 0;
+        clnt->stop_this_statement = 0;
 
-        if ((clnt.tzname[0] == '\0') && sql_query->tzname)
-            strncpy(clnt.tzname, sql_query->tzname, sizeof(clnt.tzname));
+        if ((clnt->tzname[0] == '\0') && sql_query->tzname)
+            strncpy(clnt->tzname, sql_query->tzname, sizeof(clnt->tzname));
 
         if (sql_query->dbname && dbenv->envname &&
             strcasecmp(sql_query->dbname, dbenv->envname)) {
@@ -2254,58 +2718,58 @@ static int handle_newsql_request(comdb2_appsock_arg_t *arg)
                      "DB name mismatch query:%s actual:%s", sql_query->dbname,
                      dbenv->envname);
             logmsg(LOGMSG_ERROR, "%s\n", errstr);
-            newsql_error(&clnt, errstr, CDB2__ERROR_CODE__WRONG_DB);
+            newsql_error(clnt, errstr, CDB2__ERROR_CODE__WRONG_DB);
             goto done;
         }
 
         if (sql_query->client_info) {
-            if (clnt.rawnodestats) {
-                release_node_stats(clnt.argv0, clnt.stack, clnt.origin);
-                clnt.rawnodestats = NULL;
+            if (clnt->rawnodestats) {
+                release_node_stats(clnt->argv0, clnt->stack, clnt->origin);
+                clnt->rawnodestats = NULL;
             }
-            if (clnt.conninfo.pid &&
-                clnt.conninfo.pid != sql_query->client_info->pid) {
+            if (clnt->conninfo.pid &&
+                clnt->conninfo.pid != sql_query->client_info->pid) {
                 /* Different pid is coming without reset. */
                 logmsg(LOGMSG_WARN,
                        "Multiple processes using same socket PID 1 %d "
                        "PID 2 %d Host %.8x\n",
-                       clnt.conninfo.pid, sql_query->client_info->pid,
+                       clnt->conninfo.pid, sql_query->client_info->pid,
                        sql_query->client_info->host_id);
             }
-            clnt.conninfo.pid = sql_query->client_info->pid;
-            clnt.conninfo.node = sql_query->client_info->host_id;
-            if (clnt.argv0) {
-                free(clnt.argv0);
-                clnt.argv0 = NULL;
+            clnt->conninfo.pid = sql_query->client_info->pid;
+            clnt->conninfo.node = sql_query->client_info->host_id;
+            if (clnt->argv0) {
+                free(clnt->argv0);
+                clnt->argv0 = NULL;
             }
-            if (clnt.stack) {
-                free(clnt.stack);
-                clnt.stack = NULL;
+            if (clnt->stack) {
+                free(clnt->stack);
+                clnt->stack = NULL;
             }
             if (sql_query->client_info->argv0) {
-                clnt.argv0 = strdup(sql_query->client_info->argv0);
+                clnt->argv0 = strdup(sql_query->client_info->argv0);
             }
             if (sql_query->client_info->stack) {
-                clnt.stack = strdup(sql_query->client_info->stack);
+                clnt->stack = strdup(sql_query->client_info->stack);
             }
         }
 
-        if (clnt.rawnodestats == NULL) {
-            clnt.rawnodestats = get_raw_node_stats(
-                clnt.argv0, clnt.stack, clnt.origin, sbuf2fileno(clnt.sb));
+        if (clnt->rawnodestats == NULL) {
+            clnt->rawnodestats = get_raw_node_stats(
+                clnt->argv0, clnt->stack, clnt->origin, sbuf2fileno(clnt->sb));
         }
 
-        if (process_set_commands(dbenv, &clnt, sql_query))
+        if (process_set_commands(dbenv, clnt, sql_query))
             goto done;
 
-        if (gbl_rowlocks && clnt.dbtran.mode != TRANLEVEL_SERIAL)
-            clnt.dbtran.mode = TRANLEVEL_SNAPISOL;
+        if (gbl_rowlocks && clnt->dbtran.mode != TRANLEVEL_SERIAL)
+            clnt->dbtran.mode = TRANLEVEL_SNAPISOL;
 
         /* avoid new accepting new queries/transaction on opened connections
            if we are incoherent (and not in a transaction). */
-        if (!clnt.admin && clnt.ignore_coherency == 0 &&
+        if (!clnt->admin && clnt->ignore_coherency == 0 &&
             !bdb_am_i_coherent(thedb->bdb_env) &&
-            (clnt.ctrl_sqlengine == SQLENG_NORMAL_PROCESS)) {
+            (clnt->ctrl_sqlengine == SQLENG_NORMAL_PROCESS)) {
             logmsg(LOGMSG_ERROR,
                    "%s line %d td %u new query on incoherent node, "
                    "dropping socket\n",
@@ -2313,111 +2777,71 @@ static int handle_newsql_request(comdb2_appsock_arg_t *arg)
             goto done;
         }
 
-        clnt.heartbeat = 1;
+        clnt->heartbeat = 1;
         ATOMIC_ADD(gbl_nnewsql, 1);
 
-        if (clnt.had_errors && strncasecmp(clnt.sql, "commit", 6) &&
-            strncasecmp(clnt.sql, "rollback", 8)) {
-            if (clnt.in_client_trans == 0) {
-                clnt.had_errors = 0;
+        if (clnt->had_errors && strncasecmp(clnt->sql, "commit", 6) &&
+            strncasecmp(clnt->sql, "rollback", 8)) {
+            if (clnt->in_client_trans == 0) {
+                clnt->had_errors = 0;
                 /* tell blobmem that I want my priority back
                    when the sql thread is done */
                 comdb2bma_pass_priority_back(blobmem);
-                rc = dispatch_sql_query(&clnt);
+                rc = dispatch_sql_query(clnt);
             } else {
                 /* Do Nothing */
-                newsql_heartbeat(&clnt);
+                newsql_heartbeat(clnt);
             }
-        } else if (clnt.had_errors) {
+        } else if (clnt->had_errors) {
             /* Do Nothing */
-            if (clnt.ctrl_sqlengine == SQLENG_STRT_STATE)
-                clnt.ctrl_sqlengine = SQLENG_NORMAL_PROCESS;
+            if (clnt->ctrl_sqlengine == SQLENG_STRT_STATE)
+                clnt->ctrl_sqlengine = SQLENG_NORMAL_PROCESS;
 
-            clnt.had_errors = 0;
-            clnt.in_client_trans = 0;
+            clnt->had_errors = 0;
+            clnt->in_client_trans = 0;
             rc = -1;
         } else {
             /* tell blobmem that I want my priority back
                when the sql thread is done */
             comdb2bma_pass_priority_back(blobmem);
-            rc = dispatch_sql_query(&clnt);
+            rc = dispatch_sql_query(clnt);
         }
 
-        if (clnt.osql.replay == OSQL_RETRY_DO) {
-            if (clnt.trans_has_sp) {
-                osql_set_replay(__FILE__, __LINE__, &clnt, OSQL_RETRY_NONE);
-                srs_tran_destroy(&clnt);
+        if (clnt->osql.replay == OSQL_RETRY_DO) {
+            if (clnt->trans_has_sp) {
+                osql_set_replay(__FILE__, __LINE__, clnt, OSQL_RETRY_NONE);
+                srs_tran_destroy(clnt);
             } else {
-                srs_tran_replay(&clnt, arg->thr_self);
+                srs_tran_replay(clnt, thr_self);
             }
         } else {
             /* if this transaction is done (marked by SQLENG_NORMAL_PROCESS),
                clean transaction sql history
             */
-            if (clnt.osql.history &&
-                clnt.ctrl_sqlengine == SQLENG_NORMAL_PROCESS)
-                srs_tran_destroy(&clnt);
+            if (clnt->osql.history &&
+                clnt->ctrl_sqlengine == SQLENG_NORMAL_PROCESS)
+                srs_tran_destroy(clnt);
         }
 
-        if (rc && !clnt.in_client_trans)
+        if (rc && !clnt->in_client_trans)
             goto done;
 
-        if (clnt.added_to_hist) {
-            clnt.added_to_hist = 0;
+        if (clnt->added_to_hist) {
+            clnt->added_to_hist = 0;
         } else if (APPDATA->query) {
             cdb2__query__free_unpacked(APPDATA->query, &pb_alloc);
             APPDATA->query = NULL;
         }
-        query = read_newsql_query(dbenv, &clnt, sb);
+        /* Replies held back for a pipelined request go out before we wait */
+        if (!newsql_request_pending(clnt))
+            newsql_flush(clnt);
+        if (newsql_park(clnt))
+            return;
+        query = read_newsql_query(dbenv, clnt, sb);
     }
 
 done:
-    sbuf2setclnt(sb, NULL);
-
-    if (clnt.ctrl_sqlengine == SQLENG_INTRANS_STATE) {
-        handle_sql_intrans_unrecoverable_error(&clnt);
-    }
-
-    if (clnt.rawnodestats) {
-        release_node_stats(clnt.argv0, clnt.stack, clnt.origin);
-        clnt.rawnodestats = NULL;
-    }
-
-    if (clnt.argv0) {
-        free(clnt.argv0);
-        clnt.argv0 = NULL;
-    }
-
-    if (clnt.stack) {
-        free(clnt.stack);
-        clnt.stack = NULL;
-    }
-
-    close_sp(&clnt);
-    osql_clean_sqlclntstate(&clnt);
-
-    if (clnt.dbglog) {
-        sbuf2close(clnt.dbglog);
-        clnt.dbglog = NULL;
-    }
-
-    if (query) {
-        cdb2__query__free_unpacked(query, &pb_alloc);
-    }
-
-    free_newsql_appdata(&clnt);
-
-    /* XXX free logical tran?  */
-    close_appsock(sb);
-    cleanup_clnt(&clnt);
-
-    Pthread_mutex_destroy(&clnt.wait_mutex);
-    Pthread_cond_destroy(&clnt.wait_cond);
-    Pthread_mutex_destroy(&clnt.write_lock);
-    Pthread_cond_destroy(&clnt.write_cond);
-    Pthread_mutex_destroy(&clnt.dtran_mtx);
-
-    return APPSOCK_RETURN_OK;
+    newsql_cleanup(clnt, query);
 }
 
 comdb2_appsock_t newsql_plugin = {
@@ -100,6 +100,12 @@ int finalize_drop_table(struct ireq *iq, struct schema_change_type *s,
         return rc;
     }
 
+    if ((rc = bdb_del_rowcounts(tran, db->tablename, &bdberr))) {
+        sc_errf(s, "%s: bdb_del_rowcounts failed with rc: %d bdberr: %d\n",
+                __func__, rc, bdberr);
+        return rc;
+    }
+
     if ((rc = table_version_upsert(db, tran, &bdberr)) != 0) {
         sc_errf(s, "Failed updating table version bdberr %d\n", bdberr);
         return rc;
@@ -0,0 +1,58 @@
+/*
+   Copyright 2019 Bloomberg Finance L.P.
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include "comdb2.h"
+#include "comdb2systblInt.h"
+#include "ezsystables.h"
+#include "cdb2api.h"
+#include <dbinc/rep_profile.h>
+
+/*
+  comdb2_repl_apply_profile: Where a replicant spends its time applying log
+  records, one row per stage plus one page-apply row per file.
+*/
+
+static int get_apply_profile(void **data, int *records)
+{
+    return __rep_apply_profile_get((struct rep_apply_profile **)data, records);
+}
+
+static void free_apply_profile(void *data, int records)
+{
+    __rep_apply_profile_free(data, records);
+}
+
+int systblReplApplyProfileInit(sqlite3 *db)
+{
+    return create_system_table(
+        db, "comdb2_repl_apply_profile", get_apply_profile,
+        free_apply_profile, sizeof(struct rep_apply_profile),
+        CDB2_CSTRING, "stage", -1, offsetof(struct rep_apply_profile, stage),
+        CDB2_CSTRING, "file", -1, offsetof(struct rep_apply_profile, file),
+        CDB2_INTEGER, "count", -1, offsetof(struct rep_apply_profile, count),
+        CDB2_INTEGER, "records", -1,
+            offsetof(struct rep_apply_profile, records),
+        CDB2_INTEGER, "total_us", -1,
+            offsetof(struct rep_apply_profile, total_us),
+        CDB2_INTEGER, "max_us", -1, offsetof(struct rep_apply_profile, max_us),
+        CDB2_INTEGER, "p50_us", -1, offsetof(struct rep_apply_profile, p50_us),
+        CDB2_INTEGER, "p90_us", -1, offsetof(struct rep_apply_profile, p90_us),
+        CDB2_INTEGER, "p99_us", -1, offsetof(struct rep_apply_profile, p99_us),
+        SYSTABLE_END_OF_FIELDS);
+}
@@ -142,16 +142,45 @@ Cdb2TrigTables *comdb2AddTriggerTable(Parse *parse, Cdb2TrigTables *tables,
 }
 
 // dynamic -> consumer
+// partkey, npart -> route events to npart sub-queues by partkey
 void comdb2CreateTrigger(Parse *parse, int dynamic, Token *proc,
-                         Cdb2TrigTables *tbl)
+                         Cdb2TrigTables *tbl, Token *partkey, Token *npart)
 {
     char spname[MAX_SPNAME];
+    char keyname[MAXCOLNAME + 1];
+    int nparts = 0;
     if (comdb2AuthenticateUserOp(parse))
         return;
     if (comdb2TokenToStr(proc, spname, sizeof(spname))) {
         sqlite3ErrorMsg(parse, "Procedure name is too long");
         return;
     }
+    if (partkey) {
+        char num[16];
+        if (comdb2TokenToStr(partkey, keyname, sizeof(keyname))) {
+            sqlite3ErrorMsg(parse, "Partition column name is too long");
+            return;
+        }
+        if (comdb2TokenToStr(npart, num, sizeof(num)) ||
+            !sqlite3GetInt32(num, &nparts) || nparts < 1 ||
+            nparts > BDBQUEUE_MAX_PARTITIONS) {
+            sqlite3ErrorMsg(parse, "Number of partitions must be 1-%d",
+                            BDBQUEUE_MAX_PARTITIONS);
+            return;
+        }
+        for (Cdb2TrigTables *t = tbl; t; t = t->next) {
+            int i;
+            for (i = 0; i < t->table->nCol; ++i) {
+                if (strcasecmp(t->table->aCol[i].zName, keyname) == 0)
+                    break;
+            }
+            if (i == t->table->nCol) {
+                sqlite3ErrorMsg(parse, "no such column:%s in table:%s",
+                                keyname, t->table->zName);
+                return;
+            }
+        }
+    }
 
 	Q4SP(qname, spname);
 	if (getqueuebyname(qname)) {
@@ -198,6 +227,9 @@ void comdb2CreateTrigger(Parse *parse, int dynamic, Token *proc,
 		}
 		free(prev);
 	}
+	if (nparts > 1) {
+		strbuf_appendf(s, "partition %d %s\n", nparts, keyname);
+	}
 
 	char method[64];
 	sprintf(method, "dest:%s:%s", dynamic ? "dynlua" : "lua", spname);
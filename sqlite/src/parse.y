@@ -2341,11 +2341,15 @@ cmd ::= createkw LUA AGGREGATE FUNCTION nm(Q). {
 }
 
 cmd ::= createkw LUA TRIGGER nm(Q) ON table_trigger_event(T). {
-  comdb2CreateTrigger(pParse,0,&Q,T);
+  comdb2CreateTrigger(pParse,0,&Q,T,0,0);
 }
 
 cmd ::= createkw LUA CONSUMER nm(Q) ON table_trigger_event(T). {
-  comdb2CreateTrigger(pParse,1,&Q,T);
+  comdb2CreateTrigger(pParse,1,&Q,T,0,0);
+}
+
+cmd ::= createkw LUA CONSUMER nm(Q) ON table_trigger_event(T) PARTITION BY nm(C) INTO INTEGER(N). {
+  comdb2CreateTrigger(pParse,1,&Q,T,&C,&N);
 }
 
 table_trigger_event(A) ::= table_trigger_event(B) COMMA LP TABLE fullname(T) FOR trigger_events(C) RP. {
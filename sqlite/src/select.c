@@ -6419,10 +6419,28 @@ int sqlite3Select(
     assert( WHERE_USE_LIMIT==SF_FixedLimit );
 
 
+#if defined(SQLITE_BUILDING_FOR_COMDB2)
+    /* A lone remote table whose rows go straight to the output can stop
+    ** after LIMIT+OFFSET rows; codeCursorHint() decides if it is a full
+    ** scan with the whole WHERE clause pushed into the remote query. */
+    if( p->iLimit && pTabList->nSrc==1 && pTabList->a[0].zDatabase
+     && sSort.pOrderBy==0 && !sDistinct.isTnct
+#ifndef SQLITE_OMIT_WINDOWFUNC
+     && pWin==0
+#endif
+    ){
+      pParse->iRemoteLimit = p->iOffset ? p->iOffset+1 : p->iLimit;
+      pParse->iRemoteLimitCur = pTabList->a[0].iCursor;
+    }
+#endif /* defined(SQLITE_BUILDING_FOR_COMDB2) */
+
     /* Begin the database scan. */
     SELECTTRACE(1,pParse,p,("WhereBegin\n"));
     pWInfo = sqlite3WhereBegin(pParse, pTabList, pWhere, sSort.pOrderBy,
                                p->pEList, wctrlFlags, p->nSelectRow);
+#if defined(SQLITE_BUILDING_FOR_COMDB2)
+    pParse->iRemoteLimit = 0;
+#endif /* defined(SQLITE_BUILDING_FOR_COMDB2) */
     if( pWInfo==0 ) goto select_end;
     if( sqlite3WhereOutputRowCount(pWInfo) < p->nSelectRow ){
       p->nSelectRow = sqlite3WhereOutputRowCount(pWInfo);
@@ -3305,6 +3305,8 @@ struct Parse {
   u8 write;                 /* Write transaction during sqlite3FinishCoding? */
   Cdb2DDL *comdb2_ddl_ctx;  /* Context for DDL commands */
   ast_t *ast;
+  int iRemoteLimit;         /* Register with LIMIT+OFFSET a remote scan may use */
+  int iRemoteLimitCur;      /* ... and the cursor of that scan */
 #endif /* defined(SQLITE_BUILDING_FOR_COMDB2) */
 };
 
@@ -4947,7 +4949,7 @@ struct Cdb2TrigTables {
 Cdb2TrigEvents *comdb2AddTriggerEvent(Parse*,Cdb2TrigEvents*,Cdb2TrigEvent*);
 void comdb2DropTrigger(Parse*,Token*);
 Cdb2TrigTables *comdb2AddTriggerTable(Parse*,Cdb2TrigTables*,SrcList*,Cdb2TrigEvents*);
-void comdb2CreateTrigger(Parse*,int dynamic,Token*,Cdb2TrigTables*);
+void comdb2CreateTrigger(Parse*,int dynamic,Token*,Cdb2TrigTables*,Token*,Token*);
 
 void comdb2CreateScalarFunc(Parse *, Token *);
 void comdb2DropScalarFunc(Parse *, Token *);
@@ -182,9 +182,17 @@ int sqlite3BtreeNewDb(Btree *p);
 **     to prefetch content from remote machines - to provide those
 **     implementations with limits on what needs to be prefetched and thereby
 **     reduce network bandwidth.
+**
+** BTREE_HINT_LIMIT  (arguments: i64, int)
+**
+**     The cursor is the only loop of a query and the query stops after the
+**     given number of rows are read from it, so a remote b-tree may stop
+**     fetching there.  The second argument is non-zero if this only holds
+**     when the BTREE_HINT_RANGE expression is applied as well.
 */
 #define BTREE_HINT_FLAGS 1       /* Set flags indicating cursor usage */
 #define BTREE_HINT_RANGE 2       /* Range constraints on queries */
+#define BTREE_HINT_LIMIT 3       /* Row limit for a single loop query */
 
 /*
 ** Values that may be OR'd together to form the second argument to the
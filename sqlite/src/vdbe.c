@@ -8300,25 +8300,41 @@ case OP_Init: {          /* jump */
 }
 
 #ifdef SQLITE_ENABLE_CURSOR_HINTS
-/* Opcode: CursorHint P1 * * P4 *
+/* Opcode: CursorHint P1 P2 * P4 *
 **
 ** Provide a hint to cursor P1 that it only needs to return rows that
 ** satisfy the Expr in P4.  TK_REGISTER terms in the P4 expression refer
 ** to values currently held in registers.  TK_COLUMN terms in the P4
 ** expression refer to columns in the b-tree to which cursor P1 is pointing.
+**
+** In comdb2, P4 may be NULL, and if P2 is non-zero register P2 holds the
+** most rows the query will read from cursor P1.
 */
 case OP_CursorHint: {
   VdbeCursor *pC;
 
   assert( pOp->p1>=0 && pOp->p1<p->nCursor );
+#if defined(SQLITE_BUILDING_FOR_COMDB2)
+  assert( pOp->p4type==P4_EXPR || pOp->p4.pExpr==0 );
+#else /* defined(SQLITE_BUILDING_FOR_COMDB2) */
   assert( pOp->p4type==P4_EXPR );
+#endif /* defined(SQLITE_BUILDING_FOR_COMDB2) */
   pC = p->apCsr[pOp->p1];
   if( pC ){
 #if !defined(SQLITE_BUILDING_FOR_COMDB2)
     assert( pC->eCurType==CURTYPE_BTREE );
-#endif /* !defined(SQLITE_BUILDING_FOR_COMDB2) */
     sqlite3BtreeCursorHint(pC->uc.pCursor, BTREE_HINT_RANGE,
                            pOp->p4.pExpr, aMem);
+#else /* !defined(SQLITE_BUILDING_FOR_COMDB2) */
+    if( pOp->p4.pExpr ){
+      sqlite3BtreeCursorHint(pC->uc.pCursor, BTREE_HINT_RANGE,
+                             pOp->p4.pExpr, aMem);
+    }
+    if( pOp->p2>0 ){
+      sqlite3BtreeCursorHint(pC->uc.pCursor, BTREE_HINT_LIMIT,
+                             aMem[pOp->p2].u.i, pOp->p4.pExpr!=0);
+    }
+#endif /* !defined(SQLITE_BUILDING_FOR_COMDB2) */
   }
   break;
 }
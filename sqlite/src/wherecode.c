@@ -950,6 +950,9 @@ static void codeCursorHint(
    */
   Bitmask msk;
   WhereLoop *pWLoop;
+  int nTerm = 0;        /* WHERE terms on this cursor */
+  int nHinted = 0;      /* ... and how many of them went into the hint */
+  int iLimit = 0;       /* Register with the row limit, if any */
 #endif /* defined(SQLITE_BUILDING_FOR_COMDB2) */
 
   if( OptimizationDisabled(db, SQLITE_CursorHints) ) return;
@@ -989,6 +992,7 @@ static void codeCursorHint(
        TERM_CODED commented allows me still encode equality operations
        properly*/
     if( pTerm->wtFlags & (TERM_VIRTUAL/*|TERM_CODED*/) ) continue;
+    nTerm++;
 #else /* defined(SQLITE_BUILDING_FOR_COMDB2) */
     if( pTerm->wtFlags & (TERM_VIRTUAL|TERM_CODED) ) continue;
 #endif /* defined(SQLITE_BUILDING_FOR_COMDB2) */
@@ -1061,7 +1065,29 @@ static void codeCursorHint(
 
     /* If we survive all prior tests, that means this term is worth hinting */
     pExpr = sqlite3ExprAnd(db, pExpr, sqlite3ExprDup(db, pTerm->pExpr, 0));
+#if defined(SQLITE_BUILDING_FOR_COMDB2)
+    nHinted++;
+#endif /* defined(SQLITE_BUILDING_FOR_COMDB2) */
+  }
+#if defined(SQLITE_BUILDING_FOR_COMDB2)
+  /* The row limit can go along only if no row the remote returns is
+  ** filtered out locally: a full scan hinted with every WHERE term.  The
+  ** cursor check keeps subqueries coded inside this loop from taking it. */
+  if( pParse->iRemoteLimit && pParse->iRemoteLimitCur==sHint.iTabCur
+   && pWInfo->nLevel==1 && sHint.pIdx==0
+   && pEndRange==0 && nHinted==nTerm ){
+    iLimit = pParse->iRemoteLimit;
+  }
+  if( pExpr!=0 || iLimit ){
+    if( pExpr ){
+      sWalker.xExprCallback = codeCursorHintFixExpr;
+      sqlite3WalkExpr(&sWalker, pExpr);
+    }
+    sqlite3VdbeAddOp4(v, OP_CursorHint, 
+                      (sHint.pIdx ? sHint.iIdxCur : sHint.iTabCur), iLimit, 0,
+                      (const char*)pExpr, P4_EXPR);
   }
+#else /* defined(SQLITE_BUILDING_FOR_COMDB2) */
   if( pExpr!=0 ){
     sWalker.xExprCallback = codeCursorHintFixExpr;
     sqlite3WalkExpr(&sWalker, pExpr);
@@ -1069,6 +1095,7 @@ static void codeCursorHint(
                       (sHint.pIdx ? sHint.iIdxCur : sHint.iTabCur), 0, 0,
                       (const char*)pExpr, P4_EXPR);
   }
+#endif /* defined(SQLITE_BUILDING_FOR_COMDB2) */
 }
 #else
 #if defined(SQLITE_BUILDING_FOR_COMDB2)
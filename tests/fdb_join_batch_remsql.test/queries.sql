@@ -0,0 +1,14 @@
+select o.id, r.id, r.k from o_sorted o cross join REM.r r on r.k = o.k order by o.id, r.id
+select o.id, r.id, r.k from o_unsorted o cross join REM.r r on r.k = o.k order by o.id, r.id
+select o.id, r.id from o_sorted o cross join REM.r r on r.k = o.k where o.id % 3 = 0 order by o.id, r.id
+select o.id, r.id from o_sorted o left join REM.r r on r.k = o.k order by o.id, r.id
+select o.id, r.id from o_unsorted o left join REM.r r on r.k = o.k order by o.id, r.id
+select o.id, count(r.id) from o_sorted o left join REM.r r on r.k = o.k group by o.id order by o.id
+select o.id, r.id from o_nulls o cross join REM.r r on r.k = o.k order by o.id, r.id
+select o.id, r.id from o_nulls o left join REM.r r on r.k = o.k order by o.id, r.id
+select o.id, r.id from o_nulls o cross join REM.r r on r.k is o.k order by o.id, r.id
+select o.id, r.id, r.k, r.d from o_sorted o cross join REM.rd r on r.k = o.k order by o.id, r.id
+select o.id, r.id, r.k, r.d from o_unsorted o cross join REM.rd r on r.k = o.k order by o.id, r.id
+select o.id, r.id from o_sorted o cross join REM.rd r on r.k = o.k and r.d = o.d order by o.id, r.id
+select o.id, r.id from o_unsorted o cross join REM.rd r on r.k = o.k and r.d = o.d order by o.id, r.id
+select o.id, r.id from o_nulls o left join REM.rd r on r.k = o.k and r.d = o.d order by o.id, r.id
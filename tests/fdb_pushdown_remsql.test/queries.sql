@@ -0,0 +1,20 @@
+select c0, c1, c62, c63, c64, c69 from REM.w order by c0
+select c69, c0 from REM.w where c64 % 2 = 0 order by c0
+select * from REM.w where c0 < 500
+select c63 from REM.w
+select a, b from REM.t limit 10
+select a, c from REM.t limit 10 offset 5
+select a from REM.t limit 7 offset 995
+select a from REM.t limit 5 offset 2000
+select a from REM.t limit 0
+select a, b from REM.t where b > 500 limit 7 offset 3
+select a from REM.t where b in (select b from REM.t where a < 50) limit 5
+select a from REM.t where a % 7 = (select count(*) from REM.w) % 7 limit 4 offset 2
+select a from REM.t where b > 100 and length(printf('%d', a)) = 3 limit 6 offset 1
+select a from REM.t where a < 20 union all select a from REM.t where a > 990 limit 25 offset 3
+select a from REM.t union all select c0 from REM.w limit 1010
+select * from (select a from REM.t limit 3) union all select c0 from REM.w where c0 < 300
+select count(*) from REM.t
+select count(*) from REM.w
+select count(*) from REM.t where b > 10
+select count(*) from (select a from REM.t limit 10 offset 995)
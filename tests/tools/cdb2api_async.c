@@ -0,0 +1,131 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <cdb2api.h>
+
+#define NROWS 100
+
+static int run(cdb2_hndl_tp *hndl, const char *sql)
+{
+    int rc = cdb2_run_statement(hndl, sql);
+    if (rc != 0) {
+        fprintf(stderr, "Error running '%s': %d: %s.\n", sql, rc,
+                cdb2_errstr(hndl));
+        return 1;
+    }
+    while ((rc = cdb2_next_record(hndl)) == CDB2_OK)
+        ;
+    return rc != CDB2_OK_DONE;
+}
+
+static int insert_async(cdb2_hndl_tp *hndl, int from, int to)
+{
+    for (int i = from; i < to; ++i) {
+        int rc;
+        cdb2_clearbindings(hndl);
+        cdb2_bind_param(hndl, "i", CDB2_INTEGER, &i, sizeof(i));
+        rc = cdb2_run_statement_async(hndl, "INSERT INTO t VALUES (@i)");
+        if (rc != 0) {
+            fprintf(stderr, "Error sending insert %d: %d: %s.\n", i, rc,
+                    cdb2_errstr(hndl));
+            return 1;
+        }
+    }
+    cdb2_clearbindings(hndl);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    cdb2_hndl_tp *hndl = NULL;
+    const char *conf = getenv("CDB2_CONFIG");
+    const char *db, *tier;
+    int rc;
+
+    if (argc < 2)
+        return 1;
+
+    db = argv[1];
+
+    if (argc > 2)
+        tier = argv[2];
+    else
+        tier = "default";
+
+    if (conf != NULL)
+        cdb2_set_comdb2db_config(conf);
+
+    rc = cdb2_open(&hndl, db, tier, 0);
+    if (rc != 0) {
+        fprintf(stderr, "Error opening a handle: %d: %s.\n", rc,
+                cdb2_errstr(hndl));
+        return 1;
+    }
+
+    if (run(hndl, "DROP TABLE IF EXISTS t") ||
+        run(hndl, "CREATE TABLE t (i INTEGER UNIQUE)"))
+        return 1;
+
+    /* Autocommit: every statement has a result, collected in order. */
+    if (insert_async(hndl, 0, NROWS))
+        return 1;
+    for (int i = 0; i < NROWS; ++i) {
+        cdb2_effects_tp effects;
+        rc = cdb2_next_async_result(hndl);
+        if (rc != CDB2_OK) {
+            fprintf(stderr, "Insert %d failed: %d: %s.\n", i, rc,
+                    cdb2_errstr(hndl));
+            return 1;
+        }
+        if (cdb2_get_effects(hndl, &effects) != 0 ||
+            effects.num_inserted != 1) {
+            fprintf(stderr, "Bad effects for insert %d.\n", i);
+            return 1;
+        }
+    }
+    if (cdb2_next_async_result(hndl) != CDB2_OK_DONE) {
+        fprintf(stderr, "Unexpected pending result.\n");
+        return 1;
+    }
+
+    /* A failing statement doesn't affect the ones after it. */
+    if (insert_async(hndl, NROWS - 1, NROWS + 1))
+        return 1;
+    if (cdb2_next_async_result(hndl) != CDB2ERR_DUPLICATE ||
+        cdb2_next_async_result(hndl) != CDB2_OK)
+        return 1;
+
+    /* Reads pipeline too, and their rows are read as usual. */
+    rc = cdb2_run_statement_async(hndl, "SELECT COUNT(*) FROM t");
+    if (rc != 0 || cdb2_next_async_result(hndl) != CDB2_OK ||
+        cdb2_next_record(hndl) != CDB2_OK ||
+        *(long long *)cdb2_column_value(hndl, 0) != NROWS + 1 ||
+        cdb2_next_record(hndl) != CDB2_OK_DONE) {
+        fprintf(stderr, "Bad count: %s.\n", cdb2_errstr(hndl));
+        return 1;
+    }
+
+    /* In a transaction writes have no result; COMMIT collects them. */
+    if (run(hndl, "BEGIN") || insert_async(hndl, NROWS + 1, 2 * NROWS) ||
+        run(hndl, "COMMIT"))
+        return 1;
+
+    /* cdb2_run_statement() reports errors of uncollected statements. */
+    if (insert_async(hndl, 0, 1))
+        return 1;
+    rc = cdb2_run_statement(hndl, "SELECT 1");
+    if (rc != CDB2ERR_DUPLICATE) {
+        fprintf(stderr, "Expected duplicate error, got %d.\n", rc);
+        return 1;
+    }
+
+    rc = cdb2_run_statement(hndl, "SELECT COUNT(*) FROM t");
+    if (rc != 0 || cdb2_next_record(hndl) != CDB2_OK ||
+        *(long long *)cdb2_column_value(hndl, 0) != 2 * NROWS) {
+        fprintf(stderr, "Bad final count: %s.\n", cdb2_errstr(hndl));
+        return 1;
+    }
+
+    cdb2_close(hndl);
+    return 0;
+}
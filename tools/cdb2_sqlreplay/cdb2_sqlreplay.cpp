@@ -34,23 +34,40 @@
 #include <list>
 #include <map>
 #include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
 #include <unistd.h>
 
 #include "assert.h"
 #include "cdb2api.h"
 #include "cson_amalgamation_core.h"
 
-static cdb2_hndl_tp *cdb2h = nullptr;
 std::map<std::string, std::string> sqltrack;
 std::map<std::string, std::list<cson_value*>> transactions;
 
-void replay(cdb2_hndl_tp *db, cson_value *val);
+static const char *dbname;
+static bool paced = false;     /* keep the original inter-arrival times */
+static double speedup = 1.0;   /* replay this many times faster than logged */
+static bool quiet = false;     /* don't echo statements and results */
+static int nconnections = 1;
+
+/* Workers share stdout; keep lines whole */
+static std::mutex out_lk;
 
 static const char *usage_text = 
-    "Usage: cdb2sqlreplay [-f] dbname [FILE]\n"
+    "Usage: cdb2sqlreplay [-f | -p] [-s speedup] [-j connections] [-q] dbname [FILE]\n"
     "\n"
     "Basic options:\n"
-    "  -f                Run the sql as fast as possible\n";
+    "  -f                Run the sql as fast as possible (the default)\n"
+    "  -p                Keep the logged timing between statements\n"
+    "  -s speedup        Pace at this many times the logged rate (default 1);\n"
+    "                    implies -p\n"
+    "  -j connections    Replay on this many connections; statements from the\n"
+    "                    same original client handle stay on one connection\n"
+    "  -q                Don't print statements and results, only the report\n";
 
 /* Start of functions */
 void usage() {
@@ -62,9 +79,123 @@ void usage() {
 void add_fingerprint(std::string fingerprint, std::string sql) {
     std::pair<std::string, std::string> v(fingerprint, sql);
     sqltrack.insert(v);
-    std::cout << fingerprint << " -> " << sql << std::endl;
+    if (!quiet)
+        std::cout << fingerprint << " -> " << sql << std::endl;
+}
+
+static int64_t now_us() {
+    using namespace std::chrono;
+    return duration_cast<microseconds>(
+               steady_clock::now().time_since_epoch()).count();
 }
 
+/* Log-linear latency histogram: values below 2^SUB_BITS are exact, every
+   power of two above that is split into 2^SUB_BITS buckets, so reported
+   percentiles are within ~3% of the true value at a fixed size. */
+class latency_histogram {
+    static const int SUB_BITS = 5;
+    static const int SUB_COUNT = 1 << SUB_BITS;
+    static const int NBUCKETS = (64 - SUB_BITS + 1) * SUB_COUNT;
+
+    std::vector<uint64_t> counts;
+    uint64_t total;
+    uint64_t sum;
+    uint64_t maxval;
+
+    static int bucket(uint64_t v) {
+        if (v < SUB_COUNT)
+            return v;
+        int shift = 63 - __builtin_clzll(v) - SUB_BITS;
+        return ((shift + 1) << SUB_BITS) + ((v >> shift) & (SUB_COUNT - 1));
+    }
+
+    /* largest value that lands in bucket b */
+    static uint64_t bucket_max(int b) {
+        if (b < SUB_COUNT)
+            return b;
+        int shift = (b >> SUB_BITS) - 1;
+        uint64_t sub = b & (SUB_COUNT - 1);
+        return ((SUB_COUNT + sub) << shift) + ((1ULL << shift) - 1);
+    }
+
+public:
+    latency_histogram() : counts(NBUCKETS), total(0), sum(0), maxval(0) {}
+
+    void add(uint64_t v) {
+        counts[bucket(v)]++;
+        total++;
+        sum += v;
+        if (v > maxval)
+            maxval = v;
+    }
+
+    void merge(const latency_histogram &o) {
+        for (int i = 0; i < NBUCKETS; i++)
+            counts[i] += o.counts[i];
+        total += o.total;
+        sum += o.sum;
+        if (o.maxval > maxval)
+            maxval = o.maxval;
+    }
+
+    uint64_t count() const { return total; }
+    uint64_t sum_us() const { return sum; }
+    uint64_t max() const { return maxval; }
+    uint64_t mean() const { return total ? sum / total : 0; }
+
+    uint64_t percentile(double p) const {
+        if (total == 0)
+            return 0;
+        uint64_t want = (uint64_t)(p * total + 0.999999);
+        if (want == 0)
+            want = 1;
+        uint64_t seen = 0;
+        for (int i = 0; i < NBUCKETS; i++) {
+            seen += counts[i];
+            if (seen >= want)
+                return std::min(bucket_max(i), maxval);
+        }
+        return maxval;
+    }
+};
+
+struct fingerprint_stats {
+    latency_histogram latency;
+    uint64_t errors = 0;
+};
+
+/* A statement handed from the reader to a connection */
+struct replay_work {
+    cson_value *event;
+    std::string sql;
+    std::string fingerprint;
+    int64_t time; /* logged start time in us, 0 if not logged */
+};
+
+struct replay_connection {
+    cdb2_hndl_tp *db = nullptr;
+    std::thread thd;
+    std::mutex lk;
+    std::condition_variable cv;
+    std::deque<replay_work> queue;
+    bool done = false;
+
+    /* owned by the connection's thread until it is joined */
+    std::map<std::string, fingerprint_stats> stats;
+    uint64_t statements = 0;
+    uint64_t errors = 0;
+    int64_t maxlag = 0;
+};
+
+/* Bound how far the reader gets ahead of a paced connection */
+static const size_t max_queued = 10000;
+
+static std::vector<replay_connection *> connections;
+static int64_t first_event_time = 0;
+static int64_t replay_start = 0;
+
+bool replay(cdb2_hndl_tp *db, cson_value *val, const char *sql);
+
 static bool get_ispropnull(cson_value *objval, const char *key) 
 {
     cson_object *obj;
@@ -153,47 +284,53 @@ bool event_is_sql(cson_value *val) {
     return get_strprop(val, "type") == std::string("sql");
 }
 
-void replay_transaction(cdb2_hndl_tp *db, std::list<cson_value*> &list) {
+void dispatch(cson_value *event_val);
+
+void replay_transaction(std::list<cson_value*> &list) {
     cson_value *statement;
 
-    std::cout << "replay" << std::endl;
+    if (!quiet)
+        std::cout << "replay" << std::endl;
 
     auto it = list.begin();
     while (it != list.end()) {
-        std::cout << "replaying txn" << std::endl;
+        if (!quiet)
+            std::cout << "replaying txn" << std::endl;
         if (event_is_sql(*it))
-            replay(db, *it);
-        
-        cson_free_value(*it);
+            dispatch(*it);
+        else
+            cson_free_value(*it);
         it = list.erase(it);
     }
 }
 
-void add_to_transaction(cdb2_hndl_tp *db, cson_value *val) {
+void add_to_transaction(cson_value *val) {
     const char *s = get_strprop(val, "id");
     const char *type = get_strprop(val, "type");
 
     auto i = transactions.find(s);
     if (i == transactions.end()) {
-        std::cout << "new transaction " << s << std::endl;
+        if (!quiet)
+            std::cout << "new transaction " << s << std::endl;
         std::list<cson_value*> statements;
         statements.push_back(val);
         transactions.insert(std::pair<std::string, std::list<cson_value*>>(s, statements));
     }
     else {
         auto &list = (*i).second;
-        std::cout << "add to existing transaction " << list.size() << " (" << event_is_txn(list.front()) <<  ") " << s << std::endl;
+        if (!quiet)
+            std::cout << "add to existing transaction " << list.size() << " (" << event_is_txn(list.front()) <<  ") " << s << std::endl;
         if (list.size() == 1 && event_is_txn(list.front())) {
             /* This is a single statement, and we just saw it's transaction.  We can 
                now replay the whole list. */
             list.push_back(list.front());
             list.pop_front();
-            replay_transaction(db, list);
+            replay_transaction(list);
         }
         else {
             list.push_back(val);
             if (event_is_txn(val))
-                replay_transaction(db, list);
+                replay_transaction(list);
         }
     }
 }
@@ -228,11 +365,12 @@ bool do_bindings(cdb2_hndl_tp *db, cson_value *event_val,
         int ret;
         if(get_ispropnull(bp, "value")) {
             /* bind null value as type INT for simplicity */
-            if ((ret = cdb2_bind_param(cdb2h, name, CDB2_INTEGER, NULL, 0)) != 0) {
+            if ((ret = cdb2_bind_param(db, name, CDB2_INTEGER, NULL, 0)) != 0) {
                 std::cerr << "error binding column " << name << ", ret=" << ret << std::endl;
                 return false;
             }
-            std::cout << "binding "<< type << " column " << name << " to NULL " << std::endl;
+            if (!quiet)
+                std::cout << "binding "<< type << " column " << name << " to NULL " << std::endl;
         }
         else if (strcmp(type, "largeint") == 0 || strcmp(type, "int") == 0 || strcmp(type, "smallint") == 0) {
             int64_t *iv = new int64_t;
@@ -241,11 +379,12 @@ bool do_bindings(cdb2_hndl_tp *db, cson_value *event_val,
                 std::cerr << "error getting " << type << " value of bound parameter " << name << std::endl;
                 return false;
             }
-            if ((ret = cdb2_bind_param(cdb2h, name, CDB2_INTEGER, iv, sizeof(*iv))) != 0) {
+            if ((ret = cdb2_bind_param(db, name, CDB2_INTEGER, iv, sizeof(*iv))) != 0) {
                 std::cerr << "error binding column " << name << ", ret=" << ret << std::endl;
                 return false;
             }
-            std::cout << "binding "<< type << " column " << name << " to value " << *iv << std::endl;
+            if (!quiet)
+                std::cout << "binding "<< type << " column " << name << " to value " << *iv << std::endl;
         } 
         else if (strcmp(type, "float") == 0 || strcmp(type, "doublefloat") == 0) {
             double *dv = new double;
@@ -254,11 +393,12 @@ bool do_bindings(cdb2_hndl_tp *db, cson_value *event_val,
                 std::cerr << "error getting " << type << " value of bound parameter " << name << std::endl;
                 return false;
             }
-            if ((ret = cdb2_bind_param(cdb2h, name, CDB2_REAL, dv, sizeof(*dv))) != 0) {
+            if ((ret = cdb2_bind_param(db, name, CDB2_REAL, dv, sizeof(*dv))) != 0) {
                 std::cerr << "error binding column " << name << ", ret=" << ret << std::endl;
                 return false;
             }
-            std::cout << "binding "<< type << " column " << name << " to value " << *dv << std::endl;
+            if (!quiet)
+                std::cout << "binding "<< type << " column " << name << " to value " << *dv << std::endl;
         }
         else if (strcmp(type, "char") == 0 || strcmp(type, "datetime") == 0 ||
                  strcmp(type, "datetimeus") == 0 ||
@@ -271,11 +411,12 @@ bool do_bindings(cdb2_hndl_tp *db, cson_value *event_val,
                 std::cerr << "error getting " << type << " value of bound parameter " << name << std::endl;
                 return false;
             }
-            if ((ret = cdb2_bind_param(cdb2h, name, CDB2_CSTRING, strp, strlen(strp) )) != 0) {
+            if ((ret = cdb2_bind_param(db, name, CDB2_CSTRING, strp, strlen(strp) )) != 0) {
                 std::cerr << "error binding column " << name << ", ret=" << ret << std::endl;
                 return false;
             }
-            std::cout << "binding "<< type << " column " << name << " to value " << strp << std::endl;
+            if (!quiet)
+                std::cout << "binding "<< type << " column " << name << " to value " << strp << std::endl;
         }
         else if( strcmp(type, "byte") == 0 || strcmp(type, "blob") == 0) {
             const char *strp = get_strprop(bp, "value");
@@ -293,17 +434,18 @@ bool do_bindings(cdb2_hndl_tp *db, cson_value *event_val,
             fromhex(unexpanded, (const uint8_t *) strp + 2, slen); /* no x' */
             unexpanded[unexlen] = '\0';
 
-            if ((ret = cdb2_bind_param(cdb2h, name, CDB2_BLOB, unexpanded, unexlen)) != 0) {
+            if ((ret = cdb2_bind_param(db, name, CDB2_BLOB, unexpanded, unexlen)) != 0) {
                 std::cerr << "error binding column " << name << ", ret=" << ret << std::endl;
                 free(unexpanded);
                 return false;
             }
 
             blobs_vect.push_back(unexpanded);
-            std::cout << "binding "<< type << " column " << name << " to value " << strp << std::endl;
+            if (!quiet)
+                std::cout << "binding "<< type << " column " << name << " to value " << strp << std::endl;
         }
         else
-            std::cout << "error binding unknown "<< type << " column " << name << std::endl;
+            std::cerr << "error binding unknown "<< type << " column " << name << std::endl;
     }
 
     return true;
@@ -448,42 +590,34 @@ inline void free_blobs(std::vector<uint8_t *> &blobs_vect) {
         free(*it);
 }
 
-void replay(cdb2_hndl_tp *db, cson_value *event_val) {
-    const char *sql = get_strprop(event_val, "sql");
-    if(sql == nullptr) {
-	    const char *fp = get_strprop(event_val, "fingerprint");
-	    if (fp == nullptr) {
-		    std::cerr << "No fingerprint logged?" << std::endl;
-		    return;
-	    }
-	    auto s = sqltrack.find(fp);
-	    if (s == sqltrack.end()) {
-		    std::cerr << "Unknown fingerprint? " << fp << std::endl;
-		    return;
-	    }
-	    sql = (*s).second.c_str();
-    }
-
+/* Run one statement and drain its results.  Returns false on error. */
+bool replay(cdb2_hndl_tp *db, cson_value *event_val, const char *sql) {
     std::vector<uint8_t *> blobs_vect;
     bool ok = do_bindings(db, event_val, blobs_vect);
     if (!ok) {
         free_blobs(blobs_vect);
-        return;
+        return false;
     }
 
-    std::cout << sql << std::endl;
+    if (!quiet) {
+        std::lock_guard<std::mutex> lk(out_lk);
+        std::cout << sql << std::endl;
+    }
     int rc = cdb2_run_statement(db, sql);
     cdb2_clearbindings(db);
     free_blobs(blobs_vect);
 
     if (rc != CDB2_OK) {
+        std::lock_guard<std::mutex> lk(out_lk);
         std::cerr << "run rc " << rc << ": " << cdb2_errstr(db) << std::endl;
-        return;
+        return false;
     }
 
-    /* TODO: have switch to print or not results */
     int ncols = cdb2_numcolumns(db);
     while ((rc = cdb2_next_record(db)) == CDB2_OK) {
+        if (quiet)
+            continue;
+        std::lock_guard<std::mutex> lk(out_lk);
         for (int col = 0; col < ncols; col++) {
             void *val = cdb2_column_value(db, col);
             if (val == NULL) {
@@ -498,9 +632,206 @@ void replay(cdb2_hndl_tp *db, cson_value *event_val) {
         std::cout << std::endl;
     }
     if (rc != CDB2_OK_DONE) {
+        std::lock_guard<std::mutex> lk(out_lk);
         std::cerr << "next rc " << rc << ": " << cdb2_errstr(db) << std::endl;
-        return;
+        return false;
+    }
+    return true;
+}
+
+/* Wait until a statement is due.  Returns how late it is, in us. */
+static int64_t pace(int64_t logged_time) {
+    if (!paced || logged_time == 0 || first_event_time == 0)
+        return 0;
+    int64_t due = replay_start +
+                  (int64_t)((logged_time - first_event_time) / speedup);
+    int64_t now = now_us();
+    if (due > now) {
+        std::this_thread::sleep_for(std::chrono::microseconds(due - now));
+        return 0;
     }
+    return now - due;
+}
+
+static void connection_thread(replay_connection *c) {
+    while (true) {
+        replay_work w;
+        {
+            std::unique_lock<std::mutex> lk(c->lk);
+            c->cv.wait(lk, [c] { return c->done || !c->queue.empty(); });
+            if (c->queue.empty())
+                break;
+            w = std::move(c->queue.front());
+            c->queue.pop_front();
+            c->cv.notify_all();
+        }
+
+        int64_t lag = pace(w.time);
+        if (lag > c->maxlag)
+            c->maxlag = lag;
+
+        int64_t start = now_us();
+        bool ok = replay(c->db, w.event, w.sql.c_str());
+        int64_t elapsed = now_us() - start;
+        cson_free_value(w.event);
+
+        fingerprint_stats &st = c->stats[w.fingerprint];
+        c->statements++;
+        if (ok) {
+            st.latency.add(elapsed);
+        } else {
+            st.errors++;
+            c->errors++;
+        }
+    }
+}
+
+static cdb2_hndl_tp *open_db() {
+    /* TODO: tier should be an option */
+    cdb2_hndl_tp *db = nullptr;
+    int rc;
+    char *conf = getenv("CDB2_CONFIG");
+    if (conf) {
+        cdb2_set_comdb2db_config(conf);
+        rc = cdb2_open(&db, dbname, "default", 0);
+    }
+    else { 
+        rc = cdb2_open(&db, dbname, "local", 0);
+    }
+
+    if (rc) {
+        std::cerr << "cdb2_open() failed: " << cdb2_errstr(db) << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    return db;
+}
+
+static void start_connections() {
+    for (int i = 0; i < nconnections; i++) {
+        replay_connection *c = new replay_connection;
+        c->db = open_db();
+        c->thd = std::thread(connection_thread, c);
+        connections.push_back(c);
+    }
+}
+
+static void stop_connections() {
+    for (auto c : connections) {
+        std::lock_guard<std::mutex> lk(c->lk);
+        c->done = true;
+        c->cv.notify_all();
+    }
+    for (auto c : connections)
+        c->thd.join();
+}
+
+/* Statements from one client handle keep their order on one connection.
+   The cnonce starts with the client's host id, pid and handle address
+   ("hostid-pid-handle-seq"), so everything up to the last '-' names the
+   original handle. */
+static replay_connection *connection_for(cson_value *event_val) {
+    if (connections.size() == 1)
+        return connections[0];
+    const char *cnonce = get_strprop(event_val, "cnonce");
+    if (cnonce == nullptr)
+        return connections[0];
+    std::string client(cnonce);
+    size_t pos = client.find_last_of('-');
+    if (pos != std::string::npos)
+        client.resize(pos);
+    return connections[std::hash<std::string>()(client) % connections.size()];
+}
+
+/* Hand a replayable sql event to its connection; takes ownership of it */
+void dispatch(cson_value *event_val) {
+    replay_work w;
+
+    const char *fp = get_strprop(event_val, "fingerprint");
+    const char *sql = get_strprop(event_val, "sql");
+    if (sql == nullptr) {
+        if (fp == nullptr) {
+            std::cerr << "No fingerprint logged?" << std::endl;
+            cson_free_value(event_val);
+            return;
+        }
+        auto s = sqltrack.find(fp);
+        if (s == sqltrack.end()) {
+            std::cerr << "Unknown fingerprint? " << fp << std::endl;
+            cson_free_value(event_val);
+            return;
+        }
+        sql = (*s).second.c_str();
+    }
+    w.sql = sql;
+    w.fingerprint = fp ? fp : "";
+    w.event = event_val;
+    if (!get_intprop(event_val, "time", &w.time))
+        w.time = 0;
+    if (w.time && first_event_time == 0) {
+        first_event_time = w.time;
+        replay_start = now_us();
+    }
+
+    replay_connection *c = connection_for(event_val);
+    std::unique_lock<std::mutex> lk(c->lk);
+    c->cv.wait(lk, [c] { return c->queue.size() < max_queued; });
+    c->queue.push_back(std::move(w));
+    c->cv.notify_all();
+}
+
+static void report(int64_t elapsed_us) {
+    std::map<std::string, fingerprint_stats> all;
+    uint64_t statements = 0, errors = 0;
+    int64_t maxlag = 0;
+
+    for (auto c : connections) {
+        for (auto &it : c->stats) {
+            fingerprint_stats &st = all[it.first];
+            st.latency.merge(it.second.latency);
+            st.errors += it.second.errors;
+        }
+        statements += c->statements;
+        errors += c->errors;
+        if (c->maxlag > maxlag)
+            maxlag = c->maxlag;
+    }
+
+    /* most total time first */
+    std::vector<std::pair<std::string, fingerprint_stats *>> order;
+    for (auto &it : all)
+        order.push_back(std::make_pair(it.first, &it.second));
+    std::sort(order.begin(), order.end(),
+              [](const std::pair<std::string, fingerprint_stats *> &a,
+                 const std::pair<std::string, fingerprint_stats *> &b) {
+                  return a.second->latency.sum_us() > b.second->latency.sum_us();
+              });
+
+    double secs = elapsed_us / 1000000.0;
+    printf("replayed %llu statements (%llu errors) on %d connection%s in "
+           "%.3f s, %.1f statements/s, max schedule lag %lld us\n",
+           (unsigned long long)statements, (unsigned long long)errors,
+           nconnections, nconnections == 1 ? "" : "s", secs,
+           secs > 0 ? statements / secs : 0.0, (long long)maxlag);
+    printf("%-32s %8s %6s %9s %9s %9s %9s %9s  (latency in us)\n",
+           "fingerprint", "count", "errors", "mean", "p50", "p99", "p999",
+           "max");
+    for (auto &it : order) {
+        const latency_histogram &h = it.second->latency;
+        printf("%-32s %8llu %6llu %9llu %9llu %9llu %9llu %9llu",
+               it.first.empty() ? "-" : it.first.c_str(),
+               (unsigned long long)h.count(),
+               (unsigned long long)it.second->errors,
+               (unsigned long long)h.mean(),
+               (unsigned long long)h.percentile(0.50),
+               (unsigned long long)h.percentile(0.99),
+               (unsigned long long)h.percentile(0.999),
+               (unsigned long long)h.max());
+        auto s = sqltrack.find(it.first);
+        if (s != sqltrack.end())
+            printf("  %.60s", s->second.c_str());
+        printf("\n");
+    }
+    fflush(stdout);
 }
 
 /* Event handlers.  Notes:
@@ -515,7 +846,7 @@ void replay(cdb2_hndl_tp *db, cson_value *event_val) {
      eliminate it.
   */
 
-void handle_sql(cdb2_hndl_tp *db, cson_value *event_val) {
+void handle_sql(cson_value *event_val) {
     int rc;
     /* We can only replay if we have the full SQL, including parameters.
        That means
@@ -540,17 +871,16 @@ void handle_sql(cdb2_hndl_tp *db, cson_value *event_val) {
 
 #if 0
     if (is_transactional(event_val)) {
-        add_to_transaction(db, event_val);
+        add_to_transaction(event_val);
         return;
     }
 #endif
     
-    replay(db, event_val);
-    cson_free_value(event_val);
+    dispatch(event_val);
 }
 
 /* TODO: error messages? */
-void handle_newsql(cdb2_hndl_tp *db, cson_value *val) {
+void handle_newsql(cson_value *val) {
     const char *sql = get_strprop(val, "sql");
     const char *fingerprint = get_strprop(val, "fingerprint");
 
@@ -572,11 +902,11 @@ void handle_newsql(cdb2_hndl_tp *db, cson_value *val) {
 }
 
 
-void handle_txn(cdb2_hndl_tp *db, cson_value *val) {
-    add_to_transaction(db, val);
+void handle_txn(cson_value *val) {
+    add_to_transaction(val);
 }
 
-typedef void (*event_handler)(cdb2_hndl_tp *db, cson_value *val);
+typedef void (*event_handler)(cson_value *val);
 std::map<std::string, event_handler> handlers;
     
 void init_handlers(void) {
@@ -585,17 +915,17 @@ void init_handlers(void) {
     handlers.insert(std::pair<std::string, event_handler>("txn", handle_txn));
 }
 
-void handle(cdb2_hndl_tp *db, const char *event, cson_value *event_val) {
+void handle(const char *event, cson_value *event_val) {
     auto h = handlers.find(event);
     if (h == handlers.end()) {
         cson_free_value(event_val);
         return;
     }
     else
-        h->second(db, event_val);
+        h->second(event_val);
 }
 
-void process_events(cdb2_hndl_tp *db, std::istream &in) {
+void process_events(std::istream &in) {
     std::string line;
     int linenum = 0;
 
@@ -618,7 +948,7 @@ void process_events(cdb2_hndl_tp *db, std::istream &in) {
         const char *type = get_strprop(event_val, "type");
 
         if (type != nullptr)
-            handle(cdb2h, type, event_val);
+            handle(type, event_val);
         else
             cson_free_value(event_val);
     }
@@ -626,37 +956,55 @@ void process_events(cdb2_hndl_tp *db, std::istream &in) {
 }
 
 int main(int argc, char **argv) {
-    char *dbname;
     char *filename = nullptr;
+    int c;
 
     init_handlers();
 
-    if (argc < 2) {
-        usage();
+    while ((c = getopt(argc, argv, "fps:j:qh")) != -1) {
+        switch (c) {
+        case 'f':
+            paced = false;
+            break;
+        case 'p':
+            paced = true;
+            break;
+        case 's':
+            paced = true;
+            speedup = atof(optarg);
+            if (speedup <= 0) {
+                std::cerr << "speedup must be positive" << std::endl;
+                usage();
+            }
+            break;
+        case 'j':
+            nconnections = atoi(optarg);
+            if (nconnections <= 0) {
+                std::cerr << "need at least one connection" << std::endl;
+                usage();
+            }
+            break;
+        case 'q':
+            quiet = true;
+            break;
+        default:
+            usage();
+        }
     }
-    dbname = argv[1];
-
-    if (argc >= 3)
-        filename = argv[2];
 
-    /* TODO: tier should be an option */
-    int rc;
-    char *conf = getenv("CDB2_CONFIG");
-    if (conf) {
-        cdb2_set_comdb2db_config(conf);
-        rc = cdb2_open(&cdb2h, dbname, "default", 0);
-    }
-    else { 
-        rc = cdb2_open(&cdb2h, dbname, "local", 0);
+    if (optind >= argc) {
+        usage();
     }
+    dbname = argv[optind];
 
-    if (rc) {
-        std::cerr << "cdb2_open() failed: " << cdb2_errstr(cdb2h) << std::endl;
-        exit(EXIT_FAILURE);
-    }
+    if (optind + 1 < argc)
+        filename = argv[optind + 1];
+
+    start_connections();
+    int64_t start = now_us();
 
     if (filename == nullptr) {
-        process_events(cdb2h, std::cin);
+        process_events(std::cin);
     }
     else {
         std::ifstream f;
@@ -666,9 +1014,11 @@ int main(int argc, char **argv) {
             return 1;
         }
 
-        process_events(cdb2h, f);
+        process_events(f);
     }
 
-    // cdb2_close(cdb2h);
+    stop_connections();
+    report(now_us() - start);
+
     return 0;
 }
@@ -0,0 +1,863 @@
+/*
+   Copyright 2019 Bloomberg Finance L.P.
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "comdb2ar.h"
+
+#include "chunked.h"
+#include "db_wrap.h"
+#include "error.h"
+#include "riia.h"
+#include "serialiseerror.h"
+
+#include <cassert>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+extern "C" {
+#include <unistd.h>
+}
+
+#include <lz4.h>
+
+#if defined(_AIX)
+#define DO_DIRECT O_DIRECT
+#elif defined (__linux__)
+#define DO_DIRECT O_DIRECT
+#else
+#define DO_DIRECT 0
+#endif
+
+const char CHUNK_SUFFIX[] = ".lz4chunk";
+
+// Every chunk entry starts with this header, all fields big endian.
+//   0  magic
+//   4  flags
+//   8  offset of the chunk in the original file
+//  16  uncompressed length
+//  20  stored length; equal to the uncompressed length if stored as is
+//  24  size of the original file (only meaningful on the last chunk)
+static const uint32_t CHUNK_MAGIC = 0x43484b31; /* "CHK1" */
+static const uint32_t CHUNK_LAST = 1;
+static const size_t CHUNK_HDR_LEN = 32;
+
+// Chunks waiting to be written (or restored) per worker thread.
+static const size_t CHUNKS_PER_THREAD = 4;
+
+struct chunk_header {
+    uint32_t flags;
+    uint64_t offset;
+    uint32_t rawlen;
+    uint32_t storedlen;
+    uint64_t filesize;
+};
+
+static void put32(uint8_t *p, uint32_t v)
+{
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+static void put64(uint8_t *p, uint64_t v)
+{
+    put32(p, v >> 32);
+    put32(p + 4, v);
+}
+
+static uint32_t get32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+           ((uint32_t)p[2] << 8) | p[3];
+}
+
+static uint64_t get64(const uint8_t *p)
+{
+    return ((uint64_t)get32(p) << 32) | get32(p + 4);
+}
+
+static void encode_chunk_header(uint8_t *p, const chunk_header& ch)
+{
+    put32(p, CHUNK_MAGIC);
+    put32(p + 4, ch.flags);
+    put64(p + 8, ch.offset);
+    put32(p + 16, ch.rawlen);
+    put32(p + 20, ch.storedlen);
+    put64(p + 24, ch.filesize);
+}
+
+static bool decode_chunk_header(const std::vector<uint8_t>& payload,
+        chunk_header& ch)
+{
+    if(payload.size() < CHUNK_HDR_LEN) {
+        return false;
+    }
+    const uint8_t *p = &payload[0];
+    if(get32(p) != CHUNK_MAGIC) {
+        return false;
+    }
+    ch.flags = get32(p + 4);
+    ch.offset = get64(p + 8);
+    ch.rawlen = get32(p + 16);
+    ch.storedlen = get32(p + 20);
+    ch.filesize = get64(p + 24);
+    return ch.storedlen == payload.size() - CHUNK_HDR_LEN &&
+           ch.storedlen <= ch.rawlen;
+}
+
+bool is_chunk_entry(std::string& filename)
+{
+    size_t len = sizeof(CHUNK_SUFFIX) - 1;
+    if(filename.length() <= len ||
+       filename.compare(filename.length() - len, len, CHUNK_SUFFIX) != 0) {
+        return false;
+    }
+    filename.resize(filename.length() - len);
+    return true;
+}
+
+
+// Serialise side
+
+struct OutChunk {
+    std::string filename;
+    struct stat st;
+    std::vector<uint8_t> data;     // chunk header followed by stored bytes
+    bool last;
+    unsigned long long nchunks;    // totals, set on the last chunk only
+    unsigned long long stored;
+    size_t pagesize;
+};
+
+class ChunkWriter {
+    std::list<FileInfo>& m_files;
+    std::list<FileInfo>::iterator m_next;
+    volatile iomap *m_iomap;
+    const std::string& m_incr_path;
+    bool m_incr_create;
+
+    std::mutex m_lk;
+    std::condition_variable m_writer_cv;
+    std::condition_variable m_worker_cv;
+    std::deque<std::unique_ptr<OutChunk> > m_queue;
+    size_t m_max_queued;
+    unsigned m_running;
+    unsigned long long m_files_started;
+    bool m_abort;
+    std::exception_ptr m_error;
+
+    void push(std::unique_ptr<OutChunk>& chunk);
+    void read_verified(int fd, FileInfo& file, uint8_t *buf, off_t offset,
+            size_t nbytes, std::ofstream& incr_file);
+    void compress_file(FileInfo& file, uint8_t *buf, size_t bufsize);
+    void worker();
+
+public:
+    ChunkWriter(std::list<FileInfo>& files, volatile iomap *iomap,
+            unsigned nthreads, const std::string& incr_path, bool incr_create)
+        : m_files(files), m_next(files.begin()), m_iomap(iomap),
+          m_incr_path(incr_path), m_incr_create(incr_create),
+          m_max_queued(nthreads * CHUNKS_PER_THREAD), m_running(0),
+          m_files_started(0), m_abort(false)
+    {
+    }
+
+    void run(unsigned nthreads, const std::function<void()>& on_file_start);
+};
+
+static void write_chunk_padding(size_t nbytes)
+{
+    static const char zeroes[512] = {0};
+    if(nbytes > 0 && writeall(1, zeroes, nbytes) != nbytes) {
+        std::ostringstream ss;
+        ss << "error writing zero padding: " << std::strerror(errno);
+        throw Error(ss);
+    }
+}
+
+static void write_chunk(const OutChunk& chunk)
+{
+    const std::string entry(chunk.filename + CHUNK_SUFFIX);
+    struct stat st = chunk.st;
+    st.st_size = chunk.data.size();
+
+    TarHeader head;
+    head.set_filename(entry);
+    head.set_attrs(st);
+    head.set_checksum();
+
+    if(writeall(1, head.get().c, sizeof(tar_block_header))
+            != sizeof(tar_block_header)) {
+        std::ostringstream ss;
+        ss << "error writing tar block header: " << std::strerror(errno);
+        throw SerialiseError(entry, ss.str());
+    }
+    if(writeall(1, &chunk.data[0], chunk.data.size()) != chunk.data.size()) {
+        std::ostringstream ss;
+        ss << "write error: " << std::strerror(errno);
+        throw SerialiseError(entry, ss.str());
+    }
+    size_t rem = chunk.data.size() & (512 - 1);
+    if(rem) {
+        write_chunk_padding(512 - rem);
+    }
+
+    if(chunk.last) {
+        std::clog << "a " << chunk.filename << " size=" << chunk.st.st_size
+                  << " pagesize=" << chunk.pagesize
+                  << " chunks=" << chunk.nchunks
+                  << " stored=" << chunk.stored << std::endl;
+    }
+}
+
+void ChunkWriter::push(std::unique_ptr<OutChunk>& chunk)
+{
+    std::unique_lock<std::mutex> lk(m_lk);
+    m_worker_cv.wait(lk, [this] {
+        return m_abort || m_queue.size() < m_max_queued;
+    });
+    if(m_abort) {
+        throw Error("chunk writer aborted");
+    }
+    m_queue.push_back(std::move(chunk));
+    m_writer_cv.notify_one();
+}
+
+void ChunkWriter::read_verified(int fd, FileInfo& file, uint8_t *buf,
+        off_t offset, size_t nbytes, std::ofstream& incr_file)
+// Read nbytes at offset and verify the page checksums, re-reading pages that
+// fail (they may have been caught mid-write) like serialise_file() does.
+{
+    const std::string& filename = file.get_filename();
+    size_t got = 0;
+    while(got < nbytes) {
+        ssize_t n = pread(fd, buf + got, nbytes - got, offset + got);
+        if(n <= 0) {
+            std::ostringstream ss;
+            if(n == 0) {
+                ss << "file shrank while being archived!";
+            } else {
+                ss << "read error at offset " << offset + got
+                   << " tried to read " << nbytes - got << " bytes "
+                   << std::strerror(errno);
+            }
+            throw SerialiseError(filename, ss.str());
+        }
+        got += n;
+    }
+
+    if(!file.get_checksums()) {
+        return;
+    }
+
+    size_t pagesize = file.get_pagesize();
+    for(size_t n = 0; n < nbytes; n += pagesize) {
+        int retry = 5;
+        while(true) {
+            bool verify_bool = false;
+            uint32_t verify_cksum;
+            verify_checksum(buf + n, pagesize, file.get_crypto(),
+                    file.get_swapped(), &verify_bool, &verify_cksum);
+            if(verify_bool) {
+                if(m_incr_create) {
+                    PAGE *pagep = (PAGE *) (buf + n);
+                    incr_file.write((char *) &(LSN(pagep).file), 4);
+                    incr_file.write((char *) &(LSN(pagep).offset), 4);
+                    incr_file.write((char *) &verify_cksum, 4);
+                }
+                break;
+            }
+
+            if(--retry == 0) {
+                throw SerialiseError(filename,
+                        "serialise_file:page failed checksum verification");
+            }
+
+            // wait 500ms before reading page again
+            poll(0, 0, 500);
+
+            size_t totalread = 0;
+            while(totalread < pagesize) {
+                ssize_t nread = pread(fd, buf + n + totalread,
+                        pagesize - totalread, offset + n + totalread);
+                if(nread <= 0) {
+                    std::ostringstream ss;
+                    ss << "serialise_file:read: " << std::strerror(errno);
+                    throw SerialiseError(filename, ss.str());
+                }
+                totalread += nread;
+            }
+        }
+    }
+}
+
+void ChunkWriter::compress_file(FileInfo& file, uint8_t *buf, size_t bufsize)
+{
+    const std::string& filename = file.get_filename();
+    int flags = O_RDONLY;
+    bool skip_iomap = false;
+    int num_waits = 0;
+
+    if(file.get_type() == FileInfo::BERKDB_FILE && file.get_direct_io())
+        flags |= DO_DIRECT;
+
+    int fd = open(file.get_filepath().c_str(), flags);
+    if(fd == -1 && errno == EINVAL && (flags & DO_DIRECT)) {
+        std::clog << "Turning off directio, err: " << std::strerror(errno)
+                  << std::endl;
+        flags ^= DO_DIRECT;
+        fd = open(file.get_filepath().c_str(), flags);
+    }
+    RIIA_fd fd_guard(fd);
+    if(fd == -1) {
+        if(errno == ENOENT) {
+            // Same as the serial path: files may go away intraday, recovery
+            // will complain if it was really needed.
+            std::clog << "Error opening file " << file.get_filepath()
+                      << ", err: " << std::strerror(errno) << std::endl;
+            return;
+        }
+        std::ostringstream ss;
+        ss << "cannot open file: " << std::strerror(errno);
+        throw SerialiseError(filename, ss.str());
+    }
+
+    struct stat st;
+    if(fstat(fd, &st) == -1) {
+        std::ostringstream ss;
+        ss << "cannot stat file: " << std::strerror(errno);
+        throw SerialiseError(filename, ss.str());
+    }
+    if(!S_ISREG(st.st_mode)) {
+        throw SerialiseError(filename, "not a regular file");
+    }
+
+    std::ofstream incr_file;
+    if(m_incr_create) {
+        incr_file.open(m_incr_path + "/" + filename + ".incr",
+                std::ofstream::binary | std::ofstream::trunc);
+    }
+
+    size_t pagesize = file.get_pagesize();
+    if(pagesize == 0) {
+        pagesize = 4096;
+    }
+
+    const off_t filesize = st.st_size;
+    off_t offset = 0;
+    unsigned long long nchunks = 0;
+    unsigned long long stored = 0;
+    const int bound = LZ4_compressBound(bufsize);
+
+    do {
+        while(!skip_iomap && m_iomap != NULL && m_iomap->memptrickle_time) {
+            int now = time(NULL);
+            if((now - m_iomap->memptrickle_time) > 5*60) {
+                std::clog << "long memptrickle ("
+                          << now - m_iomap->memptrickle_time
+                          << " seconds), continuing" << std::endl;
+                skip_iomap = true;
+                break;
+            }
+            num_waits++;
+            poll(0, 0, 100);
+        }
+
+        size_t nbytes = filesize - offset > (off_t) bufsize
+                            ? bufsize : filesize - offset;
+        if(nbytes) {
+            read_verified(fd, file, buf, offset, nbytes, incr_file);
+        }
+
+        std::unique_ptr<OutChunk> chunk(new OutChunk);
+        chunk->filename = filename;
+        chunk->st = st;
+        chunk->pagesize = pagesize;
+        chunk->data.resize(CHUNK_HDR_LEN + bound);
+
+        int clen = 0;
+        if(nbytes) {
+            clen = LZ4_compress_default((const char *) buf,
+                    (char *) &chunk->data[CHUNK_HDR_LEN], nbytes, bound);
+        }
+        if(clen <= 0 || clen >= (int) nbytes) {
+            // Incompressible (or empty): store as is
+            clen = nbytes;
+            if(nbytes) {
+                memcpy(&chunk->data[CHUNK_HDR_LEN], buf, nbytes);
+            }
+        }
+        chunk->data.resize(CHUNK_HDR_LEN + clen);
+
+        offset += nbytes;
+        nchunks++;
+        stored += clen;
+
+        chunk_header ch;
+        ch.flags = offset >= filesize ? CHUNK_LAST : 0;
+        ch.offset = offset - nbytes;
+        ch.rawlen = nbytes;
+        ch.storedlen = clen;
+        ch.filesize = filesize;
+        encode_chunk_header(&chunk->data[0], ch);
+
+        chunk->last = (ch.flags & CHUNK_LAST) != 0;
+        chunk->nchunks = nchunks;
+        chunk->stored = stored;
+        push(chunk);
+    } while(offset < filesize);
+
+    file.set_filesize(filesize);
+
+    if(num_waits) {
+        std::clog << "paused " << num_waits
+                  << " times because db is busy writing." << std::endl;
+    }
+}
+
+void ChunkWriter::worker()
+{
+    uint8_t *buf = NULL;
+    try {
+        if(posix_memalign((void **) &buf, 512, MAX_BUF_SIZE)) {
+            throw Error("Failed to allocate chunk buffer");
+        }
+        RIIA_malloc free_guard(buf);
+
+        while(true) {
+            std::list<FileInfo>::iterator it;
+            {
+                std::lock_guard<std::mutex> lk(m_lk);
+                if(m_abort || m_next == m_files.end()) {
+                    break;
+                }
+                it = m_next++;
+                m_files_started++;
+                m_writer_cv.notify_one();
+            }
+
+            // Keep chunks page aligned so pages are verified whole
+            size_t pagesize = it->get_pagesize() ? it->get_pagesize() : 4096;
+            size_t bufsize = MAX_BUF_SIZE - (MAX_BUF_SIZE % pagesize);
+            compress_file(*it, buf, bufsize);
+        }
+    } catch(...) {
+        std::lock_guard<std::mutex> lk(m_lk);
+        if(!m_error) {
+            m_error = std::current_exception();
+        }
+        m_abort = true;
+        m_worker_cv.notify_all();
+    }
+
+    std::lock_guard<std::mutex> lk(m_lk);
+    m_running--;
+    m_writer_cv.notify_one();
+}
+
+void ChunkWriter::run(unsigned nthreads,
+        const std::function<void()>& on_file_start)
+{
+    std::vector<std::thread> threads;
+    unsigned long long seen = 0;
+
+    m_running = nthreads;
+    for(unsigned i = 0; i < nthreads; i++) {
+        threads.push_back(std::thread(&ChunkWriter::worker, this));
+    }
+
+    try {
+        std::unique_lock<std::mutex> lk(m_lk);
+        while(true) {
+            m_writer_cv.wait(lk, [&] {
+                return m_abort || !m_queue.empty() || m_running == 0 ||
+                       m_files_started != seen;
+            });
+            if(m_abort) {
+                break;
+            }
+
+            // Serialise and release completed logs before each new file,
+            // as the serial path does.
+            if(m_files_started != seen) {
+                seen = m_files_started;
+                lk.unlock();
+                on_file_start();
+                lk.lock();
+                continue;
+            }
+
+            if(m_queue.empty()) {
+                if(m_running == 0) {
+                    break;
+                }
+                continue;
+            }
+
+            std::unique_ptr<OutChunk> chunk(std::move(m_queue.front()));
+            m_queue.pop_front();
+            m_worker_cv.notify_one();
+
+            lk.unlock();
+            write_chunk(*chunk);
+            lk.lock();
+        }
+    } catch(...) {
+        {
+            std::lock_guard<std::mutex> lk(m_lk);
+            m_abort = true;
+            m_worker_cv.notify_all();
+        }
+        for(size_t i = 0; i < threads.size(); i++) {
+            threads[i].join();
+        }
+        throw;
+    }
+
+    for(size_t i = 0; i < threads.size(); i++) {
+        threads[i].join();
+    }
+    if(m_error) {
+        std::rethrow_exception(m_error);
+    }
+}
+
+void serialise_data_files_parallel(
+    std::list<FileInfo>& files,
+    volatile iomap *iomap,
+    unsigned nthreads,
+    const std::string& incr_path,
+    bool incr_create,
+    const std::function<void()>& on_file_start
+)
+{
+    if(nthreads == 0) {
+        nthreads = 1;
+    }
+    ChunkWriter writer(files, iomap, nthreads, incr_path, incr_create);
+    writer.run(nthreads, on_file_start);
+}
+
+
+// Deserialise side
+
+struct RestoreFile {
+    std::string path;
+    int fd;
+    size_t pagesize;
+    bool sparse;
+    unsigned long long queued;
+    unsigned long long done;
+    bool have_last;
+    uint64_t filesize;
+    uid_t uid;
+    gid_t gid;
+    mode_t mode;
+};
+
+struct RestoreJob {
+    std::shared_ptr<RestoreFile> file;
+    chunk_header ch;
+    std::vector<uint8_t> payload;
+};
+
+struct ChunkRestore_impl {
+    std::mutex lk;
+    std::condition_variable cv;
+    std::deque<std::unique_ptr<RestoreJob> > queue;
+    std::map<std::string, std::shared_ptr<RestoreFile> > files;
+    std::vector<std::thread> threads;
+    unsigned nthreads;
+    size_t max_queued;
+    unsigned active;
+    bool stop;
+    std::exception_ptr error;
+
+    void worker();
+    void apply(RestoreJob& job, std::vector<uint8_t>& buf);
+    void complete(RestoreFile& file);
+    void shutdown();
+};
+
+static void pwriteall(const RestoreFile& file, const uint8_t *buf, size_t len,
+        uint64_t offset)
+{
+    while(len > 0) {
+        ssize_t n = pwrite(file.fd, buf, len, offset);
+        if(n <= 0) {
+            std::ostringstream ss;
+            ss << "Error writing " << file.path << " at offset " << offset
+               << ": " << std::strerror(errno);
+            throw Error(ss);
+        }
+        buf += n;
+        len -= n;
+        offset += n;
+    }
+}
+
+void ChunkRestore_impl::apply(RestoreJob& job, std::vector<uint8_t>& buf)
+{
+    const RestoreFile& file = *job.file;
+    const chunk_header& ch = job.ch;
+    const uint8_t *data = &job.payload[CHUNK_HDR_LEN];
+
+    if(ch.rawlen == 0) {
+        return;
+    }
+    if(ch.storedlen < ch.rawlen) {
+        if(buf.size() < ch.rawlen) {
+            buf.resize(ch.rawlen);
+        }
+        int n = LZ4_decompress_safe((const char *) data, (char *) &buf[0],
+                ch.storedlen, ch.rawlen);
+        if(n != (int) ch.rawlen) {
+            std::ostringstream ss;
+            ss << "Error decompressing chunk of " << file.path
+               << " at offset " << ch.offset;
+            throw Error(ss);
+        }
+        data = &buf[0];
+    }
+
+    if(!file.sparse) {
+        pwriteall(file, data, ch.rawlen, ch.offset);
+        return;
+    }
+
+    // Leave all-zero pages as holes; the file is sized once complete
+    static const uint8_t zeroes[65536] = {0};
+    size_t pagesize = file.pagesize;
+    if(pagesize == 0 || pagesize > sizeof(zeroes)) {
+        pwriteall(file, data, ch.rawlen, ch.offset);
+        return;
+    }
+    for(size_t off = 0; off < ch.rawlen; off += pagesize) {
+        size_t len = ch.rawlen - off < pagesize ? ch.rawlen - off : pagesize;
+        if(memcmp(data + off, zeroes, len) != 0) {
+            pwriteall(file, data + off, len, ch.offset + off);
+        }
+    }
+}
+
+void ChunkRestore_impl::complete(RestoreFile& file)
+// Called with lk held once every chunk of file has been written
+{
+    if(ftruncate(file.fd, file.filesize) == -1) {
+        std::ostringstream ss;
+        ss << "Error sizing " << file.path << ": " << std::strerror(errno);
+        throw Error(ss);
+    }
+    if(fchown(file.fd, file.uid, file.gid) == -1)
+        perror(file.path.c_str());
+    if(fchmod(file.fd, file.mode) == -1)
+        perror(file.path.c_str());
+    if(close(file.fd) == -1) {
+        std::ostringstream ss;
+        ss << "Error closing " << file.path << ": " << std::strerror(errno);
+        throw Error(ss);
+    }
+    file.fd = -1;
+
+    std::clog << "x " << file.path << " size=" << file.filesize
+              << " chunks=" << file.queued << std::endl;
+    files.erase(file.path);
+}
+
+void ChunkRestore_impl::worker()
+{
+    std::vector<uint8_t> buf;
+    std::unique_lock<std::mutex> lk(this->lk);
+
+    while(true) {
+        cv.wait(lk, [this] { return stop || !queue.empty(); });
+        if(queue.empty()) {
+            break;
+        }
+        std::unique_ptr<RestoreJob> job(std::move(queue.front()));
+        queue.pop_front();
+        active++;
+        cv.notify_all();
+        lk.unlock();
+
+        try {
+            apply(*job, buf);
+            lk.lock();
+            RestoreFile& file = *job->file;
+            file.done++;
+            if(file.have_last && file.done == file.queued) {
+                complete(file);
+            }
+        } catch(...) {
+            if(!lk.owns_lock()) {
+                lk.lock();
+            }
+            if(!error) {
+                error = std::current_exception();
+            }
+            stop = true;
+            queue.clear();
+        }
+        active--;
+        cv.notify_all();
+    }
+}
+
+void ChunkRestore_impl::shutdown()
+{
+    {
+        std::lock_guard<std::mutex> g(lk);
+        stop = true;
+        cv.notify_all();
+    }
+    for(size_t i = 0; i < threads.size(); i++) {
+        threads[i].join();
+    }
+    threads.clear();
+}
+
+ChunkRestore::ChunkRestore(unsigned nthreads) : impl(new ChunkRestore_impl)
+{
+    if(nthreads == 0) {
+        nthreads = 1;
+    }
+    impl->nthreads = nthreads;
+    impl->max_queued = nthreads * CHUNKS_PER_THREAD;
+    impl->active = 0;
+    impl->stop = false;
+}
+
+ChunkRestore::~ChunkRestore()
+{
+    impl->shutdown();
+    for(std::map<std::string, std::shared_ptr<RestoreFile> >::iterator
+            it = impl->files.begin(); it != impl->files.end(); ++it) {
+        if(it->second->fd != -1) {
+            close(it->second->fd);
+        }
+    }
+}
+
+uint64_t ChunkRestore::raw_length(const std::vector<uint8_t>& payload)
+{
+    chunk_header ch;
+    if(!decode_chunk_header(payload, ch)) {
+        return payload.size();
+    }
+    return ch.rawlen;
+}
+
+void ChunkRestore::add(const std::string& outpath,
+        const tar_block_header& head, size_t pagesize, bool sparse,
+        std::vector<uint8_t>& payload)
+{
+    std::unique_ptr<RestoreJob> job(new RestoreJob);
+    if(!decode_chunk_header(payload, job->ch)) {
+        throw Error("Bad chunk entry for " + outpath);
+    }
+    job->payload.swap(payload);
+
+    std::unique_lock<std::mutex> lk(impl->lk);
+
+    // Workers are only started once the stream turns out to be chunked
+    if(impl->threads.empty() && !impl->stop) {
+        for(unsigned i = 0; i < impl->nthreads; i++) {
+            impl->threads.push_back(
+                    std::thread(&ChunkRestore_impl::worker, impl.get()));
+        }
+    }
+
+    impl->cv.wait(lk, [this] {
+        return impl->stop || impl->queue.size() < impl->max_queued;
+    });
+    if(impl->error) {
+        std::rethrow_exception(impl->error);
+    }
+
+    std::shared_ptr<RestoreFile>& file = impl->files[outpath];
+    if(!file) {
+        int fd = open(outpath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        if(fd == -1) {
+            impl->files.erase(outpath);
+            std::ostringstream ss;
+            ss << "Error opening " << outpath << " for writing: "
+               << std::strerror(errno);
+            throw Error(ss);
+        }
+        file = std::make_shared<RestoreFile>();
+        file->path = outpath;
+        file->fd = fd;
+        file->pagesize = pagesize;
+        file->sparse = sparse;
+        file->queued = 0;
+        file->done = 0;
+        file->have_last = false;
+        file->filesize = 0;
+    }
+    if(file->have_last) {
+        throw Error("Chunk after last chunk of " + outpath);
+    }
+    if(job->ch.flags & CHUNK_LAST) {
+        file->have_last = true;
+        file->filesize = job->ch.filesize;
+        file->uid = (uid_t)strtol(head.h.uid, NULL, 8);
+        file->gid = (gid_t)strtol(head.h.gid, NULL, 8);
+        file->mode = (mode_t)strtol(head.h.mode, NULL, 8);
+    }
+    file->queued++;
+    job->file = file;
+
+    impl->queue.push_back(std::move(job));
+    impl->cv.notify_all();
+}
+
+void ChunkRestore::finish()
+{
+    {
+        std::unique_lock<std::mutex> lk(impl->lk);
+        impl->cv.wait(lk, [this] {
+            return impl->stop ||
+                   (impl->queue.empty() && impl->active == 0);
+        });
+    }
+    impl->shutdown();
+
+    if(impl->error) {
+        std::rethrow_exception(impl->error);
+    }
+    if(!impl->files.empty()) {
+        std::ostringstream ss;
+        ss << "Stream ended before the last chunk of "
+           << impl->files.begin()->first;
+        throw Error(ss);
+    }
+}
@@ -0,0 +1,88 @@
+/*
+   Copyright 2019 Bloomberg Finance L.P.
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef INCLUDED_CHUNKED
+#define INCLUDED_CHUNKED
+
+// Chunked archive format.  Instead of one tar entry per data file, each data
+// file is cut into chunks of up to MAX_BUF_SIZE bytes which are LZ4
+// compressed independently and written as their own tar entries named
+// "<filename>.lz4chunk".  Every entry starts with a small header giving the
+// offset of the chunk in the original file, so chunks of different files may
+// be interleaved in the stream and can be written back in any order.  The
+// archive is still a valid tar stream; only data files are chunked.
+
+#include <stdint.h>
+
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "file_info.h"
+#include "tar_header.h"
+
+struct iomap;
+
+extern const char CHUNK_SUFFIX[];
+
+void serialise_data_files_parallel(
+    std::list<FileInfo>& files,
+    volatile iomap *iomap,
+    unsigned nthreads,
+    const std::string& incr_path,
+    bool incr_create,
+    const std::function<void()>& on_file_start
+);
+// Read, checksum verify and compress the given data files on a pool of
+// nthreads workers and write them to stdout as chunk entries.  All output
+// happens on the calling thread; on_file_start is called on that thread
+// each time a worker moves on to a new file so that the caller can
+// interleave log files exactly as the serial path does.
+
+bool is_chunk_entry(std::string& filename);
+// If filename names a chunk entry, strip the chunk suffix in place and
+// return true.
+
+struct ChunkRestore_impl;
+
+class ChunkRestore {
+// Decompresses chunk entries read from the stream and writes them into
+// their destination files on a pool of worker threads.  Files are closed,
+// sized and given their permissions once their last chunk is written.
+
+    std::unique_ptr<ChunkRestore_impl> impl;
+
+public:
+    ChunkRestore(unsigned nthreads);
+    ~ChunkRestore();
+
+    void add(const std::string& outpath, const tar_block_header& head,
+             size_t pagesize, bool sparse, std::vector<uint8_t>& payload);
+    // Queue a chunk entry for outpath.  payload is consumed.  Blocks if too
+    // many chunks are already queued.
+
+    static uint64_t raw_length(const std::vector<uint8_t>& payload);
+    // Return the uncompressed length of a chunk entry, used to check for
+    // disk space before queueing it.
+
+    void finish();
+    // Wait for all queued chunks to be written.  Rethrows the first error
+    // hit by any worker, and throws if a file is missing its last chunk.
+};
+
+#endif // INCLUDED_CHUNKED
@@ -35,6 +35,8 @@ const char *help_text[] = {
 "  Database mydb is serialised into tape archive format on to stdout.",
 "  -s   serialise support files only (lrl, csc2 etc, no data or log files)",
 "  -L   do not disable log file deletion (dangerous)",
+"  -j N read and LZ4 compress data files on N threads; the output uses",
+"       the chunked format which needs a comdb2ar with -j support to restore",
 "",
 "To deserialise a db: comdb2ar.tsk [opts] x [/bb/bin /bb/data/mydb] < input",
 "To deserialise a db incrementally:",
@@ -60,6 +62,7 @@ const char *help_text[] = {
 "  -D           turn off directio",
 "  -E dbname    create replicant with dbname",
 "  -T type      override physrep type",
+"  -j N         restore chunked data files on N threads (default 1)",
 NULL
 };
 
@@ -111,6 +114,7 @@ int main(int argc, char *argv[])
     bool incr_path_specified = false;
     bool dryrun = false;
     bool copy_physical = false;
+    unsigned parallel_threads = 0;
 
     std::string new_db_name = "";
     std::string new_type = "default";
@@ -127,7 +131,7 @@ int main(int argc, char *argv[])
     ss << root << "/bin/comdb2";
     std::string comdb2_task(ss.str());
 
-    while((c = getopt(argc, argv, "hsSLC:I:b:x:u:rRSkKfODE:T:")) != EOF) {
+    while((c = getopt(argc, argv, "hsSLC:I:b:x:u:rRSkKfODE:T:j:")) != EOF) {
         switch(c) {
             case 'O':
                 legacy_mode = true;
@@ -230,6 +234,15 @@ int main(int argc, char *argv[])
                 new_type = std::string(optarg);
                 break;
 
+            case 'j':
+                if(std::atoi(optarg) < 0) {
+                    std::cerr << "Invalid thread count for -j: " << optarg
+                        << std::endl;
+                    std::exit(2);
+                }
+                parallel_threads = std::atoi(optarg);
+                break;
+
             case '?':
                 std::cerr << "Unrecognised option: -" << (char)c << std::endl;
                 usage();
@@ -307,7 +320,8 @@ int main(int argc, char *argv[])
                 incr_create,
                 incr_gen,
                 copy_physical,
-                incr_path
+                incr_path,
+                parallel_threads
             );
         } catch(std::exception& e) {
             std::cerr << e.what() << std::endl;
@@ -348,7 +362,8 @@ int main(int argc, char *argv[])
              is_disk_full,
              run_with_done_file,
              incr_ex,
-             dryrun
+             dryrun,
+             parallel_threads
            );
         } catch(std::exception& e) {
             std::cerr << e.what() << std::endl;
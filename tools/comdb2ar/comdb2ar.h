@@ -110,13 +110,16 @@ void serialise_database(
   bool incr_create,
   bool incr_gen,
   bool copy_physical,
-  const std::string& incr_path
+  const std::string& incr_path,
+  unsigned parallel_threads
 );
 // Serialise a database into tape archive format and write it to stdout.
 // If support_only is true then only support files (lrl and schema) will
 // be serialised.  If disable_log_deletion and the database is running then
 // it will be advised to hold log file deletion until the backup is complete
 // (highly recommended!)
+// If parallel_threads is non-zero then data files are read, verified and
+// LZ4 compressed on that many threads and written as chunk entries.
 // If legacy_mode is enabled, old file format are not removed after restore
 
 
@@ -133,7 +136,8 @@ void deserialise_database(
   bool& is_disk_full,
   bool run_with_done_file,
   bool incr_mode,
-  bool dryrun
+  bool dryrun,
+  unsigned parallel_threads
 );
 // Deserialise a database from serialised form received on stdin.
 // If lrldestdir and datadestdir are not NULL then the lrl and data files
@@ -144,7 +148,8 @@ void deserialise_database(
 // true then full recovery is run on the resulting database using the binary
 // given by comdb2_task.  If the destination disk reaches or exceeds the
 // specified percent_full during the deserialisation then the operation is
-// halted.
+// halted.  Chunk entries written by a parallel serialisation are restored
+// on parallel_threads threads (at least one).
 
 bool isDirectory(const std::string& file);
 
@@ -1,6 +1,7 @@
 #include <cstring>
 
 #include "comdb2ar.h"
+#include "chunked.h"
 #include "error.h"
 #include "file_info.h"
 #include "fdostream.h"
@@ -156,6 +157,9 @@ static void process_manifest(
                 while (ss >> tok) {
                     options.push_back(tok);
                 }
+            } else if (tok == "Chunked") {
+                // Data files come as chunk entries; nothing to set up as
+                // they are recognised by name
             } else {
                 std::clog << "Unknown directive '" << tok << "' on line "
                     << lineno << " of MANIFEST" << std::endl;
@@ -368,7 +372,8 @@ void deserialise_database(
         bool& is_disk_full,
         bool run_with_done_file,
         bool incr_mode,
-        bool dryrun
+        bool dryrun,
+        unsigned parallel_threads
 )
 // Deserialise a database from serialised from received on stdin.
 // If lrldestdir and datadestdir are not NULL then the lrl and data files
@@ -434,6 +439,9 @@ void deserialise_database(
     // The manifest map
     std::map<std::string, FileInfo> manifest_map;
 
+    // Writes out chunk entries from a parallel serialisation
+    ChunkRestore chunk_restore(parallel_threads);
+
     if (run_with_done_file)
     {
        /* remove the DONE file before we start copying */
@@ -510,6 +518,7 @@ void deserialise_database(
         // Alternativelyh, if we're running in incremental mode, then
         // we know we are moving on the the incremental backups
         if(std::memcmp(head.c, zero_head, 512) == 0) {
+            chunk_restore.finish();
             if(incr_mode){
                 std::clog << "Done with base backup, moving on to increments"
                           << std::endl << std::endl;
@@ -536,7 +545,11 @@ void deserialise_database(
         if(head.h.filename[sizeof(head.h.filename) - 1] != '\0') {
             throw Error("Bad block: filename is not null terminated");
         }
-        const std::string filename(head.h.filename);
+        std::string filename(head.h.filename);
+
+        // Chunk entries are looked up under the name of the file they
+        // belong to
+        const bool is_chunk = is_chunk_entry(filename);
 
         // Try to find this file in our manifest
         std::map<std::string, FileInfo>::const_iterator manifest_it = manifest_map.find(filename);
@@ -600,6 +613,51 @@ void deserialise_database(
             }
         }
 
+        if(is_chunk) {
+            if(datadestdir.empty()) {
+                throw Error("Stream contains files for data directory before data dir is known");
+            }
+
+            std::vector<uint8_t> payload(nblocks << 9);
+            if(readall(0, &payload[0], payload.size()) != payload.size()) {
+                std::ostringstream ss;
+                ss << "Error reading chunk of " << filename << ": "
+                    << errno << " " << strerror(errno);
+                throw Error(ss);
+            }
+            payload.resize(filesize);
+
+            struct statvfs stfs;
+            if(statvfs(datadestdir.c_str(), &stfs) == -1) {
+                std::ostringstream ss;
+                ss << "Error running statvfs on " << datadestdir
+                    << ": " << strerror(errno);
+                throw Error(ss);
+            }
+            fsblkcnt_t fsblocks = ChunkRestore::raw_length(payload) / stfs.f_bsize;
+            double percent_free = 100.00 * ((double)(stfs.f_bavail - fsblocks) / (double)stfs.f_blocks);
+            if(100.00 - percent_free >= percent_full) {
+                is_disk_full = true;
+                std::ostringstream ss;
+                ss << "Not enough space to deserialise " << filename
+                    << " - would leave only " << percent_free
+                    << "% free space";
+                throw Error(ss);
+            }
+
+            size_t pagesize = 0;
+            bool sparse = false;
+            if(manifest_it != manifest_map.end()) {
+                pagesize = manifest_it->second.get_pagesize();
+                sparse = manifest_it->second.get_sparse();
+            }
+
+            std::string outfilename(datadestdir + "/" + filename);
+            extracted_files.insert(outfilename);
+            chunk_restore.add(outfilename, head, pagesize, sparse, payload);
+            continue;
+        }
+
         std::unique_ptr<fdostream> of_ptr;
 
         if(is_text) {
@@ -1,5 +1,6 @@
 #include "comdb2ar.h"
 
+#include "chunked.h"
 #include "db_wrap.h"
 #include "error.h"
 #include "file_info.h"
@@ -740,13 +741,16 @@ void serialise_database(
   bool incr_create,
   bool incr_gen,
   bool copy_physical,
-  const std::string& incr_path
+  const std::string& incr_path,
+  unsigned parallel_threads
 )
 // Serialise a database into tape archive format and write it to stdout.
 // If support_only is true then only support files (lrl and schema) will
 // be serialised.  If disable_log_deletion and the database is running then
 // it will be advised to hold log file deletion until the backup is complete
 // (highly recommended!)
+// If parallel_threads is non-zero then data files are read and compressed
+// on that many threads and written in the chunked format (see chunked.h).
 {
     std::string dbname;
     std::string dbdir;
@@ -1160,6 +1164,11 @@ void serialise_database(
                 write_manifest_entry(manifest, *it);
         }
 
+        // Informational; chunk entries are recognised by name on restore
+        if(parallel_threads && !support_files_only) {
+            manifest << "Chunked lz4" << std::endl;
+        }
+
         // Find a recovery point after the copy, and record it in the manifest
         if (!support_files_only) {
             std::clog << "logdelete version " << log_holder->version() << std::endl;
@@ -1343,32 +1352,61 @@ void serialise_database(
         if(!support_files_only) {
 
             long long log_number(lowest_log);
-            for(std::list<FileInfo>::iterator
-                    it = data_files.begin();
-                    it != data_files.end();
-                    ++it) {
-
-                // First, serialise any complete log files that are in the .txn
-                // directory and notify the running database that they can now be
-                // archived.
-                long long old_log_number(log_number);
-                serialise_log_files(dbtxndir, dbdir, dbname, repl_name, 
-                        copy_physical && !nonames, log_number, true);
-                if(log_number != old_log_number && log_holder.get()) {
-                    log_holder->release_log(log_number - 1);
-                }
 
-                // Ok, now serialise this file.
-                // change names if necessary
+            if(parallel_threads) {
                 if (copy_physical && !nonames)
                 {
-                    if (is_changeable_file(it->get_filename()))
-                    {
-                        replace_file_name(*it, repl_name, dbname);
+                    for(std::list<FileInfo>::iterator
+                            it = data_files.begin();
+                            it != data_files.end();
+                            ++it) {
+                        if (is_changeable_file(it->get_filename()))
+                        {
+                            replace_file_name(*it, repl_name, dbname);
+                        }
                     }
                 }
 
-                serialise_file(*it, iom, "", incr_path, incr_create);
+                // Logs are still written (and released) only from this
+                // thread, between chunks, whenever a worker starts a file.
+                serialise_data_files_parallel(data_files, iom,
+                        parallel_threads, incr_path, incr_create,
+                        [&]() {
+                    long long old_log_number(log_number);
+                    serialise_log_files(dbtxndir, dbdir, dbname, repl_name,
+                            copy_physical && !nonames, log_number, true);
+                    if(log_number != old_log_number && log_holder.get()) {
+                        log_holder->release_log(log_number - 1);
+                    }
+                });
+            } else {
+                for(std::list<FileInfo>::iterator
+                        it = data_files.begin();
+                        it != data_files.end();
+                        ++it) {
+
+                    // First, serialise any complete log files that are in the .txn
+                    // directory and notify the running database that they can now be
+                    // archived.
+                    long long old_log_number(log_number);
+                    serialise_log_files(dbtxndir, dbdir, dbname, repl_name, 
+                            copy_physical && !nonames, log_number, true);
+                    if(log_number != old_log_number && log_holder.get()) {
+                        log_holder->release_log(log_number - 1);
+                    }
+
+                    // Ok, now serialise this file.
+                    // change names if necessary
+                    if (copy_physical && !nonames)
+                    {
+                        if (is_changeable_file(it->get_filename()))
+                        {
+                            replace_file_name(*it, repl_name, dbname);
+                        }
+                    }
+
+                    serialise_file(*it, iom, "", incr_path, incr_create);
+                }
             }
 
             // Serialise all remaining log files, including incomplete ones
@@ -682,6 +682,23 @@ ssl_downgrade:
     return n;
 }
 
+int SBUF2_FUNC(sbuf2rpending)(SBUF2 *sb)
+{
+    int n = 0;
+    if (sb == NULL)
+        return -1;
+#if SBUF2_UNGETC
+    n += sb->ungetc_buf_len;
+#endif
+    if (sb->rbuf != NULL && sb->rhd > sb->rtl)
+        n += sb->rhd - sb->rtl;
+#if WITH_SSL
+    if (sb->ssl != NULL)
+        n += SSL_pending(sb->ssl);
+#endif
+    return n;
+}
+
 void SBUF2_FUNC(sbuf2settimeout)(SBUF2 *sb, int readtimeout, int writetimeout)
 {
     sb->readtimeout = readtimeout;